@@ -3,6 +3,7 @@ import json
 import time
 import logging
 import os
+import socket
 from typing import List, Dict, Any, Optional
 from datetime import datetime
 
@@ -57,7 +58,8 @@ logger = logging.getLogger(__name__)
 # ============================
 SERVICE_PORT = int(os.getenv("SERVICE_PORT", "18000"))
 SERVICE_HOST = os.getenv("SERVICE_HOST", "127.0.0.1")
-MODEL_PATH = os.getenv("MODEL_PATH", "yolov8n.pt")
+SERVICE_UNIX_SOCKET = os.getenv("SERVICE_UNIX_SOCKET", "")  # Also serve HTTP on this Unix socket (same host plugin)
+MODEL_PATH = os.getenv("MODEL_PATH", "yolov8n.pt")  # .pt, or .onnx (FP32 or INT8 from tools/quantize_model.py)
 CONFIDENCE_THRESHOLD = float(os.getenv("CONFIDENCE_THRESHOLD", "0.35"))  # Optimized: 35% catches small people better
 IOU_THRESHOLD = float(os.getenv("IOU_THRESHOLD", "0.45"))  # IoU for NMS
 MIN_DETECTION_AREA = int(os.getenv("MIN_DETECTION_AREA", "20"))  # Catch even small people at distance
@@ -80,6 +82,12 @@ FALL_CONFIDENCE_THRESHOLD = float(os.getenv("FALL_CONFIDENCE_THRESHOLD", "0.8"))
 ENABLE_CLAHE = os.getenv("ENABLE_CLAHE", "true").lower() == "true"
 ENABLE_MULTI_SCALE = os.getenv("ENABLE_MULTI_SCALE", "true").lower() == "true"
 ENABLE_FRAME_ENHANCEMENT = os.getenv("ENABLE_FRAME_ENHANCEMENT", "false").lower() == "true"
+# Tiling: overlapping TILE_SIZE tiles batched with the whole frame, instead of a bigger YOLO_IMGSZ
+ENABLE_TILING = os.getenv("ENABLE_TILING", "false").lower() == "true"  # Replaces multi-scale when on
+TILE_SIZE = int(os.getenv("TILE_SIZE", "640"))  # Model's native size (the native service uses YOLO_IMGSZ)
+TILE_OVERLAP = min(max(float(os.getenv("TILE_OVERLAP", "0.2")), 0.0), 0.5)  # Fraction shared with each neighbor
+TILE_FULL_SCAN_INTERVAL = max(1, int(os.getenv("TILE_FULL_SCAN_INTERVAL", "10")))  # All tiles every N frames
+TILE_ACTIVITY_TTL = float(os.getenv("TILE_ACTIVITY_TTL", "3.0"))  # Seconds a detection keeps its tiles on
 CLAHE_CLIP_LIMIT = float(os.getenv("CLAHE_CLIP_LIMIT", "2.0"))
 CLAHE_TILE_SIZE = int(os.getenv("CLAHE_TILE_SIZE", "16"))
 SAVE_DEBUG_SAMPLES = os.getenv("SAVE_DEBUG_SAMPLES", "false").lower() == "true"
@@ -118,6 +126,8 @@ logger.info(f"YOLOv8 People Analytics Service")
 logger.info(f"="*60)
 logger.info(f"Port: {SERVICE_PORT}")
 logger.info(f"Host: {SERVICE_HOST}")
+if SERVICE_UNIX_SOCKET:
+    logger.info(f"Unix socket: {SERVICE_UNIX_SOCKET}")
 logger.info(f"Model: {MODEL_PATH}")
 logger.info(f"Confidence: {CONFIDENCE_THRESHOLD}")
 logger.info(f"IOU: {IOU_THRESHOLD}")
@@ -125,6 +135,13 @@ logger.info(f"ImgSize: {YOLO_IMGSZ}")
 logger.info(f"="*60)
 logger.info(f"CLAHE: {ENABLE_CLAHE}")
 logger.info(f"Multi-Scale: {ENABLE_MULTI_SCALE}")
+logger.info(f"Tiling: {ENABLE_TILING}" + (
+    f" ({TILE_SIZE}px, overlap={TILE_OVERLAP}, full scan every {TILE_FULL_SCAN_INTERVAL} frames)"
+    if ENABLE_TILING else ""))
+if ENABLE_TILING:
+    # The plugin downscales frames to its encodeWidth camera setting, 640 px by default.
+    logger.warning(f"Tiling only splits frames larger than {TILE_SIZE}px; "
+                   f"raise encodeWidth in the plugin's camera settings above it")
 logger.info(f"Frame Enhancement: {ENABLE_FRAME_ENHANCEMENT}")
 logger.info(f"ROI: {ENABLE_ROI} (type={ROI_TYPE})")
 logger.info(f"Undistort: {ENABLE_UNDISTORT}")
@@ -161,7 +178,8 @@ def load_model():
         
         try:
             model = YOLO(MODEL_PATH)
-            model.to('cpu')
+            if MODEL_PATH.endswith(".pt"):
+                model.to('cpu')  # Exported models (ONNX Runtime) run on the CPU already
             logger.info(f"✅ YOLO model loaded successfully")
         finally:
             # Restore original torch.load
@@ -508,8 +526,10 @@ def multi_scale_inference_smart(yolo_model, frame: np.ndarray, original_h: int,
     This avoids running 3 scales every frame (3x slower).
     """
     class FilteredResult:
-        def __init__(self, boxes=None):
+        def __init__(self, boxes=None, keypoints=None, keypoint_scale=1.0):
             self.boxes = boxes
+            self.keypoints = keypoints  # Only set for pose models
+            self.keypoint_scale = keypoint_scale
     
     # Primary inference at 1.0x scale
     r = yolo_model.predict(
@@ -525,7 +545,7 @@ def multi_scale_inference_smart(yolo_model, frame: np.ndarray, original_h: int,
     
     # If detections found, return them
     if r.boxes is not None and len(r.boxes) > 0:
-        return FilteredResult(r.boxes)
+        return FilteredResult(r.boxes, getattr(r, "keypoints", None))
     
     # No detections: Retry at larger scale to catch small/distant people
     logger.debug(f"No detections at 1.0x, retrying at 1.25x scale")
@@ -547,10 +567,143 @@ def multi_scale_inference_smart(yolo_model, frame: np.ndarray, original_h: int,
     if r_scaled.boxes is not None:
         for box in r_scaled.boxes:
             box.xyxy[0] = box.xyxy[0] / 1.25
-        return FilteredResult(r_scaled.boxes)
+        return FilteredResult(r_scaled.boxes, getattr(r_scaled, "keypoints", None), 1.0 / 1.25)
     
     return FilteredResult()
 
+class TiledResult:
+    """Merged detections of tiled_inference(), shaped like an ultralytics result."""
+    def __init__(self, boxes=None, keypoints=None):
+        self.boxes = boxes
+        self.keypoints = keypoints
+        self.keypoint_scale = 1.0
+
+def tile_origins(length: int, tile_size: int) -> List[int]:
+    """Tile positions along one axis, spread evenly so that the last tile ends at the border."""
+    if length <= tile_size:
+        return [0]
+    step = tile_size * (1.0 - TILE_OVERLAP)
+    count = int(np.ceil((length - tile_size) / step)) + 1
+    return [int(round(i * (length - tile_size) / (count - 1))) for i in range(count)]
+
+def make_tile_grid(W: int, H: int) -> List[tuple]:
+    """Overlapping (x1, y1, x2, y2) tiles of TILE_SIZE covering the frame."""
+    w, h = min(TILE_SIZE, W), min(TILE_SIZE, H)
+    return [(x, y, x + w, y + h) for y in tile_origins(H, TILE_SIZE) for x in tile_origins(W, TILE_SIZE)]
+
+def plan_tiles(state: Dict[str, Any], W: int, H: int, now: float) -> List[tuple]:
+    """
+    Tiles to run besides the whole frame: all of them every TILE_FULL_SCAN_INTERVAL frames, and
+    in between only those around persons detected in the last TILE_ACTIVITY_TTL seconds.
+    """
+    tiling = state["tiling"]
+    if tiling["size"] != (W, H):
+        tiling.update(size=(W, H), grid=make_tile_grid(W, H), frames_since_full_scan=TILE_FULL_SCAN_INTERVAL, activity=[])
+    if len(tiling["grid"]) <= 1:
+        return []
+    if tiling["frames_since_full_scan"] >= TILE_FULL_SCAN_INTERVAL:
+        tiling["frames_since_full_scan"] = 1
+        return tiling["grid"]
+    tiling["frames_since_full_scan"] += 1
+
+    remove_expired_tile_activity(tiling, now)
+    return [
+        tile for tile in tiling["grid"]
+        if any(iou(box, tile) > 0.0 for box, _ in tiling["activity"])
+    ]
+
+def remove_expired_tile_activity(tiling: Dict[str, Any], now: float):
+    tiling["activity"] = [(box, t) for box, t in tiling["activity"] if now - t <= TILE_ACTIVITY_TTL]
+
+def record_tile_activity(state: Dict[str, Any], boxes: List[List[float]], now: float):
+    """Remembers where persons are, with a margin of half their size for their movement."""
+    tiling = state["tiling"]
+    if len(tiling["grid"]) <= 1:
+        return
+    # Also here: with a full scan on every frame, plan_tiles() never gets to prune.
+    remove_expired_tile_activity(tiling, now)
+    for x1, y1, x2, y2 in boxes:
+        mx, my = (x2 - x1) * 0.5, (y2 - y1) * 0.5
+        tiling["activity"].append(((x1 - mx, y1 - my, x2 + mx, y2 + my), now))
+
+def is_cut_by_tile(box, tile, W: int, H: int, margin: float = 2.0) -> bool:
+    """Whether the box touches a tile border inside the frame, i.e. the person may be cut."""
+    x1, y1, x2, y2 = box
+    tx1, ty1, tx2, ty2 = tile
+    return ((tx1 > 0 and x1 <= tx1 + margin) or (ty1 > 0 and y1 <= ty1 + margin)
+            or (tx2 < W and x2 >= tx2 - margin) or (ty2 < H and y2 >= ty2 - margin))
+
+def merge_tile_detections(candidates: List[Dict[str, Any]], cut_containment: float = 0.6) -> List[Dict[str, Any]]:
+    """
+    Cross-tile NMS. Duplicates are suppressed by IoU; a box cut by a tile border that lies mostly
+    inside another one (the same person seen whole elsewhere) is merged into their union, keeping
+    the keypoints of the uncut box. Same rules as mergeTileDetections() of the native service.
+    """
+    kept: List[Dict[str, Any]] = []
+    for cand in sorted(candidates, key=lambda c: c["score"], reverse=True):
+        for other in kept:
+            a, b = cand["box"], other["box"]
+            inter = max(0.0, min(a[2], b[2]) - max(a[0], b[0])) * max(0.0, min(a[3], b[3]) - max(a[1], b[1]))
+            area_a = (a[2] - a[0]) * (a[3] - a[1])
+            area_b = (b[2] - b[0]) * (b[3] - b[1])
+            is_cut_part = (cand["cut"] or other["cut"]) and inter / max(min(area_a, area_b), 1e-6) > cut_containment
+            if iou(a, b) <= IOU_THRESHOLD and not is_cut_part:
+                continue
+            if cand["cut"] or other["cut"]:
+                other["box"] = [min(a[0], b[0]), min(a[1], b[1]), max(a[2], b[2]), max(a[3], b[3])]
+            if other["cut"] and not cand["cut"]:
+                other["keypoints"], other["cut"] = cand["keypoints"], False
+            break
+        else:
+            kept.append(cand)
+    return kept
+
+def tiled_inference(yolo_model, frame: np.ndarray, state: Dict[str, Any]):
+    """
+    Small people in wide views without raising YOLO_IMGSZ: the whole frame and the tiles chosen by
+    plan_tiles(), cut at full resolution, run in one batch at TILE_SIZE, and are merged with
+    cross-tile NMS.
+    """
+    from ultralytics.engine.results import Boxes, Keypoints
+
+    H, W = frame.shape[:2]
+    now = time.time()
+    tiles = [(0, 0, W, H)] + plan_tiles(state, W, H, now)
+    results = yolo_model.predict(
+        [frame[y1:y2, x1:x2] for x1, y1, x2, y2 in tiles],
+        conf=CONFIDENCE_THRESHOLD,
+        iou=IOU_THRESHOLD,
+        classes=[0],  # person only
+        imgsz=TILE_SIZE,
+        verbose=False,
+        augment=False,
+        device='cpu',
+    )
+
+    candidates = []
+    for tile, result in zip(tiles, results):
+        if result.boxes is None:
+            continue
+        tx, ty = tile[0], tile[1]
+        keypoints = getattr(result, "keypoints", None)
+        for i, (xyxy, score) in enumerate(zip(result.boxes.xyxy.tolist(), result.boxes.conf.tolist())):
+            box = [xyxy[0] + tx, xyxy[1] + ty, xyxy[2] + tx, xyxy[3] + ty]
+            points = None
+            if keypoints is not None and keypoints.data is not None and i < len(keypoints.data):
+                points = [[p[0] + tx, p[1] + ty] + list(p[2:]) for p in keypoints.data[i].tolist()]
+            candidates.append({"box": box, "score": score, "keypoints": points, "cut": is_cut_by_tile(box, tile, W, H)})
+
+    merged = merge_tile_detections(candidates)
+    record_tile_activity(state, [m["box"] for m in merged], now)
+    if not merged:
+        return TiledResult()
+
+    boxes = Boxes(torch.tensor([m["box"] + [m["score"], 0.0] for m in merged]), (H, W))
+    keypoints = None
+    if all(m["keypoints"] is not None for m in merged):
+        keypoints = Keypoints(torch.tensor([m["keypoints"] for m in merged]), (H, W))
+    return TiledResult(boxes, keypoints)
+
 # ============================
 # Pydantic Models
 # ============================
@@ -560,6 +713,7 @@ class InferRequest(BaseModel):
 
 class Detection(BaseModel):
     cls: str
+    cls_id: int = 0  # COCO class index; the C++ plugin prefers it over the "cls" label
     score: float
     x: float
     y: float
@@ -567,6 +721,8 @@ class Detection(BaseModel):
     h: float
     track_id: int
     fall_detected: bool = False  # NEW: Fall detection flag
+    # Optional COCO pose (17 x [x, y, conf], pixels); only filled when MODEL_PATH is a pose model
+    keypoints: Optional[List[List[float]]] = None
 
 class HealthResponse(BaseModel):
     status: str
@@ -599,6 +755,7 @@ def get_camera_state(camera_id: str) -> Dict[str, Any]:
             "last_time": 0.0,
             "inference_times": [],  # Track inference performance
             "created_at": time.time(),
+            "tiling": {"size": None, "grid": [], "frames_since_full_scan": 0, "activity": []},
             "fall_detector": FallDetectionManager(  # NEW: Fall detection manager
                 velocity_threshold=FALL_VELOCITY_THRESHOLD,
                 angle_change_threshold=FALL_ANGLE_CHANGE_THRESHOLD,
@@ -608,6 +765,18 @@ def get_camera_state(camera_id: str) -> Dict[str, Any]:
         }
     return camera_states[camera_id]
 
+def extract_keypoints(result, index: int) -> Optional[List[List[float]]]:
+    """Keypoints of box `index` as [[x, y, conf], ...] in pixels, or None for detect-only models."""
+    keypoints = getattr(result, "keypoints", None)
+    if keypoints is None or keypoints.data is None or index >= len(keypoints.data):
+        return None
+    scale = getattr(result, "keypoint_scale", 1.0)
+    points = keypoints.data[index].tolist()
+    return [
+        [float(p[0]) * scale, float(p[1]) * scale, float(p[2]) if len(p) > 2 else 1.0]
+        for p in points
+    ]
+
 def iou(a, b) -> float:
     """Calculate Intersection over Union"""
     ax1, ay1, ax2, ay2 = a
@@ -652,12 +821,14 @@ def infer(req: InferRequest):
     Expected by C++ plugin:
     {
         "cls": "person",
+        "cls_id": 0,
         "score": 0.9,
         "x": 180.0,
         "y": 270.6,
         "w": 120.0,
         "h": 360.8,
-        "track_id": 1
+        "track_id": 1,
+        "keypoints": [[x, y, conf], ...]  # optional, 17 COCO points (pose models only)
     }
     """
     global request_counter, error_counter
@@ -774,7 +945,10 @@ def infer(req: InferRequest):
             inference_start = time.time()
             
             # Choose inference strategy
-            if ENABLE_MULTI_SCALE:
+            if ENABLE_TILING:
+                # Whole frame + active tiles in one batch, merged with cross-tile NMS
+                r = tiled_inference(yolo_model, frame, get_camera_state(camera_id))
+            elif ENABLE_MULTI_SCALE:
                 # Smart multi-scale detection: only retry at larger scale if no detections
                 r = multi_scale_inference_smart(yolo_model, frame, H, W)
             else:
@@ -815,7 +989,7 @@ def infer(req: InferRequest):
         # ============================================
         # 3) Process YOLO outputs with tracking
         # ============================================
-        for box in r.boxes:
+        for box_index, box in enumerate(r.boxes if r.boxes is not None else []):
             try:
                 cls_id = int(box.cls[0].item())
                 if cls_id != 0:  # Only person
@@ -910,12 +1084,14 @@ def infer(req: InferRequest):
                 # Create detection object for C++ plugin
                 detections.append(Detection(
                     cls="person",
+                    cls_id=cls_id,
                     score=score,
                     x=float(x1),
                     y=float(y1),
                     w=float(w_box),
                     h=float(h_box),
-                    track_id=int(track_id)
+                    track_id=int(track_id),
+                    keypoints=extract_keypoints(r, box_index)
                 ))
                 
             except Exception as e:
@@ -962,6 +1138,8 @@ def infer(req: InferRequest):
             for det in detections:
                 det.x += x_offset
                 det.y += y_offset
+                if det.keypoints:
+                    det.keypoints = [[p[0] + x_offset, p[1] + y_offset, p[2]] for p in det.keypoints]
 
         # ============================================
         # 4) Anti-flicker: reuse last output if empty
@@ -1192,12 +1370,33 @@ async def shutdown_event():
 # ============================
 # Main
 # ============================
+def make_listening_sockets():
+    """TCP for tools and remote clients, plus the Unix socket for the plugin on this host."""
+    family = socket.AF_INET6 if ":" in SERVICE_HOST else socket.AF_INET
+    tcp_socket = socket.socket(family, socket.SOCK_STREAM)
+    tcp_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    tcp_socket.bind((SERVICE_HOST, SERVICE_PORT))
+
+    # A socket file left by a previous run would make bind() fail.
+    if os.path.exists(SERVICE_UNIX_SOCKET):
+        os.remove(SERVICE_UNIX_SOCKET)
+    unix_socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    unix_socket.bind(SERVICE_UNIX_SOCKET)
+    return [tcp_socket, unix_socket]
+
+
 if __name__ == "__main__":
     logger.info(f"Starting service on {SERVICE_HOST}:{SERVICE_PORT}")
-    uvicorn.run(
-        app,
-        host=SERVICE_HOST,
-        port=SERVICE_PORT,
-        log_level="info",
-        access_log=True
-    )
+    if SERVICE_UNIX_SOCKET:
+        logger.info(f"Also listening on unix:{SERVICE_UNIX_SOCKET}")
+        # One server on both sockets: same event loop, startup/shutdown events run once.
+        server = uvicorn.Server(uvicorn.Config(app, log_level="info", access_log=True))
+        server.run(sockets=make_listening_sockets())
+    else:
+        uvicorn.run(
+            app,
+            host=SERVICE_HOST,
+            port=SERVICE_PORT,
+            log_level="info",
+            access_log=True
+        )
@@ -0,0 +1,289 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "camera_state.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <opencv2/imgproc.hpp>
+
+#include "logger.h"
+
+namespace sample_company {
+namespace inference_service {
+
+namespace {
+
+constexpr size_t kRequestDurationWindow = 30;
+
+/** Appearance descriptor of python/service.py: normalized 8x8x8 BGR histogram of the box. */
+cv::Mat colorHistogram(const cv::Mat& image, const cv::Rect2f& box)
+{
+    const cv::Rect roi = cv::Rect(
+        cv::Point((int) box.x, (int) box.y),
+        cv::Point((int) (box.x + box.width), (int) (box.y + box.height)))
+        & cv::Rect(0, 0, image.cols, image.rows);
+    if (roi.empty())
+        return cv::Mat();
+
+    const cv::Mat patch = image(roi);
+    const int channels[] = {0, 1, 2};
+    const int binCounts[] = {8, 8, 8};
+    const float range[] = {0, 256};
+    const float* ranges[] = {range, range, range};
+    cv::Mat histogram;
+    cv::calcHist(&patch, 1, channels, cv::Mat(), histogram, 3, binCounts, ranges);
+    cv::normalize(histogram, histogram);
+    return histogram;
+}
+
+/** Bhattacharyya distance: 0 - same colors, 1 - nothing in common. */
+double appearanceDistance(const cv::Mat& a, const cv::Mat& b)
+{
+    if (a.empty() || b.empty())
+        return 1.0;
+    return cv::compareHist(a, b, cv::HISTCMP_BHATTACHARYYA);
+}
+
+float iou(const cv::Rect2f& a, const cv::Rect2f& b)
+{
+    if (a.area() <= 0 || b.area() <= 0)
+        return 0;
+    const float intersection = (a & b).area();
+    return intersection / (a.area() + b.area() - intersection + 1e-6F);
+}
+
+/** The lower the IoU (the person moved), the more the appearance counts. */
+float combinedTrackScore(float iouScore, double appearanceDistance)
+{
+    const float similarity = 1.0F - (float) appearanceDistance;
+    if (iouScore < 0.1F)
+        return 0.5F * iouScore + 0.5F * similarity;
+    if (iouScore < 0.3F)
+        return 0.6F * iouScore + 0.4F * similarity;
+    return 0.7F * iouScore + 0.3F * similarity;
+}
+
+} // namespace
+
+CameraState::CameraState(const ServiceConfig& config):
+    m_config(config),
+    m_createdAt(std::chrono::system_clock::now()),
+    m_tilePlanner(config.enableTiling ? std::make_unique<TilePlanner>(config) : nullptr)
+{
+    if (config.enableFallDetection)
+    {
+        FallDetectorSettings settings;
+        settings.velocityThreshold = config.fallVelocityThreshold;
+        settings.angleChangeThreshold = config.fallAngleChangeThreshold;
+        settings.aspectRatioThreshold = config.fallAspectRatioThreshold;
+        settings.confidenceThreshold = config.fallConfidenceThreshold;
+        m_fallDetector = std::make_unique<FallDetector>(settings);
+    }
+}
+
+std::vector<ServiceDetection> CameraState::update(const cv::Mat& image, cv::Point offset,
+    const std::vector<PersonDetection>& persons, Clock::time_point requestStart)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const Clock::time_point now = Clock::now();
+    ++m_frameIndex;
+
+    const float maxX = image.cols - 1.0F;
+    const float maxY = image.rows - 1.0F;
+
+    std::vector<ServiceDetection> detections;
+    for (const PersonDetection& person: persons)
+    {
+        const float left = std::clamp(person.box.x, 0.0F, maxX);
+        const float top = std::clamp(person.box.y, 0.0F, maxY);
+        const float right = std::clamp(person.box.x + person.box.width, 0.0F, maxX);
+        const float bottom = std::clamp(person.box.y + person.box.height, 0.0F, maxY);
+        const cv::Rect2f box(left, top, right - left, bottom - top);
+        if (box.width <= 1 || box.height <= 1 || box.area() < m_config.minDetectionArea)
+            continue;
+
+        ServiceDetection detection;
+        detection.score = person.score;
+        detection.box = box;
+        detection.trackId = matchTrack(box, colorHistogram(image, box), now);
+        detection.keypoints = person.keypoints;
+        detections.push_back(std::move(detection));
+    }
+
+    if (m_fallDetector)
+    {
+        std::vector<FallDetector::Input> fallInputs;
+        for (const ServiceDetection& detection: detections)
+            fallInputs.push_back({detection.trackId, detection.box, detection.score});
+        const std::vector<int> fallenTrackIds = m_fallDetector->update(fallInputs, m_frameIndex);
+        for (ServiceDetection& detection: detections)
+        {
+            detection.isFallDetected = std::find(fallenTrackIds.begin(), fallenTrackIds.end(),
+                detection.trackId) != fallenTrackIds.end();
+            if (detection.isFallDetected)
+            {
+                PLUGIN_LOG(warning, 1, "FALL DETECTED: Person %d (score=%.2f)",
+                    detection.trackId, detection.score);
+            }
+        }
+    }
+
+    for (ServiceDetection& detection: detections)
+    {
+        detection.box.x += (float) offset.x;
+        detection.box.y += (float) offset.y;
+        for (cv::Point3f& point: detection.keypoints)
+        {
+            point.x += (float) offset.x;
+            point.y += (float) offset.y;
+        }
+    }
+
+    // Anti-flicker: a frame without anybody right after one with somebody is likely a miss.
+    if (detections.empty() && !m_lastOutput.empty())
+    {
+        if (now - m_lastOutputTime < m_config.flickerReuseTime)
+            detections = m_lastOutput;
+    }
+    else
+    {
+        m_lastOutput = detections;
+        m_lastOutputTime = now;
+    }
+
+    expireTracks(now);
+
+    for (const ServiceDetection& detection: detections)
+        m_seenTrackIds.insert(detection.trackId);
+
+    m_requestDurations.push_back(now - requestStart);
+    if (m_requestDurations.size() > kRequestDurationWindow)
+        m_requestDurations.pop_front();
+
+    return detections;
+}
+
+int CameraState::reset()
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const int previousCount = (int) m_seenTrackIds.size();
+    m_seenTrackIds.clear();
+    m_tracks.clear();
+    m_trackHistory.clear();
+    m_nextTrackId = 1;
+    return previousCount;
+}
+
+void CameraState::resetFall()
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fallDetector)
+        m_fallDetector->resetFall();
+}
+
+CameraStatus CameraState::status() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+
+    CameraStatus result;
+    result.trackCount = (int) m_tracks.size();
+    result.uniquePersonCount = (int) m_seenTrackIds.size();
+    result.createdAt = m_createdAt;
+    if (!m_requestDurations.empty())
+    {
+        const std::chrono::duration<double> total = std::accumulate(
+            m_requestDurations.begin(), m_requestDurations.end(),
+            std::chrono::duration<double>::zero());
+        result.averageInferenceMs = total.count() * 1000 / m_requestDurations.size();
+    }
+    result.isFallDetectionEnabled = (bool) m_fallDetector;
+    if (m_fallDetector)
+        result.fallDetection = m_fallDetector->stats();
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+int CameraState::matchTrack(
+    const cv::Rect2f& box, const cv::Mat& colorHistogram, Clock::time_point now)
+{
+    Track* best = nullptr;
+    float bestScore = -1;
+
+    for (Track& track: m_tracks)
+    {
+        const float iouScore = iou(box, track.box);
+        const float score = (!track.colorHistogram.empty() && !colorHistogram.empty())
+            ? combinedTrackScore(iouScore, appearanceDistance(track.colorHistogram, colorHistogram))
+            : iouScore;
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = &track;
+        }
+    }
+
+    // A person who left and came back: position means little by now, only appearance counts.
+    bool isFromHistory = false;
+    if ((!best || bestScore < m_config.ioaThreshold) && !colorHistogram.empty())
+    {
+        for (Track& track: m_trackHistory)
+        {
+            const double distance = appearanceDistance(track.colorHistogram, colorHistogram);
+            if (distance < 0.4 && 1.0F - (float) distance > bestScore)
+            {
+                bestScore = 1.0F - (float) distance;
+                best = &track;
+                isFromHistory = true;
+            }
+        }
+    }
+
+    float threshold = m_config.ioaThreshold;
+    if (best && appearanceDistance(best->colorHistogram, colorHistogram) < 0.3)
+        threshold = 0.05F; //< Same colors: accept a weaker geometric match.
+
+    if (!best || bestScore < threshold)
+    {
+        m_tracks.push_back(Track{m_nextTrackId++, box, now, colorHistogram});
+        return m_tracks.back().id;
+    }
+
+    best->box = box;
+    best->lastSeen = now;
+    best->colorHistogram = colorHistogram;
+    const int trackId = best->id;
+    if (isFromHistory)
+    {
+        m_tracks.push_back(std::move(*best));
+        m_trackHistory.erase(m_trackHistory.begin() + (best - m_trackHistory.data()));
+        PLUGIN_LOG(debug, 0, "Re-matched track %d from history", trackId);
+    }
+    return trackId;
+}
+
+void CameraState::expireTracks(Clock::time_point now)
+{
+    m_trackHistory.erase(
+        std::remove_if(m_trackHistory.begin(), m_trackHistory.end(),
+            [&](const Track& track) { return now - track.lastSeen > m_config.trackHistoryTtl; }),
+        m_trackHistory.end());
+
+    for (auto it = m_tracks.begin(); it != m_tracks.end();)
+    {
+        if (now - it->lastSeen > m_config.trackTtl)
+        {
+            m_trackHistory.push_back(std::move(*it));
+            it = m_tracks.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+} // namespace inference_service
+} // namespace sample_company
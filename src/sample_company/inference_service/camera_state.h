@@ -0,0 +1,106 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "fall_detector.h"
+#include "service_config.h"
+#include "tile_planner.h"
+#include "yolo_detector.h"
+
+namespace sample_company {
+namespace inference_service {
+
+/** One element of the /infer response. */
+struct ServiceDetection
+{
+    int classId = 0; //< COCO; always 0 (person).
+    float score = 0;
+    cv::Rect2f box; //< Pixels of the decoded frame.
+    int trackId = 0;
+    bool isFallDetected = false;
+    std::vector<cv::Point3f> keypoints; //< Pixels of the decoded frame; empty if no pose.
+};
+
+struct CameraStatus
+{
+    int trackCount = 0;
+    int uniquePersonCount = 0;
+    std::chrono::system_clock::time_point createdAt;
+    double averageInferenceMs = 0;
+    bool isFallDetectionEnabled = false;
+    FallDetectorStats fallDetection;
+};
+
+/**
+ * What python/service.py keeps per camera: IoU + color histogram tracking with a history for
+ * re-identification, fall detection, anti-flicker and counters. Thread-safe; requests of
+ * different cameras never wait for each other.
+ */
+class CameraState
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+public:
+    explicit CameraState(const ServiceConfig& config);
+
+    /**
+     * @param image Image the persons were detected on.
+     * @param offset Position of the image in the decoded frame.
+     * @param requestStart When the request began; for the average inference time.
+     */
+    std::vector<ServiceDetection> update(const cv::Mat& image, cv::Point offset,
+        const std::vector<PersonDetection>& persons, Clock::time_point requestStart);
+
+    /** /reset: forgets the tracks and the unique person count. @return The previous count. */
+    int reset();
+
+    void resetFall();
+
+    CameraStatus status() const;
+
+    /** Null unless tiling is enabled. */
+    TilePlanner* tilePlanner() const { return m_tilePlanner.get(); }
+
+private:
+    struct Track
+    {
+        int id = 0;
+        cv::Rect2f box;
+        Clock::time_point lastSeen;
+        cv::Mat colorHistogram; //< Empty if the box was degenerate.
+    };
+
+    /** @return Id of the matched or new track. */
+    int matchTrack(const cv::Rect2f& box, const cv::Mat& colorHistogram, Clock::time_point now);
+    void expireTracks(Clock::time_point now);
+
+private:
+    const ServiceConfig& m_config;
+    const std::chrono::system_clock::time_point m_createdAt;
+
+    mutable std::mutex m_mutex;
+    std::vector<Track> m_tracks;
+    std::vector<Track> m_trackHistory; //< Expired tracks that a returning person can resume.
+    int m_nextTrackId = 1;
+    std::set<int> m_seenTrackIds;
+    std::vector<ServiceDetection> m_lastOutput;
+    Clock::time_point m_lastOutputTime;
+    std::deque<std::chrono::duration<double>> m_requestDurations; //< Last 30.
+    std::unique_ptr<FallDetector> m_fallDetector; //< Null if disabled.
+    const std::unique_ptr<TilePlanner> m_tilePlanner;
+    int64_t m_frameIndex = 0;
+};
+
+} // namespace inference_service
+} // namespace sample_company
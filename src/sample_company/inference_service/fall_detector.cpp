@@ -0,0 +1,127 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "fall_detector.h"
+
+#include <cmath>
+#include <numeric>
+#include <string>
+
+#include "logger.h"
+
+namespace sample_company {
+namespace inference_service {
+
+namespace {
+
+constexpr float kMinBoxSide = 10;
+constexpr float kRadiansToDegrees = 57.29577951308232F;
+
+template<typename T>
+void pushBounded(std::deque<T>* values, T value, int maxSize)
+{
+    values->push_back(value);
+    while ((int) values->size() > maxSize)
+        values->pop_front();
+}
+
+} // namespace
+
+FallDetector::FallDetector(FallDetectorSettings settings):
+    m_settings(settings)
+{
+}
+
+std::vector<int> FallDetector::update(const std::vector<Input>& detections, int64_t frameIndex)
+{
+    m_currentFrame = frameIndex;
+
+    std::vector<int> fallenTrackIds;
+    for (const Input& detection: detections)
+    {
+        if (detection.trackId < 0)
+            continue;
+        if (updateTracker(&m_trackers[detection.trackId], detection, frameIndex))
+            fallenTrackIds.push_back(detection.trackId);
+    }
+
+    for (auto it = m_trackers.begin(); it != m_trackers.end();)
+    {
+        if (frameIndex - it->second.lastDetectionFrame > m_settings.trackerTtlFrames)
+            it = m_trackers.erase(it);
+        else
+            ++it;
+    }
+    return fallenTrackIds;
+}
+
+void FallDetector::resetFall()
+{
+    for (auto& [trackId, tracker]: m_trackers)
+    {
+        tracker.isFallDetected = false;
+        tracker.fallFrameCount = 0;
+    }
+}
+
+FallDetectorStats FallDetector::stats() const
+{
+    FallDetectorStats result;
+    result.trackedCount = (int) m_trackers.size();
+    for (const auto& [trackId, tracker]: m_trackers)
+        result.fallenCount += tracker.isFallDetected ? 1 : 0;
+    result.currentFrame = m_currentFrame;
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+bool FallDetector::updateTracker(
+    Tracker* tracker, const Input& detection, int64_t frameIndex) const
+{
+    const float width = detection.box.width;
+    const float height = detection.box.height;
+    if (width < kMinBoxSide || height < kMinBoxSide)
+        return false;
+
+    const float aspectRatio = width / height;
+    pushBounded(&tracker->centerYs,
+        std::floor(detection.box.y + height / 2), m_settings.historySize);
+    pushBounded(&tracker->angles,
+        std::atan2(height, width) * kRadiansToDegrees, m_settings.historySize);
+    pushBounded(&tracker->aspectRatios, aspectRatio, m_settings.historySize);
+    tracker->lastDetectionFrame = frameIndex;
+
+    if (tracker->centerYs.size() < 2)
+        return false;
+    if (detection.confidence < m_settings.confidenceThreshold)
+        return false;
+
+    const float velocity = std::abs(tracker->centerYs.back() - tracker->centerYs.end()[-2]);
+    const float angleChange = std::abs(tracker->angles.back() - tracker->angles.end()[-2]);
+    const float averageAspectRatio = std::accumulate(
+        tracker->aspectRatios.begin(), tracker->aspectRatios.end(), 0.0F)
+        / tracker->aspectRatios.size();
+    const float aspectRatioIncrease = averageAspectRatio - tracker->aspectRatios.front();
+
+    std::string reasons;
+    if (velocity > m_settings.velocityThreshold)
+        reasons += " high_velocity(" + std::to_string(velocity) + ")";
+    if (angleChange > m_settings.angleChangeThreshold)
+        reasons += " angle_change(" + std::to_string(angleChange) + ")";
+    if (averageAspectRatio > m_settings.aspectRatioThreshold)
+        reasons += " aspect_ratio(" + std::to_string(averageAspectRatio) + ")";
+    if (aspectRatioIncrease > 0.5F && aspectRatio > 1.2F)
+        reasons += " ratio_increase(" + std::to_string(aspectRatioIncrease) + ")";
+
+    if (reasons.empty())
+        return false;
+
+    tracker->isFallDetected = true;
+    ++tracker->fallFrameCount;
+    PLUGIN_LOG(info, 1, "Fall detected for person %d:%s", detection.trackId, reasons.c_str());
+    return true;
+}
+
+} // namespace inference_service
+} // namespace sample_company
@@ -0,0 +1,72 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace sample_company {
+namespace inference_service {
+
+struct FallDetectorSettings
+{
+    float velocityThreshold = 20; //< Vertical move of the box center, pixels per frame.
+    float angleChangeThreshold = 45; //< Degrees.
+    float aspectRatioThreshold = 1.5F; //< Width / height.
+    float confidenceThreshold = 0.8F;
+    int historySize = 5;
+    int64_t trackerTtlFrames = 30;
+};
+
+struct FallDetectorStats
+{
+    int trackedCount = 0;
+    int fallenCount = 0;
+    int64_t currentFrame = 0;
+};
+
+/** Box-based fall heuristics per track, as python/fall_detection.py (FallDetectionManager). */
+class FallDetector
+{
+public:
+    struct Input
+    {
+        int trackId = 0;
+        cv::Rect2f box;
+        float confidence = 0;
+    };
+
+public:
+    explicit FallDetector(FallDetectorSettings settings);
+
+    /** @return Ids of the tracks seen falling in this frame. */
+    std::vector<int> update(const std::vector<Input>& detections, int64_t frameIndex);
+
+    void resetFall();
+    FallDetectorStats stats() const;
+
+private:
+    struct Tracker
+    {
+        std::deque<float> centerYs;
+        std::deque<float> angles;
+        std::deque<float> aspectRatios;
+        bool isFallDetected = false;
+        int fallFrameCount = 0;
+        int64_t lastDetectionFrame = 0;
+    };
+
+    bool updateTracker(Tracker* tracker, const Input& detection, int64_t frameIndex) const;
+
+private:
+    const FallDetectorSettings m_settings;
+    std::map<int, Tracker> m_trackers;
+    int64_t m_currentFrame = 0;
+};
+
+} // namespace inference_service
+} // namespace sample_company
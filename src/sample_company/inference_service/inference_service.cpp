@@ -0,0 +1,568 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "inference_service.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "httplib.h"
+#include "json.hpp"
+#include "logger.h"
+
+namespace sample_company {
+namespace inference_service {
+
+using json = nlohmann::json;
+using namespace std::chrono;
+
+namespace {
+
+constexpr double kRawFrameTargetBrightness = 180;
+constexpr size_t kKeepAliveMaxCount = 1000000; //< A camera keeps its connection for good.
+
+/** Lenient like Python's base64.b64decode(): characters outside the alphabet are skipped. */
+std::vector<uint8_t> base64Decode(const std::string& text)
+{
+    static const std::array<int8_t, 256> kValues =
+        []()
+        {
+            std::array<int8_t, 256> values;
+            values.fill(-1);
+            const char* const alphabet =
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for (int i = 0; i < 64; ++i)
+                values[(uint8_t) alphabet[i]] = (int8_t) i;
+            return values;
+        }();
+
+    std::vector<uint8_t> result;
+    result.reserve(text.size() / 4 * 3);
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (const char c: text)
+    {
+        if (c == '=')
+            break;
+        const int value = kValues[(uint8_t) c];
+        if (value < 0)
+            continue;
+        bits = (bits << 6) | (uint32_t) value;
+        bitCount += 6;
+        if (bitCount >= 8)
+        {
+            bitCount -= 8;
+            result.push_back((uint8_t) (bits >> bitCount));
+        }
+    }
+    return result;
+}
+
+uint32_t readLittleEndian32(const uint8_t* data)
+{
+    return (uint32_t) data[0] | ((uint32_t) data[1] << 8) | ((uint32_t) data[2] << 16)
+        | ((uint32_t) data[3] << 24);
+}
+
+/**
+ * Either a JPEG/PNG, or the raw format of the legacy plugin path: "BGR", width and height as
+ * little-endian uint32, then the pixels. Raw frames are brightened, as the Python service does.
+ * @return Empty if the image cannot be decoded.
+ */
+cv::Mat decodeImage(const std::vector<uint8_t>& bytes)
+{
+    constexpr size_t kRawHeaderSize = 11;
+    if (bytes.size() >= kRawHeaderSize && std::memcmp(bytes.data(), "BGR", 3) == 0)
+    {
+        const uint32_t width = readLittleEndian32(bytes.data() + 3);
+        const uint32_t height = readLittleEndian32(bytes.data() + 7);
+        if (width == 0 || height == 0
+            || (uint64_t) width * height * 3 != bytes.size() - kRawHeaderSize)
+        {
+            return cv::Mat();
+        }
+        const cv::Mat frame((int) height, (int) width, CV_8UC3,
+            (void*) (bytes.data() + kRawHeaderSize));
+        return Preprocessor::adjustBrightness(frame, kRawFrameTargetBrightness).clone();
+    }
+
+    return cv::imdecode(bytes, cv::IMREAD_COLOR);
+}
+
+/** Local time as Python's datetime.isoformat(), e.g. "2025-01-24T10:20:30.123456". */
+std::string isoTimestamp(system_clock::time_point time)
+{
+    const std::time_t seconds = system_clock::to_time_t(time);
+    std::tm localTime{};
+    #if defined(_WIN32)
+        localtime_s(&localTime, &seconds);
+    #else
+        localtime_r(&seconds, &localTime);
+    #endif
+    char result[40];
+    const size_t length = std::strftime(result, sizeof(result), "%Y-%m-%dT%H:%M:%S", &localTime);
+    const long long microseconds =
+        duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count() % 1000000;
+    std::snprintf(result + length, sizeof(result) - length, ".%06lld", microseconds);
+    return result;
+}
+
+json detectionToJson(const ServiceDetection& detection)
+{
+    json result = {
+        {"cls", "person"},
+        {"cls_id", detection.classId},
+        {"score", detection.score},
+        {"x", detection.box.x},
+        {"y", detection.box.y},
+        {"w", detection.box.width},
+        {"h", detection.box.height},
+        {"track_id", detection.trackId},
+        {"fall_detected", detection.isFallDetected},
+        {"keypoints", nullptr},
+    };
+    if (!detection.keypoints.empty())
+    {
+        json& keypoints = result["keypoints"] = json::array();
+        for (const cv::Point3f& point: detection.keypoints)
+            keypoints.push_back({point.x, point.y, point.z});
+    }
+    return result;
+}
+
+void setJson(httplib::Response& response, const json& body, int status = 200)
+{
+    response.status = status;
+    response.set_content(body.dump(), "application/json");
+}
+
+} // namespace
+
+InferenceService::InferenceService(ServiceConfig config):
+    m_config(std::move(config)),
+    m_startTime(steady_clock::now()),
+    m_preprocessor(m_config),
+    m_detector(YoloDetectorSettings{m_config.modelPath, m_config.inputSize,
+        m_config.confidenceThreshold, m_config.iouThreshold, m_config.inferenceThreadCount}),
+    m_server(std::make_unique<httplib::Server>())
+{
+    PLUGIN_LOG(info, 0, "Model loaded: %s (%s, %s)", m_config.modelPath.c_str(),
+        m_detector.isPoseModel() ? "pose" : "detect",
+        m_detector.isQuantizedModel() ? "int8" : "fp32");
+
+    configureServer(m_server.get());
+    if (!m_config.unixSocketPath.empty())
+    {
+        m_unixSocketServer = std::make_unique<httplib::Server>();
+        configureServer(m_unixSocketServer.get());
+    }
+}
+
+InferenceService::~InferenceService()
+{
+    stop();
+}
+
+void InferenceService::start()
+{
+    if (!m_server->bind_to_port(m_config.host, m_config.port))
+    {
+        throw std::runtime_error("Unable to listen on " + m_config.host + ":"
+            + std::to_string(m_config.port));
+    }
+    m_thread = std::thread([this]() { m_server->listen_after_bind(); });
+    m_server->wait_until_ready();
+    PLUGIN_LOG(info, 0, "Listening on http://%s:%d", m_config.host.c_str(), m_config.port);
+
+    if (m_unixSocketServer)
+    {
+        // A socket file left by a previous run that crashed would make bind() fail.
+        std::remove(m_config.unixSocketPath.c_str());
+        m_unixSocketServer->set_address_family(AF_UNIX);
+        if (!m_unixSocketServer->bind_to_port(m_config.unixSocketPath, 80))
+            throw std::runtime_error("Unable to listen on " + m_config.unixSocketPath);
+        m_unixSocketThread = std::thread([this]() { m_unixSocketServer->listen_after_bind(); });
+        m_unixSocketServer->wait_until_ready();
+        PLUGIN_LOG(info, 0, "Listening on unix:%s", m_config.unixSocketPath.c_str());
+    }
+
+    if (m_config.enableSharedFrames)
+    {
+        m_sharedFrameServer = std::make_unique<SharedFrameServer>(m_config.sharedFrameSocketPath,
+            [this](const std::string& cameraId, const cv::Mat& frame,
+                steady_clock::time_point requestStart)
+            {
+                m_requestCount.fetch_add(1, std::memory_order_relaxed);
+                return detect(cameraId, frame, requestStart);
+            });
+        try
+        {
+            m_sharedFrameServer->start();
+        }
+        catch (const std::exception& e)
+        {
+            // Not fatal: the plugins keep sending JPEGs over HTTP.
+            PLUGIN_LOG(warning, 0, "Shared frame transport disabled: %s", e.what());
+            m_sharedFrameServer.reset();
+        }
+    }
+}
+
+void InferenceService::stop()
+{
+    if (!m_thread.joinable())
+        return;
+    m_sharedFrameServer.reset();
+    if (m_unixSocketThread.joinable())
+    {
+        m_unixSocketServer->stop();
+        m_unixSocketThread.join();
+        std::remove(m_config.unixSocketPath.c_str());
+    }
+    m_server->stop();
+    m_thread.join();
+    PLUGIN_LOG(info, 0, "Stopped; total requests: %lld, total errors: %lld",
+        (long long) m_requestCount.load(), (long long) m_errorCount.load());
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void InferenceService::configureServer(httplib::Server* server)
+{
+    const size_t threadCount = (size_t) m_config.httpThreadCount;
+    server->new_task_queue = [threadCount]() { return new httplib::ThreadPool(threadCount); };
+    server->set_keep_alive_max_count(kKeepAliveMaxCount);
+
+    server->Post("/infer",
+        [this](const httplib::Request& request, httplib::Response& response)
+        {
+            handleInfer(request, response);
+        });
+    server->Get("/health",
+        [this](const httplib::Request&, httplib::Response& response)
+        {
+            handleHealth(response);
+        });
+    server->Get("/status",
+        [this](const httplib::Request&, httplib::Response& response)
+        {
+            handleStatus(response);
+        });
+    server->Post("/reset/:camera_id",
+        [this](const httplib::Request& request, httplib::Response& response)
+        {
+            handleReset(request.path_params.at("camera_id"), response);
+        });
+    server->Post("/reset_all",
+        [this](const httplib::Request&, httplib::Response& response)
+        {
+            handleResetAll(response);
+        });
+    server->Post("/reset_fall/:camera_id",
+        [this](const httplib::Request& request, httplib::Response& response)
+        {
+            handleResetFall(request.path_params.at("camera_id"), response);
+        });
+    server->Post("/reset_fall_all",
+        [this](const httplib::Request&, httplib::Response& response)
+        {
+            handleResetFallAll(response);
+        });
+
+    server->set_exception_handler(
+        [this](const httplib::Request& request, httplib::Response& response,
+            std::exception_ptr exception)
+        {
+            m_errorCount.fetch_add(1, std::memory_order_relaxed);
+            try
+            {
+                std::rethrow_exception(exception);
+            }
+            catch (const std::exception& e)
+            {
+                PLUGIN_LOG(error, 1, "%s %s: %s",
+                    request.method.c_str(), request.path.c_str(), e.what());
+            }
+            catch (...)
+            {
+                PLUGIN_LOG(error, 1, "%s %s: unknown exception",
+                    request.method.c_str(), request.path.c_str());
+            }
+            setJson(response, {{"detail", "Internal Server Error"}}, 500);
+        });
+}
+
+std::vector<ServiceDetection> InferenceService::detect(const std::string& cameraId,
+    const cv::Mat& frame, steady_clock::time_point requestStart)
+{
+    const PreparedImage prepared = m_preprocessor.prepare(frame);
+    const std::shared_ptr<CameraState> state = cameraState(cameraId);
+
+    std::vector<PersonDetection> persons;
+    try
+    {
+        persons = state->tilePlanner()
+            ? detectTiled(state->tilePlanner(), prepared.image)
+            : m_detector.detect(prepared.image);
+    }
+    catch (const std::exception& e)
+    {
+        m_errorCount.fetch_add(1, std::memory_order_relaxed);
+        PLUGIN_LOG(error, 1, "[%s] YOLO inference error: %s", cameraId.c_str(), e.what());
+        return {};
+    }
+
+    std::vector<ServiceDetection> detections =
+        state->update(prepared.image, prepared.offset, persons, requestStart);
+
+    PLUGIN_LOG(info, 1, "[%s] Detections: %zu | Time: %.1f ms", cameraId.c_str(),
+        detections.size(),
+        duration<double, std::milli>(steady_clock::now() - requestStart).count());
+    return detections;
+}
+
+std::vector<PersonDetection> InferenceService::detectTiled(
+    TilePlanner* tilePlanner, const cv::Mat& image)
+{
+    const auto now = steady_clock::now();
+
+    // The whole image first, letterboxed as without tiling, for the people too big for a tile.
+    std::vector<cv::Rect> tiles = tilePlanner->plan(image.size(), now);
+    tiles.insert(tiles.begin(), cv::Rect(0, 0, image.cols, image.rows));
+
+    std::vector<cv::Mat> images;
+    images.reserve(tiles.size());
+    for (const cv::Rect& tile: tiles)
+        images.push_back(image(tile));
+
+    std::vector<std::vector<PersonDetection>> tileDetections = m_detector.detectBatch(images);
+    for (size_t i = 1; i < tiles.size(); ++i)
+    {
+        const cv::Point2f offset((float) tiles[i].x, (float) tiles[i].y);
+        for (PersonDetection& person: tileDetections[i])
+        {
+            person.box.x += offset.x;
+            person.box.y += offset.y;
+            for (cv::Point3f& point: person.keypoints)
+            {
+                point.x += offset.x;
+                point.y += offset.y;
+            }
+        }
+    }
+
+    std::vector<PersonDetection> result = mergeTileDetections(
+        tiles, tileDetections, image.size(), m_config.iouThreshold);
+    tilePlanner->recordActivity(result, now);
+    return result;
+}
+
+void InferenceService::handleInfer(const httplib::Request& request, httplib::Response& response)
+{
+    const auto requestStart = steady_clock::now();
+    m_requestCount.fetch_add(1, std::memory_order_relaxed);
+
+    std::string image;
+    std::string cameraId;
+    try
+    {
+        const json body = json::parse(request.body);
+        image = body.at("image").get<std::string>();
+        const auto cameraIdIt = body.find("camera_id");
+        if (cameraIdIt != body.end() && !cameraIdIt->is_null())
+            cameraId = cameraIdIt->get<std::string>();
+    }
+    catch (const std::exception& e)
+    {
+        // FastAPI answers an invalid body with 422.
+        setJson(response, {{"detail", std::string("Invalid request body: ") + e.what()}}, 422);
+        return;
+    }
+    if (cameraId.empty())
+        cameraId = "default";
+
+    const cv::Mat frame = decodeImage(base64Decode(image));
+    if (frame.empty())
+    {
+        m_errorCount.fetch_add(1, std::memory_order_relaxed);
+        PLUGIN_LOG(warning, 1, "[%s] Failed to decode image", cameraId.c_str());
+        setJson(response, json::array());
+        return;
+    }
+
+    const std::vector<ServiceDetection> detections = detect(cameraId, frame, requestStart);
+
+    json body = json::array();
+    for (const ServiceDetection& detection: detections)
+        body.push_back(detectionToJson(detection));
+    setJson(response, body);
+}
+
+void InferenceService::handleHealth(httplib::Response& response) const
+{
+    setJson(response, {
+        {"status", "healthy"},
+        {"timestamp", isoTimestamp(system_clock::now())},
+        {"service_uptime_seconds",
+            duration<double>(steady_clock::now() - m_startTime).count()},
+    });
+}
+
+void InferenceService::handleStatus(httplib::Response& response) const
+{
+    std::map<std::string, std::shared_ptr<CameraState>> cameras;
+    {
+        const std::lock_guard<std::mutex> lock(m_camerasMutex);
+        cameras = m_cameras;
+    }
+
+    json camerasJson = json::object();
+    for (const auto& [cameraId, state]: cameras)
+    {
+        const CameraStatus status = state->status();
+        json fallDetection = {{"enabled", status.isFallDetectionEnabled}};
+        if (status.isFallDetectionEnabled)
+        {
+            fallDetection["total_tracked"] = status.fallDetection.trackedCount;
+            fallDetection["total_fallen"] = status.fallDetection.fallenCount;
+            fallDetection["current_frame"] = status.fallDetection.currentFrame;
+        }
+        camerasJson[cameraId] = {
+            {"tracks", status.trackCount},
+            {"unique_persons", status.uniquePersonCount},
+            {"created_at", isoTimestamp(status.createdAt)},
+            {"avg_inference_ms", status.averageInferenceMs},
+            {"fall_detection", std::move(fallDetection)},
+        };
+    }
+
+    const int64_t requestCount = m_requestCount.load(std::memory_order_relaxed);
+    const int64_t errorCount = m_errorCount.load(std::memory_order_relaxed);
+    setJson(response, {
+        {"service", "YOLOv8 People Analytics + Fall Detection"},
+        {"status", "running"},
+        {"uptime_seconds", duration<double>(steady_clock::now() - m_startTime).count()},
+        {"total_requests", requestCount},
+        {"total_errors", errorCount},
+        {"error_rate", requestCount > 0 ? errorCount * 100.0 / requestCount : 0.0},
+        {"active_cameras", cameras.size()},
+        {"fall_detection", m_config.enableFallDetection ? "ENABLED" : "DISABLED"},
+        {"cameras", std::move(camerasJson)},
+        {"model", m_config.modelPath},
+        {"timestamp", isoTimestamp(system_clock::now())},
+    });
+}
+
+void InferenceService::handleReset(const std::string& cameraId, httplib::Response& response)
+{
+    const std::shared_ptr<CameraState> state = findCameraState(cameraId);
+    if (!state)
+    {
+        setJson(response, {
+            {"camera_id", cameraId},
+            {"status", "not_found"},
+            {"message", "Camera " + cameraId + " not yet initialized"},
+        });
+        return;
+    }
+
+    const int previousCount = state->reset();
+    PLUGIN_LOG(info, 0, "[%s] Reset: cleared %d persons", cameraId.c_str(), previousCount);
+    setJson(response, {
+        {"camera_id", cameraId},
+        {"status", "reset"},
+        {"previous_count", previousCount},
+        {"current_count", 0},
+    });
+}
+
+void InferenceService::handleResetAll(httplib::Response& response)
+{
+    std::map<std::string, std::shared_ptr<CameraState>> cameras;
+    {
+        const std::lock_guard<std::mutex> lock(m_camerasMutex);
+        cameras = m_cameras;
+    }
+
+    int clearedCount = 0;
+    for (const auto& [cameraId, state]: cameras)
+    {
+        clearedCount += state->reset();
+        state->resetFall();
+    }
+    PLUGIN_LOG(info, 0, "Reset all %zu cameras, cleared %d persons",
+        cameras.size(), clearedCount);
+    setJson(response, {
+        {"status", "reset_all"},
+        {"cameras_reset", cameras.size()},
+        {"total_persons_cleared", clearedCount},
+    });
+}
+
+void InferenceService::handleResetFall(const std::string& cameraId, httplib::Response& response)
+{
+    const std::shared_ptr<CameraState> state = findCameraState(cameraId);
+    if (!state || !m_config.enableFallDetection)
+    {
+        setJson(response, {
+            {"camera_id", cameraId},
+            {"status", "not_found"},
+            {"message", "Camera " + cameraId + " not found or fall detection disabled"},
+        });
+        return;
+    }
+
+    state->resetFall();
+    PLUGIN_LOG(info, 0, "[%s] Fall detection state reset", cameraId.c_str());
+    setJson(response, {
+        {"camera_id", cameraId},
+        {"status", "fall_detection_reset"},
+        {"fall_detection_enabled", true},
+    });
+}
+
+void InferenceService::handleResetFallAll(httplib::Response& response)
+{
+    std::map<std::string, std::shared_ptr<CameraState>> cameras;
+    {
+        const std::lock_guard<std::mutex> lock(m_camerasMutex);
+        cameras = m_cameras;
+    }
+
+    const size_t resetCount = m_config.enableFallDetection ? cameras.size() : 0;
+    for (const auto& [cameraId, state]: cameras)
+        state->resetFall();
+    PLUGIN_LOG(info, 0, "Fall detection state reset for %zu camera(s)", resetCount);
+    setJson(response, {
+        {"status", "fall_detection_reset_all"},
+        {"cameras_reset", resetCount},
+    });
+}
+
+std::shared_ptr<CameraState> InferenceService::cameraState(const std::string& cameraId)
+{
+    const std::lock_guard<std::mutex> lock(m_camerasMutex);
+    std::shared_ptr<CameraState>& state = m_cameras[cameraId];
+    if (!state)
+    {
+        PLUGIN_LOG(info, 0, "[CAMERA] Initializing new camera: %s", cameraId.c_str());
+        state = std::make_shared<CameraState>(m_config);
+    }
+    return state;
+}
+
+std::shared_ptr<CameraState> InferenceService::findCameraState(const std::string& cameraId) const
+{
+    const std::lock_guard<std::mutex> lock(m_camerasMutex);
+    const auto it = m_cameras.find(cameraId);
+    return it != m_cameras.end() ? it->second : nullptr;
+}
+
+} // namespace inference_service
+} // namespace sample_company
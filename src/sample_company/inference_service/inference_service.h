@@ -0,0 +1,92 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "camera_state.h"
+#include "preprocessor.h"
+#include "service_config.h"
+#include "shared_frame_server.h"
+#include "yolo_detector.h"
+
+namespace httplib {
+class Server;
+struct Request;
+struct Response;
+} // namespace httplib
+
+namespace sample_company {
+namespace inference_service {
+
+/**
+ * HTTP API of python/service.py: POST /infer, GET /health, GET /status, POST /reset/{camera},
+ * /reset_all, /reset_fall/{camera} and /reset_fall_all, with the same request and response
+ * bodies, over TCP and optionally over a Unix domain socket. Each connection is served by a
+ * thread of a fixed pool, and requests of all cameras
+ * are decoded, preprocessed and inferred in parallel. Plugins on the same host can send frames
+ * through shared memory instead (SharedFrameServer); they get the same detections.
+ */
+class InferenceService
+{
+public:
+    /** @throws std::exception If the model cannot be loaded. */
+    explicit InferenceService(ServiceConfig config);
+    ~InferenceService();
+
+    /** @throws std::runtime_error If the address cannot be bound. */
+    void start();
+    void stop();
+
+private:
+    /** Routes and error handling; the same for the TCP and the Unix domain socket server. */
+    void configureServer(httplib::Server* server);
+
+    /** What /infer does once the image is decoded. */
+    std::vector<ServiceDetection> detect(const std::string& cameraId, const cv::Mat& frame,
+        std::chrono::steady_clock::time_point requestStart);
+
+    /** Persons on the whole image and on the tiles its TilePlanner chooses, in one batch. */
+    std::vector<PersonDetection> detectTiled(TilePlanner* tilePlanner, const cv::Mat& image);
+
+    void handleInfer(const httplib::Request& request, httplib::Response& response);
+    void handleHealth(httplib::Response& response) const;
+    void handleStatus(httplib::Response& response) const;
+    void handleReset(const std::string& cameraId, httplib::Response& response);
+    void handleResetAll(httplib::Response& response);
+    void handleResetFall(const std::string& cameraId, httplib::Response& response);
+    void handleResetFallAll(httplib::Response& response);
+
+    std::shared_ptr<CameraState> cameraState(const std::string& cameraId);
+    std::shared_ptr<CameraState> findCameraState(const std::string& cameraId) const;
+
+private:
+    const ServiceConfig m_config;
+    const std::chrono::steady_clock::time_point m_startTime;
+    const Preprocessor m_preprocessor;
+    YoloDetector m_detector;
+
+    mutable std::mutex m_camerasMutex;
+    std::map<std::string, std::shared_ptr<CameraState>> m_cameras;
+
+    std::atomic<int64_t> m_requestCount{0};
+    std::atomic<int64_t> m_errorCount{0};
+
+    std::unique_ptr<httplib::Server> m_server;
+    std::thread m_thread;
+
+    std::unique_ptr<httplib::Server> m_unixSocketServer; //< Null if disabled.
+    std::thread m_unixSocketThread;
+
+    std::unique_ptr<SharedFrameServer> m_sharedFrameServer; //< Null if disabled.
+};
+
+} // namespace inference_service
+} // namespace sample_company
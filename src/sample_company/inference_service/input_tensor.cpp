@@ -0,0 +1,410 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "input_tensor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define INPUT_TENSOR_AVX2
+    // MSVC's /arch:AVX2 implies FMA but does not say so.
+    #if defined(__FMA__) || defined(_MSC_VER)
+        #define INPUT_TENSOR_FMA
+    #endif
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define INPUT_TENSOR_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define INPUT_TENSOR_NEON
+#endif
+
+namespace sample_company {
+namespace inference_service {
+
+namespace {
+
+constexpr float kPadValue = 114.0F / 255;
+
+/** Interpolation tables of one geometry; rebuilt only when it changes. */
+struct Workspace
+{
+    cv::Size imageSize;
+    int inputSize = 0;
+    LetterboxLayout layout;
+
+    // Per column of the scaled image: offsets of the two source pixels in a BGR row, and their
+    // weights, which include the 1/255 scaling.
+    std::vector<int> columnOffsets0;
+    std::vector<int> columnOffsets1;
+    std::vector<float> columnWeights0;
+    std::vector<float> columnWeights1;
+
+    // Per row of the scaled image: the two source rows and the weight of the second one.
+    std::vector<int> rows0;
+    std::vector<int> rows1;
+    std::vector<float> rowWeights1;
+
+    std::vector<float> blendedRow; //< Of the two source rows; 3 floats per pixel.
+    std::vector<float> outputRows; //< One row of each plane; for the INT8 output only.
+};
+
+/** Source positions of cv::resize() INTER_LINEAR: pixel centers mapped, clamped at the edges. */
+void makeAxisTable(int sourceLength, int scaledLength,
+    std::vector<int>* outIndexes0, std::vector<int>* outIndexes1, std::vector<float>* outWeights1)
+{
+    outIndexes0->resize((size_t) scaledLength);
+    outIndexes1->resize((size_t) scaledLength);
+    outWeights1->resize((size_t) scaledLength);
+
+    const double ratio = (double) sourceLength / scaledLength;
+    for (int i = 0; i < scaledLength; ++i)
+    {
+        const double position = (i + 0.5) * ratio - 0.5;
+        int index = (int) std::floor(position);
+        float weight = (float) (position - index);
+        if (index < 0)
+        {
+            index = 0;
+            weight = 0;
+        }
+        if (index >= sourceLength - 1)
+        {
+            index = sourceLength - 1;
+            weight = 0;
+        }
+        (*outIndexes0)[(size_t) i] = index;
+        (*outIndexes1)[(size_t) i] = std::min(index + 1, sourceLength - 1);
+        (*outWeights1)[(size_t) i] = weight;
+    }
+}
+
+Workspace& workspaceFor(cv::Size imageSize, int inputSize)
+{
+    thread_local Workspace workspace;
+    if (workspace.imageSize == imageSize && workspace.inputSize == inputSize)
+        return workspace;
+
+    workspace.imageSize = imageSize;
+    workspace.inputSize = inputSize;
+    workspace.layout = letterboxLayout(imageSize, inputSize);
+    const cv::Size scaledSize = workspace.layout.scaledSize;
+
+    std::vector<float> columnWeights1;
+    makeAxisTable(imageSize.width, scaledSize.width,
+        &workspace.columnOffsets0, &workspace.columnOffsets1, &columnWeights1);
+    workspace.columnWeights0.resize((size_t) scaledSize.width);
+    workspace.columnWeights1.resize((size_t) scaledSize.width);
+    for (size_t i = 0; i < (size_t) scaledSize.width; ++i)
+    {
+        workspace.columnOffsets0[i] *= 3;
+        workspace.columnOffsets1[i] *= 3;
+        workspace.columnWeights0[i] = (1 - columnWeights1[i]) / 255;
+        workspace.columnWeights1[i] = columnWeights1[i] / 255;
+    }
+
+    makeAxisTable(imageSize.height, scaledSize.height,
+        &workspace.rows0, &workspace.rows1, &workspace.rowWeights1);
+
+    workspace.blendedRow.resize((size_t) imageSize.width * 3);
+    workspace.outputRows.resize((size_t) inputSize * 3);
+    return workspace;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Kernels; each has a scalar tail for the last values.
+
+/** out[i] = row0[i] + (row1[i] - row0[i]) * weight1. */
+void blendRows(const uint8_t* row0, const uint8_t* row1, float weight1, int count, float* out)
+{
+    int i = 0;
+
+    #if defined(INPUT_TENSOR_AVX2)
+        const __m256 weight = _mm256_set1_ps(weight1);
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 a = _mm256_cvtepi32_ps(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (row0 + i))));
+            const __m256 b = _mm256_cvtepi32_ps(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (row1 + i))));
+            #if defined(INPUT_TENSOR_FMA)
+                _mm256_storeu_ps(out + i, _mm256_fmadd_ps(_mm256_sub_ps(b, a), weight, a));
+            #else
+                _mm256_storeu_ps(out + i,
+                    _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), weight)));
+            #endif
+        }
+    #elif defined(INPUT_TENSOR_SSE2)
+        const __m128 weight = _mm_set1_ps(weight1);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m128i a8 = _mm_loadu_si128((const __m128i*) (row0 + i));
+            const __m128i b8 = _mm_loadu_si128((const __m128i*) (row1 + i));
+            const __m128i a16[] = {_mm_unpacklo_epi8(a8, zero), _mm_unpackhi_epi8(a8, zero)};
+            const __m128i b16[] = {_mm_unpacklo_epi8(b8, zero), _mm_unpackhi_epi8(b8, zero)};
+            for (int half = 0; half < 2; ++half)
+            {
+                const __m128i a32[] = {
+                    _mm_unpacklo_epi16(a16[half], zero), _mm_unpackhi_epi16(a16[half], zero)};
+                const __m128i b32[] = {
+                    _mm_unpacklo_epi16(b16[half], zero), _mm_unpackhi_epi16(b16[half], zero)};
+                for (int quarter = 0; quarter < 2; ++quarter)
+                {
+                    const __m128 a = _mm_cvtepi32_ps(a32[quarter]);
+                    const __m128 b = _mm_cvtepi32_ps(b32[quarter]);
+                    _mm_storeu_ps(out + i + half * 8 + quarter * 4,
+                        _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), weight)));
+                }
+            }
+        }
+    #elif defined(INPUT_TENSOR_NEON)
+        const float32x4_t weight = vdupq_n_f32(weight1);
+        for (; i + 8 <= count; i += 8)
+        {
+            const uint16x8_t a16 = vmovl_u8(vld1_u8(row0 + i));
+            const uint16x8_t b16 = vmovl_u8(vld1_u8(row1 + i));
+            const float32x4_t aLow = vcvtq_f32_u32(vmovl_u16(vget_low_u16(a16)));
+            const float32x4_t bLow = vcvtq_f32_u32(vmovl_u16(vget_low_u16(b16)));
+            const float32x4_t aHigh = vcvtq_f32_u32(vmovl_u16(vget_high_u16(a16)));
+            const float32x4_t bHigh = vcvtq_f32_u32(vmovl_u16(vget_high_u16(b16)));
+            vst1q_f32(out + i, vfmaq_f32(aLow, vsubq_f32(bLow, aLow), weight));
+            vst1q_f32(out + i + 4, vfmaq_f32(aHigh, vsubq_f32(bHigh, aHigh), weight));
+        }
+    #endif
+
+    for (; i < count; ++i)
+        out[i] = row0[i] + (row1[i] - row0[i]) * weight1;
+}
+
+/**
+ * Samples the blended BGR row at the scaled image's columns into the R, G and B planes:
+ * plane[i] = row[offsets0[i] + channel] * weights0[i] + row[offsets1[i] + channel] * weights1[i].
+ */
+void sampleColumns(const float* row, const Workspace& workspace, int count,
+    float* outR, float* outG, float* outB)
+{
+    const int* const offsets0 = workspace.columnOffsets0.data();
+    const int* const offsets1 = workspace.columnOffsets1.data();
+    const float* const weights0 = workspace.columnWeights0.data();
+    const float* const weights1 = workspace.columnWeights1.data();
+    int i = 0;
+
+    #if defined(INPUT_TENSOR_AVX2)
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256i index0 = _mm256_loadu_si256((const __m256i*) (offsets0 + i));
+            const __m256i index1 = _mm256_loadu_si256((const __m256i*) (offsets1 + i));
+            const __m256 weight0 = _mm256_loadu_ps(weights0 + i);
+            const __m256 weight1 = _mm256_loadu_ps(weights1 + i);
+            float* const planes[] = {outB, outG, outR};
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                const __m256 a = _mm256_i32gather_ps(row + channel, index0, 4);
+                const __m256 b = _mm256_i32gather_ps(row + channel, index1, 4);
+                #if defined(INPUT_TENSOR_FMA)
+                    _mm256_storeu_ps(planes[channel] + i,
+                        _mm256_fmadd_ps(b, weight1, _mm256_mul_ps(a, weight0)));
+                #else
+                    _mm256_storeu_ps(planes[channel] + i,
+                        _mm256_add_ps(_mm256_mul_ps(a, weight0), _mm256_mul_ps(b, weight1)));
+                #endif
+            }
+        }
+    #elif defined(INPUT_TENSOR_SSE2) || defined(INPUT_TENSOR_NEON)
+        // No gather instruction: four scalar loads per vector, the arithmetic vectorized.
+        for (; i + 4 <= count; i += 4)
+        {
+            float* const planes[] = {outB, outG, outR};
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                const float* const source = row + channel;
+                const float a[] = {source[offsets0[i]], source[offsets0[i + 1]],
+                    source[offsets0[i + 2]], source[offsets0[i + 3]]};
+                const float b[] = {source[offsets1[i]], source[offsets1[i + 1]],
+                    source[offsets1[i + 2]], source[offsets1[i + 3]]};
+                #if defined(INPUT_TENSOR_SSE2)
+                    _mm_storeu_ps(planes[channel] + i, _mm_add_ps(
+                        _mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(weights0 + i)),
+                        _mm_mul_ps(_mm_loadu_ps(b), _mm_loadu_ps(weights1 + i))));
+                #else
+                    vst1q_f32(planes[channel] + i, vfmaq_f32(
+                        vmulq_f32(vld1q_f32(a), vld1q_f32(weights0 + i)),
+                        vld1q_f32(b), vld1q_f32(weights1 + i)));
+                #endif
+            }
+        }
+    #endif
+
+    for (; i < count; ++i)
+    {
+        const float* const a = row + offsets0[i];
+        const float* const b = row + offsets1[i];
+        outB[i] = a[0] * weights0[i] + b[0] * weights1[i];
+        outG[i] = a[1] * weights0[i] + b[1] * weights1[i];
+        outR[i] = a[2] * weights0[i] + b[2] * weights1[i];
+    }
+}
+
+/**
+ * out[i] = saturate(round(values[i] / scale) + zeroPoint), rounding half to even, as ONNX
+ * QuantizeLinear. A division, not a multiplication by 1 / scale: that rounds differently on a
+ * few values per frame.
+ */
+void quantizeRow(const float* values, int count, float scale, int zeroPoint, int8_t* out)
+{
+    int i = 0;
+
+    #if defined(INPUT_TENSOR_AVX2)
+        const __m256 divisor = _mm256_set1_ps(scale);
+        const __m256i zero = _mm256_set1_epi32(zeroPoint);
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256i q = _mm256_add_epi32(
+                _mm256_cvtps_epi32(_mm256_div_ps(_mm256_loadu_ps(values + i), divisor)), zero);
+            const __m128i q16 = _mm_packs_epi32(
+                _mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+            _mm_storel_epi64((__m128i*) (out + i), _mm_packs_epi16(q16, q16));
+        }
+    #elif defined(INPUT_TENSOR_SSE2)
+        const __m128 divisor = _mm_set1_ps(scale);
+        const __m128i zero = _mm_set1_epi32(zeroPoint);
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m128i low = _mm_add_epi32(
+                _mm_cvtps_epi32(_mm_div_ps(_mm_loadu_ps(values + i), divisor)), zero);
+            const __m128i high = _mm_add_epi32(
+                _mm_cvtps_epi32(_mm_div_ps(_mm_loadu_ps(values + i + 4), divisor)), zero);
+            const __m128i q16 = _mm_packs_epi32(low, high);
+            _mm_storel_epi64((__m128i*) (out + i), _mm_packs_epi16(q16, q16));
+        }
+    #elif defined(INPUT_TENSOR_NEON)
+        const float32x4_t divisor = vdupq_n_f32(scale);
+        const int32x4_t zero = vdupq_n_s32(zeroPoint);
+        for (; i + 8 <= count; i += 8)
+        {
+            const int32x4_t low = vaddq_s32(
+                vcvtnq_s32_f32(vdivq_f32(vld1q_f32(values + i), divisor)), zero);
+            const int32x4_t high = vaddq_s32(
+                vcvtnq_s32_f32(vdivq_f32(vld1q_f32(values + i + 4), divisor)), zero);
+            vst1_s8(out + i, vqmovn_s16(vcombine_s16(vqmovn_s32(low), vqmovn_s32(high))));
+        }
+    #endif
+
+    for (; i < count; ++i)
+    {
+        const long q = std::lrint(values[i] / scale) + zeroPoint;
+        out[i] = (int8_t) std::clamp(q, -128L, 127L);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+
+void checkImage(const cv::Mat& image)
+{
+    if (image.empty() || image.type() != CV_8UC3)
+        throw std::invalid_argument("The model input is made of non-empty BGR images only");
+}
+
+/** Writes row y of the model input into the three plane rows. */
+void packRow(const cv::Mat& image, Workspace& workspace, int y,
+    float* outR, float* outG, float* outB)
+{
+    const LetterboxLayout& layout = workspace.layout;
+    const int inputSize = workspace.inputSize;
+    const int scaledRow = y - layout.top;
+    if (scaledRow < 0 || scaledRow >= layout.scaledSize.height)
+    {
+        std::fill(outR, outR + inputSize, kPadValue);
+        std::fill(outG, outG + inputSize, kPadValue);
+        std::fill(outB, outB + inputSize, kPadValue);
+        return;
+    }
+
+    const int right = layout.left + layout.scaledSize.width;
+    for (float* plane: {outR, outG, outB})
+    {
+        std::fill(plane, plane + layout.left, kPadValue);
+        std::fill(plane + right, plane + inputSize, kPadValue);
+    }
+
+    float* const blendedRow = workspace.blendedRow.data();
+    blendRows(
+        image.ptr<uint8_t>(workspace.rows0[(size_t) scaledRow]),
+        image.ptr<uint8_t>(workspace.rows1[(size_t) scaledRow]),
+        workspace.rowWeights1[(size_t) scaledRow],
+        image.cols * 3,
+        blendedRow);
+    sampleColumns(blendedRow, workspace, layout.scaledSize.width,
+        outR + layout.left, outG + layout.left, outB + layout.left);
+}
+
+} // namespace
+
+LetterboxLayout letterboxLayout(cv::Size imageSize, int inputSize)
+{
+    LetterboxLayout result;
+    result.scale = std::min(
+        (float) inputSize / imageSize.width, (float) inputSize / imageSize.height);
+    result.scaledSize = cv::Size(
+        (int) std::round(imageSize.width * result.scale),
+        (int) std::round(imageSize.height * result.scale));
+    result.left = (int) std::round((inputSize - result.scaledSize.width) / 2.0F - 0.1F);
+    result.top = (int) std::round((inputSize - result.scaledSize.height) / 2.0F - 0.1F);
+    return result;
+}
+
+LetterboxLayout packInputTensor(const cv::Mat& bgrImage, int inputSize, float* outTensor)
+{
+    checkImage(bgrImage);
+
+    Workspace& workspace = workspaceFor(bgrImage.size(), inputSize);
+    const size_t planeSize = (size_t) inputSize * inputSize;
+    for (int y = 0; y < inputSize; ++y)
+    {
+        float* const r = outTensor + (size_t) y * inputSize;
+        packRow(bgrImage, workspace, y, r, r + planeSize, r + 2 * planeSize);
+    }
+    return workspace.layout;
+}
+
+LetterboxLayout packInputTensorInt8(const cv::Mat& bgrImage, int inputSize,
+    float quantizationScale, int zeroPoint, int8_t* outTensor)
+{
+    checkImage(bgrImage);
+    if (!(quantizationScale > 0))
+        throw std::invalid_argument("The quantization scale must be positive");
+
+    Workspace& workspace = workspaceFor(bgrImage.size(), inputSize);
+    const size_t planeSize = (size_t) inputSize * inputSize;
+    float* const rows = workspace.outputRows.data();
+    for (int y = 0; y < inputSize; ++y)
+    {
+        packRow(bgrImage, workspace, y, rows, rows + inputSize, rows + 2 * inputSize);
+        for (int plane = 0; plane < 3; ++plane)
+        {
+            quantizeRow(rows + plane * inputSize, inputSize, quantizationScale, zeroPoint,
+                outTensor + plane * planeSize + (size_t) y * inputSize);
+        }
+    }
+    return workspace.layout;
+}
+
+const char* inputTensorInstructionSet()
+{
+    #if defined(INPUT_TENSOR_AVX2)
+        return "AVX2";
+    #elif defined(INPUT_TENSOR_SSE2)
+        return "SSE2";
+    #elif defined(INPUT_TENSOR_NEON)
+        return "NEON";
+    #else
+        return "scalar";
+    #endif
+}
+
+} // namespace inference_service
+} // namespace sample_company
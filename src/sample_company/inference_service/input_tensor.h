@@ -0,0 +1,54 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+namespace sample_company {
+namespace inference_service {
+
+/** Where an image lies in the square model input after the ultralytics letterbox. */
+struct LetterboxLayout
+{
+    float scale = 1; //< Input pixels per image pixel.
+    cv::Size scaledSize; //< Of the image in the input.
+    int left = 0; //< Padding before the image; the rest of the input is padding too.
+    int top = 0;
+};
+
+/** Scale to fit, centered, as ultralytics' LetterBox(auto=False). */
+LetterboxLayout letterboxLayout(cv::Size imageSize, int inputSize);
+
+/**
+ * Builds the model input from a BGR image in one pass, with no intermediate images: bilinear
+ * letterbox (padded with gray 114), BGR -> RGB, scaling to [0, 1], and HWC -> CHW packing. This
+ * is what cv::resize(), cv::copyMakeBorder() and cv::dnn::blobFromImage() do in four passes.
+ *
+ * Each output row blends its two source rows, then samples the blended row for the three planes
+ * at once. Both steps use SSE2, AVX2 + FMA (the "serviceUseAvx2" CMake option) or NEON, as
+ * compiled; the interpolation tables are kept per thread and recomputed only when the geometry
+ * changes. Results are within 1/255 of the OpenCV passes, whose bilinear weights are fixed-point.
+ *
+ * Thread-safe.
+ *
+ * @param bgrImage CV_8UC3, possibly a ROI.
+ * @param outTensor 3 * inputSize * inputSize floats: the R, G and B planes, e.g. one image of a
+ *     preallocated NCHW blob.
+ * @throws std::invalid_argument If the image is empty or not CV_8UC3.
+ */
+LetterboxLayout packInputTensor(const cv::Mat& bgrImage, int inputSize, float* outTensor);
+
+/**
+ * As packInputTensor(), for models with an INT8 input: each value is then quantized as by ONNX
+ * QuantizeLinear, round(value / quantizationScale) + zeroPoint saturated to int8.
+ */
+LetterboxLayout packInputTensorInt8(const cv::Mat& bgrImage, int inputSize,
+    float quantizationScale, int zeroPoint, int8_t* outTensor);
+
+/** "AVX2", "SSE2", "NEON" or "scalar": the instruction set the kernels were compiled for. */
+const char* inputTensorInstructionSet();
+
+} // namespace inference_service
+} // namespace sample_company
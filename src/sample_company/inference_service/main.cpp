@@ -0,0 +1,59 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+/**
+ * Native inference service: a drop-in replacement of python/service.py, configured by the same
+ * environment variables. Runs until SIGINT or SIGTERM.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <exception>
+#include <thread>
+
+#include "inference_service.h"
+#include "logger.h"
+#include "service_config.h"
+
+namespace {
+
+std::atomic<bool> g_stopRequested{false};
+
+extern "C" void requestStop(int /*signal*/)
+{
+    g_stopRequested = true;
+}
+
+} // namespace
+
+int main()
+{
+    using namespace sample_company::inference_service;
+
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+
+    using sample_company::vms_server_plugins::opencv_object_detection::Logger;
+    Logger::instance().start();
+
+    int exitCode = 0;
+    try
+    {
+        const ServiceConfig config = ServiceConfig::fromEnvironment();
+        config.log();
+
+        InferenceService service(config);
+        service.start();
+        while (!g_stopRequested)
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        service.stop();
+    }
+    catch (const std::exception& e)
+    {
+        PLUGIN_LOG(error, 0, "%s", e.what());
+        exitCode = 1;
+    }
+
+    Logger::instance().stop();
+    return exitCode;
+}
@@ -0,0 +1,184 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "preprocessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace sample_company {
+namespace inference_service {
+
+namespace {
+
+double meanBrightness(const cv::Mat& image)
+{
+    const cv::Scalar channelMeans = cv::mean(image);
+    double sum = 0;
+    for (int i = 0; i < image.channels(); ++i)
+        sum += channelMeans[i];
+    return sum / image.channels();
+}
+
+} // namespace
+
+Preprocessor::Preprocessor(const ServiceConfig& config):
+    m_config(config)
+{
+}
+
+cv::Mat Preprocessor::adjustBrightness(const cv::Mat& frame, double targetBrightness)
+{
+    if (meanBrightness(frame) >= targetBrightness)
+        return frame;
+
+    // Same steps as auto_adjust_brightness() of python/service.py.
+    cv::Mat lab;
+    cv::cvtColor(frame, lab, cv::COLOR_BGR2Lab);
+    std::vector<cv::Mat> channels;
+    cv::split(lab, channels);
+    const cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(4.0, cv::Size(4, 4));
+    clahe->apply(channels[0], channels[0]);
+
+    const double lightnessMean = cv::mean(channels[0])[0];
+    if (lightnessMean < targetBrightness)
+    {
+        const double scale = std::min(targetBrightness / std::max(lightnessMean, 5.0), 3.0);
+        channels[0].convertTo(channels[0], CV_8U, scale);
+    }
+    cv::merge(channels, lab);
+    cv::Mat adjusted;
+    cv::cvtColor(lab, adjusted, cv::COLOR_Lab2BGR);
+
+    return meanBrightness(adjusted) >= targetBrightness * 0.95 ? adjusted : frame;
+}
+
+PreparedImage Preprocessor::prepare(const cv::Mat& frame) const
+{
+    cv::Mat image = frame;
+    if (m_config.enableUndistort && !m_config.cameraMatrix.empty())
+        image = undistort(image);
+
+    PreparedImage result = m_config.enableRoi
+        ? applyRoi(image)
+        : PreparedImage{image, cv::Point(0, 0)};
+
+    if (m_config.enableClahe)
+        result.image = applyClahe(result.image);
+    if (m_config.enableFrameEnhancement)
+        result.image = enhance(result.image);
+
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+cv::Mat Preprocessor::undistort(const cv::Mat& frame) const
+{
+    UndistortMaps maps;
+    {
+        const std::lock_guard<std::mutex> lock(m_undistortMutex);
+        if (m_undistortMaps.frameSize != frame.size())
+        {
+            m_undistortMaps.frameSize = frame.size();
+            const cv::Mat newCameraMatrix = cv::getOptimalNewCameraMatrix(
+                m_config.cameraMatrix, m_config.distortionCoefficients, frame.size(),
+                /*alpha*/ 0.9, frame.size(), &m_undistortMaps.validRect);
+            cv::initUndistortRectifyMap(m_config.cameraMatrix, m_config.distortionCoefficients,
+                cv::Mat(), newCameraMatrix, frame.size(), CV_16SC2,
+                m_undistortMaps.map1, m_undistortMaps.map2);
+            m_undistortMaps.validRect &= cv::Rect(cv::Point(0, 0), frame.size());
+        }
+        maps = m_undistortMaps; //< Mat headers only; the maps are never modified in place.
+    }
+
+    cv::Mat result;
+    cv::remap(frame, result, maps.map1, maps.map2, cv::INTER_LINEAR);
+    if (!maps.validRect.empty() && maps.validRect.size() != frame.size())
+        result = result(maps.validRect);
+    return result;
+}
+
+PreparedImage Preprocessor::applyRoi(const cv::Mat& frame) const
+{
+    const int width = frame.cols;
+    const int height = frame.rows;
+
+    if (m_config.roiType == RoiType::rect)
+    {
+        const cv::Point topLeft(
+            std::max(0, (int) (width * m_config.roiXMin)),
+            std::max(0, (int) (height * m_config.roiYMin)));
+        const cv::Point bottomRight(
+            std::min(width, (int) (width * m_config.roiXMax)),
+            std::min(height, (int) (height * m_config.roiYMax)));
+        const cv::Rect roi(topLeft, bottomRight);
+        if (roi.empty())
+            return {frame, cv::Point(0, 0)};
+        return {frame(roi), topLeft};
+    }
+
+    // Polygon: everything outside is blacked out, and the image is cropped to the polygon's
+    // bounding box, so that the offset added to the boxes matches the image.
+    std::vector<cv::Point> points;
+    for (const cv::Point2f& point: m_config.roiPolygon)
+        points.emplace_back((int) (point.x * width), (int) (point.y * height));
+    const cv::Rect roi = cv::boundingRect(points) & cv::Rect(0, 0, width, height);
+    if (roi.empty())
+        return {frame, cv::Point(0, 0)};
+
+    cv::Mat mask = cv::Mat::zeros(frame.size(), CV_8UC1);
+    cv::fillPoly(mask, std::vector<std::vector<cv::Point>>{points}, cv::Scalar(255));
+    cv::Mat masked = cv::Mat::zeros(roi.size(), frame.type());
+    frame(roi).copyTo(masked, mask(roi));
+    return {masked, roi.tl()};
+}
+
+cv::Mat Preprocessor::applyClahe(const cv::Mat& frame) const
+{
+    cv::Mat lab;
+    cv::cvtColor(frame, lab, cv::COLOR_BGR2Lab);
+    std::vector<cv::Mat> channels;
+    cv::split(lab, channels);
+
+    const cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(
+        m_config.claheClipLimit, cv::Size(m_config.claheTileSize, m_config.claheTileSize));
+    clahe->apply(channels[0], channels[0]);
+
+    cv::merge(channels, lab);
+    cv::Mat result;
+    cv::cvtColor(lab, result, cv::COLOR_Lab2BGR);
+    return result;
+}
+
+cv::Mat Preprocessor::enhance(const cv::Mat& frame)
+{
+    static const cv::Mat gammaTable =
+        []()
+        {
+            constexpr double kGamma = 1.1;
+            cv::Mat table(1, 256, CV_8U);
+            for (int i = 0; i < 256; ++i)
+                table.at<uchar>(i) = (uchar) (std::pow(i / 255.0, 1.0 / kGamma) * 255);
+            return table;
+        }();
+
+    cv::Mat denoised;
+    cv::bilateralFilter(frame, denoised, 9, 75, 75);
+    cv::Mat brightened;
+    cv::LUT(denoised, gammaTable, brightened);
+
+    // Unsharp mask.
+    cv::Mat blurred;
+    cv::GaussianBlur(brightened, blurred, cv::Size(0, 0), 2.0);
+    cv::Mat result;
+    cv::addWeighted(brightened, 1.5, blurred, -0.5, 0, result);
+    return result;
+}
+
+} // namespace inference_service
+} // namespace sample_company
@@ -0,0 +1,60 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <mutex>
+
+#include <opencv2/core.hpp>
+
+#include "service_config.h"
+
+namespace sample_company {
+namespace inference_service {
+
+/** Image the model runs on, and where it lies in the frame the coordinates are reported in. */
+struct PreparedImage
+{
+    cv::Mat image;
+    cv::Point offset;
+};
+
+/**
+ * The image steps of python/service.py before the model: brightness correction of raw BGR
+ * frames, undistortion, ROI and CLAHE. Thread-safe; the undistortion maps are computed once per
+ * frame size instead of on every frame.
+ */
+class Preprocessor
+{
+public:
+    explicit Preprocessor(const ServiceConfig& config);
+
+    /**
+     * Brightens dark frames: CLAHE on the L channel, then scaling it up to the target mean. Only
+     * applied to the raw BGR frames of the legacy plugin path, which come out dark.
+     */
+    static cv::Mat adjustBrightness(const cv::Mat& frame, double targetBrightness);
+
+    PreparedImage prepare(const cv::Mat& frame) const;
+
+private:
+    cv::Mat undistort(const cv::Mat& frame) const;
+    PreparedImage applyRoi(const cv::Mat& frame) const;
+    cv::Mat applyClahe(const cv::Mat& frame) const;
+    static cv::Mat enhance(const cv::Mat& frame);
+
+private:
+    const ServiceConfig& m_config;
+
+    struct UndistortMaps
+    {
+        cv::Size frameSize;
+        cv::Mat map1;
+        cv::Mat map2;
+        cv::Rect validRect; //< Crop that removes the black borders.
+    };
+    mutable std::mutex m_undistortMutex;
+    mutable UndistortMaps m_undistortMaps;
+};
+
+} // namespace inference_service
+} // namespace sample_company
@@ -0,0 +1,281 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "service_config.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#include "json.hpp"
+#include "logger.h"
+
+namespace sample_company {
+namespace inference_service {
+
+using json = nlohmann::json;
+
+namespace {
+
+const char* envValue(const char* name)
+{
+    const char* value = std::getenv(name);
+    return (value && *value) ? value : nullptr;
+}
+
+void readString(const char* name, std::string* inOutValue)
+{
+    if (const char* value = envValue(name))
+        *inOutValue = value;
+}
+
+void readBool(const char* name, bool* inOutValue)
+{
+    if (const char* value = envValue(name))
+    {
+        std::string lowerCase = value;
+        std::transform(lowerCase.begin(), lowerCase.end(), lowerCase.begin(),
+            [](unsigned char c) { return (char) std::tolower(c); });
+        *inOutValue = lowerCase == "true";
+    }
+}
+
+template<typename Number>
+void readNumber(const char* name, Number* inOutValue)
+{
+    const char* value = envValue(name);
+    if (!value)
+        return;
+
+    try
+    {
+        size_t parsedLength = 0;
+        const double number = std::stod(value, &parsedLength);
+        if (value[parsedLength] != '\0')
+            throw std::invalid_argument(value);
+        *inOutValue = (Number) number;
+    }
+    catch (const std::exception&)
+    {
+        PLUGIN_LOG(warning, 0, "%s: not a number: \"%s\"; using %g", name, value,
+            (double) *inOutValue);
+    }
+}
+
+void readSeconds(const char* name, std::chrono::duration<double>* inOutValue)
+{
+    double seconds = inOutValue->count();
+    readNumber(name, &seconds);
+    *inOutValue = std::chrono::duration<double>(seconds);
+}
+
+cv::Mat matFromJson(const json& rows)
+{
+    if (!rows.is_array() || rows.empty())
+        throw std::invalid_argument("not a non-empty array");
+
+    // [[...], [...]] is a matrix, [...] a row vector.
+    const bool isMatrix = rows.front().is_array();
+    const int rowCount = isMatrix ? (int) rows.size() : 1;
+    const int columnCount = isMatrix ? (int) rows.front().size() : (int) rows.size();
+
+    cv::Mat result(rowCount, columnCount, CV_64FC1);
+    for (int row = 0; row < rowCount; ++row)
+    {
+        const json& values = isMatrix ? rows.at((size_t) row) : rows;
+        if ((int) values.size() != columnCount)
+            throw std::invalid_argument("rows of different length");
+        for (int column = 0; column < columnCount; ++column)
+            result.at<double>(row, column) = values.at((size_t) column).get<double>();
+    }
+    return result;
+}
+
+/** Same sources and order as load_calibration() of python/service.py. */
+void loadCalibration(ServiceConfig* config)
+{
+    const char* cameraMatrixJson = envValue("CAMERA_MATRIX_JSON");
+    const char* distortionJson = envValue("DISTORTION_COEFFS_JSON");
+    if (cameraMatrixJson && distortionJson)
+    {
+        try
+        {
+            config->cameraMatrix = matFromJson(json::parse(cameraMatrixJson));
+            config->distortionCoefficients = matFromJson(json::parse(distortionJson));
+            PLUGIN_LOG(info, 0, "Camera calibration loaded from environment variables");
+            return;
+        }
+        catch (const std::exception& e)
+        {
+            PLUGIN_LOG(warning, 0, "Failed to load calibration from env: %s", e.what());
+        }
+    }
+
+    std::string calibrationFile = "camera_calibration.json";
+    readString("CALIBRATION_FILE", &calibrationFile);
+    std::ifstream file(calibrationFile);
+    if (file)
+    {
+        try
+        {
+            const json calibration = json::parse(file);
+            config->cameraMatrix = matFromJson(calibration.at("camera_matrix"));
+            config->distortionCoefficients =
+                matFromJson(calibration.at("distortion_coefficients"));
+            PLUGIN_LOG(info, 0, "Camera calibration loaded from %s", calibrationFile.c_str());
+            return;
+        }
+        catch (const std::exception& e)
+        {
+            PLUGIN_LOG(warning, 0, "Failed to load calibration from file: %s", e.what());
+        }
+    }
+
+    config->cameraMatrix = cv::Mat();
+    config->distortionCoefficients = cv::Mat();
+    PLUGIN_LOG(warning, 0, "Undistort enabled but no calibration data found. "
+        "Create camera_calibration.json or set env variables.");
+}
+
+std::vector<cv::Point2f> polygonFromJson(const char* polygonJson)
+{
+    std::vector<cv::Point2f> result;
+    for (const json& point: json::parse(polygonJson))
+        result.emplace_back(point.at(0).get<float>(), point.at(1).get<float>());
+    if (result.size() < 3)
+        throw std::invalid_argument("less than 3 points");
+    return result;
+}
+
+} // namespace
+
+ServiceConfig ServiceConfig::fromEnvironment()
+{
+    ServiceConfig config;
+
+    readString("SERVICE_HOST", &config.host);
+    readNumber("SERVICE_PORT", &config.port);
+    readString("SERVICE_UNIX_SOCKET", &config.unixSocketPath);
+
+    readString("MODEL_PATH", &config.modelPath);
+    readNumber("YOLO_IMGSZ", &config.inputSize);
+    readNumber("CONFIDENCE_THRESHOLD", &config.confidenceThreshold);
+    readNumber("IOU_THRESHOLD", &config.iouThreshold);
+    readNumber("MIN_DETECTION_AREA", &config.minDetectionArea);
+
+    readBool("ENABLE_TILING", &config.enableTiling);
+    readNumber("TILE_OVERLAP", &config.tileOverlap);
+    readNumber("TILE_FULL_SCAN_INTERVAL", &config.tileFullScanInterval);
+    readSeconds("TILE_ACTIVITY_TTL", &config.tileActivityTtl);
+
+    readBool("ENABLE_SHARED_FRAMES", &config.enableSharedFrames);
+    readString("SHARED_FRAME_SOCKET", &config.sharedFrameSocketPath);
+    readNumber("HTTP_THREADS", &config.httpThreadCount);
+    readNumber("INFERENCE_THREADS", &config.inferenceThreadCount);
+
+    readSeconds("TRACK_TTL", &config.trackTtl);
+    readNumber("IOA_THRESHOLD", &config.ioaThreshold);
+    readSeconds("FLICKER_REUSE_TIME", &config.flickerReuseTime);
+
+    readBool("ENABLE_FALL_DETECTION", &config.enableFallDetection);
+    readNumber("FALL_VELOCITY_THRESHOLD", &config.fallVelocityThreshold);
+    readNumber("FALL_ANGLE_CHANGE_THRESHOLD", &config.fallAngleChangeThreshold);
+    readNumber("FALL_ASPECT_RATIO_THRESHOLD", &config.fallAspectRatioThreshold);
+    readNumber("FALL_CONFIDENCE_THRESHOLD", &config.fallConfidenceThreshold);
+
+    readBool("ENABLE_CLAHE", &config.enableClahe);
+    readNumber("CLAHE_CLIP_LIMIT", &config.claheClipLimit);
+    readNumber("CLAHE_TILE_SIZE", &config.claheTileSize);
+    readBool("ENABLE_FRAME_ENHANCEMENT", &config.enableFrameEnhancement);
+
+    readBool("ENABLE_ROI", &config.enableRoi);
+    std::string roiType = "rect";
+    readString("ROI_TYPE", &roiType);
+    config.roiType = roiType == "polygon" ? RoiType::polygon : RoiType::rect;
+    readNumber("ROI_X_MIN", &config.roiXMin);
+    readNumber("ROI_X_MAX", &config.roiXMax);
+    readNumber("ROI_Y_MIN", &config.roiYMin);
+    readNumber("ROI_Y_MAX", &config.roiYMax);
+    if (config.enableRoi && config.roiType == RoiType::polygon)
+    {
+        const char* polygonJson = envValue("ROI_POLYGON_JSON");
+        try
+        {
+            if (!polygonJson)
+                throw std::invalid_argument("ROI_POLYGON_JSON not provided");
+            config.roiPolygon = polygonFromJson(polygonJson);
+        }
+        catch (const std::exception& e)
+        {
+            PLUGIN_LOG(warning, 0, "Polygon ROI: %s; using full frame", e.what());
+            config.enableRoi = false;
+        }
+    }
+
+    readBool("ENABLE_UNDISTORT", &config.enableUndistort);
+    if (config.enableUndistort)
+        loadCalibration(&config);
+
+    const ServiceConfig defaults;
+    if (config.inputSize <= 0 || config.inputSize % 32 != 0)
+    {
+        PLUGIN_LOG(warning, 0, "YOLO_IMGSZ must be a positive multiple of 32; using %d",
+            defaults.inputSize);
+        config.inputSize = defaults.inputSize;
+    }
+    config.tileOverlap = std::clamp(config.tileOverlap, 0.0F, 0.5F);
+    config.tileFullScanInterval = std::max(1, config.tileFullScanInterval);
+    if (config.inferenceThreadCount <= 0)
+        config.inferenceThreadCount = std::max(1, (int) std::thread::hardware_concurrency());
+    config.httpThreadCount = std::max(1, config.httpThreadCount);
+    #if defined(_WIN32)
+        config.enableSharedFrames = false;
+        if (!config.unixSocketPath.empty())
+        {
+            PLUGIN_LOG(warning, 0, "SERVICE_UNIX_SOCKET is not supported on Windows; ignored");
+            config.unixSocketPath.clear();
+        }
+    #endif
+    config.claheTileSize = std::max(1, config.claheTileSize);
+
+    return config;
+}
+
+void ServiceConfig::log() const
+{
+    PLUGIN_LOG(info, 0, "YOLOv8 People Analytics Service (native)");
+    PLUGIN_LOG(info, 0, "Address: %s:%d, %d HTTP threads, %d inference threads",
+        host.c_str(), port, httpThreadCount, inferenceThreadCount);
+    if (!unixSocketPath.empty())
+        PLUGIN_LOG(info, 0, "HTTP also on unix:%s", unixSocketPath.c_str());
+    PLUGIN_LOG(info, 0, "Shared frames: %s",
+        enableSharedFrames ? sharedFrameSocketPath.c_str() : "disabled");
+    PLUGIN_LOG(info, 0, "Model: %s, input %dx%d, confidence %.2f, IoU %.2f",
+        modelPath.c_str(), inputSize, inputSize, confidenceThreshold, iouThreshold);
+    if (enableTiling)
+    {
+        PLUGIN_LOG(info, 0, "Tiling: %dx%d tiles, overlap %.2f, full scan every %d frames, "
+            "activity kept %.1f s",
+            inputSize, inputSize, tileOverlap, tileFullScanInterval, tileActivityTtl.count());
+    }
+    PLUGIN_LOG(info, 0, "CLAHE: %d, frame enhancement: %d, ROI: %d (%s), undistort: %d",
+        (int) enableClahe, (int) enableFrameEnhancement, (int) enableRoi,
+        roiType == RoiType::polygon ? "polygon" : "rect",
+        (int) (enableUndistort && !cameraMatrix.empty()));
+    if (enableFallDetection)
+    {
+        PLUGIN_LOG(info, 0, "Fall detection: velocity %.1f px/frame, angle change %.1f deg, "
+            "aspect ratio %.2f, confidence %.2f",
+            fallVelocityThreshold, fallAngleChangeThreshold, fallAspectRatioThreshold,
+            fallConfidenceThreshold);
+    }
+    else
+    {
+        PLUGIN_LOG(info, 0, "Fall detection: disabled");
+    }
+}
+
+} // namespace inference_service
+} // namespace sample_company
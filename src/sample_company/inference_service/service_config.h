@@ -0,0 +1,94 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+namespace sample_company {
+namespace inference_service {
+
+enum class RoiType
+{
+    rect,
+    polygon,
+};
+
+/**
+ * Configuration of the service. The environment variables and their defaults are those of
+ * python/service.py, so that both services can be started the same way.
+ */
+struct ServiceConfig
+{
+    std::string host = "127.0.0.1";
+    int port = 18000;
+    std::string unixSocketPath; //< HTTP on a Unix domain socket too, if not empty.
+
+    std::string modelPath = "yolov8n.onnx"; //< YOLOv8 detect or pose ONNX model, FP32 or INT8.
+    int inputSize = 640; //< YOLO_IMGSZ; must be the size the model was exported with.
+    float confidenceThreshold = 0.35F;
+    float iouThreshold = 0.45F;
+    float minDetectionArea = 20;
+
+    /**
+     * Small people in wide views: besides the whole image, overlapping tiles of inputSize are run
+     * in the same batch, at full resolution; tiles are re-run only around recent detections
+     * between full scans.
+     *
+     * Only images larger than inputSize have more than one tile. The plugin sends images of its
+     * encodeWidth camera setting, 640 px by default, so with the default YOLO_IMGSZ of 640 this
+     * does nothing until encodeWidth is raised (e.g. to 1280); TilePlanner warns then.
+     */
+    bool enableTiling = false;
+    float tileOverlap = 0.2F; //< Fraction of a tile shared with each neighbor.
+    int tileFullScanInterval = 10; //< Every this many frames, all tiles are run.
+    std::chrono::duration<double> tileActivityTtl{3.0}; //< How long a detection keeps tiles on.
+
+    bool enableSharedFrames = true; //< Unix socket + shared memory for plugins on this host.
+    std::string sharedFrameSocketPath = "/tmp/safeaging_inference.sock";
+
+    int httpThreadCount = 64; //< Each keep-alive connection (one per camera) holds a thread.
+    int inferenceThreadCount = 0; //< Models run at once; 0 means one per hardware core.
+
+    std::chrono::duration<double> trackTtl{15.0};
+    std::chrono::duration<double> trackHistoryTtl{30.0};
+    float ioaThreshold = 0.05F;
+    std::chrono::duration<double> flickerReuseTime{1.0};
+
+    bool enableFallDetection = true;
+    float fallVelocityThreshold = 20; //< Pixels per frame.
+    float fallAngleChangeThreshold = 45; //< Degrees.
+    float fallAspectRatioThreshold = 1.5F; //< Width / height.
+    float fallConfidenceThreshold = 0.8F;
+
+    bool enableClahe = true;
+    double claheClipLimit = 2.0;
+    int claheTileSize = 16;
+    bool enableFrameEnhancement = false;
+
+    bool enableRoi = true;
+    RoiType roiType = RoiType::rect;
+    float roiXMin = 0; //< Rectangle ROI, as fractions of the frame.
+    float roiXMax = 1;
+    float roiYMin = 0.3F;
+    float roiYMax = 1;
+    std::vector<cv::Point2f> roiPolygon; //< Polygon ROI, as fractions of the frame.
+
+    bool enableUndistort = true;
+    cv::Mat cameraMatrix; //< Empty if no calibration was found.
+    cv::Mat distortionCoefficients;
+
+    /**
+     * Reads the environment, and the calibration file it points to. Invalid values are logged and
+     * the defaults are kept.
+     */
+    static ServiceConfig fromEnvironment();
+
+    void log() const;
+};
+
+} // namespace inference_service
+} // namespace sample_company
@@ -0,0 +1,265 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "shared_frame_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if !defined(_WIN32)
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+#include "logger.h"
+#include "shared_frame_ring.h"
+
+namespace sample_company {
+namespace inference_service {
+
+using namespace vms_server_plugins::opencv_object_detection;
+using namespace std::chrono;
+
+namespace {
+
+/** How often blocked threads look at the stop flag. */
+constexpr milliseconds kStopCheckPeriod{200};
+
+void fillSharedDetection(const ServiceDetection& detection, SharedDetection* result)
+{
+    *result = SharedDetection();
+    result->x = detection.box.x;
+    result->y = detection.box.y;
+    result->width = detection.box.width;
+    result->height = detection.box.height;
+    result->score = detection.score;
+    result->classId = detection.classId;
+    result->trackId = detection.trackId;
+    result->isFallDetected = detection.isFallDetected ? 1 : 0;
+    if (detection.keypoints.size() == (size_t) kSharedFrameKeypointCount)
+    {
+        result->hasKeypoints = 1;
+        for (int i = 0; i < kSharedFrameKeypointCount; ++i)
+        {
+            result->keypoints[i][0] = detection.keypoints[i].x;
+            result->keypoints[i][1] = detection.keypoints[i].y;
+            result->keypoints[i][2] = detection.keypoints[i].z;
+        }
+    }
+}
+
+} // namespace
+
+SharedFrameServer::SharedFrameServer(std::string socketPath, Handler handler):
+    m_socketPath(std::move(socketPath)),
+    m_handler(std::move(handler))
+{
+}
+
+SharedFrameServer::~SharedFrameServer()
+{
+    stop();
+}
+
+#if !defined(_WIN32)
+
+void SharedFrameServer::start()
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_socketPath.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Shared frame socket path is too long: " + m_socketPath);
+    std::memcpy(address.sun_path, m_socketPath.c_str(), m_socketPath.size() + 1);
+
+    m_listeningSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listeningSocket < 0)
+        throw std::runtime_error(std::string("Shared frame socket: ") + std::strerror(errno));
+
+    // A socket file left by a previous run that crashed.
+    ::unlink(m_socketPath.c_str());
+    if (bind(m_listeningSocket, (const sockaddr*) &address, sizeof(address)) != 0
+        || listen(m_listeningSocket, SOMAXCONN) != 0)
+    {
+        const std::string error = std::strerror(errno);
+        close(m_listeningSocket);
+        m_listeningSocket = -1;
+        throw std::runtime_error("Cannot listen on " + m_socketPath + ": " + error);
+    }
+
+    m_acceptThread = std::thread([this]() { acceptConnections(); });
+    PLUGIN_LOG(info, 0, "Shared frame transport listening on %s", m_socketPath.c_str());
+}
+
+void SharedFrameServer::stop()
+{
+    if (!m_acceptThread.joinable())
+        return;
+
+    m_isStopping = true;
+    m_acceptThread.join();
+    joinFinishedConnections();
+    close(m_listeningSocket);
+    m_listeningSocket = -1;
+    ::unlink(m_socketPath.c_str());
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void SharedFrameServer::acceptConnections()
+{
+    while (!m_isStopping)
+    {
+        joinFinishedConnections();
+
+        pollfd descriptor{m_listeningSocket, POLLIN, 0};
+        if (poll(&descriptor, 1, (int) kStopCheckPeriod.count()) <= 0)
+            continue;
+
+        const int socket = accept(m_listeningSocket, nullptr, nullptr);
+        if (socket < 0)
+            continue;
+
+        #if defined(SO_NOSIGPIPE)
+            const int enable = 1;
+            setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+        #endif
+
+        const std::lock_guard<std::mutex> lock(m_connectionsMutex);
+        Connection& connection = m_connections.emplace_back();
+        connection.thread = std::thread(
+            [this, socket, &connection]()
+            {
+                serveConnection(socket);
+                close(socket);
+                connection.isFinished = true;
+            });
+    }
+}
+
+void SharedFrameServer::serveConnection(int socket)
+{
+    std::string cameraId;
+    try
+    {
+        SharedFrameHello hello;
+        while (!receiveSharedFrameBytes(socket, &hello, sizeof(hello), kStopCheckPeriod))
+        {
+            if (m_isStopping)
+                return;
+        }
+        if (hello.magic != kSharedFrameMagic || hello.version != kSharedFrameVersion)
+            throw std::runtime_error("unsupported protocol version");
+        hello.segmentName[sizeof(hello.segmentName) - 1] = '\0';
+        hello.cameraId[sizeof(hello.cameraId) - 1] = '\0';
+        cameraId = hello.cameraId[0] ? hello.cameraId : "default";
+
+        const SharedFrameRing ring = SharedFrameRing::open(hello.segmentName);
+
+        SharedFrameMessage reply;
+        reply.type = SharedFrameMessageType::helloAccepted;
+        sendSharedFrameBytes(socket, &reply, sizeof(reply));
+        PLUGIN_LOG(info, 0, "[%s] Shared frame transport connected", cameraId.c_str());
+
+        while (!m_isStopping)
+        {
+            SharedFrameMessage request;
+            if (!receiveSharedFrameBytes(socket, &request, sizeof(request), kStopCheckPeriod))
+                continue;
+            const auto requestStart = steady_clock::now();
+
+            if (request.type != SharedFrameMessageType::frameSubmitted
+                || request.slotIndex >= (uint32_t) kSharedFrameSlotCount)
+            {
+                throw std::runtime_error("malformed request");
+            }
+            SharedFrameSlotHeader& slot = ring.slot((int) request.slotIndex);
+            if (slot.state.load(std::memory_order_acquire) != SharedFrameSlotState::submitted)
+                throw std::runtime_error("frame announced for a slot that is not submitted");
+
+            const uint32_t width = slot.width;
+            const uint32_t height = slot.height;
+            const uint32_t stride = slot.stride;
+            slot.status = -1;
+            slot.detectionCount = 0;
+            if (width > 0 && height > 0 && stride >= width * 3
+                && (uint64_t) stride * height <= kSharedFrameMaxPixelBytes)
+            {
+                const cv::Mat frame((int) height, (int) width, CV_8UC3,
+                    ring.pixels((int) request.slotIndex), stride);
+                try
+                {
+                    const std::vector<ServiceDetection> detections =
+                        m_handler(cameraId, frame, requestStart);
+                    const size_t count =
+                        std::min(detections.size(), (size_t) kSharedFrameMaxDetections);
+                    for (size_t i = 0; i < count; ++i)
+                        fillSharedDetection(detections[i], &slot.detections[i]);
+                    slot.detectionCount = (uint32_t) count;
+                    slot.status = 0;
+                }
+                catch (const std::exception& e)
+                {
+                    PLUGIN_LOG(error, 1, "[%s] Shared frame: %s", cameraId.c_str(), e.what());
+                }
+            }
+            slot.state.store(SharedFrameSlotState::done, std::memory_order_release);
+
+            reply.type = SharedFrameMessageType::detectionsReady;
+            reply.slotIndex = request.slotIndex;
+            reply.sequence = request.sequence;
+            sendSharedFrameBytes(socket, &reply, sizeof(reply));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // A closed connection is the normal end of a camera.
+        PLUGIN_LOG(info, 0, "[%s] Shared frame transport disconnected: %s",
+            cameraId.c_str(), e.what());
+    }
+}
+
+#else // defined(_WIN32)
+
+void SharedFrameServer::start()
+{
+    throw std::runtime_error("Shared frame transport is not supported on Windows");
+}
+
+void SharedFrameServer::stop()
+{
+}
+
+void SharedFrameServer::acceptConnections()
+{
+}
+
+void SharedFrameServer::serveConnection(int /*socket*/)
+{
+}
+
+#endif // !defined(_WIN32)
+
+void SharedFrameServer::joinFinishedConnections()
+{
+    const std::lock_guard<std::mutex> lock(m_connectionsMutex);
+    for (auto it = m_connections.begin(); it != m_connections.end();)
+    {
+        if (m_isStopping || it->isFinished)
+        {
+            it->thread.join();
+            it = m_connections.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+} // namespace inference_service
+} // namespace sample_company
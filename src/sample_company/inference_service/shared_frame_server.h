@@ -0,0 +1,71 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "camera_state.h"
+
+namespace sample_company {
+namespace inference_service {
+
+/**
+ * Service side of the shared memory frame transport of the plugin (see shared_frame_ring.h):
+ * listens on a Unix domain socket, maps the frame ring of each connecting camera and answers
+ * each submitted frame with its detections, written back into the same slot.
+ *
+ * Like the HTTP server, each connection (one per camera) is served by its own thread; the frame
+ * is given to the handler in place, without a copy.
+ */
+class SharedFrameServer
+{
+public:
+    using Handler = std::function<std::vector<ServiceDetection>(
+        const std::string& cameraId,
+        const cv::Mat& frame,
+        std::chrono::steady_clock::time_point requestStart)>;
+
+public:
+    SharedFrameServer(std::string socketPath, Handler handler);
+    ~SharedFrameServer();
+
+    /** @throws std::runtime_error If the socket cannot be created. */
+    void start();
+    void stop();
+
+private:
+    struct Connection
+    {
+        std::thread thread;
+        std::atomic<bool> isFinished{false};
+    };
+
+    void acceptConnections();
+    void serveConnection(int socket);
+
+    /** Joins the threads of closed connections; all of them if the server is stopping. */
+    void joinFinishedConnections();
+
+private:
+    const std::string m_socketPath;
+    const Handler m_handler;
+
+    int m_listeningSocket = -1;
+    std::atomic<bool> m_isStopping{false};
+    std::thread m_acceptThread;
+
+    std::mutex m_connectionsMutex;
+    std::list<Connection> m_connections;
+};
+
+} // namespace inference_service
+} // namespace sample_company
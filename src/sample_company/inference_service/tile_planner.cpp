@@ -0,0 +1,198 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "tile_planner.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "logger.h"
+
+namespace sample_company {
+namespace inference_service {
+
+namespace {
+
+/** A box this close to an inner tile border is taken as cut by it. */
+constexpr float kCutBorderMargin = 2;
+
+/** Intersection over the smaller box above which a cut box is the same person as the other. */
+constexpr float kCutContainmentThreshold = 0.6F;
+
+/** How far around a recent detection, as a fraction of its size, a person may have moved. */
+constexpr float kActivityMargin = 0.5F;
+
+std::vector<int> tileOrigins(int length, int tileSize, float overlap)
+{
+    if (length <= tileSize)
+        return {0};
+
+    const double step = tileSize * (1.0 - overlap);
+    const int count = (int) std::ceil((length - tileSize) / step) + 1;
+    std::vector<int> result;
+    for (int i = 0; i < count; ++i)
+        result.push_back((int) std::lround((double) i * (length - tileSize) / (count - 1)));
+    return result;
+}
+
+bool isCutByTile(const cv::Rect2f& box, const cv::Rect& tile, cv::Size imageSize)
+{
+    return (tile.x > 0 && box.x <= tile.x + kCutBorderMargin)
+        || (tile.y > 0 && box.y <= tile.y + kCutBorderMargin)
+        || (tile.x + tile.width < imageSize.width
+            && box.x + box.width >= tile.x + tile.width - kCutBorderMargin)
+        || (tile.y + tile.height < imageSize.height
+            && box.y + box.height >= tile.y + tile.height - kCutBorderMargin);
+}
+
+} // namespace
+
+std::vector<cv::Rect> makeTileGrid(cv::Size imageSize, int tileSize, float overlap)
+{
+    const int width = std::min(tileSize, imageSize.width);
+    const int height = std::min(tileSize, imageSize.height);
+
+    std::vector<cv::Rect> result;
+    for (const int y: tileOrigins(imageSize.height, tileSize, overlap))
+    {
+        for (const int x: tileOrigins(imageSize.width, tileSize, overlap))
+            result.emplace_back(x, y, width, height);
+    }
+    return result;
+}
+
+std::vector<PersonDetection> mergeTileDetections(
+    const std::vector<cv::Rect>& tiles,
+    const std::vector<std::vector<PersonDetection>>& tileDetections,
+    cv::Size imageSize,
+    float iouThreshold)
+{
+    struct Candidate
+    {
+        PersonDetection person;
+        bool isCut = false;
+    };
+
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < tiles.size() && i < tileDetections.size(); ++i)
+    {
+        for (const PersonDetection& person: tileDetections[i])
+            candidates.push_back({person, isCutByTile(person.box, tiles[i], imageSize)});
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [](const Candidate& a, const Candidate& b) { return a.person.score > b.person.score; });
+
+    std::vector<Candidate> kept;
+    for (Candidate& candidate: candidates)
+    {
+        const float area = candidate.person.box.area();
+        bool isDuplicate = false;
+        for (Candidate& other: kept)
+        {
+            const float intersection = (candidate.person.box & other.person.box).area();
+            const float otherArea = other.person.box.area();
+            const float iou = intersection / std::max(area + otherArea - intersection, 1e-6F);
+            const bool isCutPart = (candidate.isCut || other.isCut)
+                && intersection / std::max(std::min(area, otherArea), 1e-6F)
+                    > kCutContainmentThreshold;
+            if (iou <= iouThreshold && !isCutPart)
+                continue;
+
+            isDuplicate = true;
+            if (candidate.isCut || other.isCut)
+                other.person.box |= candidate.person.box;
+            if (other.isCut && !candidate.isCut)
+            {
+                other.person.keypoints = std::move(candidate.person.keypoints);
+                other.isCut = false;
+            }
+            break;
+        }
+        if (!isDuplicate)
+            kept.push_back(std::move(candidate));
+    }
+
+    std::vector<PersonDetection> result;
+    result.reserve(kept.size());
+    for (Candidate& candidate: kept)
+        result.push_back(std::move(candidate.person));
+    return result;
+}
+
+TilePlanner::TilePlanner(const ServiceConfig& config):
+    m_config(config)
+{
+}
+
+std::vector<cv::Rect> TilePlanner::plan(cv::Size imageSize, Clock::time_point now)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (imageSize != m_imageSize)
+    {
+        m_imageSize = imageSize;
+        m_tiles = makeTileGrid(imageSize, m_config.inputSize, m_config.tileOverlap);
+        m_framesSinceFullScan = m_config.tileFullScanInterval;
+        m_activity.clear();
+        if (m_tiles.size() <= 1)
+        {
+            PLUGIN_LOG(warning, 0.1, "Tiling has no effect on %dx%d images: they fit in one "
+                "%d px tile; raise encodeWidth in the camera settings of the plugin",
+                imageSize.width, imageSize.height, m_config.inputSize);
+        }
+    }
+    if (m_tiles.size() <= 1)
+        return {};
+
+    if (m_framesSinceFullScan >= m_config.tileFullScanInterval)
+    {
+        m_framesSinceFullScan = 1;
+        return m_tiles;
+    }
+    ++m_framesSinceFullScan;
+
+    removeExpiredActivity(now);
+
+    std::vector<cv::Rect> result;
+    for (const cv::Rect& tile: m_tiles)
+    {
+        const cv::Rect2f tileBox((float) tile.x, (float) tile.y,
+            (float) tile.width, (float) tile.height);
+        const bool isActive = std::any_of(m_activity.begin(), m_activity.end(),
+            [&](const Activity& activity) { return !(activity.box & tileBox).empty(); });
+        if (isActive)
+            result.push_back(tile);
+    }
+    return result;
+}
+
+void TilePlanner::recordActivity(
+    const std::vector<PersonDetection>& persons, Clock::time_point now)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_tiles.size() <= 1)
+        return;
+
+    // Also here: with a full scan on every frame, plan() never gets to prune.
+    removeExpiredActivity(now);
+    for (const PersonDetection& person: persons)
+    {
+        const float marginX = person.box.width * kActivityMargin;
+        const float marginY = person.box.height * kActivityMargin;
+        m_activity.push_back({cv::Rect2f(person.box.x - marginX, person.box.y - marginY,
+            person.box.width + 2 * marginX, person.box.height + 2 * marginY), now});
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void TilePlanner::removeExpiredActivity(Clock::time_point now)
+{
+    const auto ttl = std::chrono::duration_cast<Clock::duration>(m_config.tileActivityTtl);
+    m_activity.erase(std::remove_if(m_activity.begin(), m_activity.end(),
+        [&](const Activity& activity) { return now - activity.seenAt > ttl; }),
+        m_activity.end());
+}
+
+} // namespace inference_service
+} // namespace sample_company
@@ -0,0 +1,80 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "service_config.h"
+#include "yolo_detector.h"
+
+namespace sample_company {
+namespace inference_service {
+
+/**
+ * Overlapping tiles of tileSize covering the image, spread evenly so that the last ones end at
+ * its borders. An image that fits in one tile gives a single tile of its own size.
+ */
+std::vector<cv::Rect> makeTileGrid(cv::Size imageSize, int tileSize, float overlap);
+
+/**
+ * Merges the persons detected on the whole image and on its tiles, all in pixels of the image.
+ * Duplicates are suppressed by IoU, as by the model's own NMS. A person cut by an inner tile
+ * border gives a partial box mostly inside the whole one found on the neighbor tile or on the
+ * whole image; such boxes are merged into their union instead, keeping the keypoints of the
+ * uncut one.
+ *
+ * @param tiles tileDetections[i] come from tiles[i]; the detections of the whole image are
+ *     passed as a tile equal to the image.
+ */
+std::vector<PersonDetection> mergeTileDetections(
+    const std::vector<cv::Rect>& tiles,
+    const std::vector<std::vector<PersonDetection>>& tileDetections,
+    cv::Size imageSize,
+    float iouThreshold);
+
+/**
+ * Chooses the tiles of a camera to run on each frame. Every tileFullScanInterval frames all of
+ * them run, so that far-away people the whole-image pass misses are found; in between, only the
+ * tiles around the persons detected in the last tileActivityTtl. An idle scene thus costs the
+ * whole-image pass alone. Thread-safe.
+ */
+class TilePlanner
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+public:
+    explicit TilePlanner(const ServiceConfig& config);
+
+    /** @return Tiles to run besides the whole image; none if the image fits in one. */
+    std::vector<cv::Rect> plan(cv::Size imageSize, Clock::time_point now);
+
+    /** @param persons Merged detections of the frame, in pixels of the image. */
+    void recordActivity(const std::vector<PersonDetection>& persons, Clock::time_point now);
+
+private:
+    struct Activity
+    {
+        cv::Rect2f box;
+        Clock::time_point seenAt;
+    };
+
+    /** m_mutex must be held. */
+    void removeExpiredActivity(Clock::time_point now);
+
+private:
+    const ServiceConfig& m_config;
+
+    std::mutex m_mutex;
+    cv::Size m_imageSize;
+    std::vector<cv::Rect> m_tiles; //< Grid of m_imageSize.
+    int m_framesSinceFullScan = 0;
+    std::vector<Activity> m_activity; //< Pruned by both plan() and recordActivity().
+};
+
+} // namespace inference_service
+} // namespace sample_company
@@ -0,0 +1,203 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "yolo_detector.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "logger.h"
+#include "yolo_postprocess.h"
+
+namespace sample_company {
+namespace inference_service {
+
+namespace {
+
+constexpr int kBoxValueCount = 4; //< cx, cy, w, h.
+constexpr int kPersonClassIndex = 0;
+constexpr int kPoseKeypointCount = 17;
+constexpr int kPoseOutputRowCount = kBoxValueCount + 1 + kPoseKeypointCount * 3;
+constexpr int kMaxDetections = 300; //< As ultralytics' max_det.
+
+} // namespace
+
+YoloDetector::YoloDetector(YoloDetectorSettings settings):
+    m_settings(std::move(settings))
+{
+    // cv::dnn::Net copies share their state, so each instance is read from the file.
+    const int instanceCount = std::max(1, m_settings.instanceCount);
+    m_networks.reserve((size_t) instanceCount);
+    for (int i = 0; i < instanceCount; ++i)
+    {
+        cv::dnn::Net network = cv::dnn::readNetFromONNX(m_settings.modelPath);
+        network.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        network.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+        m_networks.push_back(std::move(network));
+    }
+    for (cv::dnn::Net& network: m_networks)
+        m_freeNetworks.push_back(&network);
+
+    // QuantizeLinear / DequantizeLinear and QLinear* nodes become these OpenCV layers.
+    std::vector<cv::String> layerTypes;
+    m_networks.front().getLayerTypes(layerTypes);
+    m_isQuantizedModel = std::any_of(layerTypes.begin(), layerTypes.end(),
+        [](const cv::String& type)
+        {
+            return type == "Quantize" || type == "Dequantize"
+                || type.find("Int8") != cv::String::npos;
+        });
+
+    // Detect models output [1, 4 + classes, anchors], pose models [1, 4 + 1 + 17 * 3, anchors].
+    const cv::Mat probe = runNetwork(cv::dnn::blobFromImage(
+        cv::Mat(m_settings.inputSize, m_settings.inputSize, CV_8UC3, cv::Scalar::all(114)),
+        1.0 / 255, cv::Size(), cv::Scalar(), /*swapRB*/ true));
+    if (probe.dims != 3 || probe.size[1] <= kBoxValueCount)
+        throw std::runtime_error("Unexpected output shape of " + m_settings.modelPath);
+    m_isPoseModel = probe.size[1] == kPoseOutputRowCount;
+}
+
+std::vector<PersonDetection> YoloDetector::detect(const cv::Mat& bgrImage)
+{
+    std::vector<LetterboxLayout> layouts;
+    const cv::Mat output = runNetwork(makeInputBlob(&bgrImage, 1, &layouts));
+    return decode(output, /*batchIndex*/ 0, layouts.front(), bgrImage.size());
+}
+
+std::vector<std::vector<PersonDetection>> YoloDetector::detectBatch(
+    const std::vector<cv::Mat>& bgrImages)
+{
+    std::vector<std::vector<PersonDetection>> result;
+    if (bgrImages.size() > 1 && m_isBatchSupported.load(std::memory_order_relaxed))
+    {
+        try
+        {
+            std::vector<LetterboxLayout> layouts;
+            const cv::Mat output = runNetwork(
+                makeInputBlob(bgrImages.data(), bgrImages.size(), &layouts));
+            if (output.size[0] != (int) bgrImages.size())
+                throw std::runtime_error("output batch size " + std::to_string(output.size[0]));
+            for (size_t i = 0; i < bgrImages.size(); ++i)
+                result.push_back(decode(output, (int) i, layouts[i], bgrImages[i].size()));
+            return result;
+        }
+        catch (const std::exception& e)
+        {
+            if (m_isBatchSupported.exchange(false))
+            {
+                PLUGIN_LOG(warning, 0, "%s does not take a batch of %zu images (%s); running "
+                    "them one by one. Export it with dynamic=True for batched tiles.",
+                    m_settings.modelPath.c_str(), bgrImages.size(), e.what());
+            }
+            result.clear();
+        }
+    }
+
+    for (const cv::Mat& image: bgrImages)
+        result.push_back(detect(image));
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+cv::Mat YoloDetector::makeInputBlob(const cv::Mat* bgrImages, size_t count,
+    std::vector<LetterboxLayout>* outLayouts) const
+{
+    // Reallocated only when the batch size changes; the network is done with the previous
+    // input of this thread by then, as runNetwork() returns after the forward pass.
+    thread_local cv::Mat blob;
+    const int inputSize = m_settings.inputSize;
+    const int shape[] = {(int) count, 3, inputSize, inputSize};
+    blob.create(4, shape, CV_32F);
+
+    outLayouts->clear();
+    for (size_t i = 0; i < count; ++i)
+        outLayouts->push_back(packInputTensor(bgrImages[i], inputSize, blob.ptr<float>((int) i)));
+    return blob;
+}
+
+cv::Mat YoloDetector::runNetwork(const cv::Mat& blob)
+{
+    cv::dnn::Net* network = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(m_networksMutex);
+        m_networkReleased.wait(lock, [this]() { return !m_freeNetworks.empty(); });
+        network = m_freeNetworks.back();
+        m_freeNetworks.pop_back();
+    }
+
+    cv::Mat output;
+    try
+    {
+        network->setInput(blob);
+        output = network->forward().clone(); //< forward() returns the network's own buffer.
+    }
+    catch (...)
+    {
+        const std::lock_guard<std::mutex> lock(m_networksMutex);
+        m_freeNetworks.push_back(network);
+        m_networkReleased.notify_one();
+        throw;
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(m_networksMutex);
+        m_freeNetworks.push_back(network);
+    }
+    m_networkReleased.notify_one();
+    return output;
+}
+
+std::vector<PersonDetection> YoloDetector::decode(const cv::Mat& output, int batchIndex,
+    const LetterboxLayout& letterbox, const cv::Size& imageSize) const
+{
+    const int rowCount = output.size[1];
+    const int anchorCount = output.size[2];
+    const float* const rows = output.ptr<float>(batchIndex);
+
+    YoloPostprocessSettings postprocessSettings;
+    postprocessSettings.classCount = m_isPoseModel ? 1 : rowCount - kBoxValueCount;
+    postprocessSettings.classId = kPersonClassIndex;
+    postprocessSettings.confidenceThreshold = m_settings.confidenceThreshold;
+    postprocessSettings.iouThreshold = m_settings.iouThreshold;
+    postprocessSettings.maxDetections = kMaxDetections;
+
+    thread_local YoloBoxes boxes;
+    const std::vector<int> kept =
+        postprocessYoloOutput(rows, anchorCount, postprocessSettings, &boxes);
+
+    const auto toImageX = [&](float x) { return (x - letterbox.left) / letterbox.scale; };
+    const auto toImageY = [&](float y) { return (y - letterbox.top) / letterbox.scale; };
+
+    std::vector<PersonDetection> result;
+    result.reserve(kept.size());
+    for (const int index: kept)
+    {
+        PersonDetection detection;
+        const size_t i = (size_t) index;
+        const float left = std::clamp(toImageX(boxes.left[i]), 0.0F, (float) imageSize.width);
+        const float top = std::clamp(toImageY(boxes.top[i]), 0.0F, (float) imageSize.height);
+        const float right = std::clamp(toImageX(boxes.right[i]), 0.0F, (float) imageSize.width);
+        const float bottom =
+            std::clamp(toImageY(boxes.bottom[i]), 0.0F, (float) imageSize.height);
+        detection.box = cv::Rect2f(left, top, right - left, bottom - top);
+        detection.score = boxes.score[i];
+
+        if (m_isPoseModel)
+        {
+            const float* const anchorValues = rows + boxes.anchor[i];
+            const auto value = [&](int row) { return anchorValues[(size_t) row * anchorCount]; };
+            for (int point = 0; point < kPoseKeypointCount; ++point)
+            {
+                const int row = kBoxValueCount + 1 + point * 3;
+                detection.keypoints.emplace_back(
+                    toImageX(value(row)), toImageY(value(row + 1)), value(row + 2));
+            }
+        }
+        result.push_back(std::move(detection));
+    }
+    return result;
+}
+
+} // namespace inference_service
+} // namespace sample_company
@@ -0,0 +1,91 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+
+#include "input_tensor.h"
+
+namespace sample_company {
+namespace inference_service {
+
+struct PersonDetection
+{
+    cv::Rect2f box; //< Pixels of the image given to detect().
+    float score = 0;
+    std::vector<cv::Point3f> keypoints; //< 17 COCO points (x, y, confidence); pose models only.
+};
+
+struct YoloDetectorSettings
+{
+    std::string modelPath;
+    int inputSize = 640;
+    float confidenceThreshold = 0.35F;
+    float iouThreshold = 0.45F;
+    int instanceCount = 1; //< Copies of the network, i.e. images processed at once.
+};
+
+/**
+ * Person detector running a YOLOv8 ONNX model (detect or pose export) with the OpenCV DNN
+ * module. Input packing and decoding run on the calling thread; only the forward pass needs one
+ * of the network instances, so callers wait for a free one there and nowhere else.
+ *
+ * Statically quantized INT8 models (QDQ ONNX, see tools/quantize_model.py) load the same way;
+ * OpenCV runs their quantized layers with its INT8 kernels. The input and output stay FP32.
+ */
+class YoloDetector
+{
+public:
+    /** @throws std::exception If the model cannot be loaded or is not a YOLOv8 one. */
+    explicit YoloDetector(YoloDetectorSettings settings);
+
+    /** Thread-safe. */
+    std::vector<PersonDetection> detect(const cv::Mat& bgrImage);
+
+    /**
+     * Detects persons on several images, e.g. the tiles of a frame, in one forward pass. Models
+     * exported with a fixed batch size of 1 cannot take a batch; after the first failure the
+     * images are run one by one. Thread-safe.
+     * @return The persons of each image, in pixels of that image.
+     */
+    std::vector<std::vector<PersonDetection>> detectBatch(const std::vector<cv::Mat>& bgrImages);
+
+    bool isPoseModel() const { return m_isPoseModel; }
+
+    /** The model has quantized (INT8) layers. */
+    bool isQuantizedModel() const { return m_isQuantizedModel; }
+
+private:
+    /**
+     * @return The NCHW input of the images, packed by packInputTensor() into a buffer of the
+     *     calling thread that its next call reuses.
+     */
+    cv::Mat makeInputBlob(const cv::Mat* bgrImages, size_t count,
+        std::vector<LetterboxLayout>* outLayouts) const;
+    cv::Mat runNetwork(const cv::Mat& blob);
+
+    /** @param batchIndex Image of the batch whose output is decoded. */
+    std::vector<PersonDetection> decode(const cv::Mat& output, int batchIndex,
+        const LetterboxLayout& letterbox, const cv::Size& imageSize) const;
+
+private:
+    const YoloDetectorSettings m_settings;
+    bool m_isPoseModel = false;
+    bool m_isQuantizedModel = false;
+    std::atomic<bool> m_isBatchSupported{true};
+
+    std::mutex m_networksMutex;
+    std::condition_variable m_networkReleased;
+    std::vector<cv::dnn::Net> m_networks;
+    std::vector<cv::dnn::Net*> m_freeNetworks;
+};
+
+} // namespace inference_service
+} // namespace sample_company
@@ -0,0 +1,410 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "yolo_postprocess.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define YOLO_POSTPROCESS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define YOLO_POSTPROCESS_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define YOLO_POSTPROCESS_NEON
+#endif
+
+namespace sample_company {
+namespace inference_service {
+
+namespace {
+
+constexpr int kBoxValueCount = 4; //< cx, cy, w, h.
+
+//-------------------------------------------------------------------------------------------------
+// A register of floats and the few operations the kernels need; a mask has bit i set for lane i.
+
+#if defined(YOLO_POSTPROCESS_AVX2)
+
+using Lanes = __m256;
+constexpr int kLaneCount = 8;
+
+Lanes loadLanes(const float* values) { return _mm256_loadu_ps(values); }
+Lanes splatLanes(float value) { return _mm256_set1_ps(value); }
+Lanes minLanes(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+Lanes maxLanes(Lanes a, Lanes b) { return _mm256_max_ps(a, b); }
+Lanes addLanes(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+Lanes subLanes(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+Lanes mulLanes(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+
+unsigned greaterMask(Lanes a, Lanes b)
+{
+    return (unsigned) _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ));
+}
+
+unsigned greaterEqualMask(Lanes a, Lanes b)
+{
+    return (unsigned) _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GE_OQ));
+}
+
+unsigned equalMask(Lanes a, Lanes b)
+{
+    return (unsigned) _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ));
+}
+
+#elif defined(YOLO_POSTPROCESS_SSE2)
+
+using Lanes = __m128;
+constexpr int kLaneCount = 4;
+
+Lanes loadLanes(const float* values) { return _mm_loadu_ps(values); }
+Lanes splatLanes(float value) { return _mm_set1_ps(value); }
+Lanes minLanes(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+Lanes maxLanes(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+Lanes addLanes(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+Lanes subLanes(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+Lanes mulLanes(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+
+unsigned greaterMask(Lanes a, Lanes b)
+{
+    return (unsigned) _mm_movemask_ps(_mm_cmpgt_ps(a, b));
+}
+
+unsigned greaterEqualMask(Lanes a, Lanes b)
+{
+    return (unsigned) _mm_movemask_ps(_mm_cmpge_ps(a, b));
+}
+
+unsigned equalMask(Lanes a, Lanes b)
+{
+    return (unsigned) _mm_movemask_ps(_mm_cmpeq_ps(a, b));
+}
+
+#elif defined(YOLO_POSTPROCESS_NEON)
+
+using Lanes = float32x4_t;
+constexpr int kLaneCount = 4;
+
+Lanes loadLanes(const float* values) { return vld1q_f32(values); }
+Lanes splatLanes(float value) { return vdupq_n_f32(value); }
+Lanes minLanes(Lanes a, Lanes b) { return vminq_f32(a, b); }
+Lanes maxLanes(Lanes a, Lanes b) { return vmaxq_f32(a, b); }
+Lanes addLanes(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+Lanes subLanes(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+Lanes mulLanes(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+
+/** NEON has no movemask: keep one distinct bit per lane and add them up. */
+unsigned toMask(uint32x4_t comparison)
+{
+    static const uint32_t kLaneBits[] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(comparison, vld1q_u32(kLaneBits)));
+}
+
+unsigned greaterMask(Lanes a, Lanes b) { return toMask(vcgtq_f32(a, b)); }
+unsigned greaterEqualMask(Lanes a, Lanes b) { return toMask(vcgeq_f32(a, b)); }
+unsigned equalMask(Lanes a, Lanes b) { return toMask(vceqq_f32(a, b)); }
+
+#else
+
+using Lanes = float;
+constexpr int kLaneCount = 1;
+
+Lanes loadLanes(const float* values) { return *values; }
+Lanes splatLanes(float value) { return value; }
+Lanes minLanes(Lanes a, Lanes b) { return std::min(a, b); }
+Lanes maxLanes(Lanes a, Lanes b) { return std::max(a, b); }
+Lanes addLanes(Lanes a, Lanes b) { return a + b; }
+Lanes subLanes(Lanes a, Lanes b) { return a - b; }
+Lanes mulLanes(Lanes a, Lanes b) { return a * b; }
+unsigned greaterMask(Lanes a, Lanes b) { return a > b ? 1 : 0; }
+unsigned greaterEqualMask(Lanes a, Lanes b) { return a >= b ? 1 : 0; }
+unsigned equalMask(Lanes a, Lanes b) { return a == b ? 1 : 0; }
+
+#endif
+
+int lowestBitIndex(unsigned mask)
+{
+    int index = 0;
+    while ((mask & 1) == 0)
+    {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Decoding.
+
+/** Row of the given class in the output. */
+const float* classRow(const float* output, int anchorCount, int classId)
+{
+    return output + (size_t) (kBoxValueCount + classId) * anchorCount;
+}
+
+/** First class with the highest score, as numpy's argmax. */
+int bestClass(const float* output, int anchorCount, int classCount, int anchor)
+{
+    int result = 0;
+    float bestScore = classRow(output, anchorCount, 0)[anchor];
+    for (int classId = 1; classId < classCount; ++classId)
+    {
+        const float score = classRow(output, anchorCount, classId)[anchor];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            result = classId;
+        }
+    }
+    return result;
+}
+
+/** No other class scores higher; a tie goes to the given class. */
+bool isBestClass(const float* output, int anchorCount, int classCount, int classId, int anchor)
+{
+    const float score = classRow(output, anchorCount, classId)[anchor];
+    for (int otherClassId = 0; otherClassId < classCount; ++otherClassId)
+    {
+        if (classRow(output, anchorCount, otherClassId)[anchor] > score)
+            return false;
+    }
+    return true;
+}
+
+void appendBox(const float* output, int anchorCount, int anchor, int classId, YoloBoxes* boxes)
+{
+    const float centerX = output[anchor];
+    const float centerY = output[(size_t) anchorCount + anchor];
+    const float halfWidth = output[(size_t) 2 * anchorCount + anchor] / 2;
+    const float halfHeight = output[(size_t) 3 * anchorCount + anchor] / 2;
+    boxes->left.push_back(centerX - halfWidth);
+    boxes->top.push_back(centerY - halfHeight);
+    boxes->right.push_back(centerX + halfWidth);
+    boxes->bottom.push_back(centerY + halfHeight);
+    boxes->score.push_back(classRow(output, anchorCount, classId)[anchor]);
+    boxes->classId.push_back(classId);
+    boxes->anchor.push_back(anchor);
+}
+
+/** Boxes scoring at least the threshold for settings.classId, whatever their best class. */
+void decodeClassBoxes(const float* output, int anchorCount,
+    const YoloPostprocessSettings& settings, YoloBoxes* boxes)
+{
+    const float* const scores = classRow(output, anchorCount, settings.classId);
+    const Lanes threshold = splatLanes(settings.confidenceThreshold);
+    const int blockEnd = anchorCount / kLaneCount * kLaneCount;
+    for (int firstAnchor = 0; firstAnchor < blockEnd; firstAnchor += kLaneCount)
+    {
+        for (unsigned mask = greaterEqualMask(loadLanes(scores + firstAnchor), threshold);
+            mask != 0; mask &= mask - 1)
+        {
+            appendBox(output, anchorCount, firstAnchor + lowestBitIndex(mask), settings.classId,
+                boxes);
+        }
+    }
+
+    for (int anchor = blockEnd; anchor < anchorCount; ++anchor)
+    {
+        if (scores[anchor] >= settings.confidenceThreshold)
+            appendBox(output, anchorCount, anchor, settings.classId, boxes);
+    }
+}
+
+/** Boxes whose best score, whatever its class, is at least the threshold. */
+void decodeBestClassBoxes(const float* output, int anchorCount,
+    const YoloPostprocessSettings& settings, YoloBoxes* boxes)
+{
+    const Lanes threshold = splatLanes(settings.confidenceThreshold);
+    const int blockEnd = anchorCount / kLaneCount * kLaneCount;
+    for (int firstAnchor = 0; firstAnchor < blockEnd; firstAnchor += kLaneCount)
+    {
+        Lanes bestScores = loadLanes(classRow(output, anchorCount, 0) + firstAnchor);
+        for (int classId = 1; classId < settings.classCount; ++classId)
+        {
+            bestScores = maxLanes(bestScores,
+                loadLanes(classRow(output, anchorCount, classId) + firstAnchor));
+        }
+        for (unsigned mask = greaterEqualMask(bestScores, threshold); mask != 0;
+            mask &= mask - 1)
+        {
+            const int anchor = firstAnchor + lowestBitIndex(mask);
+            appendBox(output, anchorCount, anchor,
+                bestClass(output, anchorCount, settings.classCount, anchor), boxes);
+        }
+    }
+
+    for (int anchor = blockEnd; anchor < anchorCount; ++anchor)
+    {
+        const int classId = bestClass(output, anchorCount, settings.classCount, anchor);
+        if (classRow(output, anchorCount, classId)[anchor] >= settings.confidenceThreshold)
+            appendBox(output, anchorCount, anchor, classId, boxes);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+// Suppression.
+
+/** The kept boxes, padded to whole registers with empty boxes of no class. */
+struct KeptBoxes
+{
+    std::vector<float> left;
+    std::vector<float> top;
+    std::vector<float> right;
+    std::vector<float> bottom;
+    std::vector<float> area;
+    std::vector<float> classId; //< As floats, to be compared with the other lanes.
+
+    void reset(int capacity)
+    {
+        const size_t paddedSize = (size_t) (capacity + kLaneCount - 1) / kLaneCount * kLaneCount;
+        for (std::vector<float>* values: {&left, &top, &right, &bottom, &area})
+            values->assign(paddedSize, 0.0F);
+        classId.assign(paddedSize, -1.0F);
+    }
+};
+
+struct Workspace
+{
+    std::vector<uint64_t> order;
+    KeptBoxes kept;
+};
+
+/** Sort key: by decreasing score, then by increasing index, as std::stable_sort() would. */
+uint64_t orderKey(float score, int index)
+{
+    // Non-negative floats compare as their bit patterns; -0 and negative scores go last.
+    uint32_t scoreBits = 0;
+    if (score > 0)
+        std::memcpy(&scoreBits, &score, sizeof(scoreBits));
+    return ((uint64_t) scoreBits << 32) | (uint32_t) ~(uint32_t) index;
+}
+
+int indexOfKey(uint64_t key)
+{
+    return (int) ~(uint32_t) key;
+}
+
+} // namespace
+
+void YoloBoxes::clear()
+{
+    left.clear();
+    top.clear();
+    right.clear();
+    bottom.clear();
+    score.clear();
+    classId.clear();
+    anchor.clear();
+}
+
+std::vector<int> postprocessYoloOutput(const float* output, int anchorCount,
+    const YoloPostprocessSettings& settings, YoloBoxes* outBoxes)
+{
+    std::vector<int> result;
+    outBoxes->clear();
+    if (settings.classCount <= 0 || settings.classId >= settings.classCount
+        || settings.maxDetections <= 0)
+    {
+        return result;
+    }
+
+    const bool isClassChecked = settings.classId < 0;
+    if (isClassChecked)
+        decodeBestClassBoxes(output, anchorCount, settings, outBoxes);
+    else
+        decodeClassBoxes(output, anchorCount, settings, outBoxes);
+
+    const YoloBoxes& boxes = *outBoxes;
+    const int count = (int) boxes.size();
+    if (count == 0)
+        return result;
+
+    thread_local Workspace workspace;
+    std::vector<uint64_t>& order = workspace.order;
+    order.resize((size_t) count);
+    for (int i = 0; i < count; ++i)
+        order[(size_t) i] = orderKey(boxes.score[(size_t) i], i);
+    std::sort(order.begin(), order.end(), std::greater<uint64_t>());
+
+    const int capacity = std::min(count, settings.maxDetections);
+    KeptBoxes& kept = workspace.kept;
+    kept.reset(capacity);
+    result.reserve((size_t) capacity);
+
+    // IoU > threshold is tested as intersection > threshold * union, without a division.
+    const Lanes threshold = splatLanes(settings.iouThreshold);
+    const Lanes zero = splatLanes(0);
+    for (const uint64_t key: order)
+    {
+        const size_t index = (size_t) indexOfKey(key);
+        const float left = boxes.left[index];
+        const float top = boxes.top[index];
+        const float right = boxes.right[index];
+        const float bottom = boxes.bottom[index];
+        const float area = (right - left) * (bottom - top);
+        const float classId = (float) boxes.classId[index];
+
+        const Lanes boxLeft = splatLanes(left);
+        const Lanes boxTop = splatLanes(top);
+        const Lanes boxRight = splatLanes(right);
+        const Lanes boxBottom = splatLanes(bottom);
+        const Lanes boxArea = splatLanes(area);
+        const Lanes boxClassId = splatLanes(classId);
+
+        const int keptCount = (int) result.size();
+        bool isSuppressed = false;
+        for (int k = 0; k < keptCount && !isSuppressed; k += kLaneCount)
+        {
+            const Lanes width = maxLanes(zero, subLanes(
+                minLanes(boxRight, loadLanes(&kept.right[(size_t) k])),
+                maxLanes(boxLeft, loadLanes(&kept.left[(size_t) k]))));
+            const Lanes height = maxLanes(zero, subLanes(
+                minLanes(boxBottom, loadLanes(&kept.bottom[(size_t) k])),
+                maxLanes(boxTop, loadLanes(&kept.top[(size_t) k]))));
+            const Lanes intersection = mulLanes(width, height);
+            const Lanes unionArea = subLanes(
+                addLanes(boxArea, loadLanes(&kept.area[(size_t) k])), intersection);
+            isSuppressed = (greaterMask(intersection, mulLanes(threshold, unionArea))
+                & equalMask(boxClassId, loadLanes(&kept.classId[(size_t) k]))) != 0;
+        }
+
+        // A box of another best class is dropped only now, when it would be kept: before, it is
+        // either suppressed or suppresses nothing, as if it had not been decoded.
+        if (isSuppressed || (!isClassChecked && !isBestClass(output, anchorCount,
+            settings.classCount, settings.classId, boxes.anchor[index])))
+        {
+            continue;
+        }
+
+        kept.left[(size_t) keptCount] = left;
+        kept.top[(size_t) keptCount] = top;
+        kept.right[(size_t) keptCount] = right;
+        kept.bottom[(size_t) keptCount] = bottom;
+        kept.area[(size_t) keptCount] = area;
+        kept.classId[(size_t) keptCount] = classId;
+        result.push_back((int) index);
+        if ((int) result.size() == capacity)
+            break;
+    }
+    return result;
+}
+
+const char* yoloPostprocessInstructionSet()
+{
+    #if defined(YOLO_POSTPROCESS_AVX2)
+        return "AVX2";
+    #elif defined(YOLO_POSTPROCESS_SSE2)
+        return "SSE2";
+    #elif defined(YOLO_POSTPROCESS_NEON)
+        return "NEON";
+    #else
+        return "scalar";
+    #endif
+}
+
+} // namespace inference_service
+} // namespace sample_company
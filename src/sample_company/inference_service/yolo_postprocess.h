@@ -0,0 +1,68 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace sample_company {
+namespace inference_service {
+
+/**
+ * Candidate boxes of one image, as parallel arrays so that the IoU of one box against many can be
+ * computed a SIMD register at a time.
+ */
+struct YoloBoxes
+{
+    // Corners, in pixels of the model input.
+    std::vector<float> left;
+    std::vector<float> top;
+    std::vector<float> right;
+    std::vector<float> bottom;
+
+    std::vector<float> score;
+    std::vector<int> classId;
+    std::vector<int> anchor; //< Column of the output, e.g. to read the keypoints of pose models.
+
+    size_t size() const { return score.size(); }
+    void clear();
+};
+
+struct YoloPostprocessSettings
+{
+    int classCount = 80; //< Score rows after the 4 box rows; 1 for pose models.
+    int classId = -1; //< Keep only the boxes whose best class is this one; -1: any class.
+    float confidenceThreshold = 0.25F;
+    float iouThreshold = 0.45F;
+    int maxDetections = 300; //< As ultralytics' max_det.
+};
+
+/**
+ * Does what ultralytics' non_max_suppression() does to the output of one image of a YOLOv8
+ * detect or pose model: [4 + classes + extra rows, anchorCount] floats, rows being cx, cy, w, h,
+ * then the class scores.
+ *
+ * Decoding keeps the boxes scoring at least the confidence threshold for their best class (a box
+ * belongs to that class only), testing a whole SIMD register of anchors at once (SSE2, AVX2 or
+ * NEON, as compiled). With classId set, only the row of that class is read up front, so a frame
+ * with nobody in it costs one pass over one row; the other classes of a box are read only if the
+ * suppression would keep it.
+ *
+ * Suppression is greedy and class-aware: in decreasing score, a box is kept unless its IoU with a
+ * kept box of the same class exceeds the threshold, as cv::dnn::NMSBoxes() does per class. It is
+ * tested against a register of kept boxes at a time, and stops at maxDetections.
+ *
+ * Thread-safe.
+ *
+ * @param outBoxes The candidates; cleared first. Kept by callers to avoid reallocating it on
+ *     every frame.
+ * @return Indexes in outBoxes of the detections, by decreasing score.
+ */
+std::vector<int> postprocessYoloOutput(const float* output, int anchorCount,
+    const YoloPostprocessSettings& settings, YoloBoxes* outBoxes);
+
+/** "AVX2", "SSE2", "NEON" or "scalar": the instruction set the kernels were compiled for. */
+const char* yoloPostprocessInstructionSet();
+
+} // namespace inference_service
+} // namespace sample_company
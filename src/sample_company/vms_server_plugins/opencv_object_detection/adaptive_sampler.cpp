@@ -0,0 +1,122 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "adaptive_sampler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+std::vector<AnalysisLevel> makeAnalysisLevels(const AnalysisLevel& fullLevel)
+{
+    const int p = fullLevel.samplingPeriod;
+    const int w = fullLevel.encodeWidth;
+    std::vector<AnalysisLevel> levels = {
+        {p, w},
+        {p * 3 / 2, w},
+        {p * 3 / 2, w * 3 / 4},
+        {p * 2, w * 3 / 4},
+        {p * 2, w / 2},
+        {p * 3, w / 2},
+        {p * 4, w / 2},
+    };
+
+    // Rounding makes some equal for small periods or widths (p * 3 / 2 == p for p = 1); a step
+    // to an equal level would change nothing but still count as a degradation.
+    levels.erase(
+        std::unique(levels.begin(), levels.end(),
+            [](const AnalysisLevel& a, const AnalysisLevel& b)
+            {
+                return a.samplingPeriod == b.samplingPeriod && a.encodeWidth == b.encodeWidth;
+            }),
+        levels.end());
+    return levels;
+}
+
+AdaptiveSampler::AdaptiveSampler(AdaptiveSamplerSettings settings):
+    m_settings(std::move(settings))
+{
+    if (m_settings.levels.empty())
+        throw std::invalid_argument("AdaptiveSampler needs at least one analysis level.");
+}
+
+bool AdaptiveSampler::update(int64_t timestampUs, int64_t enqueuedCount, int64_t droppedCount)
+{
+    // A timestamp jump backwards (archive seek, camera reconnect) starts a new window.
+    if (!m_windowStarted || timestampUs < m_windowStartUs)
+    {
+        startWindow(timestampUs, enqueuedCount, droppedCount);
+        return false;
+    }
+    if (timestampUs - m_windowStartUs < m_settings.windowUs)
+        return false;
+
+    const int64_t enqueued = enqueuedCount - m_windowStartEnqueued;
+    const int64_t dropped = droppedCount - m_windowStartDropped;
+    startWindow(timestampUs, enqueuedCount, droppedCount);
+    if (enqueued <= 0)
+        return false;
+
+    const float dropRatio = (float) dropped / (float) enqueued;
+    if (dropRatio > m_settings.degradeDropRatio)
+    {
+        m_healthyWindowCount = 0;
+        if (++m_overloadedWindowCount >= m_settings.degradeWindowCount
+            && m_level + 1 < (int) m_settings.levels.size())
+        {
+            ++m_level;
+            m_overloadedWindowCount = 0;
+            return true;
+        }
+    }
+    else if (dropRatio <= m_settings.recoverDropRatio)
+    {
+        m_overloadedWindowCount = 0;
+        if (++m_healthyWindowCount >= m_settings.recoverWindowCount && m_level > 0)
+        {
+            --m_level;
+            m_healthyWindowCount = 0;
+            return true;
+        }
+    }
+    else
+    {
+        // In between: the current level is about right.
+        m_overloadedWindowCount = 0;
+        m_healthyWindowCount = 0;
+    }
+    return false;
+}
+
+void AdaptiveSampler::reset()
+{
+    m_level = 0;
+    m_windowStarted = false;
+    m_overloadedWindowCount = 0;
+    m_healthyWindowCount = 0;
+}
+
+void AdaptiveSampler::setLevels(std::vector<AnalysisLevel> levels)
+{
+    if (levels.empty())
+        throw std::invalid_argument("AdaptiveSampler needs at least one analysis level.");
+    m_settings.levels = std::move(levels);
+    reset();
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void AdaptiveSampler::startWindow(int64_t timestampUs, int64_t enqueuedCount, int64_t droppedCount)
+{
+    m_windowStarted = true;
+    m_windowStartUs = timestampUs;
+    m_windowStartEnqueued = enqueuedCount;
+    m_windowStartDropped = droppedCount;
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
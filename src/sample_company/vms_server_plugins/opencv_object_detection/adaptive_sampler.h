@@ -0,0 +1,98 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/** How much of a camera's video is analyzed: every samplingPeriod-th frame at encodeWidth. */
+struct AnalysisLevel
+{
+    int samplingPeriod = 2;
+    int encodeWidth = 640;
+};
+
+/**
+ * Levels derived from the full one: up to 4x sparser sampling and half the width; for {2, 640}
+ * they are {2, 640}, {3, 640}, {3, 480}, {4, 480}, {4, 320}, {6, 320}, {8, 320}. Levels that
+ * rounding makes equal appear once.
+ */
+std::vector<AnalysisLevel> makeAnalysisLevels(const AnalysisLevel& fullLevel);
+
+struct AdaptiveSamplerSettings
+{
+    /** Ordered from the most to the least expensive; the first one is used when not overloaded. */
+    std::vector<AnalysisLevel> levels = makeAnalysisLevels(AnalysisLevel{});
+
+    int64_t windowUs = 2'000'000; //< Drops are evaluated over windows of frame time.
+
+    /** Step down after this many consecutive windows dropping more than degradeDropRatio. */
+    float degradeDropRatio = 0.2F;
+    int degradeWindowCount = 2;
+
+    /** Step back up after this many consecutive windows dropping at most recoverDropRatio. */
+    float recoverDropRatio = 0.02F;
+    int recoverWindowCount = 5;
+};
+
+/**
+ * Control loop that trades analysis coverage for stability: when the frame queue of a camera
+ * keeps dropping frames, sampling becomes sparser and the JPEG sent to /infer smaller; when drops
+ * stop for long enough, the previous level is restored. Recovery is deliberately slower than
+ * degradation, so the level does not oscillate around the capacity of the service.
+ *
+ * Not thread-safe; owned by the thread that receives the frames.
+ */
+class AdaptiveSampler
+{
+public:
+    explicit AdaptiveSampler(AdaptiveSamplerSettings settings = {});
+
+    /** @param minSamplingPeriod Lower bound imposed from outside, e.g. by InferenceGovernor. */
+    bool shouldSample(int64_t frameIndex, int minSamplingPeriod = 1) const
+    {
+        return frameIndex % std::max(currentLevel().samplingPeriod, minSamplingPeriod) == 0;
+    }
+
+    const AnalysisLevel& currentLevel() const { return m_settings.levels[(size_t) m_level]; }
+
+    /** 0 is the full analysis level. */
+    int levelIndex() const { return m_level; }
+
+    /**
+     * @param enqueuedCount Total frames enqueued so far.
+     * @param droppedCount Total frames dropped from the queue so far.
+     * @return Whether the level changed.
+     */
+    bool update(int64_t timestampUs, int64_t enqueuedCount, int64_t droppedCount);
+
+    void reset();
+
+    /** Replaces the levels (e.g. after a settings change) and restarts from the first one. */
+    void setLevels(std::vector<AnalysisLevel> levels);
+
+private:
+    void startWindow(int64_t timestampUs, int64_t enqueuedCount, int64_t droppedCount);
+
+private:
+    AdaptiveSamplerSettings m_settings;
+    int m_level = 0;
+
+    bool m_windowStarted = false;
+    int64_t m_windowStartUs = 0;
+    int64_t m_windowStartEnqueued = 0;
+    int64_t m_windowStartDropped = 0;
+
+    int m_overloadedWindowCount = 0;
+    int m_healthyWindowCount = 0;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
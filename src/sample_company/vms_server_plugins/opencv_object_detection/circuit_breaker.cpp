@@ -0,0 +1,108 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "circuit_breaker.h"
+
+#include <algorithm>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+using namespace std::chrono;
+
+const char* circuitStateName(CircuitState state)
+{
+    switch (state)
+    {
+        case CircuitState::closed: return "closed";
+        case CircuitState::open: return "open";
+        case CircuitState::halfOpen: return "halfOpen";
+    }
+    return "unknown";
+}
+
+CircuitBreaker::CircuitBreaker(CircuitBreakerSettings settings):
+    m_settings(std::move(settings))
+{
+}
+
+CircuitBreaker::Clock::time_point CircuitBreaker::nextProbeAt() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nextProbeAt;
+}
+
+milliseconds CircuitBreaker::probeDelay() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_probeDelay;
+}
+
+bool CircuitBreaker::isProbeDue(Clock::time_point now) const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_state.load(std::memory_order_relaxed) == CircuitState::open && now >= m_nextProbeAt;
+}
+
+bool CircuitBreaker::recordSuccess()
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_consecutiveFailures = 0;
+    m_probeDelay = milliseconds(0);
+    return m_state.exchange(CircuitState::closed, std::memory_order_release)
+        != CircuitState::closed;
+}
+
+bool CircuitBreaker::recordFailure(Clock::time_point now)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    switch (m_state.load(std::memory_order_relaxed))
+    {
+        case CircuitState::closed:
+            if (++m_consecutiveFailures < m_settings.failureThreshold)
+                return false;
+            open(now, m_settings.initialProbeDelay);
+            return true;
+
+        case CircuitState::halfOpen:
+            // The service answers /health but still fails requests: back off further.
+            open(now, std::min(m_probeDelay * 2, m_settings.maxProbeDelay));
+            return true;
+
+        case CircuitState::open:
+            return false; //< Requests that were already in flight when the circuit opened.
+    }
+    return false;
+}
+
+bool CircuitBreaker::recordProbeResult(bool isHealthy, Clock::time_point now)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_state.load(std::memory_order_relaxed) != CircuitState::open)
+        return false;
+
+    if (isHealthy)
+    {
+        m_state.store(CircuitState::halfOpen, std::memory_order_release);
+        return true;
+    }
+
+    m_probeDelay = std::min(m_probeDelay * 2, m_settings.maxProbeDelay);
+    m_nextProbeAt = now + m_probeDelay;
+    return false;
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void CircuitBreaker::open(Clock::time_point now, milliseconds probeDelay)
+{
+    m_probeDelay = std::max(probeDelay, m_settings.initialProbeDelay);
+    m_nextProbeAt = now + m_probeDelay;
+    m_consecutiveFailures = 0;
+    m_state.store(CircuitState::open, std::memory_order_release);
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
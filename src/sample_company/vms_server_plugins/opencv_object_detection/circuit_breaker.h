@@ -0,0 +1,86 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+enum class CircuitState
+{
+    closed, //< Requests go through.
+    open, //< Requests fail fast; only health probes are sent, with growing delays.
+    halfOpen, //< A probe succeeded; the next request decides between closed and open.
+};
+
+const char* circuitStateName(CircuitState state);
+
+struct CircuitBreakerSettings
+{
+    /** Consecutive request failures that open the circuit. */
+    int failureThreshold = 3;
+
+    /** Delay before the first health probe; doubled after each failed probe or trial request. */
+    std::chrono::milliseconds initialProbeDelay{500};
+    std::chrono::milliseconds maxProbeDelay{30'000};
+};
+
+/**
+ * Tracks whether a remote service is worth calling. After failureThreshold consecutive failures
+ * the circuit opens: callers skip the request (and any work preparing it) until a health probe
+ * succeeds. Probes are spaced with exponential backoff, so a service that is down for a while
+ * costs one cheap request per maxProbeDelay.
+ *
+ * Thread-safe; state() is lock-free so that it can be polled for every frame.
+ */
+class CircuitBreaker
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+public:
+    explicit CircuitBreaker(CircuitBreakerSettings settings = {});
+
+    CircuitState state() const { return m_state.load(std::memory_order_acquire); }
+
+    bool allowsRequests() const { return state() != CircuitState::open; }
+
+    /** Meaningful only while open. */
+    Clock::time_point nextProbeAt() const;
+
+    std::chrono::milliseconds probeDelay() const;
+
+    bool isProbeDue(Clock::time_point now) const;
+
+    /** @return Whether the state changed. */
+    bool recordSuccess();
+
+    /** @return Whether the state changed. */
+    bool recordFailure(Clock::time_point now);
+
+    /**
+     * Result of a health probe; ignored unless the circuit is open.
+     * @return Whether the state changed.
+     */
+    bool recordProbeResult(bool isHealthy, Clock::time_point now);
+
+private:
+    void open(Clock::time_point now, std::chrono::milliseconds probeDelay);
+
+private:
+    const CircuitBreakerSettings m_settings;
+
+    mutable std::mutex m_mutex;
+    std::atomic<CircuitState> m_state{CircuitState::closed}; //< Written under m_mutex.
+    int m_consecutiveFailures = 0;
+    std::chrono::milliseconds m_probeDelay{0};
+    Clock::time_point m_nextProbeAt;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
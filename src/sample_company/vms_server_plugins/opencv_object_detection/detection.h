@@ -2,22 +2,48 @@
 
 #pragma once
 
-#include <map>
+#include <array>
 #include <memory>
 #include <vector>
-#include <string>
 
 #include <nx/sdk/analytics/rect.h>
 #include <nx/sdk/uuid.h>
 
+#include "object_classes.h"
+
 namespace sample_company {
 namespace vms_server_plugins {
 namespace opencv_object_detection {
 
-// Class labels for the MobileNet SSD model (VOC dataset).
-extern const std::vector<std::string> kClasses;
-extern const std::vector<std::string> kClassesToDetect;
-extern const std::map<std::string, std::string> kClassesToDetectPluralCapitalized;
+/**
+ * Body keypoint in the COCO pose layout, in normalized frame coordinates like the bounding box.
+ */
+struct Keypoint
+{
+    float x = 0.0F;
+    float y = 0.0F;
+    float confidence = 0.0F; //< 0 when the keypoint is not visible.
+};
+
+/** Indices of the COCO keypoints used by the plugin. */
+enum class KeypointIndex
+{
+    leftShoulder = 5,
+    rightShoulder = 6,
+    leftHip = 11,
+    rightHip = 12,
+    leftAnkle = 15,
+    rightAnkle = 16,
+};
+
+static constexpr size_t kPoseKeypointCount = 17;
+
+using PoseKeypoints = std::array<Keypoint, kPoseKeypointCount>;
+
+inline const Keypoint& keypointAt(const PoseKeypoints& keypoints, KeypointIndex index)
+{
+    return keypoints[(size_t) index];
+}
 
 /**
  * Stores information about detection (one box per frame).
@@ -25,10 +51,13 @@ extern const std::map<std::string, std::string> kClassesToDetectPluralCapitalize
 struct Detection
 {
     const nx::sdk::analytics::Rect boundingBox;
-    const std::string classLabel;
+    const int classId; //< Index into kObjectClasses.
     const float confidence;
     const nx::sdk::Uuid trackId;
     const bool fallDetected;  // FLOW 2: Fall detection flag from Python service
+
+    /** Present only when the service runs a pose model. */
+    const std::shared_ptr<const PoseKeypoints> keypoints = nullptr;
 };
 
 using DetectionList = std::vector<std::shared_ptr<Detection>>;
@@ -4,9 +4,9 @@
 
 #include "device_agent.h"
 #include <set>
-#include <iostream>
 #include <chrono>
 #include <exception>
+#include <optional>
 #include <cctype>
 
 #include <opencv2/core.hpp>
@@ -21,11 +21,14 @@
 
 #include <nx/sdk/analytics/helpers/object_metadata.h>
 #include <nx/sdk/analytics/helpers/object_metadata_packet.h>
+#include <nx/sdk/helpers/settings_response.h>
 #include <nx/sdk/helpers/string.h>
 
 #include "detection.h"
 #include "exceptions.h"
 #include "frame.h"
+#include "frame_encoder.h"
+#include "logger.h"
 
 namespace sample_company {
     namespace vms_server_plugins {
@@ -35,32 +38,101 @@ namespace sample_company {
             using namespace nx::sdk::analytics;
             using namespace std::string_literals;
 
+            namespace {
+
+                // <temp>/yolov8_people_analytics/pipeline_stats_<cameraId>.json; rỗng nếu lỗi.
+                std::filesystem::path makePipelineStatsPath(const std::string& cameraId)
+                {
+                    std::string fileName = "pipeline_stats_" + cameraId + ".json";
+                    for (char& c : fileName)
+                    {
+                        if (!std::isalnum((unsigned char)c) && c != '.' && c != '_' && c != '-')
+                            c = '_';
+                    }
+
+                    std::error_code error;
+                    const std::filesystem::path dir =
+                        std::filesystem::temp_directory_path(error) / "yolov8_people_analytics";
+                    if (error)
+                        return {};
+                    std::filesystem::create_directories(dir, error);
+                    if (error)
+                        return {};
+                    return dir / fileName;
+                }
+
+            } // namespace
+
             DeviceAgent::DeviceAgent(
                 const nx::sdk::IDeviceInfo* deviceInfo,
                 std::filesystem::path pluginHomeDir,
-                std::filesystem::path modelPath)
+                std::filesystem::path modelPath,
+                std::shared_ptr<InferenceGovernor> inferenceGovernor,
+                std::shared_ptr<InferenceRouter> inferenceRouter,
+                std::shared_ptr<TaskExecutor> executor)
                 :
                 ConsumingDeviceAgent(deviceInfo, /*enableOutput*/ true),
                 m_pluginHomeDir(std::move(pluginHomeDir)),
                 m_modelPath(std::move(modelPath)),
-                m_objectDetector(std::make_unique<ObjectDetector>(m_modelPath)),
-                m_objectTracker(std::make_unique<ObjectTracker>()),
-                m_workerThread(&DeviceAgent::workerThreadRun, this),  // FLOW 2: Start worker thread
-                m_workerShouldStop(false)
+                m_objectDetector(std::make_unique<ObjectDetector>(
+                    m_modelPath, inferenceRouter)),
+                m_inferenceGovernor(std::move(inferenceGovernor)),
+                m_governorCamera(m_inferenceGovernor->addCamera()),
+                m_inferenceRouter(std::move(inferenceRouter)),
+                m_cameraId(deviceInfo->id()),
+                m_pipelineStatsPath(makePipelineStatsPath(m_cameraId)),
+                m_lastPipelineStatsWrite(PipelineStats::Clock::now()),
+                m_executor(std::move(executor))
             {
+                m_governorCamera->setMinSamplingPeriod(
+                    m_adaptiveSampler.currentLevel().samplingPeriod);
             }
 
             DeviceAgent::~DeviceAgent()
             {
-                // FLOW 2: Signal worker thread to stop and wait for it
+                // FLOW 2: Stop the worker; the posted task references `this`, so it must finish
+                // before the destructor returns, but it must not make the Server wait long.
                 {
                     std::unique_lock<std::mutex> lk(m_frameQueueMutex);
-                    m_workerShouldStop = true;
+                    const auto isWorkerIdle = [this]() { return !m_isWorkerTaskPosted; };
+
+                    const bool isDrained = kShutdownPolicy == ShutdownPolicy::drain
+                        && m_workerTaskDone.wait_for(lk, kShutdownDrainTimeout, isWorkerIdle);
+                    if (!isDrained)
+                    {
+                        // Discard: the frames left in the queue and the one in flight, whose
+                        // /infer is aborted by terminate() (socket shutdown, no read timeout).
+                        m_pipelineStats.count(
+                            FrameCounter::discardedAtShutdown,
+                            (int64_t) m_frameQueue.size() + (m_isJobInFlight ? 1 : 0));
+                        m_frameQueue.clear();
+                        m_objectDetector->terminate();
+                    }
                 }
-                m_frameQueueCV.notify_one();
-                if (m_workerThread.joinable())
+
+                // A posted task may still be queued behind other cameras' requests: cancel it
+                // rather than wait for its turn, and wait only for a task already running.
                 {
-                    m_workerThread.join();
+                    WorkerTaskState& state = *m_workerTaskState;
+                    std::unique_lock<std::mutex> lock(state.mutex);
+                    state.isCancelled = true;
+                    state.stopped.wait(lock, [&state]() { return !state.isRunning; });
+                }
+
+                m_inferenceGovernor->removeCamera(m_governorCamera);
+                m_inferenceRouter->removeCamera(m_cameraId);
+
+                // Final counters, including what was discarded above.
+                if (!m_pipelineStatsPath.empty())
+                {
+                    try
+                    {
+                        m_pipelineStats.writeJsonFile(m_cameraId, m_pipelineStatsPath);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        PLUGIN_LOG(warning, 0, "Pipeline stats: %s", e.what());
+                    }
                 }
             }
 
@@ -84,17 +156,7 @@ namespace sample_company {
             "flags": "stateDependent"
         }
     ],
-    "supportedTypes": [
-        {
-            "objectTypeId": ")json" + kPersonObjectType + R"json("
-        },
-        {
-            "objectTypeId": ")json" + kCatObjectType + R"json("
-        },
-        {
-            "objectTypeId": ")json" + kDogObjectType + R"json("
-        }
-    ]
+    "supportedTypes": )json" + supportedTypesManifestJson() + R"json(
 }
 )json";
             }
@@ -104,23 +166,125 @@ namespace sample_company {
                 if (!videoFrame)
                     return false;
 
-                if (m_frameIndex % 200 == 0)
+                PLUGIN_LOG(debug, 1, "pixelFormat=%d w=%d h=%d lineSize0=%d",
+                    (int) videoFrame->pixelFormat(), videoFrame->width(), videoFrame->height(),
+                    videoFrame->lineSize(0));
+
+                if (!acceptFrame(videoFrame->width(), videoFrame->height()))
+                    return true;
+
+                // ============================================================
+                // FLOW 2: Frame callback MUST NOT process frames here.
+                //         Instead, enqueue frame for async worker thread.
+                //         This callback returns immediately (NON-BLOCKING).
+                // ============================================================
+
+                if (isFrameSampled() && checkServiceForSampledFrame())
+                {
+                    try
+                    {
+                        // Convert Nx frame to OpenCV Mat
+                        const auto conversionStart = PipelineStats::Clock::now();
+                        Frame frame(videoFrame, m_frameIndex);
+                        m_pipelineStats.record(PipelineStage::frameConversion, conversionStart);
+                        
+                        // Downscale here (the full-size frame is not kept); JPEG encoding is
+                        // left to the worker, so frames dropped from the queue never pay for it.
+                        // Secondary stream có aspect ratio khác: kéo về hình học của primary
+                        // stream, nên box normalized từ service đã đúng với primary stream.
+                        cv::Mat image = downscaleFrame(
+                            frame, m_adaptiveSampler.currentLevel().encodeWidth, &m_pipelineStats,
+                            m_frameSettings.primaryAspectRatio());
+
+                        enqueueFrame(std::move(image), frame.timestampUs, frame.width, frame.height);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        pushPluginDiagnosticEvent(
+                            nx::sdk::IPluginDiagnosticEvent::Level::error,
+                            "Frame conversion or downscaling error - skipping frame",
+                            e.what());
+                    }
+                }
+
+                ++m_frameIndex;
+                return true;  // ✓ Frame callback returns immediately
+            }
+
+#if defined(PLUGIN_USE_COMPRESSED_FRAMES)
+            bool DeviceAgent::pushCompressedVideoFrame(const ICompressedVideoPacket* videoFrame)
+            {
+                if (!videoFrame)
+                    return false;
+
+                if (!acceptFrame(videoFrame->width(), videoFrame->height()))
+                    return true;
+
+                SparseVideoDecoder::Packet packet;
+                packet.codec = videoFrame->codec() ? videoFrame->codec() : "";
+                packet.data = (const uint8_t*) videoFrame->data();
+                packet.size = videoFrame->dataSize();
+                if (const IMediaContext* context = videoFrame->context())
                 {
-                    std::cerr << "[DBG] pixelFormat=" << (int)videoFrame->pixelFormat()
-                        << " w=" << videoFrame->width()
-                        << " h=" << videoFrame->height()
-                        << " lineSize0=" << videoFrame->lineSize(0)
-                        << std::endl;
+                    packet.extradata = (const uint8_t*) context->extradata();
+                    packet.extradataSize = context->extradataSize();
                 }
+                packet.timestampUs = videoFrame->timestampUs();
+                packet.isKeyFrame = ((int) videoFrame->flags()
+                    & (int) ICompressedMediaPacket::MediaFlags::keyFrame) != 0;
+                packet.width = videoFrame->width();
+                packet.height = videoFrame->height();
+
+                // Cảnh không có người (hoặc service down): chỉ decode keyframe, thay cho sampler;
+                // có người thì trở lại sampler từ keyframe kế tiếp.
+                const bool isKeyFrameMode =
+                    m_governorCamera->activity() == CameraActivity::idle
+                    || !m_objectDetector->isServiceAvailable();
+                const bool isSampled = isFrameSampled();
+                const bool isWanted = (isKeyFrameMode ? packet.isKeyFrame : isSampled)
+                    && checkServiceForSampledFrame();
 
+                try
+                {
+                    std::vector<SparseVideoDecoder::DecodedFrame> decodedFrames =
+                        m_videoDecoder.decode(packet, isWanted, isKeyFrameMode,
+                            m_adaptiveSampler.currentLevel().encodeWidth,
+                            m_frameSettings.primaryAspectRatio(), &m_pipelineStats);
+                    for (SparseVideoDecoder::DecodedFrame& decoded: decodedFrames)
+                    {
+                        enqueueFrame(std::move(decoded.image), decoded.timestampUs,
+                            decoded.width, decoded.height);
+                    }
+                    m_lastVideoDecodeError.clear();
+                }
+                catch (const std::exception& e)
+                {
+                    // Lỗi decoder lặp lại ở mọi keyframe: chỉ báo khi nội dung đổi.
+                    if (e.what() != m_lastVideoDecodeError)
+                    {
+                        m_lastVideoDecodeError = e.what();
+                        pushPluginDiagnosticEvent(
+                            nx::sdk::IPluginDiagnosticEvent::Level::error,
+                            "Video decoding error",
+                            e.what());
+                    }
+                }
+
+                ++m_frameIndex;
+                return true;
+            }
+#endif
+
+            bool DeviceAgent::acceptFrame(int width, int height)
+            {
                 if (m_frameIndex % 200 == 0)
                 {
                     pushPluginDiagnosticEvent(
                         nx::sdk::IPluginDiagnosticEvent::Level::info,
                         "Frame arrived",
                         ("frame#" + std::to_string(m_frameIndex) +
-                            " w=" + std::to_string(videoFrame->width()) +
-                            " h=" + std::to_string(videoFrame->height())).c_str());
+                            " w=" + std::to_string(width) +
+                            " h=" + std::to_string(height)).c_str());
                 }
                 
                 // Nếu detector đã bị terminate cứng (hiếm), chỉ báo 1 lần rồi bỏ qua frame.
@@ -135,65 +299,101 @@ namespace sample_company {
                             "Disable the plugin.");
                         m_terminatedPrevious = true;
                     }
+                    return false;
+                }
+                return true;
+            }
+
+            bool DeviceAgent::isFrameSampled()
+            {
+                m_pipelineStats.count(FrameCounter::received);
+                m_governorCamera->countFrame();
+                m_inferenceGovernor->rebalanceIfDue(InferenceGovernor::Clock::now());
+                applySettingsIfChanged();
+
+                // 🔻 Process detection frames regularly: chu kỳ là max của m_adaptiveSampler
+                // (backpressure của camera này) và ngân sách chung của Engine.
+                return m_adaptiveSampler.shouldSample(
+                    m_frameIndex, m_governorCamera->samplingPeriod());
+            }
+
+            bool DeviceAgent::checkServiceForSampledFrame()
+            {
+                m_pipelineStats.count(FrameCounter::sampled);
+
+                // AI service đang down (circuit mở): bỏ qua cả convert/encode, worker tự probe
+                // /health và mở lại luồng khi service sống lại.
+                if (m_objectDetector->isServiceAvailable())
                     return true;
+
+                m_pipelineStats.count(FrameCounter::skippedServiceUnavailable);
+                if (m_objectDetector->circuitBreaker().isProbeDue(CircuitBreaker::Clock::now()))
+                {
+                    std::lock_guard<std::mutex> lk(m_frameQueueMutex);
+                    postWorkerTaskLocked();
                 }
+                return false;
+            }
 
-                // ============================================================
-                // FLOW 2: Frame callback MUST NOT process frames here.
-                //         Instead, enqueue frame for async worker thread.
-                //         This callback returns immediately (NON-BLOCKING).
-                // ============================================================
+            void DeviceAgent::enqueueFrame(
+                cv::Mat image, int64_t timestampUs, int frameWidth, int frameHeight)
+            {
+                // Create frame job
+                FrameJob job;
+                job.image = std::move(image);
+                job.cameraId = m_cameraId;  // Lets the service keep per-camera tracks apart
+                job.timestampUs = timestampUs;
+                job.frameIndex = m_frameIndex;
+                // Kích thước pixel cho FallAnalyzer (tỉ lệ box): của primary stream nếu có.
+                const bool hasPrimarySize = m_frameSettings.primaryAspectRatio() > 0;
+                job.frameWidth = hasPrimarySize ? m_frameSettings.primaryStreamWidth : frameWidth;
+                job.frameHeight = hasPrimarySize ? m_frameSettings.primaryStreamHeight : frameHeight;
+                job.jpegQuality = m_frameSettings.jpegQuality;
+                job.enqueuedAt = PipelineStats::Clock::now();
                 
-                // 🔻 Process detection frames regularly:
-                const int kPeriod = kDetectionFramePeriod;
-                if (m_frameIndex % kPeriod == 0)
+                // ⚠️ BACKPRESSURE: bounded queue (size 3)
+                // If queue is full, drop oldest frame and add newest
                 {
-                    try
+                    std::unique_lock<std::mutex> lk(m_frameQueueMutex);
+                    // while: the size limit may have been lowered by a settings change.
+                    while (m_frameQueue.size() >= (size_t) m_frameSettings.frameQueueMaxSize)
                     {
-                        // Convert Nx frame to OpenCV Mat for encoding
-                        Frame frame(videoFrame, m_frameIndex);
-                        
-                        // Encode frame to JPEG with downscaling
-                        std::vector<uint8_t> jpegBytes = encodeFrameToJpeg(frame, 640);
-                        
-                        // Create frame job
-                        FrameJob job;
-                        job.jpegBytes = std::move(jpegBytes);
-                        job.cameraId = "nx_camera";  // TODO: Get from device info
-                        job.timestampUs = frame.timestampUs;
-                        job.frameIndex = m_frameIndex;
-                        
-                        // ⚠️ BACKPRESSURE: bounded queue (size 3)
-                        // If queue is full, drop oldest frame and add newest
-                        {
-                            std::unique_lock<std::mutex> lk(m_frameQueueMutex);
-                            if (m_frameQueue.size() >= kFrameQueueMaxSize)
-                            {
-                                // Drop oldest (front) frame to make room
-                                m_frameQueue.pop_front();
-                                if (m_frameIndex % 20 == 0)
-                                {
-                                    pushPluginDiagnosticEvent(
-                                        nx::sdk::IPluginDiagnosticEvent::Level::warning,
-                                        "Frame queue full - dropping old frames",
-                                        "Worker thread may be slow; increase queue or reduce FPS");
-                                }
-                            }
-                            m_frameQueue.push_back(std::move(job));
-                        }
-                        m_frameQueueCV.notify_one();  // Wake up worker thread
-                    }
-                    catch (const std::exception& e)
-                    {
-                        pushPluginDiagnosticEvent(
-                            nx::sdk::IPluginDiagnosticEvent::Level::error,
-                            "Frame encoding error",
-                            e.what());
+                        // Drop oldest (front) frame to make room
+                        m_frameQueue.pop_front();
+                        m_pipelineStats.count(FrameCounter::droppedAtEnqueue);
                     }
+                    m_frameQueue.push_back(std::move(job));
+                    postWorkerTaskLocked();  // Wake up the worker
                 }
+                m_pipelineStats.count(FrameCounter::enqueued);
 
-                ++m_frameIndex;
-                return true;  // ✓ Frame callback returns immediately
+                updateAdaptiveSampling(timestampUs);
+            }
+
+            Result<const ISettingsResponse*> DeviceAgent::settingsReceived()
+            {
+                std::map<std::string, std::string> errors;
+                DeviceAgentSettings settings;
+                {
+                    std::lock_guard<std::mutex> lk(m_settingsMutex);
+                    settings = DeviceAgentSettings::fromValues(currentSettings(), m_settings, &errors);
+                    m_settings = settings;
+                }
+                m_settingsVersion.fetch_add(1);
+
+                // Thread-safe setters, applied right away.
+                m_governorCamera->setPriority(settings.priority);
+                m_objectDetector->setRequestTimeouts(
+                    settings.inferConnectTimeout(), settings.inferReadTimeout());
+
+                if (errors.empty())
+                    return nullptr;
+
+                // Invalid values keep the previous ones; the Client shows the errors per field.
+                const auto response = new SettingsResponse();
+                for (const auto& [name, message]: errors)
+                    response->setError(name, message);
+                return response;
             }
 
             void DeviceAgent::doSetNeededMetadataTypes(
@@ -226,83 +426,259 @@ namespace sample_company {
             //-------------------------------------------------------------------------------------------------
             // private
 
+            void DeviceAgent::postWorkerTaskLocked()
+            {
+                if (m_isWorkerTaskPosted)
+                    return;  // The posted task will see the new frame
+                m_isWorkerTaskPosted = true;
+                m_executor->post(
+                    [this, state = m_workerTaskState]()
+                    {
+                        {
+                            const std::lock_guard<std::mutex> lock(state->mutex);
+                            if (state->isCancelled)
+                                return; //< The agent is being destroyed; `this` may be gone.
+                            state->isRunning = true;
+                        }
+
+                        const auto markStopped =
+                            [&state]()
+                            {
+                                {
+                                    const std::lock_guard<std::mutex> lock(state->mutex);
+                                    state->isRunning = false;
+                                }
+                                state->stopped.notify_all();
+                            };
+
+                        // Otherwise m_isWorkerTaskPosted would stay set and this camera's frames
+                        // would never be processed again; the executor only logs the error.
+                        const auto recover =
+                            [this](const std::string& error)
+                            {
+                                pushPluginDiagnosticEvent(
+                                    nx::sdk::IPluginDiagnosticEvent::Level::error,
+                                    "Worker task failed",
+                                    error);
+                                finishWorkerTask();
+                            };
+                        try
+                        {
+                            runWorkerTask();
+                        }
+                        catch (const std::exception& e)
+                        {
+                            recover(e.what());
+                            markStopped();
+                            throw;
+                        }
+                        catch (...)
+                        {
+                            recover("Unknown error");
+                            markStopped();
+                            throw;
+                        }
+                        markStopped();
+                    });
+            }
+
             // ============================================================
-            // FLOW 2: Worker thread - runs in background
+            // FLOW 2: Worker task - runs on the Engine's executor
             // Dequeues newest frame, processes it, and pushes metadata
             // ============================================================
-            void DeviceAgent::workerThreadRun()
+            void DeviceAgent::runWorkerTask()
             {
-                while (true)
+                if (!m_objectDetector->isServiceAvailable())
                 {
-                    FrameJob job;
-                    
-                    // Wait for frame or shutdown signal
-                    {
-                        std::unique_lock<std::mutex> lk(m_frameQueueMutex);
-                        m_frameQueueCV.wait(lk, [this]() {
-                            return !m_frameQueue.empty() || m_workerShouldStop;
-                        });
-                        
-                        if (m_workerShouldStop && m_frameQueue.empty())
-                            break;  // Exit thread
-                        
-                        if (m_frameQueue.empty())
-                            continue;  // Spurious wakeup, wait again
-                        
-                        // Dequeue NEWEST frame (drop old ones if multiple in queue)
-                        job = std::move(m_frameQueue.back());
-                        m_frameQueue.clear();  // Drop all other frames
-                    }
-                    
-                    // Process frame job (WITHOUT holding lock)
-                    try
+                    checkServiceRecovery();
+                }
+                else
+                {
+                    std::optional<FrameJob> job;
                     {
-                        MetadataPacketList metadataPackets = processFrameJob(job);
-                        
-                        // Enqueue metadata packets for Nx to pull
+                        std::lock_guard<std::mutex> lk(m_frameQueueMutex);
+                        if (!m_frameQueue.empty())
                         {
-                            std::unique_lock<std::mutex> lk(m_metadataQueueMutex);
-                            for (const auto& pkt : metadataPackets)
-                            {
-                                m_metadataQueue.push_back(pkt);
-                            }
+                            // Dequeue NEWEST frame (drop old ones if multiple in queue)
+                            job = std::move(m_frameQueue.back());
+                            m_pipelineStats.count(
+                                FrameCounter::droppedAtDequeue, (int64_t) m_frameQueue.size() - 1);
+                            m_frameQueue.clear();  // Drop all other frames
+                            m_isJobInFlight = true;
                         }
                     }
-                    catch (const std::exception& e)
+
+                    if (job)
                     {
-                        pushPluginDiagnosticEvent(
-                            nx::sdk::IPluginDiagnosticEvent::Level::error,
-                            "Worker thread: frame processing error",
-                            e.what());
+                        m_pipelineStats.record(PipelineStage::queueWait, job->enqueuedAt);
+
+                        // Process frame job (WITHOUT holding lock)
+                        try
+                        {
+                            pushMetadataPackets(processFrameJob(*job));
+                        }
+                        catch (const std::exception& e)
+                        {
+                            pushPluginDiagnosticEvent(
+                                nx::sdk::IPluginDiagnosticEvent::Level::error,
+                                "Worker: frame processing error",
+                                e.what());
+                        }
+                        reportServiceStateChange();
                     }
                 }
+
+                writePipelineStatsIfDue();
+                finishWorkerTask();
             }
-            
-            // ============================================================
-            // FLOW 2: Encode frame to JPEG bytes
-            // ============================================================
-            std::vector<uint8_t> DeviceAgent::encodeFrameToJpeg(const Frame& frame, int targetWidth)
+
+            void DeviceAgent::finishWorkerTask()
+            {
+                // Frames that arrived meanwhile: go to the back of the executor queue instead of
+                // looping here, so that other cameras get their turn.
+                std::lock_guard<std::mutex> lk(m_frameQueueMutex);
+                m_isJobInFlight = false;
+                m_isWorkerTaskPosted = false;
+                if (!m_frameQueue.empty())
+                    postWorkerTaskLocked();
+                m_workerTaskDone.notify_all();
+            }
+
+            void DeviceAgent::checkServiceRecovery()
             {
-                cv::Mat sendImg = frame.cvMat;
-                
-                // Downscale for faster HTTP transmission and inference
-                if (frame.width > targetWidth)
                 {
-                    float scale = (float)targetWidth / (float)frame.width;
-                    int newH = std::max(1, (int)std::round(frame.height * scale));
-                    cv::resize(sendImg, sendImg, cv::Size(targetWidth, newH));
+                    // Frames queued right before the circuit opened would only fail fast.
+                    std::lock_guard<std::mutex> lk(m_frameQueueMutex);
+                    m_pipelineStats.count(
+                        FrameCounter::skippedServiceUnavailable, (int64_t) m_frameQueue.size());
+                    m_frameQueue.clear();
                 }
-                
-                // Encode to JPEG
-                std::vector<uint8_t> jpegBytes;
-                std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 80};  // 80% quality
-                
-                if (!cv::imencode(".jpg", sendImg, jpegBytes, params))
+
+                m_objectDetector->probeServiceHealthIfDue(m_cameraId);
+                reportServiceStateChange();
+            }
+
+            void DeviceAgent::reportServiceStateChange()
+            {
+                const CircuitBreaker& circuitBreaker = m_objectDetector->circuitBreaker();
+                const CircuitState state = circuitBreaker.state();
+                if (state == m_reportedServiceState)
+                    return;
+
+                // halfOpen chỉ là trạng thái thử; chỉ báo khi request thật đã quyết định.
+                if (state == CircuitState::open && m_reportedServiceState != CircuitState::open)
+                {
+                    pushPluginDiagnosticEvent(
+                        nx::sdk::IPluginDiagnosticEvent::Level::error,
+                        "AI service unavailable - analysis paused",
+                        "Frames are not analyzed until /health responds; next probe in "
+                            + std::to_string(circuitBreaker.probeDelay().count())
+                            + " ms, backing off while the service stays down.");
+                }
+                else if (state == CircuitState::closed)
                 {
-                    throw ObjectDetectionError("Failed to encode frame to JPEG");
+                    m_lastDetectionError.clear();
+                    pushPluginDiagnosticEvent(
+                        nx::sdk::IPluginDiagnosticEvent::Level::info,
+                        "AI service available - analysis resumed",
+                        "Frames skipped while unavailable: " + std::to_string(
+                            m_pipelineStats.counter(FrameCounter::skippedServiceUnavailable)) + ".");
+                }
+
+                if (state != CircuitState::halfOpen)
+                    m_reportedServiceState = state;
+            }
+
+            void DeviceAgent::applySettingsIfChanged()
+            {
+                const int version = m_settingsVersion.load();
+                if (version == m_appliedSettingsVersion)
+                    return;
+                m_appliedSettingsVersion = version;
+
+                const DeviceAgentSettings previous = m_frameSettings;
+                {
+                    std::lock_guard<std::mutex> lk(m_settingsMutex);
+                    m_frameSettings = m_settings;
+                }
+
+                // Restart adaptive sampling only if its levels actually change.
+                if (m_frameSettings.samplingPeriod != previous.samplingPeriod
+                    || m_frameSettings.encodeWidth != previous.encodeWidth)
+                {
+                    m_adaptiveSampler.setLevels(makeAnalysisLevels(
+                        {m_frameSettings.samplingPeriod, m_frameSettings.encodeWidth}));
+                    m_governorCamera->setMinSamplingPeriod(
+                        m_adaptiveSampler.currentLevel().samplingPeriod);
+                }
+            }
+
+            void DeviceAgent::updateAdaptiveSampling(int64_t timestampUs)
+            {
+                const int64_t dropped = m_pipelineStats.counter(FrameCounter::droppedAtEnqueue)
+                    + m_pipelineStats.counter(FrameCounter::droppedAtDequeue);
+                if (!m_adaptiveSampler.update(
+                    timestampUs, m_pipelineStats.counter(FrameCounter::enqueued), dropped))
+                {
+                    return;
+                }
+
+                // Chỉ báo khi đổi mức, thay vì cảnh báo theo từng frame bị drop.
+                const AnalysisLevel& level = m_adaptiveSampler.currentLevel();
+                m_governorCamera->setMinSamplingPeriod(level.samplingPeriod);
+                const std::string description = "Analyzing every "
+                    + std::to_string(level.samplingPeriod) + " frame(s) at "
+                    + std::to_string(level.encodeWidth) + " px; frames received: "
+                    + std::to_string(m_pipelineStats.counter(FrameCounter::received))
+                    + ", inferred: " + std::to_string(m_pipelineStats.counter(FrameCounter::inferred))
+                    + ", dropped: " + std::to_string(dropped) + ".";
+                pushPluginDiagnosticEvent(
+                    m_adaptiveSampler.levelIndex() > 0
+                        ? nx::sdk::IPluginDiagnosticEvent::Level::warning
+                        : nx::sdk::IPluginDiagnosticEvent::Level::info,
+                    m_adaptiveSampler.levelIndex() > 0
+                        ? "Frame queue overloaded - analysis reduced"
+                        : "Frame analysis back to full rate",
+                    description);
+            }
+
+            void DeviceAgent::pushMetadataPackets(const MetadataPacketList& metadataPackets)
+            {
+                const auto pushStart = PipelineStats::Clock::now();
+                for (const auto& metadataPacket : metadataPackets)
+                {
+                    metadataPacket->addRef();  // pushMetadataPacket() takes ownership of one ref.
+                    pushMetadataPacket(metadataPacket.get());
+                }
+                m_pipelineStats.record(PipelineStage::push, pushStart);
+            }
+
+            void DeviceAgent::writePipelineStatsIfDue()
+            {
+                const auto now = PipelineStats::Clock::now();
+                if (m_pipelineStatsPath.empty() ||
+                    now - m_lastPipelineStatsWrite < kPipelineStatsWritePeriod)
+                {
+                    return;
+                }
+                m_lastPipelineStatsWrite = now;
+
+                try
+                {
+                    m_pipelineStats.writeJsonFile(m_cameraId, m_pipelineStatsPath);
+                    if (!m_pipelineStatsPathReported)
+                    {
+                        pushPluginDiagnosticEvent(
+                            nx::sdk::IPluginDiagnosticEvent::Level::info,
+                            "Pipeline latency stats",
+                            ("Per-stage latency histograms: " + m_pipelineStatsPath.string()).c_str());
+                        m_pipelineStatsPathReported = true;
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    PLUGIN_LOG(warning, 1, "Pipeline stats: %s", e.what());
                 }
-                
-                return jpegBytes;
             }
             
             // ============================================================
@@ -314,8 +690,11 @@ namespace sample_company {
                 
                 try
                 {
-                    // Call Python AI service with JPEG bytes
-                    DetectionList detections = m_objectDetector->run(job.cameraId, job.jpegBytes);
+                    // Call AI service: shared memory if offered, JPEG over HTTP otherwise.
+                    DetectionList detections = m_objectDetector->run(
+                        job.cameraId, job.image, job.jpegQuality, &m_pipelineStats);
+                    m_pipelineStats.count(FrameCounter::inferred);
+                    const auto metadataBuildStart = PipelineStats::Clock::now();
                     
                     // Create ObjectMetadata for bboxes
                     const auto& objectMetadataPacket =
@@ -325,25 +704,61 @@ namespace sample_company {
                         result.push_back(objectMetadataPacket);
 
                     // Emit state-dependent person presence event (start/finish).
+                    // Per-frame evidence goes through debouncers, so a single missed detection
+                    // does not produce a FINISHED/STARTED pair.
                     bool hasPerson = false;
-                    std::set<nx::sdk::Uuid> currentFallDetectedTrackIds;
-                    for (const auto& detection : detections)
+                    if (kUseNativeFallAnalysis)
+                    {
+                        // Keypoint verdicts for all persons of the frame in one batch.
+                        m_poseFallClassifier.classify(
+                            detections, job.frameWidth, job.frameHeight, job.timestampUs,
+                            &m_poseVerdicts);
+                    }
+                    for (size_t i = 0; i < detections.size(); ++i)
                     {
-                        if (detection->classLabel != "person")
+                        const auto& detection = detections[i];
+                        if (detection->classId != kPersonClassId)
                             continue;
 
                         hasPerson = true;
-                        if (detection->fallDetected)
-                            currentFallDetectedTrackIds.insert(detection->trackId);
+                        const bool fallDetected = kUseNativeFallAnalysis
+                            ? m_fallAnalyzer.update(
+                                *detection, job.frameWidth, job.frameHeight, job.timestampUs,
+                                m_poseVerdicts[i])
+                            : detection->fallDetected;
+
+                        // Emit state-dependent fall events per track_id.
+                        const DebouncedTransition fallTransition =
+                            m_fallDebouncer.update(detection->trackId, fallDetected, job.timestampUs);
+                        if (fallTransition != DebouncedTransition::none)
+                        {
+                            result.push_back(makeFallEventPacket(
+                                detection->trackId,
+                                fallTransition == DebouncedTransition::started,
+                                job.timestampUs));
+                        }
                     }
 
-                    if (hasPerson != m_personDetectionActive)
+                    if (kUseNativeFallAnalysis)
+                        m_fallAnalyzer.removeStaleTracks(job.timestampUs);
+
+                    // FINISH for fallen tracks that stayed out of the frame long enough.
+                    std::vector<nx::sdk::Uuid> finishedFallTrackIds;
+                    m_fallDebouncer.updateUnobserved(job.timestampUs, &finishedFallTrackIds);
+                    for (const auto& trackId : finishedFallTrackIds)
+                        result.push_back(makeFallEventPacket(trackId, false, job.timestampUs));
+
+                    const DebouncedTransition personTransition =
+                        m_personPresenceDebouncer.update(hasPerson, job.timestampUs);
+                    if (personTransition != DebouncedTransition::none)
                     {
                         EventList personEvents;
                         personEvents.push_back(std::make_shared<Event>(Event{
-                            hasPerson ? EventType::detection_started : EventType::detection_finished,
+                            personTransition == DebouncedTransition::started
+                                ? EventType::detection_started
+                                : EventType::detection_finished,
                             job.timestampUs,
-                            "person"
+                            kPersonClassId
                         }));
 
                         const auto personEventPackets =
@@ -352,66 +767,42 @@ namespace sample_company {
                             result.end(),
                             std::make_move_iterator(personEventPackets.begin()),
                             std::make_move_iterator(personEventPackets.end()));
-
-                        m_personDetectionActive = hasPerson;
                     }
 
-                    // Emit state-dependent fall events per track_id.
-                    // START: newly fallen tracks.
-                    for (const auto& trackId : currentFallDetectedTrackIds)
-                    {
-                        if (m_activeFallDetectedTrackIds.count(trackId) > 0)
-                            continue;
-
-                        auto eventMetadata = nx::sdk::makePtr<nx::sdk::analytics::EventMetadata>();
-                        eventMetadata->setCaption("Fall detected");
-                        eventMetadata->setDescription(
-                            "Person " + nx::sdk::UuidHelper::toStdString(trackId) + " is in fallen state");
-                        eventMetadata->setIsActive(true);
-                        eventMetadata->setTypeId(kFallDetectedEventType);
+                    // Camera đang có người / có fall được ưu tiên ngân sách inference.
+                    m_governorCamera->setActivity(m_fallDebouncer.isAnyActive()
+                        ? CameraActivity::fallActive
+                        : m_personPresenceDebouncer.isActive()
+                            ? CameraActivity::personPresent
+                            : CameraActivity::idle);
 
-                        auto eventPacket = nx::sdk::makePtr<nx::sdk::analytics::EventMetadataPacket>();
-                        eventPacket->addItem(eventMetadata.get());
-                        eventPacket->setTimestampUs(job.timestampUs);
-                        result.push_back(eventPacket);
-
-                        m_activeFallDetectedTrackIds.insert(trackId);
-                    }
-
-                    // FINISH: tracks that were fallen before but are no longer fallen now.
-                    std::vector<nx::sdk::Uuid> tracksToClear;
-                    for (const auto& activeTrackId : m_activeFallDetectedTrackIds)
-                    {
-                        if (currentFallDetectedTrackIds.count(activeTrackId) > 0)
-                            continue;
-
-                        auto eventMetadata = nx::sdk::makePtr<nx::sdk::analytics::EventMetadata>();
-                        eventMetadata->setCaption("Fall cleared");
-                        eventMetadata->setDescription(
-                            "Person " + nx::sdk::UuidHelper::toStdString(activeTrackId) + " is no longer fallen");
-                        eventMetadata->setIsActive(false);
-                        eventMetadata->setTypeId(kFallDetectedEventType);
-
-                        auto eventPacket = nx::sdk::makePtr<nx::sdk::analytics::EventMetadataPacket>();
-                        eventPacket->addItem(eventMetadata.get());
-                        eventPacket->setTimestampUs(job.timestampUs);
-                        result.push_back(eventPacket);
-
-                        tracksToClear.push_back(activeTrackId);
-                    }
-
-                    for (const auto& trackId : tracksToClear)
-                        m_activeFallDetectedTrackIds.erase(trackId);
+                    m_pipelineStats.record(PipelineStage::metadataBuild, metadataBuildStart);
+                }
+                catch (const ObjectDetectorIsTerminatedError&)
+                {
+                    // /infer aborted by ~DeviceAgent; counted as discardedAtShutdown there.
+                }
+                catch (const ObjectDetectorUnavailableError&)
+                {
+                    // Already reported once by reportServiceStateChange().
+                    m_pipelineStats.count(FrameCounter::skippedServiceUnavailable);
                 }
                 catch (const ObjectDetectionError& e)
                 {
-                    pushPluginDiagnosticEvent(
-                        nx::sdk::IPluginDiagnosticEvent::Level::error,
-                        "AI service call failed - will retry next frame",
-                        e.what());
+                    m_pipelineStats.count(FrameCounter::failed);
+                    // Cùng một lỗi lặp lại mỗi frame chỉ báo một lần.
+                    if (e.what() != m_lastDetectionError)
+                    {
+                        m_lastDetectionError = e.what();
+                        pushPluginDiagnosticEvent(
+                            nx::sdk::IPluginDiagnosticEvent::Level::error,
+                            "AI service call failed - will retry next frame",
+                            e.what());
+                    }
                 }
                 catch (const std::exception& e)
                 {
+                    m_pipelineStats.count(FrameCounter::failed);
                     pushPluginDiagnosticEvent(
                         nx::sdk::IPluginDiagnosticEvent::Level::error,
                         "Unexpected error in processFrameJob",
@@ -421,6 +812,33 @@ namespace sample_company {
                 return result;
             }
 
+            Ptr<IMetadataPacket> DeviceAgent::makeFallEventPacket(
+                const nx::sdk::Uuid& trackId,
+                bool isActive,
+                int64_t timestampUs)
+            {
+                auto eventMetadata = nx::sdk::makePtr<nx::sdk::analytics::EventMetadata>();
+                if (isActive)
+                {
+                    eventMetadata->setCaption("Fall detected");
+                    eventMetadata->setDescription(
+                        "Person " + nx::sdk::UuidHelper::toStdString(trackId) + " is in fallen state");
+                }
+                else
+                {
+                    eventMetadata->setCaption("Fall cleared");
+                    eventMetadata->setDescription(
+                        "Person " + nx::sdk::UuidHelper::toStdString(trackId) + " is no longer fallen");
+                }
+                eventMetadata->setIsActive(isActive);
+                eventMetadata->setTypeId(kFallDetectedEventType);
+
+                auto eventPacket = nx::sdk::makePtr<nx::sdk::analytics::EventMetadataPacket>();
+                eventPacket->addItem(eventMetadata.get());
+                eventPacket->setTimestampUs(timestampUs);
+                return eventPacket;
+            }
+
             DeviceAgent::MetadataPacketList DeviceAgent::eventsToEventMetadataPacketList(
                 const EventList& events,
                 int64_t timestampUs)
@@ -447,7 +865,7 @@ namespace sample_company {
                             : kFinishedSuffix;
 
                         const std::string caption =
-                            kClassesToDetectPluralCapitalized.at(event->classLabel) +
+                            std::string(objectClass(event->classId).pluralCaption) +
                             " detection" + suffix;
 
                         const std::string description = caption;
@@ -464,9 +882,10 @@ namespace sample_company {
                     }
                     else if (event->eventType == EventType::object_detected)
                     {
-                        std::string caption = event->classLabel + kDetectionEventCaptionSuffix;
+                        const std::string classLabel(objectClass(event->classId).label);
+                        std::string caption = classLabel + kDetectionEventCaptionSuffix;
                         caption[0] = (char)toupper(caption[0]);
-                        std::string description = event->classLabel + kDetectionEventDescriptionSuffix;
+                        std::string description = classLabel + kDetectionEventDescriptionSuffix;
                         description[0] = (char)toupper(description[0]);
 
                         eventMetadata->setCaption(caption);
@@ -488,192 +907,9 @@ namespace sample_company {
                 const DetectionList& detections,
                 int64_t timestampUs)
             {
-                using nx::sdk::Attribute;
-                using nx::sdk::IAttribute;
-
-                using nx::sdk::analytics::ObjectMetadata;
-                using nx::sdk::analytics::ObjectMetadataPacket;
-
-                if (detections.empty())
-                    return nullptr;
-
-                const auto objectMetadataPacket = makePtr<ObjectMetadataPacket>();
-
-                // --- PASS 1: đếm số person trong frame, gom trackId ---
-                m_currentPersons = 0;
-                std::set<nx::sdk::Uuid> framePersonIds;
-
-                for (const std::shared_ptr<Detection>& detection : detections)
-                {
-                    if (detection->classLabel == "person")
-                    {
-                        ++m_currentPersons;
-                        framePersonIds.insert(detection->trackId);
-                    }
-                }
-
-                // Cập nhật tập trackId đã từng xuất hiện (đếm không trùng)
-                m_seenPersonIds.insert(framePersonIds.begin(), framePersonIds.end());
-                const int totalUniquePersons = static_cast<int>(m_seenPersonIds.size());
-
-                // --- PASS 2: tạo ObjectMetadata + gắn attribute + caption ---
-                for (const std::shared_ptr<Detection>& detection : detections)
-                {
-                    auto objectMetadata = makePtr<ObjectMetadata>();
-
-                    objectMetadata->setBoundingBox(detection->boundingBox);
-                    objectMetadata->setConfidence(detection->confidence);
-                    objectMetadata->setTrackId(detection->trackId);
-
-                    if (detection->classLabel == "person")
-                    {
-                        objectMetadata->setTypeId(kPersonObjectType);
-
-                        // 1) id từng người (trackId)
-                        objectMetadata->addAttribute(makePtr<Attribute>(
-                            IAttribute::Type::string,
-                            "yolov8_person_id",
-                            nx::sdk::UuidHelper::toStdString(detection->trackId)));
-
-                        // 2) số người đang có trong frame hiện tại
-                        objectMetadata->addAttribute(makePtr<Attribute>(
-                            IAttribute::Type::number,
-                            "yolov8_person_count_frame",
-                            std::to_string(m_currentPersons)));
-
-                        // 3) tổng số người khác nhau đã đi qua (đếm không trùng)
-                        objectMetadata->addAttribute(makePtr<Attribute>(
-                            IAttribute::Type::number,
-                            "yolov8_person_count_unique",
-                            std::to_string(totalUniquePersons)));
-                    }
-                    else if (detection->classLabel == "cat")
-                    {
-                        objectMetadata->setTypeId(kCatObjectType);
-                    }
-                    else if (detection->classLabel == "dog")
-                    {
-                        objectMetadata->setTypeId(kDogObjectType);
-                    }
-
-                    objectMetadataPacket->addItem(objectMetadata.releasePtr());
-                }
-
-                objectMetadataPacket->setTimestampUs(timestampUs);
-                return objectMetadataPacket;
-            }
-
-            void DeviceAgent::reinitializeObjectTrackerOnFrameSizeChanges(const Frame& frame)
-            {
-                const bool frameSizeUnset = m_previousFrameWidth == 0 && m_previousFrameHeight == 0;
-                if (frameSizeUnset)
-                {
-                    m_previousFrameWidth = frame.width;
-                    m_previousFrameHeight = frame.height;
-                    return;
-                }
-
-                const bool frameSizeChanged =
-                    frame.width != m_previousFrameWidth ||
-                    frame.height != m_previousFrameHeight;
-
-                if (frameSizeChanged)
-                {
-                    m_objectTracker = std::make_unique<ObjectTracker>();
-                    m_previousFrameWidth = frame.width;
-                    m_previousFrameHeight = frame.height;
-                }
-            }
-
-            DeviceAgent::MetadataPacketList DeviceAgent::processFrame(
-                const IUncompressedVideoFrame* videoFrame)
-            {
-                if (m_frameIndex % 200 == 0)
-                {
-                    std::cerr << "[DBG] pixelFormat=" << (int)videoFrame->pixelFormat()
-                        << " w=" << videoFrame->width()
-                        << " h=" << videoFrame->height()
-                        << " lineSize0=" << videoFrame->lineSize(0)
-                        << std::endl;
-                }
-
-                try
-                {
-                    // ⚠️ Frame constructor có thể ném exception (unsupported pixel format, cvtColor fail, etc)
-                    Frame frame(videoFrame, m_frameIndex);
-                    reinitializeObjectTrackerOnFrameSizeChanges(frame);
-
-                    if (m_frameIndex % 200 == 0)
-                    {
-                        pushPluginDiagnosticEvent(
-                            nx::sdk::IPluginDiagnosticEvent::Level::info,
-                            "Calling detector",
-                            "About to call Python /infer endpoint");
-                    }
-
-                    // 1) Gọi Python service -> lấy detections đã có track_id
-                    DetectionList detections = m_objectDetector->run(frame);
-
-                    // 2) Dùng trực tiếp detections từ Python để tạo ObjectMetadata
-                    const auto& objectMetadataPacket =
-                        detectionsToObjectMetadataPacket(detections, frame.timestampUs);
-
-                    // 3) Không còn events từ tracking, nên truyền EventList rỗng
-                    EventList emptyEvents;
-                    const auto& eventMetadataPacketList =
-                        eventsToEventMetadataPacketList(emptyEvents, frame.timestampUs);
-
-                    MetadataPacketList result;
-                    if (objectMetadataPacket)
-                        result.push_back(objectMetadataPacket);
-
-                    result.insert(
-                        result.end(),
-                        std::make_move_iterator(eventMetadataPacketList.begin()),
-                        std::make_move_iterator(eventMetadataPacketList.end()));
-
-                    return result;
-                }
-                catch (const ObjectDetectionError& e)
-                {
-                    // Log error nhưng KHÔNG terminate plugin
-                    // Plugin sẽ tiếp tục chạy và retry lần sau
-                    pushPluginDiagnosticEvent(
-                        nx::sdk::IPluginDiagnosticEvent::Level::error,
-                        "Object detection failed - will retry next frame",
-                        e.what());
-                }
-                catch (const ObjectTrackingError& e)
-                {
-                    pushPluginDiagnosticEvent(
-                        nx::sdk::IPluginDiagnosticEvent::Level::error,
-                        "Object tracking error - will retry next frame",
-                        e.what());
-                }
-                catch (const std::runtime_error& e)
-                {
-                    // Frame constructor throws std::runtime_error for unsupported pixel format
-                    pushPluginDiagnosticEvent(
-                        nx::sdk::IPluginDiagnosticEvent::Level::error,
-                        "Frame conversion error (unsupported pixel format or OpenCV error) - skipping frame",
-                        e.what());
-                }
-                catch (const std::exception& e)
-                {
-                    pushPluginDiagnosticEvent(
-                        nx::sdk::IPluginDiagnosticEvent::Level::error,
-                        "Unexpected error in frame processing",
-                        (std::string("Type: ") + typeid(e).name() + " Message: " + e.what()).c_str());
-                }
-                catch (...)
-                {
-                    pushPluginDiagnosticEvent(
-                        nx::sdk::IPluginDiagnosticEvent::Level::error,
-                        "Unknown exception in frame processing",
-                        "catch(...) - Unable to determine exception type");
-                }
-
-                return {};
+                // Đếm người (trong frame / không trùng) và gắn attribute do builder đảm nhiệm;
+                // builder tái sử dụng ObjectMetadata/Attribute giữa các frame.
+                return m_objectMetadataBuilder.build(detections, timestampUs);
             }
 
         } // namespace opencv_object_detection
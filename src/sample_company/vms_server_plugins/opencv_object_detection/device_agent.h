@@ -4,12 +4,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <memory>
 #include <vector>
 #include <set>
 #include <queue>
-#include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <deque>
@@ -20,9 +21,21 @@
 #include <nx/sdk/helpers/uuid_helper.h>
 #include <nx/sdk/ptr.h>
 
+#include "adaptive_sampler.h"
+#include "device_agent_settings.h"
 #include "engine.h"
+#include "event_debouncer.h"
+#include "fall_analyzer.h"
+#include "inference_governor.h"
+#include "inference_router.h"
 #include "object_detector.h"
+#include "object_metadata_builder.h"
 #include "object_tracker.h"
+#include "pipeline_stats.h"
+#include "pose_fall_classifier.h"
+#include "sparse_video_decoder.h"
+#include "task_executor.h"
+#include "uuid_hash.h"
 
 namespace sample_company {
 namespace vms_server_plugins {
@@ -33,10 +46,14 @@ namespace opencv_object_detection {
 // ========================================
 struct FrameJob
 {
-    std::vector<uint8_t> jpegBytes;  // JPEG encoded frame
+    cv::Mat image;  // Downscaled BGR frame; JPEG-encoded by the worker
     std::string cameraId;
     int64_t timestampUs;
     int64_t frameIndex;
+    int frameWidth;   // Primary stream frame size, used to restore pixel geometry of normalized boxes
+    int frameHeight;
+    int jpegQuality;
+    PipelineStats::Clock::time_point enqueuedAt;  // Start of the queueWait stage
 };
 
 class DeviceAgent: public nx::sdk::analytics::ConsumingDeviceAgent
@@ -48,7 +65,10 @@ public:
     DeviceAgent(
         const nx::sdk::IDeviceInfo* deviceInfo,
         std::filesystem::path pluginHomeDir,
-        std::filesystem::path modelPath);
+        std::filesystem::path modelPath,
+        std::shared_ptr<InferenceGovernor> inferenceGovernor,
+        std::shared_ptr<InferenceRouter> inferenceRouter,
+        std::shared_ptr<TaskExecutor> executor);
 
     virtual ~DeviceAgent() override;
 
@@ -58,12 +78,22 @@ protected:
     virtual bool pushUncompressedVideoFrame(
         const nx::sdk::analytics::IUncompressedVideoFrame* videoFrame) override;
 
+#if defined(PLUGIN_USE_COMPRESSED_FRAMES)
+    // Engine không yêu cầu frame đã decode: Server gửi packet nén, plugin chỉ decode frame
+    // được sample (SparseVideoDecoder).
+    virtual bool pushCompressedVideoFrame(
+        const nx::sdk::analytics::ICompressedVideoPacket* videoFrame) override;
+#endif
+
     virtual void doSetNeededMetadataTypes(
         nx::sdk::Result<void>* outValue,
         const nx::sdk::analytics::IMetadataTypes* neededMetadataTypes) override;
 
+    virtual nx::sdk::Result<const nx::sdk::ISettingsResponse*> settingsReceived() override;
+
 private:
-    void reinitializeObjectTrackerOnFrameSizeChanges(const Frame& frame);
+    // Pick up the settings stored by settingsReceived() (frame thread)
+    void applySettingsIfChanged();
 
     nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadataPacket> detectionsToObjectMetadataPacket(
         const DetectionList& detections,
@@ -73,24 +103,55 @@ private:
         const EventList& events,
         int64_t timestampUs);
 
-    MetadataPacketList processFrame(
-        const nx::sdk::analytics::IUncompressedVideoFrame* videoFrame);
+    nx::sdk::Ptr<nx::sdk::analytics::IMetadataPacket> makeFallEventPacket(
+        const nx::sdk::Uuid& trackId,
+        bool isActive,
+        int64_t timestampUs);
+
+    // Diagnostic event every 200 frames; false if the detector is broken (frame thread)
+    bool acceptFrame(int width, int height);
+
+    // Count the frame and decide whether the samplers pick it (frame thread)
+    bool isFrameSampled();
+
+    // Count a sampled frame; false if it must be skipped because the AI service is down, in
+    // which case the worker is woken to probe /health if due (frame thread)
+    bool checkServiceForSampledFrame();
+
+    // Queue a downscaled BGR image for the worker (frame thread)
+    void enqueueFrame(cv::Mat image, int64_t timestampUs, int frameWidth, int frameHeight);
 
     // ============ FLOW 2: Frame queuing & async worker ============
-    // Worker thread function that runs in background
-    void workerThreadRun();
-    
-    // Encode frame to JPEG bytes
-    std::vector<uint8_t> encodeFrameToJpeg(const Frame& frame, int targetWidth = 640);
+    // Post runWorkerTask() to m_executor unless already posted; m_frameQueueMutex must be held
+    void postWorkerTaskLocked();
+
+    // One step of the worker: process the newest queued frame, or probe /health while the AI
+    // service circuit is open; re-posts itself while frames remain (executor thread)
+    void runWorkerTask();
+
+    // End of a worker step, also when it threw: lets the next one be posted, re-posting it while
+    // frames remain, and wakes the destructor
+    void finishWorkerTask();
     
     // Process queued frame job and return metadata packets
     MetadataPacketList processFrameJob(const FrameJob& job);
 
-private:
-    const std::string kPersonObjectType = "nx.base.Person";
-    const std::string kCatObjectType = "nx.base.Cat";
-    const std::string kDogObjectType = "nx.base.Dog";
+    // Hand metadata packets to the Server (worker thread)
+    void pushMetadataPackets(const MetadataPacketList& metadataPackets);
+
+    // Rewrite the pipeline stats file every kPipelineStatsWritePeriod (worker thread)
+    void writePipelineStatsIfDue();
 
+    // Feed the drop counters to m_adaptiveSampler and report level changes (frame thread)
+    void updateAdaptiveSampling(int64_t timestampUs);
+
+    // While the AI service circuit is open: drop queued frames, probe /health if due (worker)
+    void checkServiceRecovery();
+
+    // One diagnostic event per circuit state change of the AI service (worker thread)
+    void reportServiceStateChange();
+
+private:
     const std::string kDetectionEventType = "sample.opencv_object_detection.detection";
     const std::string kDetectionEventCaptionSuffix = " detected";
     const std::string kDetectionEventDescriptionSuffix = " detected";
@@ -101,11 +162,41 @@ private:
     // FLOW 2: Fall Detection Event
     const std::string kFallDetectedEventType = "mycompany.yolov8_people_analytics.fallDetected";
 
-    /** Process every 2nd frame for better detection frequency (reasonable balance). */
-    static constexpr int kDetectionFramePeriod = 2;
-    
-    // ============ FLOW 2: Frame queue config ============
-    static constexpr size_t kFrameQueueMaxSize = 3;  // Drop old frames if queue full
+    /** What ~DeviceAgent does with the frames still queued when analytics is disabled. */
+    enum class ShutdownPolicy
+    {
+        discard, //< Drop them and abort the /infer request in flight: teardown is immediate.
+        drain, //< Analyze them and push their metadata, for at most kShutdownDrainTimeout.
+    };
+    static constexpr ShutdownPolicy kShutdownPolicy = ShutdownPolicy::discard;
+
+    /**
+     * Bound on the drain; afterwards the rest is discarded as with ShutdownPolicy::discard. The
+     * Server destroys agents one after another, so this adds up over the cameras toggled at once.
+     */
+    static constexpr std::chrono::milliseconds kShutdownDrainTimeout{300};
+
+    /** How often the per-stage latency histograms are written to m_pipelineStatsPath. */
+    static constexpr std::chrono::seconds kPipelineStatsWritePeriod{10};
+
+    /** Decide falls in the plugin instead of trusting `fall_detected` from the service. */
+    static constexpr bool kUseNativeFallAnalysis = true;
+
+    /** Person presence: 2 of the last 5 analyzed frames to start, 4 to finish, held >= 3 s. */
+    static constexpr DebouncerSettings kPersonPresenceDebouncerSettings{
+        /*windowSize*/ 5,
+        /*activateCount*/ 2,
+        /*deactivateCount*/ 4,
+        /*minActiveUs*/ 3'000'000,
+        /*minInactiveUs*/ 1'000'000};
+
+    /** Falls: 2 of 6 to start (FallAnalyzer already smooths), 5 to finish, held >= 5 s. */
+    static constexpr DebouncerSettings kFallDebouncerSettings{
+        /*windowSize*/ 6,
+        /*activateCount*/ 2,
+        /*deactivateCount*/ 5,
+        /*minActiveUs*/ 5'000'000,
+        /*minInactiveUs*/ 0};
 
 private:
     bool m_terminated = false;
@@ -115,38 +206,87 @@ private:
     std::filesystem::path m_modelPath;
 
     const std::unique_ptr<ObjectDetector> m_objectDetector;
-    std::unique_ptr<ObjectTracker> m_objectTracker;
     int m_frameIndex = 0;
 
-    int m_previousFrameWidth = 0;
-    int m_previousFrameHeight = 0;
+    // Share of the Engine-wide inference budget; its sampling period is a lower bound for
+    // m_adaptiveSampler.
+    const std::shared_ptr<InferenceGovernor> m_inferenceGovernor;
+    const std::shared_ptr<InferenceGovernor::Camera> m_governorCamera;
+
+    // Engine-wide choice of the inference service for each request; this camera's place on its
+    // service is freed in the destructor.
+    const std::shared_ptr<InferenceRouter> m_inferenceRouter;
+
+    // ====== Settings (deviceAgentSettingsModel in the Engine manifest) ======
+    // settingsReceived() runs on a Server thread: it stores m_settings and bumps the version;
+    // the frame thread copies them into m_frameSettings before the next frame.
+    std::mutex m_settingsMutex;
+    DeviceAgentSettings m_settings; //< Guarded by m_settingsMutex.
+    std::atomic<int> m_settingsVersion{0};
+    int m_appliedSettingsVersion = 0; //< Frame thread only.
+    DeviceAgentSettings m_frameSettings; //< Frame thread only.
+
+    // Sampling period and JPEG width, adapted to the drops (frame thread only). Its first
+    // level is samplingPeriod/encodeWidth of m_frameSettings.
+    AdaptiveSampler m_adaptiveSampler;
+
+#if defined(PLUGIN_USE_COMPRESSED_FRAMES)
+    SparseVideoDecoder m_videoDecoder; //< Frame thread only.
+    std::string m_lastVideoDecodeError; //< Reported once until it changes; frame thread only.
+#endif
 
     // ====== ĐẾM NGƯỜI ======
-    // Số người trong frame hiện tại (persons đang thấy trên màn hình).
-    int m_currentPersons = 0;
+    // Số người trong frame hiện tại và số trackId person không trùng, cùng với cache
+    // ObjectMetadata/Attribute theo track.
+    ObjectMetadataBuilder m_objectMetadataBuilder;
 
-    // Tập các trackId person đã từng xuất hiện (đếm không trùng).
-    std::set<nx::sdk::Uuid> m_seenPersonIds;
+    // ====== Pipeline instrumentation ======
+    // Declared before the worker state: worker tasks record into them.
+    const std::string m_cameraId;
+    PipelineStats m_pipelineStats;
+    const std::filesystem::path m_pipelineStatsPath; //< Empty if the temp dir is unavailable.
+    PipelineStats::Clock::time_point m_lastPipelineStatsWrite;
+    bool m_pipelineStatsPathReported = false;
     
     // ============ FLOW 2: Async frame processing ============
-    // Mutex + CV for frame queue
+    // Frames are processed by tasks on the Engine's shared executor instead of a thread per
+    // camera. At most one task of this agent is posted at a time, so the worker state below is
+    // still accessed by one thread at a time, and cameras take turns on the pool threads.
+    const std::shared_ptr<TaskExecutor> m_executor;
     std::mutex m_frameQueueMutex;
-    std::condition_variable m_frameQueueCV;
+    std::condition_variable m_workerTaskDone;
     std::deque<FrameJob> m_frameQueue;
+    bool m_isWorkerTaskPosted = false; //< Guarded by m_frameQueueMutex.
+    bool m_isJobInFlight = false; //< Dequeued, not yet processed; guarded by m_frameQueueMutex.
+
+    // Shared with the posted tasks, which may outlive the agent in the executor queue: once the
+    // agent is cancelled, a task that has not started yet does nothing, and the destructor only
+    // waits for one that is running.
+    struct WorkerTaskState
+    {
+        std::mutex mutex;
+        std::condition_variable stopped;
+        bool isCancelled = false;
+        bool isRunning = false;
+    };
+    const std::shared_ptr<WorkerTaskState> m_workerTaskState =
+        std::make_shared<WorkerTaskState>();
+
+    // AI service outage reporting (worker thread only): state already reported, and the last
+    // detection error pushed, so that repeated identical errors do not flood the Server.
+    CircuitState m_reportedServiceState = CircuitState::closed;
+    std::string m_lastDetectionError;
     
-    // Worker thread
-    std::thread m_workerThread;
-    bool m_workerShouldStop = false;
-    
-    // Outgoing metadata packet queue (non-blocking)
-    std::mutex m_metadataQueueMutex;
-    std::deque<nx::sdk::Ptr<nx::sdk::analytics::IMetadataPacket>> m_metadataQueue;
-    
-    // Fall detection deduplication: track which trackIds have active fallDetected events
-    std::set<nx::sdk::Uuid> m_activeFallDetectedTrackIds;
+    // Fall event debouncing per trackId: only stable START/FINISH transitions become events.
+    KeyedDebouncer<nx::sdk::Uuid, UuidHash> m_fallDebouncer{kFallDebouncerSettings};
+
+    // Native fall heuristics over per-track box histories (used by the worker thread only).
+    FallAnalyzer m_fallAnalyzer;
+    PoseFallClassifier m_poseFallClassifier;
+    std::vector<PoseVerdict> m_poseVerdicts;
 
     // Track state of person presence to emit start/finish state-dependent events.
-    bool m_personDetectionActive = false;
+    Debouncer m_personPresenceDebouncer{kPersonPresenceDebouncerSettings};
 };
 
 } // namespace opencv_object_detection
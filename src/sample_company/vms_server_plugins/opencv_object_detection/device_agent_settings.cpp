@@ -0,0 +1,131 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "device_agent_settings.h"
+
+#include <array>
+#include <stdexcept>
+
+#include "json.hpp"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+using json = nlohmann::json;
+
+struct IntegerSetting
+{
+    const char* name;
+    const char* caption;
+    const char* description;
+    int minValue;
+    int maxValue;
+    int DeviceAgentSettings::* field;
+};
+
+const std::array<IntegerSetting, 9> kIntegerSettings{{
+    {"samplingPeriod", "Analyze every n-th frame",
+        "Sampling period when the inference service keeps up; it grows automatically under load.",
+        1, 100, &DeviceAgentSettings::samplingPeriod},
+    {"encodeWidth", "Inference image width (px)",
+        "Frames are downscaled to this width before being sent for inference.",
+        160, 1920, &DeviceAgentSettings::encodeWidth},
+    {"jpegQuality", "JPEG quality",
+        "Quality of the JPEG sent for inference.",
+        10, 100, &DeviceAgentSettings::jpegQuality},
+    {"frameQueueMaxSize", "Frame queue size",
+        "Frames waiting for inference; when full, the oldest one is dropped.",
+        1, 30, &DeviceAgentSettings::frameQueueMaxSize},
+    {"inferConnectTimeoutMs", "Inference connect timeout (ms)",
+        "",
+        50, 10000, &DeviceAgentSettings::inferConnectTimeoutMs},
+    {"inferReadTimeoutMs", "Inference read timeout (ms)",
+        "",
+        50, 30000, &DeviceAgentSettings::inferReadTimeoutMs},
+    {"priority", "Priority",
+        "Weight of this camera when the Server-wide inference budget is shared.",
+        1, 10, &DeviceAgentSettings::priority},
+    {"primaryStreamWidth", "Primary stream width (px)",
+        "When the secondary stream is analyzed and its aspect ratio differs from the primary "
+            "one: frames are reshaped to the primary aspect ratio. 0 - same aspect ratio.",
+        0, 7680, &DeviceAgentSettings::primaryStreamWidth},
+    {"primaryStreamHeight", "Primary stream height (px)",
+        "See the primary stream width.",
+        0, 4320, &DeviceAgentSettings::primaryStreamHeight},
+}};
+
+} // namespace
+
+std::string DeviceAgentSettings::modelJson()
+{
+    const DeviceAgentSettings defaults;
+
+    json items = json::array();
+    for (const IntegerSetting& setting: kIntegerSettings)
+    {
+        json item = {
+            {"type", "SpinBox"},
+            {"name", setting.name},
+            {"caption", setting.caption},
+            {"defaultValue", defaults.*setting.field},
+            {"minValue", setting.minValue},
+            {"maxValue", setting.maxValue},
+        };
+        if (*setting.description)
+            item["description"] = setting.description;
+        items.push_back(std::move(item));
+    }
+
+    const json model = {
+        {"type", "Settings"},
+        {"items", {{
+            {"type", "GroupBox"},
+            {"caption", "Performance"},
+            {"items", std::move(items)},
+        }}},
+    };
+    return model.dump(4);
+}
+
+DeviceAgentSettings DeviceAgentSettings::fromValues(
+    const std::map<std::string, std::string>& values,
+    const DeviceAgentSettings& current,
+    std::map<std::string, std::string>* outErrors)
+{
+    DeviceAgentSettings result = current;
+    for (const IntegerSetting& setting: kIntegerSettings)
+    {
+        const auto it = values.find(setting.name);
+        if (it == values.end())
+            continue;
+
+        int value = 0;
+        try
+        {
+            size_t parsedLength = 0;
+            value = std::stoi(it->second, &parsedLength);
+            if (parsedLength != it->second.size())
+                throw std::invalid_argument(it->second);
+        }
+        catch (const std::exception&)
+        {
+            (*outErrors)[setting.name] = "Not an integer: \"" + it->second + "\".";
+            continue;
+        }
+
+        if (value < setting.minValue || value > setting.maxValue)
+        {
+            (*outErrors)[setting.name] = "Must be in [" + std::to_string(setting.minValue)
+                + ", " + std::to_string(setting.maxValue) + "].";
+            continue;
+        }
+        result.*setting.field = value;
+    }
+    return result;
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,69 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Per-camera performance knobs. Declared as "deviceAgentSettingsModel" in the Engine manifest,
+ * edited in the camera settings of the Client and applied by the DeviceAgent without being
+ * recreated.
+ */
+struct DeviceAgentSettings
+{
+    int samplingPeriod = 2; //< Analyze every n-th frame when not overloaded.
+    int encodeWidth = 640; //< Width of the JPEG sent to /infer when not overloaded.
+    int jpegQuality = 80;
+    int frameQueueMaxSize = 3; //< Older frames are dropped when the queue is full.
+    int inferConnectTimeoutMs = 500;
+    int inferReadTimeoutMs = 1000;
+    int priority = 1; //< Weight of the camera in the Engine's inference budget.
+
+    /**
+     * Resolution of the primary stream, needed only when the analyzed (secondary) stream has
+     * another aspect ratio, e.g. 704x576 for a 16:9 camera; 0 if it has the same one.
+     */
+    int primaryStreamWidth = 0;
+    int primaryStreamHeight = 0;
+
+    std::chrono::milliseconds inferConnectTimeout() const
+    {
+        return std::chrono::milliseconds(inferConnectTimeoutMs);
+    }
+
+    std::chrono::milliseconds inferReadTimeout() const
+    {
+        return std::chrono::milliseconds(inferReadTimeoutMs);
+    }
+
+    /** Width / height of the primary stream, or 0 if not set. */
+    double primaryAspectRatio() const
+    {
+        if (primaryStreamWidth <= 0 || primaryStreamHeight <= 0)
+            return 0;
+        return (double) primaryStreamWidth / primaryStreamHeight;
+    }
+
+    /** JSON of the settings model, with the defaults above. */
+    static std::string modelJson();
+
+    /**
+     * Settings from the values received from the Server. Values that are missing keep the
+     * current ones; values that are not integers or are out of range keep them too and are
+     * reported in outErrors (setting name -> message).
+     */
+    static DeviceAgentSettings fromValues(
+        const std::map<std::string, std::string>& values,
+        const DeviceAgentSettings& current,
+        std::map<std::string, std::string>* outErrors);
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
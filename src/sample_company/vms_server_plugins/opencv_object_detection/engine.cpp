@@ -4,7 +4,18 @@
 
 #include "engine.h"
 
+#include <string>
+
+#include <nx/sdk/i_plugin_diagnostic_event.h>
+
 #include "device_agent.h"
+#include "device_agent_settings.h"
+#include "logger.h"
+
+/** Set by the "analyzeSecondaryStream" CMake option. */
+#if !defined(PLUGIN_ANALYZE_SECONDARY_STREAM)
+    #define PLUGIN_ANALYZE_SECONDARY_STREAM 0
+#endif
 
 namespace sample_company {
 namespace vms_server_plugins {
@@ -13,10 +24,48 @@ namespace opencv_object_detection {
 using namespace nx::sdk;
 using namespace nx::sdk::analytics;
 
+namespace {
+
+/** Engine settings, declared in engineSettingsModel of the Plugin manifest. */
+const std::string kInferencesPerSecondSetting = "inferencesPerSecond";
+const std::string kInferenceEndpointSetting = "inferenceEndpoint";
+const std::string kCameraAffinitySetting = "cameraAffinity";
+const std::string kSharedFrameSocketSetting = "sharedFrameSocket";
+
+/**
+ * Stream decoded for the DeviceAgents unless chosen otherwise in the camera settings of the
+ * Client. The secondary one saves the Server a full-resolution decode per camera; its frames
+ * are mapped back to the primary stream via DeviceAgentSettings::primaryAspectRatio().
+ */
+const std::string kPreferredStream = PLUGIN_ANALYZE_SECONDARY_STREAM ? "secondary" : "primary";
+
+/**
+ * Without needUncompressedVideoFrames_* the Server sends the compressed packets, and the
+ * DeviceAgent decodes only the frames it analyzes (see SparseVideoDecoder).
+ */
+#if defined(PLUGIN_USE_COMPRESSED_FRAMES)
+    const std::string kCapabilities = "";
+#else
+    const std::string kCapabilities = "needUncompressedVideoFrames_yuv420";
+#endif
+
+std::string toString(const std::vector<ServiceEndpoint>& endpoints)
+{
+    std::string result;
+    for (const ServiceEndpoint& endpoint: endpoints)
+        result += (result.empty() ? "" : ", ") + endpoint.toString();
+    return result;
+}
+
+} // namespace
+
 Engine::Engine(std::filesystem::path pluginHomeDir):
     nx::sdk::analytics::Engine(/*enableOutput*/ true),
     m_pluginHomeDir(std::move(pluginHomeDir))
 {
+    // Log writer thread for the lifetime of the Engine, not of the library (see Logger).
+    Logger::instance().start();
+
     // Model nằm cùng thư mục plugin:
     // C:\Program Files\Network Optix\Nx Meta\MediaServer\plugins\yolov8_people_analytics_plugin\yolov8n.onnx
     m_modelPath = m_pluginHomeDir / "yolov5s.onnx";
@@ -27,6 +76,9 @@ Engine::Engine(std::filesystem::path pluginHomeDir):
 
 Engine::~Engine()
 {
+    // Executor threads may outlive the Engine (DeviceAgents share it); they log to stderr
+    // directly from here on.
+    Logger::instance().stop();
 }
 
 void Engine::doObtainDeviceAgent(
@@ -36,16 +88,67 @@ void Engine::doObtainDeviceAgent(
     *outResult = new DeviceAgent(
         deviceInfo,
         m_pluginHomeDir,
-        m_modelPath);
+        m_modelPath,
+        m_inferenceGovernor,
+        m_inferenceRouter,
+        m_executor);
+}
+
+Result<const ISettingsResponse*> Engine::settingsReceived()
+{
+    const std::string value = settingValue(kInferencesPerSecondSetting);
+    if (!value.empty())
+    {
+        try
+        {
+            m_inferenceGovernor->setInferencesPerSecond(std::stod(value));
+        }
+        catch (const std::exception&)
+        {
+            pushPluginDiagnosticEvent(
+                IPluginDiagnosticEvent::Level::warning,
+                "Invalid inference budget",
+                "Setting " + kInferencesPerSecondSetting + " = \"" + value + "\" is not a number; "
+                    "keeping " + std::to_string(m_inferenceGovernor->inferencesPerSecond()) + ".");
+        }
+    }
+
+    const std::string endpoint = settingValue(kInferenceEndpointSetting);
+    if (!endpoint.empty())
+    {
+        try
+        {
+            m_inferenceRouter->setEndpoints(ServiceEndpoint::parseList(endpoint));
+        }
+        catch (const std::exception& e)
+        {
+            pushPluginDiagnosticEvent(
+                IPluginDiagnosticEvent::Level::warning,
+                "Invalid inference endpoint",
+                std::string(e.what()) + "; keeping "
+                    + toString(m_inferenceRouter->endpoints()) + ".");
+        }
+    }
+
+    const std::string cameraAffinity = settingValue(kCameraAffinitySetting);
+    if (!cameraAffinity.empty())
+        m_inferenceRouter->setCameraAffinity(cameraAffinity == "true");
+
+    // Empty is a valid value here: it disables the shared memory transport.
+    m_inferenceRouter->setSharedFrameSocketPath(settingValue(kSharedFrameSocketSetting));
+    return nullptr;
 }
 
 std::string Engine::manifestString() const
 {
     // Request YUV420 format (same as internal NX server format, more efficient)
     // YV12 format is YUV 4:2:0 planar, which we properly convert to BGR for OpenCV
+    // (or compressed packets, see kCapabilities)
     return /*suppress newline*/ 1 + R"json(
 {
-    "capabilities": "needUncompressedVideoFrames_yuv420"
+    "capabilities": ")json" + kCapabilities + R"json(",
+    "preferredStream": ")json" + kPreferredStream + R"json(",
+    "deviceAgentSettingsModel": )json" + DeviceAgentSettings::modelJson() + R"json(
 }
 )json";
 }
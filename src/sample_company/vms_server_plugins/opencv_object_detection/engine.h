@@ -5,11 +5,16 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
 
 #include <nx/sdk/analytics/helpers/plugin.h>
 #include <nx/sdk/analytics/helpers/engine.h>
 #include <nx/sdk/analytics/i_uncompressed_video_frame.h>
 
+#include "inference_governor.h"
+#include "inference_router.h"
+#include "task_executor.h"
+
 namespace sample_company {
 namespace vms_server_plugins {
 namespace opencv_object_detection {
@@ -23,6 +28,8 @@ public:
 protected:
     virtual std::string manifestString() const override;
 
+    virtual nx::sdk::Result<const nx::sdk::ISettingsResponse*> settingsReceived() override;
+
     virtual void doObtainDeviceAgent(
         nx::sdk::Result<nx::sdk::analytics::IDeviceAgent*>* outResult,
         const nx::sdk::IDeviceInfo* deviceInfo) override;
@@ -30,6 +37,19 @@ protected:
 private:
     std::filesystem::path m_pluginHomeDir;
     std::filesystem::path m_modelPath;   //< Full path tới file .onnx
+
+    // Ngân sách inference chung cho mọi camera của Server; DeviceAgent nào cũng hỏi nó trước
+    // khi sample frame. shared_ptr vì DeviceAgent có thể sống lâu hơn Engine.
+    const std::shared_ptr<InferenceGovernor> m_inferenceGovernor =
+        std::make_shared<InferenceGovernor>();
+
+    // Các AI service (TCP hoặc Unix socket) và tải của chúng; ObjectDetector của mọi camera
+    // hỏi nó gửi request tới service nào.
+    const std::shared_ptr<InferenceRouter> m_inferenceRouter =
+        std::make_shared<InferenceRouter>();
+
+    // Thread pool chạy worker task của mọi DeviceAgent (thay cho một thread mỗi camera).
+    const std::shared_ptr<TaskExecutor> m_executor = std::make_shared<TaskExecutor>();
 };
 
 } // namespace opencv_object_detection
@@ -3,7 +3,6 @@
 #pragma once
 
 #include <cstdint>
-#include <string>
 
 namespace sample_company {
 namespace vms_server_plugins {
@@ -20,7 +19,7 @@ struct Event
 {
     const EventType eventType;
     const int64_t timestampUs;
-    const std::string classLabel;
+    const int classId;
 };
 
 } // namespace opencv_object_detection
@@ -0,0 +1,76 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "event_debouncer.h"
+
+#include <algorithm>
+#include <bitset>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+Debouncer::Debouncer(const DebouncerSettings& settings):
+    m_settings(settings)
+{
+    m_settings.windowSize = std::clamp(m_settings.windowSize, 1, 64);
+    m_settings.activateCount = std::clamp(m_settings.activateCount, 1, m_settings.windowSize);
+    m_settings.deactivateCount = std::clamp(m_settings.deactivateCount, 1, m_settings.windowSize);
+    m_windowMask = (m_settings.windowSize == 64)
+        ? ~uint64_t(0)
+        : ((uint64_t(1) << m_settings.windowSize) - 1);
+}
+
+DebouncedTransition Debouncer::update(bool observation, int64_t timestampUs)
+{
+    m_window = ((m_window << 1) | (observation ? 1 : 0)) & m_windowMask;
+    m_filled = std::min(m_filled + 1, m_settings.windowSize);
+
+    const int positives = positiveCount();
+    const int negatives = m_filled - positives;
+    const int64_t heldUs = timestampUs - m_stateSinceUs;
+
+    if (!m_active)
+    {
+        if (positives >= m_settings.activateCount && heldUs >= m_settings.minInactiveUs)
+        {
+            // Restart the window from the new state: leaving it needs fresh contrary evidence.
+            m_window = m_windowMask;
+            m_filled = m_settings.windowSize;
+            m_active = true;
+            m_stateSinceUs = timestampUs;
+            return DebouncedTransition::started;
+        }
+    }
+    else
+    {
+        if (negatives >= m_settings.deactivateCount && heldUs >= m_settings.minActiveUs)
+        {
+            m_window = 0;
+            m_filled = m_settings.windowSize;
+            m_active = false;
+            m_stateSinceUs = timestampUs;
+            return DebouncedTransition::finished;
+        }
+    }
+    return DebouncedTransition::none;
+}
+
+void Debouncer::reset()
+{
+    m_window = 0;
+    m_filled = 0;
+    m_active = false;
+    m_stateSinceUs = INT64_MIN / 2;
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+int Debouncer::positiveCount() const
+{
+    return (int) std::bitset<64>(m_window).count();
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,154 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+struct DebouncerSettings
+{
+    /** Number of most recent observations considered (M); at most 64. */
+    int windowSize = 5;
+
+    /** Positive observations within the window needed to become active (N of M). */
+    int activateCount = 2;
+
+    /** Negative observations within the window needed to become inactive. */
+    int deactivateCount = 4;
+
+    /** Once active, stay active at least this long regardless of observations. */
+    int64_t minActiveUs = 0;
+
+    /** Once inactive, stay inactive at least this long regardless of observations. */
+    int64_t minInactiveUs = 0;
+};
+
+enum class DebouncedTransition
+{
+    none,
+    started,
+    finished,
+};
+
+/**
+ * Turns a noisy per-frame boolean into a stable state: a transition is reported only when enough
+ * observations of the sliding window agree and the current state has been held long enough.
+ */
+class Debouncer
+{
+public:
+    explicit Debouncer(const DebouncerSettings& settings = {});
+
+    DebouncedTransition update(bool observation, int64_t timestampUs);
+
+    bool isActive() const { return m_active; }
+
+    void reset();
+
+private:
+    int positiveCount() const;
+
+private:
+    DebouncerSettings m_settings;
+    uint64_t m_windowMask = 0;
+    uint64_t m_window = 0; //< Bit 0 is the newest observation, 1 means positive.
+    int m_filled = 0;
+    bool m_active = false;
+    int64_t m_stateSinceUs = INT64_MIN / 2;
+};
+
+/**
+ * Independent Debouncer per key (e.g. per track), created on first observation. Keys that are
+ * missing from a frame are fed negative observations by updateUnobserved(), so a single missed
+ * detection does not end the state while a track that is gone eventually does.
+ */
+template<typename Key, typename Hash = std::hash<Key>>
+class KeyedDebouncer
+{
+public:
+    explicit KeyedDebouncer(const DebouncerSettings& settings = {}, int64_t idleTtlUs = 30'000'000):
+        m_settings(settings),
+        m_idleTtlUs(idleTtlUs)
+    {
+    }
+
+    DebouncedTransition update(const Key& key, bool observation, int64_t timestampUs)
+    {
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+        {
+            if (!observation)
+                return DebouncedTransition::none; //< Nothing to debounce for an unknown key.
+            it = m_entries.emplace(key, Entry{Debouncer(m_settings), timestampUs, timestampUs}).first;
+        }
+
+        Entry& entry = it->second;
+        entry.lastObservedUs = timestampUs;
+        if (observation)
+            entry.lastPositiveUs = timestampUs;
+        return entry.debouncer.update(observation, timestampUs);
+    }
+
+    /**
+     * Feeds a negative observation to every key not updated at timestampUs and forgets inactive
+     * keys without positive observations for longer than the idle TTL.
+     * @param outFinished Receives the keys whose state finished as a result.
+     */
+    void updateUnobserved(int64_t timestampUs, std::vector<Key>* outFinished)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); )
+        {
+            Entry& entry = it->second;
+            if (entry.lastObservedUs != timestampUs
+                && entry.debouncer.update(false, timestampUs) == DebouncedTransition::finished)
+            {
+                outFinished->push_back(it->first);
+            }
+
+            if (!entry.debouncer.isActive() && timestampUs - entry.lastPositiveUs > m_idleTtlUs)
+                it = m_entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    bool isActive(const Key& key) const
+    {
+        const auto it = m_entries.find(key);
+        return it != m_entries.end() && it->second.debouncer.isActive();
+    }
+
+    bool isAnyActive() const
+    {
+        for (const auto& [key, entry]: m_entries)
+        {
+            if (entry.debouncer.isActive())
+                return true;
+        }
+        return false;
+    }
+
+    void reset() { m_entries.clear(); }
+
+private:
+    struct Entry
+    {
+        Debouncer debouncer;
+        int64_t lastObservedUs;
+        int64_t lastPositiveUs;
+    };
+
+    DebouncerSettings m_settings;
+    int64_t m_idleTtlUs;
+    std::unordered_map<Key, Entry, Hash> m_entries;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
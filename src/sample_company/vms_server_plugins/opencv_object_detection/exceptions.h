@@ -23,6 +23,10 @@ class ObjectDetectorIsTerminatedError: public ObjectDetectorError
 class ObjectDetectionError: public ObjectDetectorError
     { using ObjectDetectorError::ObjectDetectorError; };
 
+/** The AI service is known to be down; thrown without contacting it. */
+class ObjectDetectorUnavailableError: public ObjectDetectionError
+    { using ObjectDetectionError::ObjectDetectionError; };
+
 class ObjectTrackerError: public Error { using Error::Error; };
 
 class ObjectTrackingError: public ObjectTrackerError
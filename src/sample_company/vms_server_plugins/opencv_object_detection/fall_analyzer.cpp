@@ -0,0 +1,138 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "fall_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+constexpr float kRadiansToDegrees = 57.29577951308232F;
+
+} // namespace
+
+FallAnalyzer::FallAnalyzer(FallAnalyzerSettings settings):
+    m_settings(settings)
+{
+}
+
+void FallAnalyzer::setSettings(const FallAnalyzerSettings& settings)
+{
+    m_settings = settings;
+}
+
+bool FallAnalyzer::update(
+    const Detection& detection,
+    int frameWidth,
+    int frameHeight,
+    int64_t timestampUs,
+    PoseVerdict poseVerdict)
+{
+    if (frameWidth <= 0 || frameHeight <= 0)
+        return false;
+
+    TrackState& track = m_tracks[detection.trackId];
+    track.lastUpdateUs = timestampUs;
+
+    const nx::sdk::analytics::Rect& box = detection.boundingBox;
+    const float widthPx = box.width * (float) frameWidth;
+    const float heightPx = box.height * (float) frameHeight;
+    const float minSidePx = m_settings.minBoxSide * (float) frameHeight;
+
+    // Tiny boxes carry no usable shape information; they neither raise nor clear a fall.
+    if (widthPx < minSidePx || heightPx < minSidePx)
+        return track.fallen;
+
+    Sample sample;
+    sample.centerY = box.y + box.height / 2.0F;
+    sample.angleDeg = std::atan2(heightPx, widthPx) * kRadiansToDegrees;
+    sample.aspectRatio = widthPx / heightPx;
+
+    const bool wasFull = track.history.full();
+    const Sample evicted = track.history.push(sample);
+    track.aspectRatioSum += sample.aspectRatio;
+    if (wasFull)
+        track.aspectRatioSum -= evicted.aspectRatio;
+
+    const bool isFallingNow = (poseVerdict == PoseVerdict::unknown)
+        ? isFalling(track, detection.confidence)
+        : (poseVerdict == PoseVerdict::fallen);
+    applyHysteresis(&track, isFallingNow);
+    return track.fallen;
+}
+
+void FallAnalyzer::removeStaleTracks(int64_t timestampUs)
+{
+    for (auto it = m_tracks.begin(); it != m_tracks.end(); )
+    {
+        if (timestampUs - it->second.lastUpdateUs > m_settings.trackTtlUs)
+            it = m_tracks.erase(it);
+        else
+            ++it;
+    }
+}
+
+void FallAnalyzer::reset()
+{
+    m_tracks.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+bool FallAnalyzer::isFalling(const TrackState& track, float confidence) const
+{
+    const auto& history = track.history;
+    if (history.size() < 2)
+        return false;
+
+    if (confidence < m_settings.confidenceThreshold)
+        return false;
+
+    const Sample& current = history.back();
+    const Sample& previous = history[history.size() - 2];
+
+    const float velocity = std::abs(current.centerY - previous.centerY);
+    if (velocity > m_settings.velocityThreshold)
+        return true;
+
+    const float angleChange = std::abs(current.angleDeg - previous.angleDeg);
+    if (angleChange > m_settings.angleChangeThresholdDeg)
+        return true;
+
+    const float averageAspectRatio = track.aspectRatioSum / (float) history.size();
+    if (averageAspectRatio > m_settings.aspectRatioThreshold)
+        return true;
+
+    const float aspectRatioIncrease = averageAspectRatio - history.front().aspectRatio;
+    return aspectRatioIncrease > m_settings.aspectRatioIncreaseThreshold
+        && current.aspectRatio > m_settings.aspectRatioIncreaseMinCurrent;
+}
+
+void FallAnalyzer::applyHysteresis(TrackState* track, bool isFallingNow) const
+{
+    if (isFallingNow)
+    {
+        track->negativeFrameCount = 0;
+        track->positiveFrameCount = std::min(
+            track->positiveFrameCount + 1, m_settings.enterFrameCount);
+        if (track->positiveFrameCount >= m_settings.enterFrameCount)
+            track->fallen = true;
+    }
+    else
+    {
+        track->positiveFrameCount = 0;
+        track->negativeFrameCount = std::min(
+            track->negativeFrameCount + 1, m_settings.exitFrameCount);
+        if (track->negativeFrameCount >= m_settings.exitFrameCount)
+            track->fallen = false;
+    }
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
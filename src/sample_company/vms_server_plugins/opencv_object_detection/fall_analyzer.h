@@ -0,0 +1,118 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include <nx/sdk/uuid.h>
+
+#include "detection.h"
+#include "pose_fall_classifier.h"
+#include "ring_buffer.h"
+#include "uuid_hash.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Thresholds of the bounding-box fall heuristics. The defaults mirror FallDetectionTracker in
+ * python/fall_detection.py, with pixel distances expressed as fractions of the frame height so
+ * that they do not depend on the resolution the frame was analyzed at (the service sees 640x480).
+ */
+struct FallAnalyzerSettings
+{
+    /** Vertical movement of the box center between two analyzed frames. */
+    float velocityThreshold = 20.0F / 480.0F;
+
+    /** Change of atan2(height, width) of the box between two analyzed frames, in degrees. */
+    float angleChangeThresholdDeg = 45.0F;
+
+    /** Width/height ratio of the box averaged over the history. */
+    float aspectRatioThreshold = 1.5F;
+
+    /** Growth of the averaged ratio since the oldest sample, checked with the current ratio. */
+    float aspectRatioIncreaseThreshold = 0.5F;
+    float aspectRatioIncreaseMinCurrent = 1.2F;
+
+    float confidenceThreshold = 0.8F;
+
+    /** Boxes with a side smaller than this fraction of the frame height are ignored. */
+    float minBoxSide = 10.0F / 480.0F;
+
+    /** Consecutive positive frames needed to enter the fallen state. */
+    int enterFrameCount = 2;
+
+    /** Consecutive negative frames needed to leave the fallen state. */
+    int exitFrameCount = 5;
+
+    /** Tracks that have not been updated for this long are forgotten. */
+    int64_t trackTtlUs = 15'000'000;
+};
+
+/**
+ * Native port of the fall heuristics of the inference service, run per person track on the
+ * detections received from /infer. Each track keeps a fixed-size history, so an update costs the
+ * same regardless of how long the person has been tracked.
+ */
+class FallAnalyzer
+{
+public:
+    static constexpr size_t kHistorySize = 5;
+
+public:
+    explicit FallAnalyzer(FallAnalyzerSettings settings = {});
+
+    void setSettings(const FallAnalyzerSettings& settings);
+    const FallAnalyzerSettings& settings() const { return m_settings; }
+
+    /**
+     * Feeds a person detection into the history of its track.
+     * @param poseVerdict Result of PoseFallClassifier for this detection; when known, it replaces
+     *     the bounding-box heuristics as the per-frame evidence fed into the hysteresis.
+     * @return Whether the track is in the fallen state after this observation.
+     */
+    bool update(
+        const Detection& detection,
+        int frameWidth,
+        int frameHeight,
+        int64_t timestampUs,
+        PoseVerdict poseVerdict = PoseVerdict::unknown);
+
+    /** Forgets tracks that have not been updated within FallAnalyzerSettings::trackTtlUs. */
+    void removeStaleTracks(int64_t timestampUs);
+
+    void reset();
+
+    size_t trackCount() const { return m_tracks.size(); }
+
+private:
+    struct Sample
+    {
+        float centerY = 0.0F; //< Fraction of the frame height.
+        float angleDeg = 0.0F;
+        float aspectRatio = 0.0F;
+    };
+
+    struct TrackState
+    {
+        RingBuffer<Sample, kHistorySize> history;
+        float aspectRatioSum = 0.0F;
+        int positiveFrameCount = 0;
+        int negativeFrameCount = 0;
+        bool fallen = false;
+        int64_t lastUpdateUs = 0;
+    };
+
+    bool isFalling(const TrackState& track, float confidence) const;
+    void applyHysteresis(TrackState* track, bool isFallingNow) const;
+
+private:
+    FallAnalyzerSettings m_settings;
+    std::unordered_map<nx::sdk::Uuid, TrackState, UuidHash> m_tracks;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,66 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "frame_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "exceptions.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+/** Smaller differences, like 1920x1088 against 16:9, are padding rather than another geometry. */
+constexpr double kAspectRatioTolerance = 0.02;
+
+} // namespace
+
+cv::Mat downscaleFrame(
+    const Frame& frame, int targetWidth, PipelineStats* stats, double aspectRatio)
+{
+    const double frameAspectRatio = (double) frame.width / frame.height;
+    const bool isReshaped =
+        aspectRatio > 0 && std::abs(aspectRatio / frameAspectRatio - 1) > kAspectRatioTolerance;
+
+    // Downscale for faster HTTP transmission and inference.
+    if (frame.width <= targetWidth && !isReshaped)
+        return frame.cvMat;
+
+    const auto start = PipelineStats::Clock::now();
+    const int newWidth = std::min(targetWidth, frame.width);
+    const int newHeight = std::max(1,
+        (int) std::round(newWidth / (isReshaped ? aspectRatio : frameAspectRatio)));
+    cv::Mat result;
+    cv::resize(frame.cvMat, result, cv::Size(newWidth, newHeight));
+    if (stats)
+        stats->record(PipelineStage::resize, start);
+    return result;
+}
+
+std::vector<uint8_t> encodeJpeg(const cv::Mat& image, int quality, PipelineStats* stats)
+{
+    const auto start = PipelineStats::Clock::now();
+    std::vector<uint8_t> jpegBytes;
+    const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, quality};
+    if (!cv::imencode(".jpg", image, jpegBytes, params))
+        throw ObjectDetectionError("Failed to encode frame to JPEG");
+
+    if (stats)
+        stats->record(PipelineStage::jpegEncode, start);
+    return jpegBytes;
+}
+
+std::vector<uint8_t> encodeFrameToJpeg(const Frame& frame, int targetWidth, PipelineStats* stats)
+{
+    return encodeJpeg(downscaleFrame(frame, targetWidth, stats), /*quality*/ 80, stats);
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,47 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "frame.h"
+#include "pipeline_stats.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Downscales the frame to targetWidth, keeping the aspect ratio; narrower frames are returned as
+ * is (sharing the data).
+ * @param stats If not null, receives the resize stage timing.
+ * @param aspectRatio If positive, the width / height of the result instead of the frame's: the
+ *     frame of a secondary stream is stretched to the geometry of the primary one, so that
+ *     normalized coordinates in the result are those of the primary stream.
+ */
+cv::Mat downscaleFrame(
+    const Frame& frame,
+    int targetWidth = 640,
+    PipelineStats* stats = nullptr,
+    double aspectRatio = 0);
+
+/**
+ * Encodes an image as the JPEG sent to /infer.
+ * @param stats If not null, receives the jpegEncode stage timing.
+ * @throws ObjectDetectionError
+ */
+std::vector<uint8_t> encodeJpeg(
+    const cv::Mat& image,
+    int quality = 80,
+    PipelineStats* stats = nullptr);
+
+/** downscaleFrame() followed by encodeJpeg(). */
+std::vector<uint8_t> encodeFrameToJpeg(
+    const Frame& frame,
+    int targetWidth = 640,
+    PipelineStats* stats = nullptr);
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
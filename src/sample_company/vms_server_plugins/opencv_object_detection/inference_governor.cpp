@@ -0,0 +1,178 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "inference_governor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+using namespace std::chrono;
+
+namespace {
+
+constexpr double kMinWeight = 1e-3;
+
+} // namespace
+
+InferenceGovernor::InferenceGovernor(InferenceGovernorSettings settings):
+    m_settings(std::move(settings)),
+    m_inferencesPerSecond(m_settings.inferencesPerSecond),
+    m_lastRebalance(Clock::now())
+{
+}
+
+std::shared_ptr<InferenceGovernor::Camera> InferenceGovernor::addCamera(double priority)
+{
+    auto camera = std::make_shared<Camera>();
+    camera->setPriority(priority);
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_cameras.push_back(camera);
+    m_nextRebalanceAt.store(0, std::memory_order_relaxed); //< Rebalance on the next frame.
+    return camera;
+}
+
+void InferenceGovernor::removeCamera(const std::shared_ptr<Camera>& camera)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_cameras.erase(std::remove(m_cameras.begin(), m_cameras.end(), camera), m_cameras.end());
+    m_nextRebalanceAt.store(0, std::memory_order_relaxed);
+}
+
+void InferenceGovernor::setInferencesPerSecond(double inferencesPerSecond)
+{
+    m_inferencesPerSecond.store(std::max(inferencesPerSecond, 0.0), std::memory_order_relaxed);
+    m_nextRebalanceAt.store(0, std::memory_order_relaxed);
+}
+
+double InferenceGovernor::inferencesPerSecond() const
+{
+    return m_inferencesPerSecond.load(std::memory_order_relaxed);
+}
+
+void InferenceGovernor::rebalanceIfDue(Clock::time_point now)
+{
+    if (now.time_since_epoch().count() < m_nextRebalanceAt.load(std::memory_order_relaxed))
+        return;
+
+    // Another camera thread is already at it; its result is as good as ours.
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    rebalance(now);
+    m_nextRebalanceAt.store(
+        (now + m_settings.rebalancePeriod).time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void InferenceGovernor::rebalance(Clock::time_point now)
+{
+    const double elapsedS = duration<double>(now - m_lastRebalance).count();
+    m_lastRebalance = now;
+
+    const size_t cameraCount = m_cameras.size();
+    m_weights.assign(cameraCount, 0.0);
+    m_demands.assign(cameraCount, 0.0);
+    m_rates.assign(cameraCount, -1.0); //< Negative until the camera's rate is settled.
+
+    for (size_t i = 0; i < cameraCount; ++i)
+    {
+        Camera& camera = *m_cameras[i];
+
+        const int64_t frameCount = camera.m_frameCount.load(std::memory_order_relaxed);
+        if (elapsedS > 0)
+        {
+            const double measured = (frameCount - camera.m_rebalancedFrameCount) / elapsedS;
+            camera.m_framesPerSecond = camera.m_framesPerSecond > 0
+                ? 0.5 * camera.m_framesPerSecond + 0.5 * measured
+                : measured;
+        }
+        camera.m_rebalancedFrameCount = frameCount;
+
+        double boost = 1.0;
+        switch (camera.m_activity.load(std::memory_order_relaxed))
+        {
+            case CameraActivity::idle: break;
+            case CameraActivity::personPresent: boost = m_settings.personPresentBoost; break;
+            case CameraActivity::fallActive: boost = m_settings.fallActiveBoost; break;
+        }
+        m_weights[i] =
+            std::max(camera.m_priority.load(std::memory_order_relaxed) * boost, kMinWeight);
+        m_demands[i] = camera.m_framesPerSecond
+            / std::max(camera.m_minSamplingPeriod.load(std::memory_order_relaxed), 1);
+    }
+
+    const double budget = m_inferencesPerSecond.load(std::memory_order_relaxed);
+    if (budget <= 0)
+    {
+        for (const auto& camera: m_cameras)
+            camera->m_samplingPeriod.store(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Water-filling: cameras whose demand fits into their weighted share get exactly their
+    // demand; the rest of the budget is split again among the others until nobody fits.
+    double remaining = budget;
+    while (true)
+    {
+        double weightSum = 0;
+        for (size_t i = 0; i < cameraCount; ++i)
+        {
+            if (m_rates[i] < 0)
+                weightSum += m_weights[i];
+        }
+        if (weightSum == 0)
+            break;
+
+        bool isAnySettled = false;
+        for (size_t i = 0; i < cameraCount; ++i)
+        {
+            if (m_rates[i] < 0 && m_demands[i] <= remaining * m_weights[i] / weightSum)
+            {
+                m_rates[i] = m_demands[i];
+                isAnySettled = true;
+            }
+        }
+
+        if (!isAnySettled)
+        {
+            for (size_t i = 0; i < cameraCount; ++i)
+            {
+                if (m_rates[i] < 0)
+                    m_rates[i] = remaining * m_weights[i] / weightSum;
+            }
+            break;
+        }
+
+        remaining = budget;
+        for (size_t i = 0; i < cameraCount; ++i)
+        {
+            if (m_rates[i] >= 0)
+                remaining -= m_rates[i];
+        }
+    }
+
+    for (size_t i = 0; i < cameraCount; ++i)
+    {
+        Camera& camera = *m_cameras[i];
+        int period = 1;
+        if (camera.m_framesPerSecond > 0 && m_rates[i] < m_demands[i])
+        {
+            period = m_rates[i] > 0
+                ? (int) std::ceil(camera.m_framesPerSecond / m_rates[i])
+                : m_settings.maxSamplingPeriod;
+        }
+        camera.m_samplingPeriod.store(
+            std::clamp(period, 1, m_settings.maxSamplingPeriod), std::memory_order_relaxed);
+    }
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
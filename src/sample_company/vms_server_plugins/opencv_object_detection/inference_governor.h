@@ -0,0 +1,126 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/** What a camera currently shows; raises its share of the inference budget. */
+enum class CameraActivity
+{
+    idle,
+    personPresent,
+    fallActive,
+};
+
+struct InferenceGovernorSettings
+{
+    /** Inferences per second for all cameras of the Server together; 0 means unlimited. */
+    double inferencesPerSecond = 0.0;
+
+    /** Even with the budget exhausted, every camera is analyzed once per this many frames. */
+    int maxSamplingPeriod = 30;
+
+    /** Weight multipliers applied to the camera priority. */
+    double personPresentBoost = 2.0;
+    double fallActiveBoost = 4.0;
+
+    std::chrono::milliseconds rebalancePeriod{1000};
+};
+
+/**
+ * Splits a Server-wide inference budget between the cameras of an Engine. Each camera gets a
+ * share proportional to its priority times its activity boost; shares a camera cannot use
+ * (because it has fewer frames to analyze) are redistributed to the others. The result is a
+ * sampling period per camera, recomputed from the measured frame rates once per
+ * rebalancePeriod.
+ *
+ * Thread-safe. The per-frame calls (Camera::countFrame(), Camera::samplingPeriod(),
+ * rebalanceIfDue() when not due) only touch atomics.
+ */
+class InferenceGovernor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** Handle of one camera; owned by its DeviceAgent. */
+    class Camera
+    {
+    public:
+        /** Only every samplingPeriod()-th frame may be analyzed. */
+        int samplingPeriod() const { return m_samplingPeriod.load(std::memory_order_relaxed); }
+
+        void countFrame() { m_frameCount.fetch_add(1, std::memory_order_relaxed); }
+
+        void setActivity(CameraActivity activity)
+        {
+            m_activity.store(activity, std::memory_order_relaxed);
+        }
+
+        CameraActivity activity() const { return m_activity.load(std::memory_order_relaxed); }
+
+        /**
+         * Sampling period the camera would use with an unlimited budget, e.g. because of its
+         * own backpressure; the governor does not allocate inferences beyond it.
+         */
+        void setMinSamplingPeriod(int period)
+        {
+            m_minSamplingPeriod.store(period, std::memory_order_relaxed);
+        }
+
+        void setPriority(double priority) { m_priority.store(priority, std::memory_order_relaxed); }
+
+    private:
+        friend class InferenceGovernor;
+
+        std::atomic<int> m_samplingPeriod{1};
+        std::atomic<int64_t> m_frameCount{0};
+        std::atomic<CameraActivity> m_activity{CameraActivity::idle};
+        std::atomic<int> m_minSamplingPeriod{1};
+        std::atomic<double> m_priority{1.0};
+
+        // Owned by InferenceGovernor::rebalance().
+        int64_t m_rebalancedFrameCount = 0;
+        double m_framesPerSecond = 0;
+    };
+
+public:
+    explicit InferenceGovernor(InferenceGovernorSettings settings = {});
+
+    std::shared_ptr<Camera> addCamera(double priority = 1.0);
+    void removeCamera(const std::shared_ptr<Camera>& camera);
+
+    void setInferencesPerSecond(double inferencesPerSecond);
+    double inferencesPerSecond() const;
+
+    /** Recomputes the sampling periods if rebalancePeriod has passed since the last time. */
+    void rebalanceIfDue(Clock::time_point now);
+
+private:
+    void rebalance(Clock::time_point now);
+
+private:
+    const InferenceGovernorSettings m_settings;
+
+    std::atomic<double> m_inferencesPerSecond;
+    std::atomic<Clock::rep> m_nextRebalanceAt{0};
+
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<Camera>> m_cameras;
+    Clock::time_point m_lastRebalance;
+    std::vector<double> m_weights; //< Scratch buffers of rebalance(), kept to avoid allocations.
+    std::vector<double> m_demands;
+    std::vector<double> m_rates;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
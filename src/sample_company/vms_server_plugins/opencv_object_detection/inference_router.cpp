@@ -0,0 +1,258 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "inference_router.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "logger.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+using namespace std::chrono;
+
+InferenceRouter::InferenceRouter(InferenceRouterSettings settings):
+    m_settings(std::move(settings))
+{
+    m_endpoints.emplace_back();
+}
+
+void InferenceRouter::setEndpoints(std::vector<ServiceEndpoint> endpoints)
+{
+    if (endpoints.empty())
+        throw std::invalid_argument("No inference endpoint is given");
+
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (std::equal(endpoints.begin(), endpoints.end(), m_endpoints.begin(), m_endpoints.end(),
+        [](const ServiceEndpoint& a, const Endpoint& b) { return a == b.endpoint; }))
+    {
+        return;
+    }
+
+    m_endpoints.clear();
+    for (ServiceEndpoint& endpoint: endpoints)
+        m_endpoints.emplace_back().endpoint = std::move(endpoint);
+    m_cameraEndpoints.clear();
+    m_revision.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<ServiceEndpoint> InferenceRouter::endpoints() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<ServiceEndpoint> result;
+    for (const Endpoint& endpoint: m_endpoints)
+        result.push_back(endpoint.endpoint);
+    return result;
+}
+
+void InferenceRouter::setCameraAffinity(bool isEnabled)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (isEnabled == m_isCameraAffinityEnabled)
+        return;
+
+    m_isCameraAffinityEnabled = isEnabled;
+    m_cameraEndpoints.clear();
+    for (Endpoint& endpoint: m_endpoints)
+        endpoint.cameraCount = 0;
+}
+
+void InferenceRouter::setSharedFrameSocketPath(std::string socketPath)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    m_sharedFrameSocketPath = std::move(socketPath);
+}
+
+std::string InferenceRouter::sharedFrameSocketPath(ServiceEndpoint* outEndpoint) const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_endpoints.size() != 1 || !m_endpoints.front().endpoint.isLocal())
+        return std::string();
+
+    *outEndpoint = m_endpoints.front().endpoint;
+    return m_sharedFrameSocketPath;
+}
+
+int InferenceRouter::endpointCount() const
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return (int) m_endpoints.size();
+}
+
+InferenceRouter::Route InferenceRouter::acquire(
+    const std::string& cameraId, Clock::time_point now)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+
+    int index = -1;
+    if (!m_isCameraAffinityEnabled)
+    {
+        index = pickEndpoint(/*countCameras*/ false, now);
+    }
+    else
+    {
+        const auto it = m_cameraEndpoints.find(cameraId);
+        if (it != m_cameraEndpoints.end() && isAvailable(m_endpoints[it->second], now))
+        {
+            index = it->second;
+        }
+        else
+        {
+            index = pickEndpoint(/*countCameras*/ true, now);
+            if (it == m_cameraEndpoints.end())
+            {
+                m_cameraEndpoints.emplace(cameraId, index);
+                ++m_endpoints[index].cameraCount;
+            }
+            else if (it->second != index)
+            {
+                // The tracks of the camera are lost with the move; its events restart.
+                PLUGIN_LOG(warning, 0, "[%s] Moved from inference endpoint %s to %s",
+                    cameraId.c_str(), m_endpoints[it->second].endpoint.toString().c_str(),
+                    m_endpoints[index].endpoint.toString().c_str());
+                --m_endpoints[it->second].cameraCount;
+                ++m_endpoints[index].cameraCount;
+                it->second = index;
+            }
+        }
+    }
+
+    Endpoint& endpoint = m_endpoints[index];
+    // Only one trial request at a time for an endpoint that has failed.
+    if (endpoint.consecutiveFailureCount >= m_settings.failureThreshold && now >= endpoint.retryAt)
+        endpoint.retryAt = now + endpoint.retryDelay;
+    ++endpoint.inFlightCount;
+
+    return Route{index, endpoint.endpoint, m_revision.load(std::memory_order_relaxed)};
+}
+
+void InferenceRouter::release(const Route& route, RequestOutcome outcome, Clock::time_point now,
+    std::optional<Clock::duration> latency)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    if (route.revision != m_revision.load(std::memory_order_relaxed)
+        || route.endpointIndex < 0 || route.endpointIndex >= (int) m_endpoints.size())
+    {
+        return;
+    }
+
+    Endpoint& endpoint = m_endpoints[route.endpointIndex];
+    endpoint.inFlightCount = std::max(endpoint.inFlightCount - 1, 0);
+
+    switch (outcome)
+    {
+        case RequestOutcome::success:
+            if (latency)
+            {
+                const double latencyMs = duration<double, std::milli>(*latency).count();
+                endpoint.averageLatencyMs = endpoint.averageLatencyMs > 0
+                    ? endpoint.averageLatencyMs
+                        + m_settings.latencyEwmaAlpha * (latencyMs - endpoint.averageLatencyMs)
+                    : latencyMs;
+            }
+            if (endpoint.consecutiveFailureCount >= m_settings.failureThreshold)
+            {
+                PLUGIN_LOG(info, 0, "Inference endpoint %s is available again",
+                    endpoint.endpoint.toString().c_str());
+            }
+            endpoint.consecutiveFailureCount = 0;
+            endpoint.retryDelay = milliseconds::zero();
+            break;
+        case RequestOutcome::failure:
+            recordFailure(&endpoint, now);
+            break;
+        case RequestOutcome::cancelled:
+            break;
+    }
+}
+
+void InferenceRouter::removeCamera(const std::string& cameraId)
+{
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_cameraEndpoints.find(cameraId);
+    if (it == m_cameraEndpoints.end())
+        return;
+
+    --m_endpoints[it->second].cameraCount;
+    m_cameraEndpoints.erase(it);
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+bool InferenceRouter::isAvailable(const Endpoint& endpoint, Clock::time_point now) const
+{
+    return endpoint.consecutiveFailureCount < m_settings.failureThreshold
+        || now >= endpoint.retryAt;
+}
+
+int InferenceRouter::pickEndpoint(bool countCameras, Clock::time_point now) const
+{
+    // An endpoint without a response yet is assumed as fast as the fastest known one, so that
+    // it gets its first requests soon.
+    double unknownLatencyMs = std::numeric_limits<double>::max();
+    for (const Endpoint& endpoint: m_endpoints)
+    {
+        if (endpoint.averageLatencyMs > 0)
+            unknownLatencyMs = std::min(unknownLatencyMs, endpoint.averageLatencyMs);
+    }
+    if (unknownLatencyMs == std::numeric_limits<double>::max())
+        unknownLatencyMs = 1;
+
+    int result = -1;
+    double minLoad = std::numeric_limits<double>::max();
+    for (int i = 0; i < (int) m_endpoints.size(); ++i)
+    {
+        const Endpoint& endpoint = m_endpoints[i];
+        if (!isAvailable(endpoint, now))
+            continue;
+
+        const double latencyMs =
+            endpoint.averageLatencyMs > 0 ? endpoint.averageLatencyMs : unknownLatencyMs;
+        const int queueLength =
+            endpoint.inFlightCount + 1 + (countCameras ? endpoint.cameraCount : 0);
+        const double load = queueLength * latencyMs;
+        if (load < minLoad)
+        {
+            minLoad = load;
+            result = i;
+        }
+    }
+    if (result >= 0)
+        return result;
+
+    // All are down: the one to be retried first; it fails fast until then.
+    result = 0;
+    for (int i = 1; i < (int) m_endpoints.size(); ++i)
+    {
+        if (m_endpoints[i].retryAt < m_endpoints[result].retryAt)
+            result = i;
+    }
+    return result;
+}
+
+void InferenceRouter::recordFailure(Endpoint* endpoint, Clock::time_point now)
+{
+    ++endpoint->consecutiveFailureCount;
+    if (endpoint->consecutiveFailureCount < m_settings.failureThreshold)
+        return;
+
+    endpoint->retryDelay = endpoint->retryDelay > milliseconds::zero()
+        ? std::min(endpoint->retryDelay * 2, m_settings.maxRetryDelay)
+        : m_settings.initialRetryDelay;
+    endpoint->retryAt = now + endpoint->retryDelay;
+
+    if (endpoint->consecutiveFailureCount == m_settings.failureThreshold)
+    {
+        PLUGIN_LOG(warning, 0, "Inference endpoint %s is unavailable; retrying in %lld ms",
+            endpoint->endpoint.toString().c_str(), (long long) endpoint->retryDelay.count());
+    }
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
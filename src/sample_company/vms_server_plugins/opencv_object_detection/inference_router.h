@@ -0,0 +1,143 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "service_endpoint.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+struct InferenceRouterSettings
+{
+    /** Weight of the newest request in the latency average. */
+    double latencyEwmaAlpha = 0.2;
+
+    /** Consecutive failures after which an endpoint gets no requests until its retry time. */
+    int failureThreshold = 2;
+
+    /** Delay before an unhealthy endpoint is tried again; doubled after each failed retry. */
+    std::chrono::milliseconds initialRetryDelay{1000};
+    std::chrono::milliseconds maxRetryDelay{30'000};
+};
+
+enum class RequestOutcome
+{
+    success,
+    failure, //< No response, or an error status: counts against the endpoint.
+    cancelled, //< Aborted by the plugin: says nothing about the endpoint.
+};
+
+/**
+ * Spreads the requests of all cameras of an Engine over several inference services, e.g. one
+ * process per NUMA node of the Server.
+ *
+ * An endpoint's load is its requests in flight weighted by its average latency (EWMA), so a
+ * slower process gets proportionally fewer requests. With camera affinity (the default) a camera
+ * stays on the endpoint it was first given, because the service keeps its tracks; it moves only
+ * when that endpoint fails, and is then placed by the same load measure, counting the cameras
+ * already pinned to each endpoint. Without affinity each request goes to the least loaded
+ * endpoint.
+ *
+ * An endpoint that fails failureThreshold times in a row is skipped until a retry time that
+ * backs off exponentially; the first request after it is a trial. If all endpoints are down,
+ * the one to be retried first is chosen, and the caller's circuit breaker takes over.
+ *
+ * Thread-safe; acquire() and release() take one short lock.
+ */
+class InferenceRouter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /** Endpoint picked for one request; to be passed back to release(). */
+    struct Route
+    {
+        int endpointIndex = -1;
+        ServiceEndpoint endpoint;
+        uint64_t revision = 0; //< Of the endpoint list; stale routes are ignored by release().
+    };
+
+public:
+    /** Starts with the single default endpoint, 127.0.0.1:18000. */
+    explicit InferenceRouter(InferenceRouterSettings settings = {});
+
+    /**
+     * Replaces the endpoints; stats and camera assignments are reset unless the list is the
+     * same.
+     * @throws std::invalid_argument If the list is empty.
+     */
+    void setEndpoints(std::vector<ServiceEndpoint> endpoints);
+    std::vector<ServiceEndpoint> endpoints() const;
+
+    void setCameraAffinity(bool isEnabled);
+
+    /**
+     * Socket of the shared memory transport of the native service (its SHARED_FRAME_SOCKET);
+     * empty disables the transport.
+     */
+    void setSharedFrameSocketPath(std::string socketPath);
+
+    /**
+     * The shared memory socket, if the transport can be used: a single endpoint is configured
+     * and it is on this host, so that the frames reach the service the user chose. Otherwise
+     * empty.
+     * @param outEndpoint Receives that endpoint, e.g. to key its tracks.
+     */
+    std::string sharedFrameSocketPath(ServiceEndpoint* outEndpoint) const;
+
+    /** Incremented by each change of the endpoint list; lock-free. */
+    uint64_t revision() const { return m_revision.load(std::memory_order_acquire); }
+
+    int endpointCount() const;
+
+    /** Picks the endpoint for the next request of the camera and counts it as in flight. */
+    Route acquire(const std::string& cameraId, Clock::time_point now);
+
+    /** @param latency Of a request that got a response; omitted for health probes. */
+    void release(const Route& route, RequestOutcome outcome, Clock::time_point now,
+        std::optional<Clock::duration> latency = std::nullopt);
+
+    /** Frees the camera's place on its endpoint; call when the camera goes away. */
+    void removeCamera(const std::string& cameraId);
+
+private:
+    struct Endpoint
+    {
+        ServiceEndpoint endpoint;
+        int inFlightCount = 0;
+        double averageLatencyMs = 0;
+        int cameraCount = 0;
+        int consecutiveFailureCount = 0;
+        std::chrono::milliseconds retryDelay{0};
+        Clock::time_point retryAt; //< Unhealthy until then if the failure threshold is reached.
+    };
+
+    bool isAvailable(const Endpoint& endpoint, Clock::time_point now) const;
+    int pickEndpoint(bool countCameras, Clock::time_point now) const;
+    void recordFailure(Endpoint* endpoint, Clock::time_point now);
+
+private:
+    const InferenceRouterSettings m_settings;
+
+    std::atomic<uint64_t> m_revision{0};
+
+    mutable std::mutex m_mutex;
+    std::vector<Endpoint> m_endpoints;
+    bool m_isCameraAffinityEnabled = true;
+    std::string m_sharedFrameSocketPath = "/tmp/safeaging_inference.sock"; //< Service default.
+    std::unordered_map<std::string, int> m_cameraEndpoints; //< Camera id -> endpoint index.
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,111 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+int highestBit(uint64_t value)
+{
+    int result = 0;
+    while (value >>= 1)
+        ++result;
+    return result;
+}
+
+} // namespace
+
+void LatencyHistogram::record(int64_t valueUs)
+{
+    const uint64_t value = (uint64_t) std::max<int64_t>(valueUs, 0);
+
+    m_counts[(size_t) bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = m_maxUs.load(std::memory_order_relaxed);
+    while (value > max && !m_maxUs.compare_exchange_weak(max, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+int64_t LatencyHistogram::count() const
+{
+    return (int64_t) m_count.load(std::memory_order_relaxed);
+}
+
+int64_t LatencyHistogram::maxUs() const
+{
+    return (int64_t) m_maxUs.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::meanUs() const
+{
+    const uint64_t count = m_count.load(std::memory_order_relaxed);
+    if (count == 0)
+        return 0.0;
+    return (double) m_sumUs.load(std::memory_order_relaxed) / (double) count;
+}
+
+int64_t LatencyHistogram::valueAtPercentileUs(double percentile) const
+{
+    // Buckets are summed instead of trusting m_count, which a concurrent writer may have
+    // already incremented.
+    uint64_t total = 0;
+    for (const std::atomic<uint64_t>& bucket: m_counts)
+        total += bucket.load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0;
+
+    const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    const uint64_t target =
+        std::max<uint64_t>(1, (uint64_t) std::ceil(clamped / 100.0 * (double) total));
+
+    uint64_t cumulative = 0;
+    for (int i = 0; i < kBucketCount; ++i)
+    {
+        cumulative += m_counts[(size_t) i].load(std::memory_order_relaxed);
+        if (cumulative >= target)
+            return std::min(bucketUpperBoundUs(i), maxUs());
+    }
+    return maxUs();
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+int LatencyHistogram::bucketIndex(uint64_t valueUs)
+{
+    if (valueUs < (uint64_t) kSubBucketCount)
+        return (int) valueUs;
+
+    const int exponent = highestBit(valueUs);
+    if (exponent > kMaxExponent)
+        return kBucketCount - 1;
+
+    const int group = exponent - kSubBucketBits + 1;
+    const int subBucket = (int) (valueUs >> (exponent - kSubBucketBits)) - kSubBucketCount;
+    return group * kSubBucketCount + subBucket;
+}
+
+int64_t LatencyHistogram::bucketUpperBoundUs(int index)
+{
+    if (index < kSubBucketCount)
+        return index;
+
+    const int group = index / kSubBucketCount;
+    const int subBucket = index % kSubBucketCount;
+    const int shift = group - 1;
+    const int64_t lowerBound = (int64_t) (kSubBucketCount + subBucket) << shift;
+    return lowerBound + ((int64_t) 1 << shift) - 1;
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
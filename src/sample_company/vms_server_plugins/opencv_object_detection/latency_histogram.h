@@ -0,0 +1,54 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Log-linear latency histogram in the spirit of HdrHistogram: values below 32 us have a bucket
+ * each, larger values get 32 sub-buckets per power of two, which keeps the relative error of a
+ * reported percentile within ~3% over the whole range.
+ *
+ * record() is a few integer operations and relaxed atomic increments, so it may be called from
+ * any thread on the frame path while another thread reads the histogram.
+ */
+class LatencyHistogram
+{
+public:
+    void record(int64_t valueUs);
+
+    int64_t count() const;
+    int64_t maxUs() const;
+    double meanUs() const;
+
+    /**
+     * @param percentile In [0, 100].
+     * @return Highest value equivalent to the percentile, or 0 if nothing was recorded.
+     */
+    int64_t valueAtPercentileUs(double percentile) const;
+
+private:
+    static int bucketIndex(uint64_t valueUs);
+    static int64_t bucketUpperBoundUs(int index);
+
+private:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 31; //< Larger values (over ~35 minutes) are clamped.
+    static constexpr int kBucketCount = kSubBucketCount * (kMaxExponent - kSubBucketBits + 2);
+
+    std::array<std::atomic<uint64_t>, kBucketCount> m_counts{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sumUs{0};
+    std::atomic<uint64_t> m_maxUs{0};
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,370 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "logger.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+using namespace std::chrono;
+
+namespace {
+
+constexpr milliseconds kWritePeriod{50};
+
+int64_t steadyNowNs()
+{
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+char levelLetter(LogLevel level)
+{
+    switch (level)
+    {
+        case LogLevel::debug: return 'D';
+        case LogLevel::info: return 'I';
+        case LogLevel::warning: return 'W';
+        case LogLevel::error: return 'E';
+    }
+    return '?';
+}
+
+const char* baseName(const char* path)
+{
+    const char* result = path;
+    for (const char* c = path; *c; ++c)
+    {
+        if (*c == '/' || *c == '\\')
+            result = c + 1;
+    }
+    return result;
+}
+
+} // namespace
+
+//-------------------------------------------------------------------------------------------------
+// LogRateLimiter
+
+LogRateLimiter::LogRateLimiter(double messagesPerSecond, int burst):
+    m_intervalNs(messagesPerSecond > 0 ? (int64_t) (1e9 / messagesPerSecond) : 0),
+    m_burstToleranceNs(m_intervalNs * std::max(0, burst - 1))
+{
+}
+
+int LogRateLimiter::tryAcquire()
+{
+    if (m_intervalNs == 0)
+        return 0;
+
+    const int64_t now = steadyNowNs();
+    int64_t theoreticalArrival = m_theoreticalArrivalNs.load(std::memory_order_relaxed);
+    while (true)
+    {
+        if (now < theoreticalArrival - m_burstToleranceNs)
+        {
+            m_suppressedCount.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        const int64_t next = std::max(theoreticalArrival, now) + m_intervalNs;
+        if (m_theoreticalArrivalNs.compare_exchange_weak(
+            theoreticalArrival, next, std::memory_order_relaxed))
+        {
+            return m_suppressedCount.exchange(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------
+// Logger
+
+struct Logger::Ring
+{
+    static constexpr uint32_t kCapacity = 128;
+    static constexpr size_t kTextSize = 216;
+
+    struct Record
+    {
+        system_clock::time_point time;
+        const char* file;
+        int line;
+        int suppressedCount;
+        LogLevel level;
+        bool isTruncated;
+        char text[kTextSize];
+    };
+
+    explicit Ring(int threadIndex): threadIndex(threadIndex) {}
+
+    const int threadIndex;
+    std::array<Record, kCapacity> records;
+    std::atomic<uint32_t> head{0}; //< Next record to write out; advanced by the writer thread.
+    std::atomic<uint32_t> tail{0}; //< Next free record; advanced by the owning thread.
+    std::atomic<uint32_t> droppedCount{0}; //< Messages that found the ring full.
+    std::atomic<bool> isThreadAlive{true};
+};
+
+namespace {
+
+/** Marks the ring of an exiting thread, so that the writer frees it once it is empty. */
+struct ThreadRingHolder
+{
+    std::shared_ptr<Logger::Ring> ring;
+
+    ~ThreadRingHolder()
+    {
+        if (ring)
+            ring->isThreadAlive.store(false, std::memory_order_release);
+    }
+};
+
+thread_local ThreadRingHolder tlsRingHolder;
+
+/** One line of the log, with the level, time, thread and call site in front of the message. */
+std::string formatRecord(const Logger::Ring::Record& record, int threadIndex)
+{
+    const std::time_t seconds = system_clock::to_time_t(record.time);
+    std::tm localTime{};
+    #if defined(_WIN32)
+        localtime_s(&localTime, &seconds);
+    #else
+        localtime_r(&seconds, &localTime);
+    #endif
+    const int milliseconds = (int) (duration_cast<std::chrono::milliseconds>(
+        record.time.time_since_epoch()).count() % 1000);
+
+    char prefix[128];
+    std::snprintf(prefix, sizeof(prefix), "[%c %02d:%02d:%02d.%03d t%d %s:%d] ",
+        levelLetter(record.level), localTime.tm_hour, localTime.tm_min, localTime.tm_sec,
+        milliseconds, threadIndex, baseName(record.file), record.line);
+
+    std::string text = prefix;
+    text += record.text;
+    if (record.isTruncated)
+        text += "...";
+    if (record.suppressedCount > 0)
+        text += " (" + std::to_string(record.suppressedCount) + " suppressed)";
+    text += '\n';
+    return text;
+}
+
+/** Counts a Logger::write() call for as long as it runs. */
+class InFlightWrite
+{
+public:
+    explicit InFlightWrite(std::atomic<int>* count): m_count(count) { m_count->fetch_add(1); }
+    ~InFlightWrite() { m_count->fetch_sub(1, std::memory_order_release); }
+
+    InFlightWrite(const InFlightWrite&) = delete;
+    InFlightWrite& operator=(const InFlightWrite&) = delete;
+
+private:
+    std::atomic<int>* const m_count;
+};
+
+} // namespace
+
+Logger& Logger::instance()
+{
+    // Leaked on purpose, see the class comment.
+    static Logger* const logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger() = default;
+
+void Logger::start()
+{
+    const std::lock_guard<std::mutex> startLock(m_startMutex);
+    if (m_startCount++ > 0)
+        return;
+
+    {
+        const std::lock_guard<std::mutex> lock(m_wakeUpMutex);
+        m_stopping = false;
+    }
+    m_thread = std::thread(&Logger::run, this);
+    m_isWriterRunning.store(true, std::memory_order_release);
+}
+
+void Logger::stop()
+{
+    const std::lock_guard<std::mutex> startLock(m_startMutex);
+    if (m_startCount == 0 || --m_startCount > 0)
+        return;
+
+    // New messages go to stderr directly from now on. Sequentially consistent with the count in
+    // write(): a write() that saw the writer running is counted here.
+    m_isWriterRunning.store(false);
+    {
+        const std::lock_guard<std::mutex> lock(m_wakeUpMutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+    m_thread.join();
+
+    // Messages pushed after the last drain() of the writer thread would be lost otherwise.
+    while (m_inFlightWriteCount.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield();
+    drain();
+}
+
+void Logger::write(LogLevel level, const char* file, int line, int suppressedCount,
+    const char* format, ...)
+{
+    Ring* const ring = threadRing();
+
+    // Counted before the check, so that stop() either makes this write go to stderr or waits
+    // for it before its final drain().
+    const InFlightWrite inFlightWrite(&m_inFlightWriteCount);
+    if (!m_isWriterRunning.load())
+    {
+        va_list args;
+        va_start(args, format);
+        writeDirectly(ring, level, file, line, suppressedCount, format, args);
+        va_end(args);
+        return;
+    }
+
+    const uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->head.load(std::memory_order_acquire) >= Ring::kCapacity)
+    {
+        ring->droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Ring::Record& record = ring->records[tail % Ring::kCapacity];
+    record.time = system_clock::now();
+    record.file = file;
+    record.line = line;
+    record.suppressedCount = suppressedCount;
+    record.level = level;
+
+    va_list args;
+    va_start(args, format);
+    const int length = std::vsnprintf(record.text, sizeof(record.text), format, args);
+    va_end(args);
+    if (length < 0)
+        record.text[0] = '\0';
+    record.isTruncated = length >= (int) sizeof(record.text);
+
+    ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+Logger::Ring* Logger::threadRing()
+{
+    if (!tlsRingHolder.ring)
+    {
+        const std::lock_guard<std::mutex> lock(m_ringsMutex);
+        tlsRingHolder.ring = std::make_shared<Ring>(m_nextThreadIndex++);
+        m_rings.push_back(tlsRingHolder.ring);
+    }
+    return tlsRingHolder.ring.get();
+}
+
+void Logger::run()
+{
+    while (true)
+    {
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock(m_wakeUpMutex);
+            m_wakeUp.wait_for(lock, kWritePeriod, [this]() { return m_stopping; });
+            stopping = m_stopping;
+        }
+        drain();
+        if (stopping)
+            return;
+    }
+}
+
+void Logger::writeDirectly(Ring* ring, LogLevel level, const char* file, int line,
+    int suppressedCount, const char* format, va_list args)
+{
+    Ring::Record record;
+    record.time = system_clock::now();
+    record.file = file;
+    record.line = line;
+    record.suppressedCount = suppressedCount;
+    record.level = level;
+    const int length = std::vsnprintf(record.text, sizeof(record.text), format, args);
+    if (length < 0)
+        record.text[0] = '\0';
+    record.isTruncated = length >= (int) sizeof(record.text);
+
+    const std::string text = formatRecord(record, ring->threadIndex);
+    std::fwrite(text.data(), 1, text.size(), stderr);
+    std::fflush(stderr);
+}
+
+void Logger::drain()
+{
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        const std::lock_guard<std::mutex> lock(m_ringsMutex);
+        rings = m_rings;
+    }
+
+    struct Line
+    {
+        system_clock::time_point time;
+        std::string text;
+    };
+    std::vector<Line> lines;
+
+    for (const auto& ring: rings)
+    {
+        // Read before the records: a ring seen dead and then empty will stay empty.
+        const bool isThreadAlive = ring->isThreadAlive.load(std::memory_order_acquire);
+
+        uint32_t head = ring->head.load(std::memory_order_relaxed);
+        const uint32_t tail = ring->tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head)
+        {
+            const Ring::Record& record = ring->records[head % Ring::kCapacity];
+            lines.push_back({record.time, formatRecord(record, ring->threadIndex)});
+        }
+        ring->head.store(head, std::memory_order_release);
+
+        const uint32_t droppedCount = ring->droppedCount.exchange(0, std::memory_order_relaxed);
+        if (droppedCount > 0)
+        {
+            lines.push_back({system_clock::now(), "[W logger] " + std::to_string(droppedCount)
+                + " messages of thread t" + std::to_string(ring->threadIndex)
+                + " dropped: the log ring was full\n"});
+        }
+
+        if (!isThreadAlive)
+        {
+            const std::lock_guard<std::mutex> lock(m_ringsMutex);
+            m_rings.erase(std::remove(m_rings.begin(), m_rings.end(), ring), m_rings.end());
+        }
+    }
+
+    if (lines.empty())
+        return;
+
+    std::stable_sort(lines.begin(), lines.end(),
+        [](const Line& a, const Line& b) { return a.time < b.time; });
+
+    std::string batch;
+    for (const Line& line: lines)
+        batch += line.text;
+    std::fwrite(batch.data(), 1, batch.size(), stderr);
+    std::fflush(stderr);
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,149 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Lowest level compiled in: 0 - debug, 1 - info, 2 - warning, 3 - error. Calls below it are
+ * removed at compile time, arguments included. Set by the "pluginLogMinLevel" CMake variable.
+ */
+#ifndef PLUGIN_LOG_MIN_LEVEL
+    #define PLUGIN_LOG_MIN_LEVEL 1
+#endif
+
+#if defined(__GNUC__)
+    #define PLUGIN_LOG_PRINTF_FORMAT(formatIndex, firstArgIndex) \
+        __attribute__((format(printf, formatIndex, firstArgIndex)))
+#else
+    #define PLUGIN_LOG_PRINTF_FORMAT(formatIndex, firstArgIndex)
+#endif
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+enum class LogLevel: int
+{
+    debug = 0,
+    info = 1,
+    warning = 2,
+    error = 3,
+};
+
+constexpr LogLevel kMinLogLevel = (LogLevel) PLUGIN_LOG_MIN_LEVEL;
+
+/**
+ * Rate limit of one log call site, shared by all threads and all cameras going through it.
+ * GCRA (the token bucket written as a single "theoretical arrival time"), so that it is one
+ * atomic compare-and-swap when the message passes and one load when it does not.
+ */
+class LogRateLimiter
+{
+public:
+    /** @param messagesPerSecond 0 means unlimited. */
+    explicit LogRateLimiter(double messagesPerSecond, int burst = 1);
+
+    /**
+     * @return -1 if the message must be dropped, otherwise the number of messages dropped since
+     *     the previous one that passed.
+     */
+    int tryAcquire();
+
+private:
+    const int64_t m_intervalNs;
+    const int64_t m_burstToleranceNs;
+    std::atomic<int64_t> m_theoreticalArrivalNs{0};
+    std::atomic<int> m_suppressedCount{0};
+};
+
+/**
+ * Process-wide asynchronous log. A message is formatted on the calling thread into a fixed-size
+ * slot of that thread's own single-producer ring: no lock, no allocation and no syscall on the
+ * caller's side. A background thread collects all the rings a few times per second and writes
+ * them to stderr in one go. When a ring is full, the message is dropped and counted; the writer
+ * reports the count.
+ *
+ * The writer thread runs between start() and stop(), called by the owner of the threads that
+ * log (the Engine, the service's main()); while it does not run, messages are written to stderr
+ * synchronously. The instance is never destroyed: joining the writer from a static destructor
+ * would run under the loader lock when the plugin library is unloaded on Windows, and threads
+ * still logging at exit would use a destroyed object.
+ */
+class Logger
+{
+public:
+    static Logger& instance();
+
+    /** Starts the writer thread. Calls nest: only the last matching stop() stops it. */
+    void start();
+
+    /** Writes what is left in the rings, then stops the writer thread. */
+    void stop();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /** @param suppressedCount Dropped by the rate limit since the previous message of the site. */
+    void write(LogLevel level, const char* file, int line, int suppressedCount,
+        const char* format, ...) PLUGIN_LOG_PRINTF_FORMAT(6, 7);
+
+public:
+    struct Ring;
+
+private:
+    Logger();
+
+    Ring* threadRing();
+    void run();
+    void drain();
+
+    void writeDirectly(Ring* ring, LogLevel level, const char* file, int line,
+        int suppressedCount, const char* format, va_list args);
+
+private:
+    std::mutex m_ringsMutex;
+    std::vector<std::shared_ptr<Ring>> m_rings;
+    int m_nextThreadIndex = 1;
+
+    std::mutex m_startMutex; //< Serializes start() and stop().
+    int m_startCount = 0;
+    std::atomic<bool> m_isWriterRunning{false};
+    std::atomic<int> m_inFlightWriteCount{0}; //< write() calls that may still push to a ring.
+
+    std::mutex m_wakeUpMutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
+
+/**
+ * PLUGIN_LOG(warning, 1, "/infer failed: %s", error) - printf-style message at the given level,
+ * at most the given number of times per second from this line (0 - no limit).
+ */
+#define PLUGIN_LOG(LEVEL, MESSAGES_PER_SECOND, ...) \
+    do \
+    { \
+        namespace plugin_log_ns_ = ::sample_company::vms_server_plugins::opencv_object_detection; \
+        if constexpr (plugin_log_ns_::LogLevel::LEVEL >= plugin_log_ns_::kMinLogLevel) \
+        { \
+            static plugin_log_ns_::LogRateLimiter pluginLogRateLimiter_(MESSAGES_PER_SECOND); \
+            const int pluginLogSuppressedCount_ = pluginLogRateLimiter_.tryAcquire(); \
+            if (pluginLogSuppressedCount_ >= 0) \
+            { \
+                plugin_log_ns_::Logger::instance().write(plugin_log_ns_::LogLevel::LEVEL, \
+                    __FILE__, __LINE__, pluginLogSuppressedCount_, __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
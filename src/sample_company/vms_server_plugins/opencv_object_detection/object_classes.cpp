@@ -0,0 +1,43 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "object_classes.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+int classIdFromLabel(std::string_view label)
+{
+    // Persons are by far the most frequent label, so check them before scanning the table.
+    if (label == objectClass(kPersonClassId).label)
+        return kPersonClassId;
+
+    for (const ObjectClass& objectClass: kObjectClasses)
+    {
+        if (objectClass.label == label)
+            return objectClass.id;
+    }
+    return kUnknownClassId;
+}
+
+std::string supportedTypesManifestJson()
+{
+    std::string result = "[";
+    for (const int classId: kReportedClassIds)
+    {
+        if (result.size() > 1)
+            result += ",";
+        result += R"json(
+        {
+            "objectTypeId": ")json";
+        result += objectClass(classId).objectTypeId;
+        result += R"json("
+        })json";
+    }
+    result += "\n    ]";
+    return result;
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
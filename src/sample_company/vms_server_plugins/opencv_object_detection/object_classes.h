@@ -0,0 +1,130 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Entry of the class registry. The id is the class index in the output of the YOLO model (COCO
+ * order), so dispatching on a detection is an array index.
+ */
+struct ObjectClass
+{
+    constexpr ObjectClass(
+        int id,
+        std::string_view label,
+        std::string_view objectTypeId = {},
+        std::string_view pluralCaption = {})
+        :
+        id(id), label(label), objectTypeId(objectTypeId), pluralCaption(pluralCaption)
+    {
+    }
+
+    int id;
+    std::string_view label; //< Label used by the inference service ("cls").
+
+    /** Nx object type the class is reported as; empty for classes the plugin ignores. */
+    std::string_view objectTypeId;
+
+    /** Caption of prolonged detection events, e.g. "People detection STARTED". */
+    std::string_view pluralCaption;
+
+    constexpr bool isReported() const { return !objectTypeId.empty(); }
+};
+
+constexpr std::array<ObjectClass, 80> kObjectClasses{{
+    {0, "person", "nx.base.Person", "People"},
+    {1, "bicycle"}, {2, "car"}, {3, "motorcycle"}, {4, "airplane"}, {5, "bus"}, {6, "train"},
+    {7, "truck"}, {8, "boat"}, {9, "traffic light"}, {10, "fire hydrant"}, {11, "stop sign"},
+    {12, "parking meter"}, {13, "bench"}, {14, "bird"},
+    {15, "cat", "nx.base.Cat", "Cats"},
+    {16, "dog", "nx.base.Dog", "Dogs"},
+    {17, "horse"}, {18, "sheep"}, {19, "cow"}, {20, "elephant"}, {21, "bear"}, {22, "zebra"},
+    {23, "giraffe"}, {24, "backpack"}, {25, "umbrella"}, {26, "handbag"}, {27, "tie"},
+    {28, "suitcase"}, {29, "frisbee"}, {30, "skis"}, {31, "snowboard"}, {32, "sports ball"},
+    {33, "kite"}, {34, "baseball bat"}, {35, "baseball glove"}, {36, "skateboard"},
+    {37, "surfboard"}, {38, "tennis racket"}, {39, "bottle"}, {40, "wine glass"}, {41, "cup"},
+    {42, "fork"}, {43, "knife"}, {44, "spoon"}, {45, "bowl"}, {46, "banana"}, {47, "apple"},
+    {48, "sandwich"}, {49, "orange"}, {50, "broccoli"}, {51, "carrot"}, {52, "hot dog"},
+    {53, "pizza"}, {54, "donut"}, {55, "cake"}, {56, "chair"}, {57, "couch"},
+    {58, "potted plant"}, {59, "bed"}, {60, "dining table"}, {61, "toilet"}, {62, "tv"},
+    {63, "laptop"}, {64, "mouse"}, {65, "remote"}, {66, "keyboard"}, {67, "cell phone"},
+    {68, "microwave"}, {69, "oven"}, {70, "toaster"}, {71, "sink"}, {72, "refrigerator"},
+    {73, "book"}, {74, "clock"}, {75, "vase"}, {76, "scissors"}, {77, "teddy bear"},
+    {78, "hair drier"}, {79, "toothbrush"},
+}};
+
+constexpr int kObjectClassCount = (int) kObjectClasses.size();
+constexpr int kUnknownClassId = -1;
+
+constexpr int kPersonClassId = 0;
+constexpr int kCatClassId = 15;
+constexpr int kDogClassId = 16;
+
+constexpr bool isValidClassId(int id) { return id >= 0 && id < kObjectClassCount; }
+
+constexpr const ObjectClass& objectClass(int id) { return kObjectClasses[(size_t) id]; }
+
+namespace detail {
+
+constexpr bool classIdsMatchIndices()
+{
+    for (int i = 0; i < kObjectClassCount; ++i)
+    {
+        if (kObjectClasses[(size_t) i].id != i)
+            return false;
+    }
+    return true;
+}
+
+constexpr size_t reportedClassCount()
+{
+    size_t result = 0;
+    for (const ObjectClass& objectClass: kObjectClasses)
+        result += objectClass.isReported() ? 1 : 0;
+    return result;
+}
+
+template<size_t kCount>
+constexpr std::array<int, kCount> reportedClassIds()
+{
+    std::array<int, kCount> result{};
+    size_t i = 0;
+    for (const ObjectClass& objectClass: kObjectClasses)
+    {
+        if (objectClass.isReported())
+            result[i++] = objectClass.id;
+    }
+    return result;
+}
+
+} // namespace detail
+
+static_assert(detail::classIdsMatchIndices(), "Class ids must be equal to their indices.");
+static_assert(objectClass(kPersonClassId).label == "person");
+static_assert(objectClass(kCatClassId).label == "cat");
+static_assert(objectClass(kDogClassId).label == "dog");
+
+/** Classes the plugin reports to the Server, in id order. */
+constexpr auto kReportedClassIds =
+    detail::reportedClassIds<detail::reportedClassCount()>();
+
+/**
+ * Resolves a label received from the inference service.
+ * @return kUnknownClassId if the label is not in the registry.
+ */
+int classIdFromLabel(std::string_view label);
+
+/** JSON array for the "supportedTypes" field of the DeviceAgent manifest. */
+std::string supportedTypesManifestJson();
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -1,6 +1,8 @@
 #include "object_detector.h"
 #include "exceptions.h"
 #include "frame.h"
+#include "frame_encoder.h"
+#include "logger.h"
 
 #ifdef _MSC_VER
 #pragma warning(push, 0)
@@ -17,7 +19,7 @@
 #endif
 
 #include "json.hpp"
-#include <unordered_map>
+#include <algorithm>
 #include <mutex>
 
 namespace sample_company {
@@ -89,262 +91,78 @@ namespace sample_company {
                     return out;
                 }
 
-                std::string matToBase64Jpeg(const cv::Mat& frame)
+                // Pose keypoints từ service: mảng 17 phần tử [x, y, conf] (pixel).
+                // Trả về nullptr nếu không đúng định dạng COCO.
+                std::shared_ptr<const PoseKeypoints> parseKeypoints(
+                    const json& j, int frameW, int frameH)
                 {
-                    cv::Mat bgr;
+                    if (!j.is_array() || j.size() != kPoseKeypointCount)
+                        return nullptr;
 
-                    if (frame.empty())
-                        throw ObjectDetectionError("Empty frame Mat");
-
-                    if (frame.type() == CV_8UC3)
-                    {
-                        bgr = frame;
-                    }
-                    else if (frame.type() == CV_8UC4)
+                    auto keypoints = std::make_shared<PoseKeypoints>();
+                    for (size_t i = 0; i < kPoseKeypointCount; ++i)
                     {
-                        cv::cvtColor(frame, bgr, cv::COLOR_BGRA2BGR);
+                        const json& point = j[i];
+                        if (!point.is_array() || point.size() < 2)
+                            return nullptr;
+
+                        Keypoint& keypoint = (*keypoints)[i];
+                        keypoint.x = point[0].get<float>() / static_cast<float>(frameW);
+                        keypoint.y = point[1].get<float>() / static_cast<float>(frameH);
+                        keypoint.confidence = point.size() > 2 ? point[2].get<float>() : 1.0f;
                     }
-                    else if (frame.type() == CV_8UC1)
-                    {
-                        cv::cvtColor(frame, bgr, cv::COLOR_GRAY2BGR);
-                    }
-                    else
-                    {
-                        throw ObjectDetectionError("Unsupported Mat type=" + std::to_string(frame.type()));
-                    }
-
-                    // Ensure Mat is contiguous in memory
-                    if (!bgr.isContinuous())
-                    {
-                        bgr = bgr.clone();
-                    }
-
-                    if (bgr.empty())
-                        throw ObjectDetectionError("bgr Mat is empty after processing");
-
-                    // Skip imencode entirely - just use raw BGR with minimal compression
-                    // This avoids issues with missing JPEG/PNG encoders
-                    const uint8_t* data = bgr.data;
-                    size_t dataSize = bgr.total() * bgr.elemSize();
-                    
-                    std::cerr << "[C++ encode] Using RAW_BGR: " << bgr.cols << "x" << bgr.rows 
-                              << " data=" << dataSize << " bytes" << std::endl;
-                    
-                    // Simple format: magic + width + height + raw BGR data
-                    std::vector<uchar> buf;
-                    
-                    // Add magic "BGR" header
-                    buf.push_back('B');
-                    buf.push_back('G');
-                    buf.push_back('R');
-                    
-                    // Add dimensions (4 bytes each, little-endian)
-                    uint32_t w = bgr.cols;
-                    uint32_t h = bgr.rows;
-                    buf.push_back((w >> 0) & 0xFF);
-                    buf.push_back((w >> 8) & 0xFF);
-                    buf.push_back((w >> 16) & 0xFF);
-                    buf.push_back((w >> 24) & 0xFF);
-                    buf.push_back((h >> 0) & 0xFF);
-                    buf.push_back((h >> 8) & 0xFF);
-                    buf.push_back((h >> 16) & 0xFF);
-                    buf.push_back((h >> 24) & 0xFF);
-                    
-                    // Add raw BGR data
-                    buf.insert(buf.end(), data, data + dataSize);
-                    
-                    std::cerr << "[C++ encode] Total buffer: " << buf.size() << " bytes (header=11)" << std::endl;
-                    
-                    if (buf.empty())
-                        throw ObjectDetectionError("Encoded buffer is empty");
-                    
-                    return base64Encode(buf.data(), buf.size());
+                    return keypoints;
                 }
 
-                static nx::sdk::Uuid uuidFromTrackId(int trackId)
+                // HTTP client cho endpoint; Unix socket dùng cùng protocol HTTP, host là path.
+                std::unique_ptr<httplib::Client> makeClient(const ServiceEndpoint& endpoint)
                 {
-                    static std::mutex m;
-                    static std::unordered_map<int, nx::sdk::Uuid> map;
-
-                    std::lock_guard<std::mutex> lk(m);
+                    if (!endpoint.isUnixSocket)
+                        return std::make_unique<httplib::Client>(endpoint.host, endpoint.port);
 
-                    auto it = map.find(trackId);
-                    if (it != map.end())
-                        return it->second;
-
-                    // tạo 1 UUID mới và cache lại cho trackId này
-                    nx::sdk::Uuid u = nx::sdk::UuidHelper::randomUuid();
-                    map.emplace(trackId, u);
-                    return u;
+                    auto client = std::make_unique<httplib::Client>(endpoint.host);
+                    client->set_address_family(AF_UNIX);
+                    return client;
                 }
 
-                // Gọi Python service, trả về DetectionList (danh sách Detection của plugin)
-                DetectionList callPythonService(const Frame& frame)
+                // Box pixel -> normalized, clamp vào frame. Trả về false nếu box rỗng.
+                bool normalizeBox(
+                    float x, float y, float w, float h, int frameW, int frameH,
+                    nx::sdk::analytics::Rect* outBox)
                 {
-                    DetectionList result;
-
-                    const Mat& image = frame.cvMat;
-                    if (image.empty())
-                        return result;
-
-                    static std::chrono::steady_clock::time_point lastCall = std::chrono::steady_clock::now();
-                    auto now = std::chrono::steady_clock::now();
-                    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastCall).count();
-
-                    // ví dụ: chỉ gọi tối đa 5 lần/giây
-                    if (ms < 200)
-                        return {};
-                    lastCall = now;
-
-                // Resize để giảm thời gian imencode/base64 và tăng FPS tổng
-                    cv::Mat sendImg = image;
-                    const int targetW = 640; // bạn có thể thử 416 nếu máy yếu
-                    if (image.cols > targetW)
-                    {
-                        float scale = (float)targetW / (float)image.cols;
-                        int newW = targetW;
-                        int newH = std::max(1, (int)std::round(image.rows * scale));
-                        cv::resize(image, sendImg, cv::Size(newW, newH));
-                    }
-
-                    const int imgW = sendImg.cols;
-                    const int imgH = sendImg.rows;
-                    
-                    std::cerr << "[C++ infer] Encoding sendImg " << imgW << "x" << imgH 
-                              << " type=" << sendImg.type() << " continuous=" << sendImg.isContinuous() << std::endl;
-                    
-                    std::string b64;
-                    try
-                    {
-                        std::cerr << "[C++ infer] Calling matToBase64Jpeg..." << std::endl;
-                        b64 = matToBase64Jpeg(sendImg);
-                        std::cerr << "[C++ infer] matToBase64Jpeg returned, b64 size=" << b64.size() << std::endl;
-                    }
-                    catch (const std::exception& e)
-                    {
-                        std::cerr << "[C++ infer] matToBase64Jpeg threw exception: " << e.what() << std::endl;
-                        throw ObjectDetectionError(std::string("Failed to encode image to base64: ") + e.what());
-                    }
-
-                    if (b64.empty())
-                    {
-                        std::cerr << "[C++ infer] ERROR: b64 is empty after encoding!" << std::endl;
-                        throw ObjectDetectionError("b64 empty after imencode - image may be invalid");
-                    }
-                    
-                    std::cerr << "[C++ infer] b64 size OK: " << b64.size() << " bytes" << std::endl;
-
-
-                    // 2. JSON request body
-                    json req;
-                    req["camera_id"] = "nx_camera";  // tạm thời, sau này map đúng ID camera nếu cần
-                    req["image"] = b64;
-
-                    // 3. HTTP client -> POST /infer
-                    // Reuse client để đỡ tạo kết nối liên tục mỗi frame
-                    thread_local httplib::Client cli("127.0.0.1", 18000);
-                    cli.set_keep_alive(true); // Keep connection alive để tái sử dụng
-
-                    // Tăng timeout để Python service có thời gian xử lý
-                    cli.set_connection_timeout(1, 500000); // 1.5s (1s + 500ms)
-                    cli.set_read_timeout(2, 500000);       // 2.5s (2s + 500ms)
-                    cli.set_write_timeout(1, 0);           // 1s
-
-
-                    static int s_reqCount = 0;
-                    if ((++s_reqCount % 20) == 0)
-                    {
-                        std::cerr << "[C++] calling /infer count=" << s_reqCount << std::endl;
-                    }
-
-                    auto res = cli.Post("/infer", req.dump(), "application/json");
-
-                    // ❗ res là pointer-like
-                    if (!res)
-                    {
-                        static int s_fail = 0;
-                        if ((++s_fail % 200) == 0)
-                        {
-                            std::cerr << "[C++] /infer failed (no response)" << std::endl;
-                            std::cerr << "[C++] Python service at 127.0.0.1:18000 may not be running." << std::endl;
-                        }
-                        return {};
-                    }
-
-                    if (res->status != 200)
-                    {
-                        static int s_bad = 0;
-                        if ((++s_bad % 200) == 0)
-                            std::cerr << "[C++] /infer status=" << res->status 
-                                     << " body=" << res->body.substr(0, 100) << std::endl;
-                        return {};
-                    }
-
-                    json j;
-                    try
-                    {
-                        j = json::parse(res->body);
-                    }
-                    catch (...)
-                    {
-                        return {};
-                    }
-
-                    if (!j.is_array())
-                        return {};
-
-                    // 5. Mỗi phần tử là 1 detection:
-                    //    { "cls": "person", "score": 0.9, "x": 180.0, "y": 270.6, "w": 120.0, "h": 360.8, "track_id": 1 }
-                    for (const auto& item : j)
-                    {
-                        const std::string classLabel = item.value("cls", "person");
-                        const float score = item.value("score", 0.0f);
-
-                        float x = item.value("x", 0.0f);
-                        float y = item.value("y", 0.0f);
-                        float w = item.value("w", 0.0f);
-                        float h = item.value("h", 0.0f);
-
-                        if (w <= 0.0f || h <= 0.0f)
-                            continue;
-
-                        // Chuyển từ toạ độ pixel sang normalized [0..1]
-                        float xNorm = x / static_cast<float>(imgW);
-                        float yNorm = y / static_cast<float>(imgH);
-                        float wNorm = w / static_cast<float>(imgW);
-                        float hNorm = h / static_cast<float>(imgH);
-
-                        // Clamp lại cho chắc
-                        if (xNorm < 0.0f) xNorm = 0.0f;
-                        if (yNorm < 0.0f) yNorm = 0.0f;
-                        if (xNorm + wNorm > 1.0f) wNorm = 1.0f - xNorm;
-                        if (yNorm + hNorm > 1.0f) hNorm = 1.0f - yNorm;
-
-                        if (wNorm <= 0.0f || hNorm <= 0.0f)
-                            continue;
-
-                        // 🔹 Lấy track_id từ JSON -> UUID ổn định
-                        const int trackId = item.value("track_id", 0);
-                        nx::sdk::Uuid trackUuid = uuidFromTrackId(trackId);
-
-                        auto detection = std::make_shared<Detection>(Detection{
-                            nx::sdk::analytics::Rect(xNorm, yNorm, wNorm, hNorm),
-                            classLabel,
-                            score,
-                            trackUuid
-                            });
-
-                        result.push_back(detection);
-                    }
+                    if (w <= 0.0f || h <= 0.0f)
+                        return false;
+
+                    float xNorm = std::max(0.0f, x / static_cast<float>(frameW));
+                    float yNorm = std::max(0.0f, y / static_cast<float>(frameH));
+                    float wNorm = w / static_cast<float>(frameW);
+                    float hNorm = h / static_cast<float>(frameH);
+                    if (xNorm + wNorm > 1.0f) wNorm = 1.0f - xNorm;
+                    if (yNorm + hNorm > 1.0f) hNorm = 1.0f - yNorm;
+                    if (wNorm <= 0.0f || hNorm <= 0.0f)
+                        return false;
+
+                    *outBox = nx::sdk::analytics::Rect(xNorm, yNorm, wNorm, hNorm);
+                    return true;
+                }
 
-                    static int s_log = 0;
-                    if ((++s_log % 100) == 0)
+                // Class của detection: ưu tiên "cls_id" (index COCO), fallback sang nhãn "cls".
+                // Trả về kUnknownClassId nếu class không có trong registry.
+                int parseClassId(const json& item)
+                {
+                    const auto classIdIt = item.find("cls_id");
+                    if (classIdIt != item.end() && classIdIt->is_number_integer())
                     {
-                        std::cerr << "[C++] detections=" << result.size()
-                            << " img=" << imgW << "x" << imgH << std::endl;
+                        const int classId = classIdIt->get<int>();
+                        return isValidClassId(classId) ? classId : kUnknownClassId;
                     }
 
-                    return result;
+                    const auto labelIt = item.find("cls");
+                    if (labelIt == item.end())
+                        return kPersonClassId;
+                    if (!labelIt->is_string())
+                        return kUnknownClassId;
+                    return classIdFromLabel(labelIt->get_ref<const std::string&>());
                 }
 
             } // namespace (anonymous)
@@ -352,9 +170,25 @@ namespace sample_company {
             //-------------------------------------------------------------------------------------------------
             // ObjectDetector implementation
 
-            ObjectDetector::ObjectDetector(std::filesystem::path modelPath) :
-                m_modelPath(std::move(modelPath))
+            ObjectDetector::ObjectDetector(
+                std::filesystem::path modelPath,
+                std::shared_ptr<InferenceRouter> inferenceRouter)
+                :
+                m_modelPath(std::move(modelPath)),
+                m_inferenceRouter(inferenceRouter
+                    ? std::move(inferenceRouter)
+                    : std::make_shared<InferenceRouter>())
+            {
+            }
+
+            ObjectDetector::~ObjectDetector() = default;
+
+            void ObjectDetector::setRequestTimeouts(
+                std::chrono::milliseconds connectTimeout,
+                std::chrono::milliseconds readTimeout)
             {
+                m_connectTimeoutMs = connectTimeout.count();
+                m_readTimeoutMs = readTimeout.count();
             }
 
             void ObjectDetector::ensureInitialized()
@@ -371,61 +205,161 @@ namespace sample_company {
 
             bool ObjectDetector::isTerminated() const
             {
-                return m_terminated;
+                return m_terminated.load();
             }
 
             void ObjectDetector::terminate()
             {
                 m_terminated = true;
+
+                // Abort request đang chờ response thay vì đợi hết read timeout.
+                {
+                    const std::lock_guard<std::mutex> lock(m_clientsMutex);
+                    for (const EndpointClients& clients: m_clients)
+                    {
+                        clients.inferClient->stop();
+                        clients.healthClient->stop();
+                    }
+                    if (m_sharedFrameClient)
+                        m_sharedFrameClient->stop();
+                }
             }
 
-            DetectionList ObjectDetector::run(const Frame& frame)
+            // ============================================================
+            // FLOW 2: New method - run inference on JPEG bytes
+            // ============================================================
+            DetectionList ObjectDetector::run(
+                const std::string& cameraId,
+                const std::vector<uint8_t>& jpegBytes,
+                PipelineStats* stats)
             {
                 if (isTerminated())
-                    return {};
+                {
+                    throw ObjectDetectorIsTerminatedError(
+                        "Object detector is terminated; /infer is not called.");
+                }
 
-                try
+                // Fast-fail: không tốn connection timeout cho mỗi frame khi service đang down.
+                if (!m_circuitBreaker.allowsRequests())
                 {
-                    return runImpl(frame);
+                    throw ObjectDetectorUnavailableError(
+                        "AI service is unavailable; waiting for /health to recover");
                 }
-                catch (const ObjectDetectionError&)
+
+                if (jpegBytes.empty())
+                    throw ObjectDetectionError("JPEG bytes are empty");
+
+                // Endpoint ít tải nhất (hoặc endpoint giữ track của camera); in-flight tới release().
+                const InferenceRouter::Route route =
+                    m_inferenceRouter->acquire(cameraId, InferenceRouter::Clock::now());
+
+                try
                 {
-                    // ĐỂ CHO device_agent.cpp bắt và push event
-                    throw;
+                    std::chrono::steady_clock::duration roundTripTime{};
+                    DetectionList result = callPythonServiceMultipart(
+                        cameraId, jpegBytes, route.endpoint, stats, &roundTripTime);
+                    m_inferenceRouter->release(route, RequestOutcome::success,
+                        InferenceRouter::Clock::now(), roundTripTime);
+                    m_circuitBreaker.recordSuccess();
+                    return result;
                 }
-                catch (const cv::Exception& e)
+                catch (const ObjectDetectionError&)
                 {
-                    throw ObjectDetectionError(std::string("OpenCV error: ") + e.what());
+                    // Request bị terminate() abort: không phải lỗi của service.
+                    if (isTerminated())
+                    {
+                        m_inferenceRouter->release(
+                            route, RequestOutcome::cancelled, InferenceRouter::Clock::now());
+                        throw ObjectDetectorIsTerminatedError("/infer was cancelled.");
+                    }
+                    m_inferenceRouter->release(
+                        route, RequestOutcome::failure, InferenceRouter::Clock::now());
+                    m_circuitBreaker.recordFailure(CircuitBreaker::Clock::now());
+                    throw;  // Re-throw detection errors
                 }
                 catch (const std::exception& e)
                 {
-                    throw ObjectDetectionError(std::string("Std error: ") + e.what());
+                    m_inferenceRouter->release(
+                        route, RequestOutcome::failure, InferenceRouter::Clock::now());
+                    m_circuitBreaker.recordFailure(CircuitBreaker::Clock::now());
+                    throw ObjectDetectionError(std::string("Error in run(cameraId, jpegBytes): ") + e.what());
                 }
             }
-            
-            // ============================================================
-            // FLOW 2: New method - run inference on JPEG bytes
-            // ============================================================
-            DetectionList ObjectDetector::run(const std::string& cameraId, const std::vector<uint8_t>& jpegBytes)
+
+            DetectionList ObjectDetector::run(
+                const std::string& cameraId,
+                const cv::Mat& image,
+                int jpegQuality,
+                PipelineStats* stats)
             {
                 if (isTerminated())
-                    return {};
+                {
+                    throw ObjectDetectorIsTerminatedError(
+                        "Object detector is terminated; /infer is not called.");
+                }
 
-                try
+                if (!m_circuitBreaker.allowsRequests())
                 {
-                    if (jpegBytes.empty())
-                        throw ObjectDetectionError("JPEG bytes are empty");
-                    
-                    return callPythonServiceMultipart(cameraId, jpegBytes);
+                    throw ObjectDetectorUnavailableError(
+                        "AI service is unavailable; waiting for /health to recover");
                 }
-                catch (const ObjectDetectionError&)
+
+                if (image.empty())
+                    throw ObjectDetectionError("Image is empty");
+
+                // Service native cùng host: pixel ghi thẳng vào shared memory, không JPEG/base64.
+                // Socket shared memory không qua router: chỉ dùng khi endpoint duy nhất mà user
+                // cấu hình ở cùng host, để frame không tới service khác.
+                ServiceEndpoint sharedFrameEndpoint;
+                const std::string sharedFrameSocketPath =
+                    m_inferenceRouter->sharedFrameSocketPath(&sharedFrameEndpoint);
+                if (!sharedFrameSocketPath.empty()
+                    && SharedFrameClient::canTransfer(image)
+                    && sharedFrameClientFor(sharedFrameSocketPath).ensureConnected(cameraId))
                 {
-                    throw;  // Re-throw detection errors
+                    try
+                    {
+                        DetectionList result = callServiceSharedFrame(
+                            cameraId, image, sharedFrameEndpoint, stats);
+                        m_circuitBreaker.recordSuccess();
+                        return result;
+                    }
+                    catch (const std::exception& e)
+                    {
+                        if (isTerminated())
+                            throw ObjectDetectorIsTerminatedError("/infer was cancelled.");
+                        m_circuitBreaker.recordFailure(CircuitBreaker::Clock::now());
+                        throw ObjectDetectionError(
+                            std::string("Shared frame transport: ") + e.what());
+                    }
                 }
-                catch (const std::exception& e)
+
+                const std::vector<uint8_t> jpegBytes = encodeJpeg(image, jpegQuality, stats);
+                if (stats)
+                    stats->count(FrameCounter::encoded);
+                return run(cameraId, jpegBytes, stats);
+            }
+
+            bool ObjectDetector::probeServiceHealthIfDue(const std::string& cameraId)
+            {
+                const auto now = CircuitBreaker::Clock::now();
+                if (isTerminated() || !m_circuitBreaker.isProbeDue(now))
+                    return false;
+
+                const InferenceRouter::Route route = m_inferenceRouter->acquire(cameraId, now);
+                const auto res = clientsFor(route.endpoint).healthClient->Get("/health");
+                if (isTerminated())
                 {
-                    throw ObjectDetectionError(std::string("Error in run(cameraId, jpegBytes): ") + e.what());
+                    // Probe aborted by terminate(): says nothing about the service
+                    m_inferenceRouter->release(
+                        route, RequestOutcome::cancelled, InferenceRouter::Clock::now());
+                    return false;
                 }
+                const bool isHealthy = res && res->status == 200;
+                m_inferenceRouter->release(route,
+                    isHealthy ? RequestOutcome::success : RequestOutcome::failure,
+                    InferenceRouter::Clock::now());
+                return m_circuitBreaker.recordProbeResult(isHealthy, CircuitBreaker::Clock::now());
             }
             
             // ============================================================
@@ -434,12 +368,17 @@ namespace sample_company {
             // ============================================================
             DetectionList ObjectDetector::callPythonServiceMultipart(
                 const std::string& cameraId, 
-                const std::vector<uint8_t>& jpegBytes)
+                const std::vector<uint8_t>& jpegBytes,
+                const ServiceEndpoint& endpoint,
+                PipelineStats* stats,
+                std::chrono::steady_clock::duration* roundTripTime)
             {
                 DetectionList result;
                 
                 try
                 {
+                    const auto requestStart = PipelineStats::Clock::now();
+
                     // Base64 encode JPEG for JSON request
                     std::string b64 = base64Encode(jpegBytes.data(), jpegBytes.size());
                     
@@ -453,47 +392,37 @@ namespace sample_company {
                     
                     std::string jsonBody = req.dump();
                     
-                    // HTTP client (thread-local, reused)
-                    thread_local httplib::Client cli("127.0.0.1", 18000);
-                    cli.set_keep_alive(true);
+                    // HTTP client (per camera, reused). Timeouts may change between requests
+                    // (settings), and are applied here, on the only thread using the client.
+                    httplib::Client& cli = *clientsFor(endpoint).inferClient;
+                    cli.set_connection_timeout(std::chrono::milliseconds(m_connectTimeoutMs.load()));
+                    cli.set_read_timeout(std::chrono::milliseconds(m_readTimeoutMs.load()));
                     
-                    // ⚠️ SHORT TIMEOUT FOR MVP: fail-fast if AI service is slow
-                    // 1.5 seconds total (fail-fast instead of blocking Nx)
-                    cli.set_connection_timeout(0, 500000);  // 500ms
-                    cli.set_read_timeout(1, 0);             // 1s
-                    cli.set_write_timeout(0, 500000);       // 500ms
-                    
-                    static int s_reqCount = 0;
-                    if ((++s_reqCount % 20) == 0)
-                    {
-                        std::cerr << "[FLOW2 C++] Calling /infer with JPEG, count=" << s_reqCount 
-                                  << " jpegSize=" << jpegBytes.size() << " bytes" << std::endl;
-                    }
+                    PLUGIN_LOG(debug, 1, "Calling /infer with JPEG, jpegSize=%zu bytes",
+                        jpegBytes.size());
                     
                     // POST /infer endpoint
                     auto res = cli.Post("/infer", jsonBody, "application/json");
                     
                     if (!res)
                     {
-                        static int s_fail = 0;
-                        if ((++s_fail % 200) == 0)
-                        {
-                            std::cerr << "[FLOW2 C++] /infer failed (no response)" << std::endl;
-                            std::cerr << "[FLOW2 C++] Python service at 127.0.0.1:18000 may not be running." << std::endl;
-                        }
+                        PLUGIN_LOG(warning, 0.1,
+                            "/infer failed (%s); is the inference service running at %s?",
+                            httplib::to_string(res.error()).c_str(), endpoint.toString().c_str());
                         throw ObjectDetectionError("No response from /infer endpoint");
                     }
                     
                     if (res->status != 200)
                     {
-                        static int s_bad = 0;
-                        if ((++s_bad % 200) == 0)
-                        {
-                            std::cerr << "[FLOW2 C++] /infer status=" << res->status 
-                                     << " body=" << res->body.substr(0, 100) << std::endl;
-                        }
+                        PLUGIN_LOG(warning, 0.1, "/infer status=%d body=%.100s",
+                            res->status, res->body.c_str());
                         throw ObjectDetectionError("HTTP error " + std::to_string(res->status));
                     }
+
+                    const auto parseStart = stats
+                        ? stats->record(PipelineStage::httpRoundTrip, requestStart)
+                        : PipelineStats::Clock::now();
+                    *roundTripTime = parseStart - requestStart;
                     
                     // Parse JSON response
                     json j;
@@ -516,13 +445,18 @@ namespace sample_company {
                         throw ObjectDetectionError("Failed to decode JPEG bytes to determine frame dimensions");
                     const int frameW = decodedJpeg.cols;
                     const int frameH = decodedJpeg.rows;
+
+                    removeStaleTrackUuids(std::chrono::steady_clock::now());
+                    const std::string endpointKey = endpoint.toString();
                     
                     // Parse each detection
                     for (const auto& item : j)
                     {
                         try
                         {
-                            const std::string classLabel = item.value("cls", "person");
+                            const int classId = parseClassId(item);
+                            if (classId == kUnknownClassId)
+                                continue;
                             const float score = item.value("score", 0.0f);
                             
                             float x = item.value("x", 0.0f);
@@ -532,51 +466,44 @@ namespace sample_company {
                             
                             const bool fallDetected = item.value("fall_detected", false);  // FLOW 2
                             
-                            if (w <= 0.0f || h <= 0.0f)
-                                continue;
-                            
-                            // Normalize coordinates
-                            float xNorm = x / static_cast<float>(frameW);
-                            float yNorm = y / static_cast<float>(frameH);
-                            float wNorm = w / static_cast<float>(frameW);
-                            float hNorm = h / static_cast<float>(frameH);
-                            
-                            // Clamp
-                            if (xNorm < 0.0f) xNorm = 0.0f;
-                            if (yNorm < 0.0f) yNorm = 0.0f;
-                            if (xNorm + wNorm > 1.0f) wNorm = 1.0f - xNorm;
-                            if (yNorm + hNorm > 1.0f) hNorm = 1.0f - yNorm;
-                            
-                            if (wNorm <= 0.0f || hNorm <= 0.0f)
+                            // Normalize coordinates + clamp
+                            nx::sdk::analytics::Rect box;
+                            if (!normalizeBox(x, y, w, h, frameW, frameH, &box))
                                 continue;
                             
                             // Get track ID
-                            const int trackId = item.value("track_id", 0);
-                            nx::sdk::Uuid trackUuid = uuidFromTrackId(trackId);
+                            const nx::sdk::Uuid trackId = trackUuid(
+                                endpointKey, cameraId, item.value("track_id", 0));
+
+                            // Optional pose: "keypoints": [[x, y, conf], ...] in pixels
+                            std::shared_ptr<const PoseKeypoints> keypoints;
+                            const auto keypointsIt = item.find("keypoints");
+                            if (keypointsIt != item.end())
+                                keypoints = parseKeypoints(*keypointsIt, frameW, frameH);
                             
                             // FLOW 2: Include fall_detected flag
                             auto detection = std::make_shared<Detection>(Detection{
-                                nx::sdk::analytics::Rect(xNorm, yNorm, wNorm, hNorm),
-                                classLabel,
+                                box,
+                                classId,
                                 score,
-                                trackUuid,
-                                fallDetected  // FLOW 2
+                                trackId,
+                                fallDetected,  // FLOW 2
+                                std::move(keypoints)
                             });
                             
                             result.push_back(detection);
                         }
                         catch (const std::exception& e)
                         {
-                            std::cerr << "[FLOW2 C++] Error parsing detection item: " << e.what() << std::endl;
+                            PLUGIN_LOG(warning, 1, "Error parsing detection item: %s", e.what());
                             continue;  // Skip bad items
                         }
                     }
                     
-                    static int s_log = 0;
-                    if ((++s_log % 100) == 0)
-                    {
-                        std::cerr << "[FLOW2 C++] detections=" << result.size() << std::endl;
-                    }
+                    PLUGIN_LOG(debug, 1, "detections=%zu", result.size());
+
+                    if (stats)
+                        stats->record(PipelineStage::responseParse, parseStart);
                     
                     return result;
                 }
@@ -590,25 +517,161 @@ namespace sample_company {
                 }
             }
 
+            DetectionList ObjectDetector::callServiceSharedFrame(
+                const std::string& cameraId,
+                const cv::Mat& image,
+                const ServiceEndpoint& endpoint,
+                PipelineStats* stats)
+            {
+                const auto requestStart = PipelineStats::Clock::now();
+                const std::vector<SharedDetection> sharedDetections = m_sharedFrameClient->infer(
+                    image, std::chrono::milliseconds(m_readTimeoutMs.load()));
+                const auto convertStart = stats
+                    ? stats->record(PipelineStage::sharedFrameRoundTrip, requestStart)
+                    : PipelineStats::Clock::time_point();
+
+                removeStaleTrackUuids(std::chrono::steady_clock::now());
+                const std::string endpointKey = endpoint.toString();
+
+                const int frameW = image.cols;
+                const int frameH = image.rows;
+                DetectionList result;
+                for (const SharedDetection& item: sharedDetections)
+                {
+                    if (!isValidClassId(item.classId))
+                        continue;
+
+                    nx::sdk::analytics::Rect box;
+                    if (!normalizeBox(item.x, item.y, item.width, item.height, frameW, frameH, &box))
+                        continue;
+
+                    std::shared_ptr<PoseKeypoints> keypoints;
+                    if (item.hasKeypoints)
+                    {
+                        keypoints = std::make_shared<PoseKeypoints>();
+                        for (size_t i = 0; i < kPoseKeypointCount; ++i)
+                        {
+                            Keypoint& keypoint = (*keypoints)[i];
+                            keypoint.x = item.keypoints[i][0] / static_cast<float>(frameW);
+                            keypoint.y = item.keypoints[i][1] / static_cast<float>(frameH);
+                            keypoint.confidence = item.keypoints[i][2];
+                        }
+                    }
+
+                    result.push_back(std::make_shared<Detection>(Detection{
+                        box,
+                        item.classId,
+                        item.score,
+                        trackUuid(endpointKey, cameraId, item.trackId),
+                        item.isFallDetected != 0,
+                        std::move(keypoints)
+                    }));
+                }
+
+                PLUGIN_LOG(debug, 1, "detections=%zu (shared frame)", result.size());
+
+                if (stats)
+                    stats->record(PipelineStage::responseParse, convertStart);
+                return result;
+            }
+
             //-------------------------------------------------------------------------------------------------
             // private
 
+            SharedFrameClient& ObjectDetector::sharedFrameClientFor(const std::string& socketPath)
+            {
+                if (!m_sharedFrameClient || m_sharedFrameClient->socketPath() != socketPath)
+                {
+                    auto client = std::make_unique<SharedFrameClient>(socketPath);
+                    const std::lock_guard<std::mutex> lock(m_clientsMutex);
+                    if (isTerminated())
+                        client->stop();
+                    m_sharedFrameClient = std::move(client);
+                }
+                return *m_sharedFrameClient;
+            }
+
+            nx::sdk::Uuid ObjectDetector::trackUuid(
+                const std::string& endpoint, const std::string& cameraId, int trackId)
+            {
+                TrackUuid& track = m_trackUuids[std::make_tuple(endpoint, cameraId, trackId)];
+                if (track.uuid.isNull())
+                    track.uuid = nx::sdk::UuidHelper::randomUuid();
+                track.lastSeen = std::chrono::steady_clock::now();
+                return track.uuid;
+            }
+
+            void ObjectDetector::removeStaleTrackUuids(std::chrono::steady_clock::time_point now)
+            {
+                // Quét cả map tối đa mỗi giây một lần, không phải mỗi response.
+                if (now - m_lastTrackUuidCleanup < std::chrono::seconds(1))
+                    return;
+                m_lastTrackUuidCleanup = now;
+
+                for (auto it = m_trackUuids.begin(); it != m_trackUuids.end();)
+                {
+                    if (now - it->second.lastSeen > kTrackUuidTtl)
+                        it = m_trackUuids.erase(it);
+                    else
+                        ++it;
+                }
+            }
+
             // Hàm loadModel() cũ không còn dùng nữa, nhưng giữ lại cho đủ định nghĩa (nếu header còn khai báo).
             void ObjectDetector::loadModel()
             {
                 // KHÔNG còn dùng OpenCV DNN / ONNX nữa.
             }
 
-            DetectionList ObjectDetector::runImpl(const Frame& frame)
+            ObjectDetector::EndpointClients& ObjectDetector::clientsFor(
+                const ServiceEndpoint& endpoint)
             {
-                if (isTerminated())
+                const uint64_t revision = m_inferenceRouter->revision();
+                if (revision != m_clientsRevision)
                 {
-                    throw ObjectDetectorIsTerminatedError(
-                        "Object detection error: object detector is terminated.");
+                    m_clientsRevision = revision;
+                    const std::vector<ServiceEndpoint> endpoints = m_inferenceRouter->endpoints();
+
+                    const std::lock_guard<std::mutex> lock(m_clientsMutex);
+                    m_clients.erase(
+                        std::remove_if(m_clients.begin(), m_clients.end(),
+                            [&endpoints](const EndpointClients& clients)
+                            {
+                                return std::find(endpoints.begin(), endpoints.end(),
+                                    clients.endpoint) == endpoints.end();
+                            }),
+                        m_clients.end());
+                }
+
+                for (EndpointClients& clients: m_clients)
+                {
+                    if (clients.endpoint == endpoint)
+                        return clients;
                 }
 
-                // Thay toàn bộ logic ONNX cũ bằng gọi Python service:
-                return callPythonService(frame);
+                EndpointClients clients;
+                clients.endpoint = endpoint;
+
+                clients.inferClient = makeClient(endpoint);
+                clients.inferClient->set_keep_alive(true);
+                clients.inferClient->set_write_timeout(0, 500000);       // 500ms
+
+                // /health phải rẻ: timeout ngắn hơn /infer, không giữ kết nối giữa các probe.
+                clients.healthClient = makeClient(endpoint);
+                clients.healthClient->set_keep_alive(false);
+                clients.healthClient->set_connection_timeout(0, 200000);  // 200ms
+                clients.healthClient->set_read_timeout(0, 500000);        // 500ms
+
+                PLUGIN_LOG(info, 0, "Inference service endpoint: %s", endpoint.toString().c_str());
+
+                const std::lock_guard<std::mutex> lock(m_clientsMutex);
+                if (isTerminated())
+                {
+                    clients.inferClient->stop();
+                    clients.healthClient->stop();
+                }
+                m_clients.push_back(std::move(clients));
+                return m_clients.back();
             }
 
         } // namespace opencv_object_detection
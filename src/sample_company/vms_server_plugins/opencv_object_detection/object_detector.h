@@ -4,9 +4,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <opencv2/dnn.hpp>
@@ -14,8 +19,15 @@
 #include <nx/sdk/helpers/uuid_helper.h>
 #include <nx/sdk/uuid.h>
 
+#include "circuit_breaker.h"
 #include "detection.h"
 #include "frame.h"
+#include "pipeline_stats.h"
+#include "inference_router.h"
+#include "service_endpoint.h"
+#include "shared_frame_client.h"
+
+namespace httplib { class Client; }
 
 namespace sample_company {
 namespace vms_server_plugins {
@@ -25,39 +37,138 @@ class ObjectDetector
 {
 public:
     // modelPath: ĐƯỜNG DẪN ĐẦY ĐỦ tới file .onnx
-    explicit ObjectDetector(std::filesystem::path modelPath);
+    // inferenceRouter: chọn service (TCP hoặc Unix socket) cho từng request, chung cho mọi
+    // camera của Engine; null = chỉ 127.0.0.1:18000.
+    explicit ObjectDetector(
+        std::filesystem::path modelPath,
+        std::shared_ptr<InferenceRouter> inferenceRouter = nullptr);
+    ~ObjectDetector();
 
     void ensureInitialized();
     bool isTerminated() const;
+
+    // Thread-safe: có thể gọi từ thread khác trong lúc worker đang chờ /infer hoặc /health;
+    // request đang chạy bị abort (socket shutdown) và các lần run() sau ném
+    // ObjectDetectorIsTerminatedError.
     void terminate();
     
     // FLOW 2: Run inference on JPEG bytes via HTTP /infer endpoint
     // Signature: run(cameraId, jpegBytes) -> DetectionList
-    // Throws ObjectDetectionError on HTTP error / timeout / JSON parse error
-    DetectionList run(const std::string& cameraId, const std::vector<uint8_t>& jpegBytes);
+    // Throws ObjectDetectionError on HTTP error / timeout / JSON parse error,
+    // ObjectDetectorIsTerminatedError after terminate()
+    // stats (optional): nhận thời gian của stage httpRoundTrip và responseParse.
+    DetectionList run(
+        const std::string& cameraId,
+        const std::vector<uint8_t>& jpegBytes,
+        PipelineStats* stats = nullptr);
     
-    // Legacy: Run inference on Frame (still available)
-    DetectionList run(const Frame& frame);
+    // Gửi ảnh BGR (đã downscale) cho service: qua shared memory nếu router cho phép (một
+    // endpoint duy nhất, cùng host; xem InferenceRouter::sharedFrameSocketPath()) và service
+    // native nghe trên socket đó (xem shared_frame_ring.h), nếu không thì encode JPEG
+    // (jpegQuality) và gọi run(cameraId, jpegBytes). Cùng exception và circuit breaker với HTTP.
+    // stats (optional): nhận thêm stage jpegEncode / sharedFrameRoundTrip và counter encoded.
+    DetectionList run(
+        const std::string& cameraId,
+        const cv::Mat& image,
+        int jpegQuality,
+        PipelineStats* stats = nullptr);
+
+    // Circuit breaker của AI service: run(cameraId, jpegBytes) mở circuit sau vài lỗi liên tiếp
+    // và khi đó ném ObjectDetectorUnavailableError ngay, không gọi HTTP. Caller nên bỏ qua cả
+    // bước encode khi isServiceAvailable() == false.
+    bool isServiceAvailable() const { return m_circuitBreaker.allowsRequests(); }
+    const CircuitBreaker& circuitBreaker() const { return m_circuitBreaker; }
+
+    // Timeout của /infer; thread-safe, áp dụng từ request tiếp theo.
+    void setRequestTimeouts(
+        std::chrono::milliseconds connectTimeout,
+        std::chrono::milliseconds readTimeout);
+
+    // Gửi GET /health nếu circuit đang mở và đã tới lượt probe (backoff tăng dần), tới endpoint
+    // mà router chọn cho camera. Returns true nếu state của circuit đổi.
+    bool probeServiceHealthIfDue(const std::string& cameraId);
 
 private:
     void loadModel();
     
     // FLOW 2: Call Python AI service via HTTP multipart/form-data
+    // roundTripTime: thời gian từ lúc gửi tới lúc có response, cho EWMA latency của router.
     DetectionList callPythonServiceMultipart(
         const std::string& cameraId, 
-        const std::vector<uint8_t>& jpegBytes);
+        const std::vector<uint8_t>& jpegBytes,
+        const ServiceEndpoint& endpoint,
+        PipelineStats* stats,
+        std::chrono::steady_clock::duration* roundTripTime);
     
-    DetectionList runImpl(const Frame& frame);
+    DetectionList callServiceSharedFrame(
+        const std::string& cameraId,
+        const cv::Mat& image,
+        const ServiceEndpoint& endpoint,
+        PipelineStats* stats);
+
+    // Client của socket shared memory, tạo lại khi Engine settings đổi socket. Chỉ gọi trên
+    // worker thread.
+    SharedFrameClient& sharedFrameClientFor(const std::string& socketPath);
+
+    // Nx track Uuid ổn định cho track id của service. Service đánh số track riêng cho từng
+    // camera (và mỗi endpoint một bộ đếm), nên key gồm cả endpoint và camera. Chỉ gọi trên
+    // worker thread.
+    nx::sdk::Uuid trackUuid(const std::string& endpoint, const std::string& cameraId, int trackId);
+
+    // Bỏ Uuid của track không xuất hiện trong kTrackUuidTtl (service đã quên track đó).
+    void removeStaleTrackUuids(std::chrono::steady_clock::time_point now);
+
+    struct EndpointClients
+    {
+        ServiceEndpoint endpoint;
+        std::unique_ptr<httplib::Client> inferClient;
+        std::unique_ptr<httplib::Client> healthClient;
+    };
+
+    // HTTP client của endpoint, tạo khi cần; bỏ client của endpoint không còn trong Engine
+    // settings. Chỉ gọi trên worker thread.
+    EndpointClients& clientsFor(const ServiceEndpoint& endpoint);
 
 private:
     bool m_netLoaded = false;
-    bool m_terminated = false;
+    std::atomic<bool> m_terminated{false};
 
     // Full path tới file model, ví dụ:
     // C:\Program Files\...\plugins\yolov8_people_analytics_plugin\yolov8n.onnx
     const std::filesystem::path m_modelPath;
 
     std::unique_ptr<cv::dnn::Net> m_net;
+
+    CircuitBreaker m_circuitBreaker;
+
+    const std::shared_ptr<InferenceRouter> m_inferenceRouter;
+    uint64_t m_clientsRevision = 0; //< Revision của router khi m_clients được dọn lần cuối.
+
+    // HTTP client của camera này (mỗi endpoint một cặp), dùng bởi một worker task tại một thời điểm (không còn
+    // thread_local vì task chạy trên thread bất kỳ của executor); terminate() gọi stop() từ
+    // thread khác. Worker chỉ thêm/bỏ client khi giữ m_clientsMutex.
+    std::mutex m_clientsMutex;
+    std::vector<EndpointClients> m_clients;
+
+    // Transport của service native cùng host; không kết nối thì dùng HTTP. Tạo khi cần; worker
+    // chỉ thay nó khi giữ m_clientsMutex.
+    std::unique_ptr<SharedFrameClient> m_sharedFrameClient;
+
+    struct TrackUuid
+    {
+        nx::sdk::Uuid uuid;
+        std::chrono::steady_clock::time_point lastSeen;
+    };
+
+    static constexpr std::chrono::seconds kTrackUuidTtl{30};
+
+    // Key: endpoint, camera id, track id của service.
+    std::map<std::tuple<std::string, std::string, int>, TrackUuid> m_trackUuids;
+    std::chrono::steady_clock::time_point m_lastTrackUuidCleanup{};
+
+    // ⚠️ SHORT TIMEOUT FOR MVP: fail-fast if AI service is slow (per-camera setting).
+    std::atomic<int64_t> m_connectTimeoutMs{500};
+    std::atomic<int64_t> m_readTimeoutMs{1000};
 };
 
 } // namespace opencv_object_detection
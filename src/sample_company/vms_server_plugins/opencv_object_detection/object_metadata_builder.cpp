@@ -0,0 +1,188 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "object_metadata_builder.h"
+
+#include <nx/sdk/helpers/uuid_helper.h>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+using namespace nx::sdk;
+using namespace nx::sdk::analytics;
+
+namespace {
+
+const std::string kPersonIdAttributeName = "yolov8_person_id";
+const char* const kPersonCountFrameAttributeName = "yolov8_person_count_frame";
+const char* const kPersonCountUniqueAttributeName = "yolov8_person_count_unique";
+
+} // namespace
+
+Ptr<ObjectMetadataPacket> ObjectMetadataBuilder::build(
+    const DetectionList& detections,
+    int64_t timestampUs)
+{
+    if (detections.empty())
+        return nullptr;
+
+    m_currentPersonCount = 0;
+    for (const std::shared_ptr<Detection>& detection: detections)
+    {
+        if (detection->classId == kPersonClassId)
+        {
+            ++m_currentPersonCount;
+            m_seenPersonIds.insert(detection->trackId);
+        }
+    }
+
+    const Ptr<Attribute>& countFrameAttribute = countAttribute(
+        kPersonCountFrameAttributeName,
+        m_currentPersonCount,
+        &m_countFrameAttributeValue,
+        &m_countFrameAttribute);
+    const Ptr<Attribute>& countUniqueAttribute = countAttribute(
+        kPersonCountUniqueAttributeName,
+        uniquePersonCount(),
+        &m_countUniqueAttributeValue,
+        &m_countUniqueAttribute);
+
+    const auto objectMetadataPacket = makePtr<ObjectMetadataPacket>();
+    for (const std::shared_ptr<Detection>& detection: detections)
+    {
+        TrackCache& track = trackCache(*detection, timestampUs);
+
+        const bool isPerson = detection->classId == kPersonClassId;
+        const bool sendId = isPerson && !track.idSent;
+        const bool sendCountFrame =
+            isPerson && track.sentPersonCountFrame != m_currentPersonCount;
+        const bool sendCountUnique =
+            isPerson && track.sentPersonCountUnique != uniquePersonCount();
+
+        const Ptr<ObjectMetadata> objectMetadata =
+            acquireMetadata(detection->trackId, &track, sendId || sendCountFrame || sendCountUnique);
+
+        objectMetadata->setBoundingBox(detection->boundingBox);
+        objectMetadata->setConfidence(detection->confidence);
+
+        if (sendId)
+        {
+            objectMetadata->addAttribute(track.idAttribute);
+            track.idSent = true;
+        }
+        if (sendCountFrame)
+        {
+            objectMetadata->addAttribute(countFrameAttribute);
+            track.sentPersonCountFrame = m_currentPersonCount;
+        }
+        if (sendCountUnique)
+        {
+            objectMetadata->addAttribute(countUniqueAttribute);
+            track.sentPersonCountUnique = uniquePersonCount();
+        }
+
+        objectMetadataPacket->addItem(objectMetadata.get());
+    }
+
+    objectMetadataPacket->setTimestampUs(timestampUs);
+
+    removeStaleTracks(timestampUs);
+    return objectMetadataPacket;
+}
+
+void ObjectMetadataBuilder::reset()
+{
+    m_tracks.clear();
+    m_seenPersonIds.clear();
+    m_currentPersonCount = 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+ObjectMetadataBuilder::TrackCache& ObjectMetadataBuilder::trackCache(
+    const Detection& detection,
+    int64_t timestampUs)
+{
+    TrackCache& track = m_tracks[detection.trackId];
+    track.lastSeenUs = timestampUs;
+
+    if (!track.idAttribute)
+    {
+        track.idAttribute = makePtr<Attribute>(
+            IAttribute::Type::string,
+            kPersonIdAttributeName,
+            UuidHelper::toStdString(detection.trackId));
+    }
+
+    // The class of a track may change between frames; the cached metadata is dropped only then.
+    if (detection.classId != track.classId)
+    {
+        track.classId = detection.classId;
+        track.plainMetadata.reset();
+    }
+
+    return track;
+}
+
+Ptr<ObjectMetadata> ObjectMetadataBuilder::acquireMetadata(
+    const Uuid& trackId,
+    TrackCache* track,
+    bool withAttributes)
+{
+    // An instance still referenced by a packet the Server has not released yet must not be
+    // modified; attributes would also stick to a reused instance, so those get a fresh one.
+    const bool canReuse = !withAttributes
+        && track->plainMetadata
+        && track->plainMetadata->refCountThreadUnsafe() == 1;
+
+    if (canReuse)
+        return track->plainMetadata;
+
+    const auto result = makePtr<ObjectMetadata>();
+    result->setTrackId(trackId);
+    if (isValidClassId(track->classId) && objectClass(track->classId).isReported())
+        result->setTypeId(std::string(objectClass(track->classId).objectTypeId));
+
+    if (!withAttributes)
+        track->plainMetadata = result;
+
+    return result;
+}
+
+const Ptr<Attribute>& ObjectMetadataBuilder::countAttribute(
+    const char* name,
+    int value,
+    int* cachedValue,
+    Ptr<Attribute>* cachedAttribute)
+{
+    if (*cachedValue != value || !*cachedAttribute)
+    {
+        *cachedAttribute = makePtr<Attribute>(
+            IAttribute::Type::number,
+            name,
+            std::to_string(value));
+        *cachedValue = value;
+    }
+    return *cachedAttribute;
+}
+
+void ObjectMetadataBuilder::removeStaleTracks(int64_t timestampUs)
+{
+    // Scanning all tracks on every frame is unnecessary; once per TTL is enough.
+    if (timestampUs - m_lastCleanupUs < kTrackCacheTtlUs)
+        return;
+    m_lastCleanupUs = timestampUs;
+
+    for (auto it = m_tracks.begin(); it != m_tracks.end(); )
+    {
+        if (timestampUs - it->second.lastSeenUs > kTrackCacheTtlUs)
+            it = m_tracks.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,92 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <nx/sdk/analytics/helpers/object_metadata.h>
+#include <nx/sdk/analytics/helpers/object_metadata_packet.h>
+#include <nx/sdk/helpers/attribute.h>
+#include <nx/sdk/ptr.h>
+#include <nx/sdk/uuid.h>
+
+#include "detection.h"
+#include "uuid_hash.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Builds ObjectMetadataPacket from detections while keeping per-frame allocations low:
+ * - Each track's UUID string and id attribute are created once.
+ * - Person count attributes are created once per value and shared by all objects of the frame.
+ * - Attributes are attached only when their value differs from the one last sent for the track;
+ *     the Server keeps the previous values of a track's attributes.
+ * - Objects without attributes reuse the track's cached ObjectMetadata as soon as the Server has
+ *     released the previous packet that referenced it.
+ */
+class ObjectMetadataBuilder
+{
+public:
+    /** @return Null if there are no detections. */
+    nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadataPacket> build(
+        const DetectionList& detections,
+        int64_t timestampUs);
+
+    /** Persons in the last built frame. */
+    int currentPersonCount() const { return m_currentPersonCount; }
+
+    /** Distinct person tracks seen since construction or reset(). */
+    int uniquePersonCount() const { return (int) m_seenPersonIds.size(); }
+
+    void reset();
+
+private:
+    struct TrackCache
+    {
+        int classId = kUnknownClassId;
+        nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadata> plainMetadata; //< Never has attributes.
+        nx::sdk::Ptr<nx::sdk::Attribute> idAttribute;
+        bool idSent = false;
+        int sentPersonCountFrame = -1;
+        int sentPersonCountUnique = -1;
+        int64_t lastSeenUs = 0;
+    };
+
+    TrackCache& trackCache(const Detection& detection, int64_t timestampUs);
+
+    nx::sdk::Ptr<nx::sdk::analytics::ObjectMetadata> acquireMetadata(
+        const nx::sdk::Uuid& trackId,
+        TrackCache* track,
+        bool withAttributes);
+
+    const nx::sdk::Ptr<nx::sdk::Attribute>& countAttribute(
+        const char* name,
+        int value,
+        int* cachedValue,
+        nx::sdk::Ptr<nx::sdk::Attribute>* cachedAttribute);
+
+    void removeStaleTracks(int64_t timestampUs);
+
+private:
+    static constexpr int64_t kTrackCacheTtlUs = 30'000'000;
+
+    std::unordered_map<nx::sdk::Uuid, TrackCache, UuidHash> m_tracks;
+    std::unordered_set<nx::sdk::Uuid, UuidHash> m_seenPersonIds;
+    int m_currentPersonCount = 0;
+
+    int m_countFrameAttributeValue = -1;
+    nx::sdk::Ptr<nx::sdk::Attribute> m_countFrameAttribute;
+    int m_countUniqueAttributeValue = -1;
+    nx::sdk::Ptr<nx::sdk::Attribute> m_countUniqueAttribute;
+
+    int64_t m_lastCleanupUs = 0;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
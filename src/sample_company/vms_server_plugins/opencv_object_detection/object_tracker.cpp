@@ -26,7 +26,7 @@ cv::Ptr<ITrackerByMatching> createTrackerByMatchingWithFastDescriptor()
 {
     TrackerParams params;
 
-    // Real forget delay is `params.forget_delay * kDetectionFramePeriod`.
+    // Real forget delay is `params.forget_delay * samplingPeriod` (a DeviceAgent setting).
     params.forget_delay = 75;
 
     // Keep forgotten tracks for cleaning up our tracks and dropping cv::detail::tracking::tbm tracks manually.
@@ -76,7 +76,7 @@ public:
 
     Status status() const { return m_status; }
     int64_t startTimeUs() const { return m_detections.begin()->first; }
-    std::string classLabel() const { return m_detections.begin()->second->classLabel; };
+    int classId() const { return m_detections.begin()->second->classId; };
 
 private:
     std::map<
@@ -94,8 +94,7 @@ private:
 ObjectTracker::ObjectTracker():
     m_tracker(createTrackerByMatchingWithFastDescriptor())
 {
-    for (const std::string& classLabel: kClassesToDetect)
-        m_detectionActive[classLabel] = false;
+    m_detectionActive.fill(false);
 }
 
 ObjectTracker::Result ObjectTracker::run(const Frame& frame, const DetectionList& detections)
@@ -120,15 +119,15 @@ ObjectTracker::Result ObjectTracker::run(const Frame& frame, const DetectionList
 EventList ObjectTracker::generateDetectionFinishedEvents(int64_t timestampUs)
 {
     EventList result;
-    for (const std::string& classLabel: kClassesToDetect)
+    for (const int classId: kReportedClassIds)
     {
-        if (m_detectionActive[classLabel])
+        if (m_detectionActive[(size_t) classId])
         {
             bool noActiveTracks = true;
             for (const auto& pair: m_tracks)
             {
                 const std::shared_ptr<Track> track = pair.second;
-                if (track->classLabel() == "person")
+                if (track->classId() == kPersonClassId)
                 {
                     noActiveTracks = false;
                     break;
@@ -140,9 +139,9 @@ EventList ObjectTracker::generateDetectionFinishedEvents(int64_t timestampUs)
                 result.push_back(std::make_shared<Event>(Event{
                     /*eventType*/ EventType::detection_finished,
                     /*timestampUs*/ timestampUs,
-                    /*classLabel*/ classLabel,
+                    /*classId*/ classId,
                 }));
-                m_detectionActive[classLabel] = false;
+                m_detectionActive[(size_t) classId] = false;
             }
         }
     }
@@ -153,7 +152,7 @@ void ObjectTracker::copyDetectionsHistoryToTrack(
     const Frame& frame,
     int64_t cvTrackId,
     Track* track,
-    const std::string& classLabel) const
+    int classId) const
 {
     const cv::detail::tracking::tbm::Track& cvTrack = m_tracker->tracks().at((size_t) cvTrackId);
     for (const TrackedObject& trackedDetection: cvTrack.objects)
@@ -164,7 +163,7 @@ void ObjectTracker::copyDetectionsHistoryToTrack(
         std::shared_ptr<const DetectionInternal> detection = convertTrackedObjectToDetection(
             /*frame*/ frame,
             /*trackedDetection*/ trackedDetection,
-            /*classLabel*/ classLabel,
+            /*classId*/ classId,
             /*idMapper*/ m_idMapper.get());
         track->addDetection(
             /*timestampUs*/ (int64_t) trackedDetection.timestamp,
@@ -204,36 +203,33 @@ EventList ObjectTracker::processDetection(
 
     const Track::Status& trackStatus = track->status();
 
+    const int classId = detection->detection->classId;
     if (trackStatus == Track::Status::started)
     {
-        const std::string classLabel = detection->detection->classLabel;
-
         copyDetectionsHistoryToTrack(
             /*frame*/ frame,
             /*cvTrackId*/ cvTrackId,
             /*track*/ track.get(),
-            /*classLabel*/ classLabel);
+            /*classId*/ classId);
 
         events.push_back(std::make_shared<Event>(Event{
             /*eventType*/ EventType::object_detected,
             /*timestampUs*/ track->startTimeUs(),
-            /*classLabel*/ classLabel,
+            /*classId*/ classId,
         }));
     }
 
-    const std::string& classLabel = detection->detection->classLabel;
     if ((trackStatus == Track::Status::started || trackStatus == Track::Status::active) &&
-        std::find(kClassesToDetect.begin(), kClassesToDetect.end(), classLabel) !=
-        kClassesToDetect.end())
+        objectClass(classId).isReported())
     {
-        if (!m_detectionActive[classLabel])
+        if (!m_detectionActive[(size_t) classId])
         {
             events.push_back(std::make_shared<Event>(Event{
                 /*eventType*/ EventType::detection_started,
                 /*timestampUs*/ track->startTimeUs(),
-                /*classLabel*/ classLabel,
+                /*classId*/ classId,
             }));
-            m_detectionActive[classLabel] = true;
+            m_detectionActive[(size_t) classId] = true;
         }
     }
 
@@ -271,16 +267,16 @@ ObjectTracker::Result ObjectTracker::runImpl(
     const Frame& frame,
     const DetectionList& detections)
 {
-    // Unfortunately the OpenCV tbm module does not support preserving classLabel during tracking.
+    // Unfortunately the OpenCV tbm module does not support preserving the class during tracking.
     // See issue: https://github.com/opencv/opencv_contrib/issues/2298
-    // Therefore, we save information about classLabels in the map from unique id of the detection
-    // (bounding box + timestamp) to classLabel.
-    std::map<const CompositeDetectionId, std::string> classLabels;
+    // Therefore, we save information about classes in the map from unique id of the detection
+    // (bounding box + timestamp) to classId.
+    ClassIdMap classIds;
 
     TrackedObjects detectionsToTrack = convertDetectionsToTrackedObjects(
         /*frame*/ frame,
         /*detections*/ detections,
-        /*classLabels*/ &classLabels);
+        /*classIds*/ &classIds);
 
     // Perform tracking and extract tracked detections.
     m_tracker->process(frame.cvMat, detectionsToTrack, (uint64_t) frame.timestampUs);
@@ -290,7 +286,7 @@ ObjectTracker::Result ObjectTracker::runImpl(
         convertTrackedObjectsToDetections(
         /*frame*/ frame,
         /*trackedDetections*/ trackedDetections,
-        /*classLabels*/ classLabels,
+        /*classIds*/ classIds,
         /*idMapper*/ m_idMapper.get());
 
     EventList events = generateEvents(
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <map>
 
@@ -47,7 +48,7 @@ private:
         const Frame& frame,
         int64_t cvTrackId,
         Track* track,
-        const std::string& classLabel) const;
+        int classId) const;
 
     std::shared_ptr<Track> getOrCreateTrack(const nx::sdk::Uuid& trackId);
 
@@ -71,7 +72,7 @@ private:
     const cv::Ptr<cv::detail::tracking::tbm::ITrackerByMatching> m_tracker;
     const std::unique_ptr<IdMapper> m_idMapper{new IdMapper()};
     std::map</*trackId*/ const nx::sdk::Uuid, /*track*/ std::shared_ptr<Track>> m_tracks;
-    std::map</*classLabel*/ const std::string, /*detectionActive*/ bool> m_detectionActive;
+    std::array</*detectionActive*/ bool, kObjectClassCount> m_detectionActive{}; //< By classId.
 };
 
 } // namespace opencv_object_detection
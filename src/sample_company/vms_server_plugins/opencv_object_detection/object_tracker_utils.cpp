@@ -37,12 +37,12 @@ void IdMapper::removeAllExcept(const std::set<Uuid>& idsToKeep)
 }
 
 /**
- * Convert detections from the plugin format to the format of opencv::detail::tracking::tbm, preserving classLabels.
+ * Convert detections from the plugin format to the format of opencv::detail::tracking::tbm, preserving classIds.
  */
 TrackedObjects convertDetectionsToTrackedObjects(
     const Frame& frame,
     const DetectionList& detections,
-    ClassLabelMap* inOutClassLabels)
+    ClassIdMap* inOutClassIds)
 {
     TrackedObjects result;
 
@@ -53,10 +53,10 @@ TrackedObjects convertDetectionsToTrackedObjects(
             frame.width,
             frame.height);
 
-        inOutClassLabels->insert(std::make_pair(CompositeDetectionId{
+        inOutClassIds->insert(std::make_pair(CompositeDetectionId{
             frame.index,
             cvRect},
-            detection->classLabel));
+            detection->classId));
 
         result.push_back(TrackedObject(
             cvRect,
@@ -69,17 +69,17 @@ TrackedObjects convertDetectionsToTrackedObjects(
 }
 
 /**
- * Convert detection from tbm format to our format, restoring the classLabels.
+ * Convert detection from tbm format to our format, restoring the classIds.
  */
 std::shared_ptr<DetectionInternal> convertTrackedObjectToDetection(
     const Frame& frame,
     const TrackedObject& trackedDetection,
-    const std::string& classLabel,
+    int classId,
     IdMapper* idMapper)
 {
     auto detection = std::make_shared<Detection>(Detection{
         /*boundingBox*/ cvRectToNxRect(trackedDetection.rect, frame.width, frame.height),
-        classLabel,
+        classId,
         (float) trackedDetection.confidence,
         /*trackId*/ idMapper->get(trackedDetection.object_id)});
     return std::make_shared<DetectionInternal>(DetectionInternal{
@@ -89,24 +89,24 @@ std::shared_ptr<DetectionInternal> convertTrackedObjectToDetection(
 }
 
 /**
- * Convert detections from opencv::detail::tracking::tbm format to the plugin format, restoring classLabels.
+ * Convert detections from opencv::detail::tracking::tbm format to the plugin format, restoring classIds.
  */
 DetectionInternalList convertTrackedObjectsToDetections(
     const Frame& frame,
     const TrackedObjects& trackedDetections,
-    const ClassLabelMap& classLabels,
+    const ClassIdMap& classIds,
     IdMapper* idMapper)
 {
     DetectionInternalList result;
     for (const cv::detail::tracking::tbm::TrackedObject& trackedDetection: trackedDetections)
     {
-        const std::string classLabel = classLabels.at({
+        const int classId = classIds.at({
             frame.index,
             trackedDetection.rect});
         result.push_back(convertTrackedObjectToDetection(
             frame,
             trackedDetection,
-            classLabel,
+            classId,
             idMapper));
     }
 
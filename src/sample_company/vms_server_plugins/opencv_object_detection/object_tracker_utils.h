@@ -46,23 +46,23 @@ struct CompositeDetectionId
     const cv::Rect rect;
 };
 
-using ClassLabelMap = std::map<const CompositeDetectionId, std::string>;
+using ClassIdMap = std::map<const CompositeDetectionId, int>;
 
 cv::detail::tracking::tbm::TrackedObjects convertDetectionsToTrackedObjects(
     const Frame& frame,
     const DetectionList& detections,
-    ClassLabelMap* inOutClassLabels);
+    ClassIdMap* inOutClassIds);
 
 std::shared_ptr<DetectionInternal> convertTrackedObjectToDetection(
     const Frame& frame,
     const cv::detail::tracking::tbm::TrackedObject& trackedDetection,
-    const std::string& classLabel,
+    int classId,
     IdMapper* idMapper);
 
 DetectionInternalList convertTrackedObjectsToDetections(
     const Frame& frame,
     const cv::detail::tracking::tbm::TrackedObjects& trackedDetections,
-    const ClassLabelMap& classLabels,
+    const ClassIdMap& classIds,
     IdMapper* idMapper);
 
 DetectionList extractDetectionList(const DetectionInternalList& detectionsInternal);
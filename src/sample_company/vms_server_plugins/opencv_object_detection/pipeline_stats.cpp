@@ -0,0 +1,129 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "pipeline_stats.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include "json.hpp"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+using json = nlohmann::json;
+
+const char* pipelineStageName(PipelineStage stage)
+{
+    switch (stage)
+    {
+        case PipelineStage::videoDecode: return "videoDecode";
+        case PipelineStage::frameConversion: return "frameConversion";
+        case PipelineStage::resize: return "resize";
+        case PipelineStage::jpegEncode: return "jpegEncode";
+        case PipelineStage::queueWait: return "queueWait";
+        case PipelineStage::httpRoundTrip: return "httpRoundTrip";
+        case PipelineStage::sharedFrameRoundTrip: return "sharedFrameRoundTrip";
+        case PipelineStage::responseParse: return "responseParse";
+        case PipelineStage::metadataBuild: return "metadataBuild";
+        case PipelineStage::push: return "push";
+    }
+    return "unknown";
+}
+
+const char* frameCounterName(FrameCounter counter)
+{
+    switch (counter)
+    {
+        case FrameCounter::received: return "received";
+        case FrameCounter::sampled: return "sampled";
+        case FrameCounter::skippedServiceUnavailable: return "skippedServiceUnavailable";
+        case FrameCounter::enqueued: return "enqueued";
+        case FrameCounter::droppedAtEnqueue: return "droppedAtEnqueue";
+        case FrameCounter::droppedAtDequeue: return "droppedAtDequeue";
+        case FrameCounter::encoded: return "encoded";
+        case FrameCounter::inferred: return "inferred";
+        case FrameCounter::failed: return "failed";
+        case FrameCounter::discardedAtShutdown: return "discardedAtShutdown";
+    }
+    return "unknown";
+}
+
+PipelineStats::Clock::time_point PipelineStats::record(
+    PipelineStage stage,
+    Clock::time_point start)
+{
+    const Clock::time_point now = Clock::now();
+    record(stage, now - start);
+    return now;
+}
+
+void PipelineStats::record(PipelineStage stage, Clock::duration elapsed)
+{
+    m_histograms[(size_t) stage].record(
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+std::string PipelineStats::toJson(const std::string& cameraId) const
+{
+    json stages = json::object();
+    for (int i = 0; i < kPipelineStageCount; ++i)
+    {
+        const auto stage = (PipelineStage) i;
+        const LatencyHistogram& h = histogram(stage);
+        stages[pipelineStageName(stage)] = {
+            {"count", h.count()},
+            {"meanUs", h.meanUs()},
+            {"p50Us", h.valueAtPercentileUs(50.0)},
+            {"p90Us", h.valueAtPercentileUs(90.0)},
+            {"p99Us", h.valueAtPercentileUs(99.0)},
+            {"p999Us", h.valueAtPercentileUs(99.9)},
+            {"maxUs", h.maxUs()},
+        };
+    }
+
+    json frames = json::object();
+    for (int i = 0; i < kFrameCounterCount; ++i)
+        frames[frameCounterName((FrameCounter) i)] = counter((FrameCounter) i);
+
+    const int64_t received = counter(FrameCounter::received);
+    const double analyzedPercent = received > 0
+        ? 100.0 * (double) counter(FrameCounter::inferred) / (double) received
+        : 0.0;
+
+    const json result = {
+        {"cameraId", cameraId},
+        {"uptimeS", std::chrono::duration_cast<std::chrono::seconds>(
+            Clock::now() - m_startTime).count()},
+        {"stages", std::move(stages)},
+        {"frames", std::move(frames)},
+        {"analyzedPercent", analyzedPercent},
+    };
+    return result.dump(2);
+}
+
+void PipelineStats::writeJsonFile(
+    const std::string& cameraId,
+    const std::filesystem::path& path) const
+{
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+            throw std::runtime_error("Unable to open " + tempPath.string());
+        file << toJson(cameraId) << '\n';
+        if (!file)
+            throw std::runtime_error("Unable to write " + tempPath.string());
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+        throw std::runtime_error("Unable to replace " + path.string() + ": " + error.message());
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
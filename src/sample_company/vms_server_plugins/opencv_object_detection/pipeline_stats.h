@@ -0,0 +1,109 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "latency_histogram.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/** Stages of the frame pipeline of a DeviceAgent, in processing order. */
+enum class PipelineStage
+{
+    videoDecode, //< Compressed packet -> decoded picture; only with useCompressedFrames.
+    frameConversion, //< IUncompressedVideoFrame or decoded picture -> BGR cv::Mat.
+    resize,
+    jpegEncode,
+    queueWait, //< From enqueueing the job to the worker picking it up.
+    httpRoundTrip, //< Building the /infer request and waiting for the response.
+    sharedFrameRoundTrip, //< Copying the frame to shared memory and waiting for the detections.
+    responseParse,
+    metadataBuild, //< Object metadata, fall analysis and events.
+    push, //< Handing the packets to the Server.
+};
+
+constexpr int kPipelineStageCount = (int) PipelineStage::push + 1;
+
+const char* pipelineStageName(PipelineStage stage);
+
+/** What happened to the frames of a camera; each frame moves down the list until it is lost. */
+enum class FrameCounter
+{
+    received, //< Frames the Server pushed to the DeviceAgent.
+    sampled, //< Frames picked for analysis.
+    skippedServiceUnavailable, //< Sampled or queued while the AI service circuit was open.
+    enqueued, //< Converted, downscaled and queued for the worker.
+    droppedAtEnqueue, //< Evicted from a full queue by a newer frame.
+    droppedAtDequeue, //< Skipped by the worker in favor of the newest queued frame.
+    encoded, //< JPEG-encoded by the worker.
+    inferred,
+    failed, //< Inference or post-processing threw.
+    discardedAtShutdown, //< Queued or in flight when the DeviceAgent was destroyed.
+};
+
+constexpr int kFrameCounterCount = (int) FrameCounter::discardedAtShutdown + 1;
+
+const char* frameCounterName(FrameCounter counter);
+
+/**
+ * Latency histograms of every pipeline stage and frame counters of one camera. Recording is
+ * thread-safe and cheap enough to stay enabled in production.
+ */
+class PipelineStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+public:
+    /**
+     * Records the time elapsed since `start`.
+     * @return Current time, so that consecutive stages can be chained.
+     */
+    Clock::time_point record(PipelineStage stage, Clock::time_point start);
+
+    void record(PipelineStage stage, Clock::duration elapsed);
+
+    const LatencyHistogram& histogram(PipelineStage stage) const
+    {
+        return m_histograms[(size_t) stage];
+    }
+
+    void count(FrameCounter counter, int64_t value = 1)
+    {
+        m_frameCounters[(size_t) counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    int64_t counter(FrameCounter counter) const
+    {
+        return m_frameCounters[(size_t) counter].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Count, mean, max and p50/p90/p99/p99.9 of each stage, in microseconds, the frame counters
+     * and the share of received frames that were analyzed.
+     */
+    std::string toJson(const std::string& cameraId) const;
+
+    /**
+     * Replaces the file atomically, so that readers never see a partially written one.
+     * @throws std::runtime_error
+     */
+    void writeJsonFile(const std::string& cameraId, const std::filesystem::path& path) const;
+
+private:
+    std::array<LatencyHistogram, kPipelineStageCount> m_histograms;
+    std::array<std::atomic<int64_t>, kFrameCounterCount> m_frameCounters{};
+    const Clock::time_point m_startTime = Clock::now();
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -30,6 +30,13 @@ Result<IEngine*> Plugin::doObtainEngine()
  * - description: Description of the plugin in a few sentences.
  * - version: Version of the plugin.
  * - vendor: Plugin creator (person or company) name.
+ * - engineSettingsModel: Server-wide settings of the Engine; inferencesPerSecond is the budget
+ *     InferenceGovernor splits between the cameras (0 means unlimited).
+ *     inferenceEndpoint lists the services, comma-separated, each "host:port" or "unix:/path"
+ *     for a Unix domain socket; InferenceRouter sends each request to the least loaded one.
+ *     cameraAffinity keeps each camera on one service, which holds its tracks.
+ *     sharedFrameSocket is where the native service on this host takes frames through shared
+ *     memory; used only if the single configured endpoint is local.
  */
 std::string Plugin::manifestString() const
 {
@@ -39,7 +46,42 @@ std::string Plugin::manifestString() const
     "name": "YOLOv8 People Analytics",
     "description": "Analytics plugin using YOLOv8 model for people detection.",
     "version": "1.0.0",
-    "vendor": "HumanCounterV8"
+    "vendor": "HumanCounterV8",
+    "engineSettingsModel": {
+        "type": "Settings",
+        "items": [
+            {
+                "type": "SpinBox",
+                "name": "inferencesPerSecond",
+                "caption": "Inference budget (per second, all cameras)",
+                "description": "Frames analyzed per second across all cameras; 0 (the default) means unlimited. Cameras with a person or an active fall get a larger share.",
+                "defaultValue": 0,
+                "minValue": 0,
+                "maxValue": 1000
+            },
+            {
+                "type": "TextField",
+                "name": "inferenceEndpoint",
+                "caption": "Inference service endpoints",
+                "description": "Comma-separated list of host:port, or unix:/path/to/socket for a service on this host listening on a Unix domain socket (Linux and macOS). Each request goes to the least loaded service that responds.",
+                "defaultValue": "127.0.0.1:18000"
+            },
+            {
+                "type": "CheckBox",
+                "name": "cameraAffinity",
+                "caption": "Keep each camera on one service",
+                "description": "Needed when the services track people themselves; a camera moves only when its service stops responding. Off: every frame goes to the least loaded service.",
+                "defaultValue": true
+            },
+            {
+                "type": "TextField",
+                "name": "sharedFrameSocket",
+                "caption": "Shared memory socket",
+                "description": "SHARED_FRAME_SOCKET of the native inference service. Frames go through shared memory instead of HTTP only when a single endpoint is set and it is on this host (unix:/path, 127.0.0.1 or localhost). Empty: always HTTP.",
+                "defaultValue": "/tmp/safeaging_inference.sock"
+            }
+        ]
+    }
 }
 )json";
 }
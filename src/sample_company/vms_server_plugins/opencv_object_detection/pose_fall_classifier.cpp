@@ -0,0 +1,223 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "pose_fall_classifier.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+constexpr float kDegreesToRadians = 0.017453292519943295F;
+
+bool isVisible(const Keypoint& keypoint, float minConfidence)
+{
+    return keypoint.confidence >= minConfidence;
+}
+
+} // namespace
+
+void PoseFallClassifier::Batch::clear()
+{
+    detectionIndex.clear();
+    torsoDx.clear();
+    torsoDy.clear();
+    hipY.clear();
+    hipToAnkle.clear();
+    ankleVisible.clear();
+    previousHipY.clear();
+    dtSeconds.clear();
+    recentDrop.clear();
+}
+
+void PoseFallClassifier::Batch::resize(size_t size)
+{
+    fallen.resize(size);
+    dropped.resize(size);
+}
+
+PoseFallClassifier::PoseFallClassifier(PoseFallClassifierSettings settings)
+{
+    setSettings(settings);
+}
+
+void PoseFallClassifier::setSettings(const PoseFallClassifierSettings& settings)
+{
+    m_settings = settings;
+    m_tanTiltThreshold = std::tan(m_settings.torsoTiltThresholdDeg * kDegreesToRadians);
+}
+
+void PoseFallClassifier::classify(
+    const DetectionList& detections,
+    int frameWidth,
+    int frameHeight,
+    int64_t timestampUs,
+    std::vector<PoseVerdict>* outVerdicts)
+{
+    outVerdicts->assign(detections.size(), PoseVerdict::unknown);
+    if (frameWidth <= 0 || frameHeight <= 0)
+        return;
+
+    gather(detections, frameWidth, frameHeight, timestampUs);
+    evaluate();
+    scatter(detections, timestampUs, outVerdicts);
+
+    for (auto it = m_hipStates.begin(); it != m_hipStates.end(); )
+    {
+        if (timestampUs - it->second.timestampUs > m_settings.trackTtlUs)
+            it = m_hipStates.erase(it);
+        else
+            ++it;
+    }
+}
+
+void PoseFallClassifier::reset()
+{
+    m_hipStates.clear();
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void PoseFallClassifier::gather(
+    const DetectionList& detections,
+    int frameWidth,
+    int frameHeight,
+    int64_t timestampUs)
+{
+    Batch& b = m_batch;
+    b.clear();
+
+    // Torso geometry is measured in pixels so that the tilt does not depend on the frame aspect.
+    const float w = (float) frameWidth;
+    const float h = (float) frameHeight;
+    const float minConfidence = m_settings.minKeypointConfidence;
+
+    for (size_t i = 0; i < detections.size(); ++i)
+    {
+        const Detection& detection = *detections[i];
+        if (!detection.keypoints || detection.classId != kPersonClassId)
+            continue;
+
+        const PoseKeypoints& k = *detection.keypoints;
+        const Keypoint& leftShoulder = keypointAt(k, KeypointIndex::leftShoulder);
+        const Keypoint& rightShoulder = keypointAt(k, KeypointIndex::rightShoulder);
+        const Keypoint& leftHip = keypointAt(k, KeypointIndex::leftHip);
+        const Keypoint& rightHip = keypointAt(k, KeypointIndex::rightHip);
+        if (!isVisible(leftShoulder, minConfidence) || !isVisible(rightShoulder, minConfidence)
+            || !isVisible(leftHip, minConfidence) || !isVisible(rightHip, minConfidence))
+        {
+            continue;
+        }
+
+        const float shoulderX = (leftShoulder.x + rightShoulder.x) * 0.5F;
+        const float shoulderY = (leftShoulder.y + rightShoulder.y) * 0.5F;
+        const float hipX = (leftHip.x + rightHip.x) * 0.5F;
+        const float hipY = (leftHip.y + rightHip.y) * 0.5F;
+
+        const Keypoint& leftAnkle = keypointAt(k, KeypointIndex::leftAnkle);
+        const Keypoint& rightAnkle = keypointAt(k, KeypointIndex::rightAnkle);
+        float ankleY = 0.0F;
+        float ankleVisible = 1.0F;
+        if (isVisible(leftAnkle, minConfidence) && isVisible(rightAnkle, minConfidence))
+            ankleY = std::max(leftAnkle.y, rightAnkle.y);
+        else if (isVisible(leftAnkle, minConfidence))
+            ankleY = leftAnkle.y;
+        else if (isVisible(rightAnkle, minConfidence))
+            ankleY = rightAnkle.y;
+        else
+            ankleVisible = 0.0F;
+
+        float previousHipY = hipY;
+        float dtSeconds = 0.0F;
+        float recentDrop = 0.0F;
+        const auto state = m_hipStates.find(detection.trackId);
+        if (state != m_hipStates.end())
+        {
+            previousHipY = state->second.hipY;
+            dtSeconds = (float) (timestampUs - state->second.timestampUs) * 1e-6F;
+            if (timestampUs - state->second.lastDropUs <= m_settings.hipDropMemoryUs)
+                recentDrop = 1.0F;
+        }
+
+        b.detectionIndex.push_back(i);
+        b.torsoDx.push_back((hipX - shoulderX) * w);
+        b.torsoDy.push_back((hipY - shoulderY) * h);
+        b.hipY.push_back(hipY);
+        b.hipToAnkle.push_back((ankleY - hipY) * h);
+        b.ankleVisible.push_back(ankleVisible);
+        b.previousHipY.push_back(previousHipY);
+        b.dtSeconds.push_back(dtSeconds);
+        b.recentDrop.push_back(recentDrop);
+    }
+
+    b.resize(b.detectionIndex.size());
+}
+
+void PoseFallClassifier::evaluate()
+{
+    Batch& b = m_batch;
+    const size_t n = b.detectionIndex.size();
+
+    const float tanTilt = m_tanTiltThreshold;
+    const float lowHipRatio = m_settings.lowHipHeightRatio;
+    const float dropThreshold = m_settings.hipDropVelocityThreshold;
+
+    const float* const torsoDx = b.torsoDx.data();
+    const float* const torsoDy = b.torsoDy.data();
+    const float* const hipY = b.hipY.data();
+    const float* const hipToAnkle = b.hipToAnkle.data();
+    const float* const ankleVisible = b.ankleVisible.data();
+    const float* const previousHipY = b.previousHipY.data();
+    const float* const dtSeconds = b.dtSeconds.data();
+    const float* const recentDrop = b.recentDrop.data();
+    uint8_t* const fallen = b.fallen.data();
+    uint8_t* const dropped = b.dropped.data();
+
+    // Branch-free on purpose: every lane evaluates every condition.
+    for (size_t i = 0; i < n; ++i)
+    {
+        const float dx = std::fabs(torsoDx[i]);
+        const float dy = std::fabs(torsoDy[i]);
+        const float torsoLength = std::sqrt(dx * dx + dy * dy);
+
+        // Deviation from vertical exceeds the threshold <=> |dx| > tan(threshold) * |dy|.
+        const bool tilted = dx > tanTilt * dy;
+
+        const bool hipLow = ankleVisible[i] > 0.5F && hipToAnkle[i] < lowHipRatio * torsoLength;
+
+        const float velocity = dtSeconds[i] > 0.0F
+            ? (hipY[i] - previousHipY[i]) / std::max(dtSeconds[i], 1e-3F)
+            : 0.0F;
+        const bool dropNow = velocity > dropThreshold;
+
+        dropped[i] = (uint8_t) dropNow;
+        fallen[i] = (uint8_t) (tilted & (hipLow | dropNow | (recentDrop[i] > 0.5F)));
+    }
+}
+
+void PoseFallClassifier::scatter(
+    const DetectionList& detections,
+    int64_t timestampUs,
+    std::vector<PoseVerdict>* outVerdicts)
+{
+    const Batch& b = m_batch;
+    for (size_t i = 0; i < b.detectionIndex.size(); ++i)
+    {
+        const size_t detectionIndex = b.detectionIndex[i];
+        (*outVerdicts)[detectionIndex] = b.fallen[i] ? PoseVerdict::fallen : PoseVerdict::upright;
+
+        HipState& state = m_hipStates[detections[detectionIndex]->trackId];
+        state.hipY = b.hipY[i];
+        state.timestampUs = timestampUs;
+        if (b.dropped[i])
+            state.lastDropUs = timestampUs;
+    }
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,116 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <nx/sdk/uuid.h>
+
+#include "detection.h"
+#include "uuid_hash.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+enum class PoseVerdict
+{
+    unknown, //< No keypoints, or the torso keypoints are not visible.
+    upright,
+    fallen,
+};
+
+struct PoseFallClassifierSettings
+{
+    float minKeypointConfidence = 0.3F;
+
+    /** Torso deviation from vertical (shoulder midpoint to hip midpoint) to count as tilted. */
+    float torsoTiltThresholdDeg = 60.0F;
+
+    /**
+     * Hip height above the ankles, in torso lengths, below which a tilted person is considered
+     * lying. A person bending over keeps straight legs, so the hips stay high.
+     */
+    float lowHipHeightRatio = 0.5F;
+
+    /** Downward hip speed, in frame heights per second, that counts as a drop. */
+    float hipDropVelocityThreshold = 0.6F;
+
+    /** How long after a hip drop a tilted torso is still attributed to a fall. */
+    int64_t hipDropMemoryUs = 2'000'000;
+
+    int64_t trackTtlUs = 15'000'000;
+};
+
+/**
+ * Keypoint-based fall classifier. A person is fallen when the torso is tilted towards horizontal
+ * and either the hips are low above the ankles or they have recently dropped quickly; sitting
+ * (upright torso) and bending (high hips, no drop) are not flagged.
+ *
+ * All persons of a frame are classified in one pass: keypoints are gathered into contiguous
+ * per-feature arrays and the geometry is evaluated with branch-free loops that the compiler
+ * vectorizes.
+ */
+class PoseFallClassifier
+{
+public:
+    explicit PoseFallClassifier(PoseFallClassifierSettings settings = {});
+
+    void setSettings(const PoseFallClassifierSettings& settings);
+
+    /**
+     * @param outVerdicts Receives one verdict per element of detections; non-person detections
+     *     and detections without keypoints get PoseVerdict::unknown.
+     */
+    void classify(
+        const DetectionList& detections,
+        int frameWidth,
+        int frameHeight,
+        int64_t timestampUs,
+        std::vector<PoseVerdict>* outVerdicts);
+
+    void reset();
+
+private:
+    struct HipState
+    {
+        float hipY = 0.0F; //< Fraction of the frame height.
+        int64_t timestampUs = 0;
+        int64_t lastDropUs = INT64_MIN / 2;
+    };
+
+    /** Per-frame scratch arrays, one element per gathered person; reused to avoid allocations. */
+    struct Batch
+    {
+        std::vector<size_t> detectionIndex;
+        std::vector<float> torsoDx;
+        std::vector<float> torsoDy;
+        std::vector<float> hipY;
+        std::vector<float> hipToAnkle;
+        std::vector<float> ankleVisible;
+        std::vector<float> previousHipY;
+        std::vector<float> dtSeconds;
+        std::vector<float> recentDrop;
+        std::vector<uint8_t> fallen;
+        std::vector<uint8_t> dropped;
+
+        void clear();
+        void resize(size_t size);
+    };
+
+    void gather(const DetectionList& detections, int frameWidth, int frameHeight, int64_t timestampUs);
+    void evaluate();
+    void scatter(const DetectionList& detections, int64_t timestampUs, std::vector<PoseVerdict>* outVerdicts);
+
+private:
+    PoseFallClassifierSettings m_settings;
+    float m_tanTiltThreshold = 0.0F;
+    std::unordered_map<nx::sdk::Uuid, HipState, UuidHash> m_hipStates;
+    Batch m_batch;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,60 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Fixed-capacity FIFO that overwrites its oldest element when full. Never allocates; all
+ * operations are O(1).
+ */
+template<typename T, size_t kCapacity>
+class RingBuffer
+{
+    static_assert(kCapacity > 0, "RingBuffer capacity must be positive.");
+
+public:
+    /** @return The element that was overwritten, or a default-constructed one. */
+    T push(const T& value)
+    {
+        T evicted{};
+        if (m_size == kCapacity)
+            evicted = m_items[m_head];
+        else
+            ++m_size;
+
+        m_items[m_head] = value;
+        m_head = (m_head + 1) % kCapacity;
+        return evicted;
+    }
+
+    /** Index 0 is the oldest element, size() - 1 is the newest one. */
+    const T& operator[](size_t index) const
+    {
+        return m_items[(m_head + kCapacity - m_size + index) % kCapacity];
+    }
+
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[m_size - 1]; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    bool full() const { return m_size == kCapacity; }
+    static constexpr size_t capacity() { return kCapacity; }
+
+    void clear() { m_size = 0; m_head = 0; }
+
+private:
+    std::array<T, kCapacity> m_items{};
+    size_t m_head = 0; //< Position the next element is written to.
+    size_t m_size = 0;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
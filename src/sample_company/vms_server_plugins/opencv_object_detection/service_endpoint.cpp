@@ -0,0 +1,93 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "service_endpoint.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+const std::string kUnixSocketPrefix = "unix:";
+
+} // namespace
+
+ServiceEndpoint ServiceEndpoint::parse(const std::string& text)
+{
+    ServiceEndpoint result;
+
+    if (text.compare(0, kUnixSocketPrefix.size(), kUnixSocketPrefix) == 0)
+    {
+        #if defined(_WIN32)
+            throw std::invalid_argument("Unix domain sockets are not supported on Windows");
+        #endif
+        result.host = text.substr(kUnixSocketPrefix.size());
+        result.port = 0;
+        result.isUnixSocket = true;
+        if (result.host.empty())
+            throw std::invalid_argument("\"" + text + "\": the socket path is empty");
+        return result;
+    }
+
+    const size_t colon = text.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == text.size())
+        throw std::invalid_argument("\"" + text + "\" is neither host:port nor unix:/path");
+
+    result.host = text.substr(0, colon);
+    try
+    {
+        size_t parsedLength = 0;
+        result.port = std::stoi(text.substr(colon + 1), &parsedLength);
+        if (colon + 1 + parsedLength != text.size())
+            throw std::invalid_argument(text);
+    }
+    catch (const std::exception&)
+    {
+        throw std::invalid_argument("\"" + text + "\": the port is not a number");
+    }
+    if (result.port <= 0 || result.port > 65535)
+        throw std::invalid_argument("\"" + text + "\": the port is out of range");
+    return result;
+}
+
+std::vector<ServiceEndpoint> ServiceEndpoint::parseList(const std::string& text)
+{
+    std::vector<ServiceEndpoint> result;
+    size_t begin = 0;
+    while (begin <= text.size())
+    {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos)
+            end = text.size();
+
+        const size_t first = text.find_first_not_of(" \t", begin);
+        const size_t last = text.find_last_not_of(" \t", end - 1);
+        if (first >= end || last == std::string::npos || last < first)
+            throw std::invalid_argument("\"" + text + "\": an endpoint is empty");
+
+        const ServiceEndpoint endpoint = parse(text.substr(first, last - first + 1));
+        if (std::find(result.begin(), result.end(), endpoint) != result.end())
+            throw std::invalid_argument("\"" + text + "\": " + endpoint.toString() + " is repeated");
+        result.push_back(endpoint);
+        begin = end + 1;
+    }
+    return result;
+}
+
+std::string ServiceEndpoint::toString() const
+{
+    return isUnixSocket ? kUnixSocketPrefix + host : host + ":" + std::to_string(port);
+}
+
+bool ServiceEndpoint::isLocal() const
+{
+    return isUnixSocket || host == "localhost" || host == "::1" || host == "[::1]"
+        || host.compare(0, 4, "127.") == 0;
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,45 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Where the inference service listens for HTTP: "host:port" over TCP, or "unix:/path/to.sock"
+ * for a Unix domain socket on this host, which skips the TCP/IP stack for every frame.
+ */
+struct ServiceEndpoint
+{
+    std::string host = "127.0.0.1"; //< The socket path if isUnixSocket.
+    int port = 18000; //< Unused if isUnixSocket.
+    bool isUnixSocket = false;
+
+    /** @throws std::invalid_argument */
+    static ServiceEndpoint parse(const std::string& text);
+
+    /**
+     * Comma-separated endpoints, e.g. "unix:/run/a.sock, unix:/run/b.sock"; never empty.
+     * @throws std::invalid_argument
+     */
+    static std::vector<ServiceEndpoint> parseList(const std::string& text);
+
+    std::string toString() const;
+
+    /** Whether the service runs on this host: a Unix socket, or a loopback address. */
+    bool isLocal() const;
+
+    bool operator==(const ServiceEndpoint& other) const
+    {
+        return host == other.host && port == other.port && isUnixSocket == other.isUnixSocket;
+    }
+    bool operator!=(const ServiceEndpoint& other) const { return !(*this == other); }
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
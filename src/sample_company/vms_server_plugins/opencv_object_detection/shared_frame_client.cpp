@@ -0,0 +1,252 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "shared_frame_client.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if !defined(_WIN32)
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+#include "logger.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+constexpr std::chrono::milliseconds kHelloTimeout{500};
+
+#if !defined(_WIN32)
+
+/** @return -1 if nobody listens on the path. */
+int connectUnixSocket(const std::string& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return -1;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    #if defined(SO_NOSIGPIPE)
+        const int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+    #endif
+
+    if (connect(fd, (const sockaddr*) &address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif // !defined(_WIN32)
+
+} // namespace
+
+SharedFrameClient::SharedFrameClient(std::string socketPath):
+    m_socketPath(std::move(socketPath))
+{
+}
+
+SharedFrameClient::~SharedFrameClient()
+{
+    disconnect();
+}
+
+bool SharedFrameClient::ensureConnected(const std::string& cameraId)
+{
+    if (!kIsSharedFrameTransportSupported || m_isStopped)
+        return false;
+    if (m_socket >= 0 && cameraId == m_cameraId)
+        return true;
+
+    disconnect();
+    const Clock::time_point now = Clock::now();
+    if (now < m_nextConnectAttempt)
+        return false;
+    m_nextConnectAttempt = now + kReconnectPeriod;
+
+    #if !defined(_WIN32)
+        const int fd = connectUnixSocket(m_socketPath);
+        if (fd < 0)
+            return false;
+        {
+            const std::lock_guard<std::mutex> lock(m_socketMutex);
+            m_socket = fd;
+        }
+
+        try
+        {
+            m_ring = SharedFrameRing::create();
+
+            SharedFrameHello hello;
+            std::strncpy(hello.segmentName, m_ring.name().c_str(), sizeof(hello.segmentName) - 1);
+            std::strncpy(hello.cameraId, cameraId.c_str(), sizeof(hello.cameraId) - 1);
+            sendSharedFrameBytes(m_socket, &hello, sizeof(hello));
+
+            SharedFrameMessage reply;
+            if (!receiveSharedFrameBytes(m_socket, &reply, sizeof(reply), kHelloTimeout)
+                || reply.type != SharedFrameMessageType::helloAccepted)
+            {
+                throw std::runtime_error("no hello reply");
+            }
+        }
+        catch (const std::exception& e)
+        {
+            PLUGIN_LOG(warning, 0.1, "Shared frame transport at %s refused: %s; using HTTP",
+                m_socketPath.c_str(), e.what());
+            disconnect();
+            return false;
+        }
+
+        // Both processes have it mapped: the memory is freed when the last of them goes away.
+        m_ring.unlink();
+        m_cameraId = cameraId;
+        m_nextSlot = 0;
+        PLUGIN_LOG(info, 0, "[%s] Frames go through shared memory (%s)",
+            cameraId.c_str(), m_socketPath.c_str());
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+bool SharedFrameClient::canTransfer(const cv::Mat& image)
+{
+    return image.type() == CV_8UC3
+        && (size_t) image.cols * 3 * (size_t) image.rows <= kSharedFrameMaxPixelBytes;
+}
+
+std::vector<SharedDetection> SharedFrameClient::infer(
+    const cv::Mat& image, std::chrono::milliseconds timeout)
+{
+    if (m_socket < 0)
+        throw std::runtime_error("Shared frame transport is not connected");
+    if (!canTransfer(image))
+        throw std::runtime_error("Image does not fit into a shared frame slot");
+
+    bool isConnectionUsable = false; //< Set for failures of the request, not of the transport.
+    try
+    {
+        const int slotIndex = findFreeSlot();
+        if (slotIndex < 0)
+            throw std::runtime_error("All shared frame slots are held by the service");
+
+        SharedFrameSlotHeader& slot = m_ring.slot(slotIndex);
+        const size_t stride = (size_t) image.cols * 3;
+        cv::Mat pixels(image.rows, image.cols, CV_8UC3, m_ring.pixels(slotIndex), stride);
+        image.copyTo(pixels);
+
+        const uint64_t sequence = m_nextSequence++;
+        slot.width = (uint32_t) image.cols;
+        slot.height = (uint32_t) image.rows;
+        slot.stride = (uint32_t) stride;
+        slot.sequence = sequence;
+        slot.status = 0;
+        slot.detectionCount = 0;
+        slot.state.store(SharedFrameSlotState::submitted, std::memory_order_release);
+        m_nextSlot = (slotIndex + 1) % kSharedFrameSlotCount;
+
+        SharedFrameMessage request;
+        request.type = SharedFrameMessageType::frameSubmitted;
+        request.slotIndex = (uint32_t) slotIndex;
+        request.sequence = sequence;
+        sendSharedFrameBytes(m_socket, &request, sizeof(request));
+
+        const Clock::time_point deadline = Clock::now() + timeout;
+        for (;;)
+        {
+            const auto remaining = std::max(std::chrono::milliseconds::zero(),
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()));
+            SharedFrameMessage reply;
+            if (!receiveSharedFrameBytes(m_socket, &reply, sizeof(reply), remaining))
+            {
+                // The connection stays: the slot is freed when the late reply arrives.
+                isConnectionUsable = true;
+                throw std::runtime_error("Timed out waiting for the detections");
+            }
+            if (m_isStopped)
+                throw std::runtime_error("Shared frame transport is stopped");
+
+            // Replies to requests that timed out earlier only free their slots.
+            if (reply.type != SharedFrameMessageType::detectionsReady
+                || reply.sequence != sequence)
+            {
+                continue;
+            }
+
+            if (slot.state.load(std::memory_order_acquire) != SharedFrameSlotState::done)
+                throw std::runtime_error("Detections announced for a slot that is not done");
+            if (slot.status != 0)
+            {
+                isConnectionUsable = true;
+                throw std::runtime_error("The service failed to process the frame");
+            }
+
+            const size_t count =
+                std::min<size_t>(slot.detectionCount, kSharedFrameMaxDetections);
+            return std::vector<SharedDetection>(slot.detections, slot.detections + count);
+        }
+    }
+    catch (const std::exception&)
+    {
+        if (!isConnectionUsable)
+            disconnect();
+        throw;
+    }
+}
+
+void SharedFrameClient::stop()
+{
+    m_isStopped = true;
+    #if !defined(_WIN32)
+        const std::lock_guard<std::mutex> lock(m_socketMutex);
+        if (m_socket >= 0)
+            shutdown(m_socket, SHUT_RDWR); //< Wakes up infer(); the owner closes the socket.
+    #endif
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+int SharedFrameClient::findFreeSlot() const
+{
+    for (int i = 0; i < kSharedFrameSlotCount; ++i)
+    {
+        const int index = (m_nextSlot + i) % kSharedFrameSlotCount;
+        if (m_ring.slot(index).state.load(std::memory_order_acquire)
+            != SharedFrameSlotState::submitted)
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+void SharedFrameClient::disconnect()
+{
+    #if !defined(_WIN32)
+        const std::lock_guard<std::mutex> lock(m_socketMutex);
+        if (m_socket >= 0)
+            close(m_socket);
+        m_socket = -1;
+    #endif
+    m_ring = SharedFrameRing();
+    m_cameraId.clear();
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,80 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "shared_frame_ring.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Plugin side of the shared memory frame transport (see shared_frame_ring.h) for one camera.
+ *
+ * Used by one thread at a time; stop() may be called from any thread and aborts the request in
+ * flight. While the service does not listen on the socket, connection attempts are spaced by
+ * kReconnectPeriod, so that the caller can fall back to HTTP at no cost.
+ */
+class SharedFrameClient
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::seconds kReconnectPeriod{5};
+
+public:
+    explicit SharedFrameClient(std::string socketPath);
+    ~SharedFrameClient();
+
+    const std::string& socketPath() const { return m_socketPath; }
+
+    /**
+     * Connects and hands the segment over to the service unless already done for this camera.
+     * @return Whether infer() can be called.
+     */
+    bool ensureConnected(const std::string& cameraId);
+
+    /** Whether the image is 8-bit BGR and fits into a slot. */
+    static bool canTransfer(const cv::Mat& image);
+
+    /**
+     * Copies the image into a free slot and waits for its detections. If the transport fails (as
+     * opposed to a timeout or an error of the service) the connection is closed; the next
+     * ensureConnected() reopens it.
+     * @throws std::runtime_error On timeout, on a closed connection or after stop().
+     */
+    std::vector<SharedDetection> infer(const cv::Mat& image, std::chrono::milliseconds timeout);
+
+    /** Thread-safe. */
+    void stop();
+
+private:
+    int findFreeSlot() const;
+    void disconnect();
+
+private:
+    const std::string m_socketPath;
+
+    std::mutex m_socketMutex; //< Guards m_socket against stop() from another thread.
+    int m_socket = -1;
+    std::atomic<bool> m_isStopped{false};
+
+    SharedFrameRing m_ring;
+    std::string m_cameraId; //< Camera the service knows the connection by.
+    Clock::time_point m_nextConnectAttempt;
+    uint64_t m_nextSequence = 1;
+    int m_nextSlot = 0;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
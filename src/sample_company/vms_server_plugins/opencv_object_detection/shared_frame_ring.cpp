@@ -0,0 +1,258 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "shared_frame_ring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/mman.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+constexpr size_t kPixelAlignment = 64;
+
+constexpr size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr size_t kSlotPixelsOffset = alignUp(sizeof(SharedFrameSlotHeader), kPixelAlignment);
+constexpr size_t kSlotSize = alignUp(kSlotPixelsOffset + kSharedFrameMaxPixelBytes, 4096);
+constexpr size_t kSlotsOffset = alignUp(sizeof(SharedFrameRingHeader), 4096);
+constexpr size_t kSegmentSize = kSlotsOffset + kSlotSize * kSharedFrameSlotCount;
+
+std::runtime_error systemError(const std::string& what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+#if !defined(_WIN32)
+
+SharedFrameRing SharedFrameRing::create()
+{
+    static std::atomic<int> segmentCounter{0};
+
+    // Short: macOS limits the names to 31 characters.
+    const std::string name = "/safeaging-" + std::to_string((long) getpid()) + "-"
+        + std::to_string(segmentCounter.fetch_add(1));
+
+    // Group-readable: the service may run under another account of the group of the Server.
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0)
+        throw systemError("shm_open(" + name + ")");
+
+    if (ftruncate(fd, (off_t) kSegmentSize) != 0)
+    {
+        const std::runtime_error error = systemError("ftruncate(" + name + ")");
+        close(fd);
+        shm_unlink(name.c_str());
+        throw error;
+    }
+
+    void* const data = mmap(nullptr, kSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        const std::runtime_error error = systemError("mmap(" + name + ")");
+        shm_unlink(name.c_str());
+        throw error;
+    }
+
+    SharedFrameRing result(name, data, kSegmentSize);
+    result.m_isLinked = true;
+
+    SharedFrameRingHeader* const header = new (data) SharedFrameRingHeader();
+    header->slotSize = kSlotSize;
+    header->pixelCapacity = kSharedFrameMaxPixelBytes;
+    for (int i = 0; i < kSharedFrameSlotCount; ++i)
+        new (result.m_data + kSlotsOffset + kSlotSize * i) SharedFrameSlotHeader();
+
+    return result;
+}
+
+SharedFrameRing SharedFrameRing::open(const std::string& name)
+{
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        throw systemError("shm_open(" + name + ")");
+
+    struct stat status{};
+    if (fstat(fd, &status) != 0 || (size_t) status.st_size != kSegmentSize)
+    {
+        close(fd);
+        throw std::runtime_error("Shared frame segment " + name + " has an unexpected size");
+    }
+
+    void* const data = mmap(nullptr, kSegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        throw systemError("mmap(" + name + ")");
+
+    SharedFrameRing result(name, data, kSegmentSize);
+    const auto* header = (const SharedFrameRingHeader*) data;
+    if (header->magic != kSharedFrameMagic || header->version != kSharedFrameVersion
+        || header->slotCount != kSharedFrameSlotCount || header->slotSize != kSlotSize
+        || header->pixelCapacity != kSharedFrameMaxPixelBytes)
+    {
+        throw std::runtime_error("Shared frame segment " + name + " has an unexpected layout");
+    }
+    return result;
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+    unlink();
+    if (m_data)
+        munmap(m_data, m_size);
+}
+
+void SharedFrameRing::unlink()
+{
+    if (m_isLinked)
+        shm_unlink(m_name.c_str());
+    m_isLinked = false;
+}
+
+void sendSharedFrameBytes(int socket, const void* data, size_t size)
+{
+    #if defined(MSG_NOSIGNAL)
+        constexpr int kFlags = MSG_NOSIGNAL; //< A closed peer is an error, not a SIGPIPE.
+    #else
+        constexpr int kFlags = 0; //< macOS: the socket is created with SO_NOSIGPIPE.
+    #endif
+
+    const auto* bytes = (const uint8_t*) data;
+    while (size > 0)
+    {
+        const ssize_t sent = send(socket, bytes, size, kFlags);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            throw systemError("Shared frame socket send");
+        bytes += sent;
+        size -= (size_t) sent;
+    }
+}
+
+bool receiveSharedFrameBytes(
+    int socket, void* data, size_t size, std::chrono::milliseconds timeout)
+{
+    auto* bytes = (uint8_t*) data;
+    bool isStarted = false;
+    while (size > 0)
+    {
+        pollfd descriptor{socket, POLLIN, 0};
+        const int ready = poll(&descriptor, 1, (int) timeout.count());
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready < 0)
+            throw systemError("Shared frame socket poll");
+        if (ready == 0)
+        {
+            if (!isStarted)
+                return false;
+            throw std::runtime_error("Shared frame socket: truncated message");
+        }
+
+        const ssize_t received = recv(socket, bytes, size, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received == 0)
+            throw std::runtime_error("Shared frame socket closed by the peer");
+        if (received < 0)
+            throw systemError("Shared frame socket receive");
+        isStarted = true;
+        bytes += received;
+        size -= (size_t) received;
+    }
+    return true;
+}
+
+#else // defined(_WIN32)
+
+SharedFrameRing SharedFrameRing::create()
+{
+    throw std::runtime_error("Shared frame transport is not supported on Windows");
+}
+
+SharedFrameRing SharedFrameRing::open(const std::string& /*name*/)
+{
+    throw std::runtime_error("Shared frame transport is not supported on Windows");
+}
+
+SharedFrameRing::~SharedFrameRing() = default;
+
+void SharedFrameRing::unlink()
+{
+}
+
+void sendSharedFrameBytes(int /*socket*/, const void* /*data*/, size_t /*size*/)
+{
+    throw std::runtime_error("Shared frame transport is not supported on Windows");
+}
+
+bool receiveSharedFrameBytes(
+    int /*socket*/, void* /*data*/, size_t /*size*/, std::chrono::milliseconds /*timeout*/)
+{
+    throw std::runtime_error("Shared frame transport is not supported on Windows");
+}
+
+#endif // !defined(_WIN32)
+
+SharedFrameRing::SharedFrameRing(std::string name, void* data, size_t size):
+    m_name(std::move(name)),
+    m_data((uint8_t*) data),
+    m_size(size)
+{
+}
+
+SharedFrameRing::SharedFrameRing(SharedFrameRing&& other) noexcept:
+    m_name(std::move(other.m_name)),
+    m_isLinked(std::exchange(other.m_isLinked, false)),
+    m_data(std::exchange(other.m_data, nullptr)),
+    m_size(std::exchange(other.m_size, 0))
+{
+}
+
+SharedFrameRing& SharedFrameRing::operator=(SharedFrameRing&& other) noexcept
+{
+    if (this != &other)
+    {
+        SharedFrameRing discarded(std::move(*this));
+        m_name = std::move(other.m_name);
+        m_isLinked = std::exchange(other.m_isLinked, false);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+SharedFrameSlotHeader& SharedFrameRing::slot(int index) const
+{
+    return *(SharedFrameSlotHeader*) (m_data + kSlotsOffset + kSlotSize * (size_t) index);
+}
+
+uint8_t* SharedFrameRing::pixels(int index) const
+{
+    return m_data + kSlotsOffset + kSlotSize * (size_t) index + kSlotPixelsOffset;
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
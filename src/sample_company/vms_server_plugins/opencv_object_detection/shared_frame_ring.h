@@ -0,0 +1,179 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Same-host frame transport between the plugin and the inference service.
+ *
+ * The plugin creates a POSIX shared memory segment per camera: a header followed by a ring of
+ * slots, each holding a BGR frame and the detections found on it. The plugin connects to the
+ * Unix domain socket of the service and sends a SharedFrameHello naming the segment; after that,
+ * each frame costs one memcpy into a slot and one 16-byte message each way:
+ * - plugin: writes the pixels, sets the slot state to submitted, sends frameSubmitted;
+ * - service: reads the pixels in place, writes the detections into the slot, sets the state to
+ *   done, sends detectionsReady.
+ * A slot whose request timed out stays submitted until the service is done with it, so the
+ * plugin never overwrites pixels the service may still be reading.
+ *
+ * The socket rather than an eventfd carries the notifications: it works on all POSIX systems,
+ * and either side sees the other one going away as end-of-file.
+ *
+ * Not available on Windows: kIsSharedFrameTransportSupported is false, and the plugin keeps
+ * sending JPEGs over HTTP.
+ */
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+#if defined(_WIN32)
+    constexpr bool kIsSharedFrameTransportSupported = false;
+#else
+    constexpr bool kIsSharedFrameTransportSupported = true;
+#endif
+
+constexpr uint32_t kSharedFrameMagic = 0x53414652; //< "SAFR".
+constexpr uint32_t kSharedFrameVersion = 1;
+
+constexpr int kSharedFrameSlotCount = 3;
+constexpr int kSharedFrameMaxDetections = 64;
+constexpr int kSharedFrameKeypointCount = 17; //< COCO pose layout.
+
+/**
+ * Largest frame a slot holds: the encodeWidth setting goes up to 1920. Only the pages actually
+ * written are committed, so a 640-pixel stream uses about 1 MB per slot.
+ */
+constexpr size_t kSharedFrameMaxPixelBytes = 1920 * 1920 * 3;
+
+enum class SharedFrameSlotState: uint32_t
+{
+    idle, //< Owned by the plugin.
+    submitted, //< Owned by the service.
+    done, //< Owned by the plugin; the detections are valid.
+};
+
+static_assert(std::atomic<SharedFrameSlotState>::is_always_lock_free,
+    "Slot state is shared between processes and must be lock-free.");
+
+/** One person, in pixels of the submitted frame. */
+struct SharedDetection
+{
+    float x = 0;
+    float y = 0;
+    float width = 0;
+    float height = 0;
+    float score = 0;
+    int32_t classId = 0; //< COCO.
+    int32_t trackId = 0;
+    uint8_t isFallDetected = 0;
+    uint8_t hasKeypoints = 0;
+    uint8_t reserved[2] = {};
+    float keypoints[kSharedFrameKeypointCount][3] = {}; //< x, y, confidence.
+};
+
+struct SharedFrameSlotHeader
+{
+    std::atomic<SharedFrameSlotState> state{SharedFrameSlotState::idle};
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t stride = 0; //< Bytes per row of pixels.
+    uint64_t sequence = 0; //< Of the request; echoed in detectionsReady.
+    int32_t status = 0; //< 0 if the detections are valid.
+    uint32_t detectionCount = 0;
+    SharedDetection detections[kSharedFrameMaxDetections];
+};
+
+struct SharedFrameRingHeader
+{
+    uint32_t magic = kSharedFrameMagic;
+    uint32_t version = kSharedFrameVersion;
+    uint32_t slotCount = kSharedFrameSlotCount;
+    uint32_t reserved = 0;
+    uint64_t slotSize = 0; //< Bytes from one slot header to the next.
+    uint64_t pixelCapacity = 0; //< Bytes of pixels per slot.
+};
+
+/** First message of a connection; the service answers with helloAccepted or closes. */
+struct SharedFrameHello
+{
+    uint32_t magic = kSharedFrameMagic;
+    uint32_t version = kSharedFrameVersion;
+    char segmentName[64] = {}; //< For shm_open().
+    char cameraId[128] = {};
+};
+
+enum class SharedFrameMessageType: uint32_t
+{
+    helloAccepted,
+    frameSubmitted,
+    detectionsReady,
+};
+
+struct SharedFrameMessage
+{
+    SharedFrameMessageType type = SharedFrameMessageType::frameSubmitted;
+    uint32_t slotIndex = 0;
+    uint64_t sequence = 0;
+};
+
+/**
+ * Mapping of a frame ring segment. The plugin creates it, the service opens it by name. Both
+ * sides check the layout, so neither trusts sizes read from memory the other process can write.
+ */
+class SharedFrameRing
+{
+public:
+    /**
+     * Creates a new segment with a unique name. The name should be unlinked once the service has
+     * opened it: the memory then goes away with the last of the two processes.
+     * @throws std::runtime_error
+     */
+    static SharedFrameRing create();
+
+    /** @throws std::runtime_error If the segment is missing or its layout is not the expected one. */
+    static SharedFrameRing open(const std::string& name);
+
+    SharedFrameRing() = default;
+    SharedFrameRing(SharedFrameRing&& other) noexcept;
+    SharedFrameRing& operator=(SharedFrameRing&& other) noexcept;
+    ~SharedFrameRing();
+
+    bool isMapped() const { return m_data != nullptr; }
+    const std::string& name() const { return m_name; }
+
+    /** Removes the name; the mapping stays valid. */
+    void unlink();
+
+    SharedFrameSlotHeader& slot(int index) const;
+    uint8_t* pixels(int index) const;
+
+private:
+    SharedFrameRing(std::string name, void* data, size_t size);
+
+private:
+    std::string m_name;
+    bool m_isLinked = false;
+    uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+/** @throws std::runtime_error If the socket is closed or fails. */
+void sendSharedFrameBytes(int socket, const void* data, size_t size);
+
+/**
+ * Waits for a message.
+ * @return False on timeout.
+ * @throws std::runtime_error If the socket is closed or fails.
+ */
+bool receiveSharedFrameBytes(
+    int socket, void* data, size_t size, std::chrono::milliseconds timeout);
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
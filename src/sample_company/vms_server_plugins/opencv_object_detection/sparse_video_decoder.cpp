@@ -0,0 +1,303 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "sparse_video_decoder.h"
+
+// Compiled into the plugin with the "useCompressedFrames" CMake option only.
+#if defined(PLUGIN_USE_COMPRESSED_FRAMES)
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/mem.h>
+#include <libswscale/swscale.h>
+}
+
+#include "logger.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+/** Smaller differences, like 1920x1088 against 16:9, are padding rather than another geometry. */
+constexpr double kAspectRatioTolerance = 0.02;
+
+const AVCodec* findDecoder(const std::string& codec)
+{
+    std::string name = codec;
+    std::transform(name.begin(), name.end(), name.begin(),
+        [](unsigned char c) { return (char) std::tolower(c); });
+    if (name == "h265")
+        name = "hevc";
+    return avcodec_find_decoder_by_name(name.c_str());
+}
+
+std::string errorString(int error)
+{
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(error, buffer, sizeof(buffer));
+    return buffer;
+}
+
+} // namespace
+
+SparseVideoDecoder::~SparseVideoDecoder()
+{
+    close();
+}
+
+std::vector<SparseVideoDecoder::DecodedFrame> SparseVideoDecoder::decode(
+    const Packet& packet,
+    bool isWanted,
+    bool isKeyFrameMode,
+    int targetWidth,
+    double aspectRatio,
+    PipelineStats* stats)
+{
+    std::vector<DecodedFrame> result;
+
+    if (isKeyFrameMode != m_isKeyFrameMode)
+    {
+        m_isKeyFrameMode = isKeyFrameMode;
+        // The frames up to the next key frame reference the skipped ones.
+        if (!isKeyFrameMode)
+            m_isWaitingForKeyFrame = true;
+    }
+
+    if (packet.isKeyFrame)
+    {
+        // A new decoder only at a key frame, which needs nothing from the previous one.
+        const int lowres = lowresFor(packet, targetWidth);
+        if (!m_context || packet.codec != m_codec || lowres != m_lowres)
+            open(packet, lowres);
+        m_isWaitingForKeyFrame = false;
+        m_streamWidth = packet.width;
+        m_streamHeight = packet.height;
+    }
+
+    if (!m_context || m_isWaitingForKeyFrame || (m_isKeyFrameMode && !packet.isKeyFrame)
+        || !packet.data || packet.size <= 0)
+    {
+        return result;
+    }
+
+    // Nothing after the frame depends on it.
+    if (!isWanted && (m_isKeyFrameMode || m_isIntraOnly))
+        return result;
+
+    const auto decodeStart = PipelineStats::Clock::now();
+
+    if (isWanted)
+    {
+        m_wantedTimestamps.push_back(packet.timestampUs);
+        if (m_wantedTimestamps.size() > kMaxWantedTimestampCount)
+            m_wantedTimestamps.pop_front();
+    }
+
+    // Read by the decoder for each frame: unwanted frames are decoded only if referenced.
+    m_context->skip_frame = isWanted ? AVDISCARD_DEFAULT : AVDISCARD_NONREF;
+
+    // Not reference-counted: avcodec_send_packet() copies the data, with the padding it needs.
+    m_packet->data = const_cast<uint8_t*>(packet.data);
+    m_packet->size = packet.size;
+    m_packet->pts = packet.timestampUs;
+    m_packet->dts = AV_NOPTS_VALUE;
+    m_packet->flags = packet.isKeyFrame ? AV_PKT_FLAG_KEY : 0;
+    const int error = avcodec_send_packet(m_context, m_packet);
+    m_packet->data = nullptr;
+    m_packet->size = 0;
+
+    if (error == AVERROR_INVALIDDATA)
+    {
+        PLUGIN_LOG(warning, 0.1, "Corrupted %s packet skipped", m_codec.c_str());
+    }
+    else if (error < 0 && error != AVERROR(EAGAIN))
+    {
+        close();
+        throw std::runtime_error("Cannot decode " + packet.codec + ": " + errorString(error));
+    }
+
+    // Key frames alone: drain the decoder so that it does not hold the frame back until the
+    // next key frame to reorder it.
+    if (m_isKeyFrameMode)
+        avcodec_send_packet(m_context, nullptr);
+
+    PipelineStats::Clock::duration conversionTime{};
+    receiveFrames(targetWidth, aspectRatio, stats, &result, &conversionTime);
+
+    if (m_isKeyFrameMode)
+        avcodec_flush_buffers(m_context);
+
+    if (stats)
+    {
+        stats->record(PipelineStage::videoDecode,
+            PipelineStats::Clock::now() - decodeStart - conversionTime);
+    }
+    return result;
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void SparseVideoDecoder::open(const Packet& packet, int lowres)
+{
+    close();
+
+    const AVCodec* codec = findDecoder(packet.codec);
+    if (!codec)
+        throw std::runtime_error("Unsupported video codec: " + packet.codec);
+
+    m_context = avcodec_alloc_context3(codec);
+    if (!m_context)
+        throw std::runtime_error("Cannot allocate a " + packet.codec + " decoder");
+
+    if (packet.extradata && packet.extradataSize > 0)
+    {
+        m_context->extradata = (uint8_t*) av_mallocz(
+            (size_t) packet.extradataSize + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (m_context->extradata)
+        {
+            std::memcpy(m_context->extradata, packet.extradata, (size_t) packet.extradataSize);
+            m_context->extradata_size = packet.extradataSize;
+        }
+    }
+    m_context->lowres = lowres;
+    // One camera per frame thread is parallel enough; frame threading would also hold frames
+    // back and apply skip_frame to later ones.
+    m_context->thread_count = 1;
+
+    const int error = avcodec_open2(m_context, codec, nullptr);
+    if (error < 0)
+    {
+        close();
+        throw std::runtime_error("Cannot open the " + packet.codec + " decoder: "
+            + errorString(error));
+    }
+
+    m_packet = av_packet_alloc();
+    m_frame = av_frame_alloc();
+    if (!m_packet || !m_frame)
+    {
+        close();
+        throw std::runtime_error("Cannot allocate a " + packet.codec + " frame");
+    }
+
+    m_codec = packet.codec;
+    m_lowres = lowres;
+    const AVCodecDescriptor* descriptor = avcodec_descriptor_get(codec->id);
+    m_isIntraOnly = descriptor && (descriptor->props & AV_CODEC_PROP_INTRA_ONLY);
+    m_wantedTimestamps.clear();
+    PLUGIN_LOG(info, 0, "Decoding %s in the plugin at 1/%d resolution",
+        m_codec.c_str(), 1 << m_lowres);
+}
+
+void SparseVideoDecoder::close()
+{
+    sws_freeContext(m_swsContext);
+    m_swsContext = nullptr;
+    av_frame_free(&m_frame);
+    av_packet_free(&m_packet);
+    avcodec_free_context(&m_context);
+    m_codec.clear();
+    m_lowres = 0;
+    m_isIntraOnly = false;
+    m_isWaitingForKeyFrame = true;
+}
+
+int SparseVideoDecoder::lowresFor(const Packet& packet, int targetWidth) const
+{
+    const AVCodec* codec = findDecoder(packet.codec);
+    // The stream size is needed to report it for the reduced frames.
+    if (!codec || packet.width <= 0 || packet.height <= 0)
+        return 0;
+
+    int lowres = 0;
+    while (lowres < codec->max_lowres && (packet.width >> (lowres + 1)) >= targetWidth)
+        ++lowres;
+    return lowres;
+}
+
+void SparseVideoDecoder::receiveFrames(
+    int targetWidth,
+    double aspectRatio,
+    PipelineStats* stats,
+    std::vector<DecodedFrame>* outFrames,
+    PipelineStats::Clock::duration* outConversionTime)
+{
+    while (avcodec_receive_frame(m_context, m_frame) == 0)
+    {
+        const int64_t timestampUs = m_frame->best_effort_timestamp != AV_NOPTS_VALUE
+            ? m_frame->best_effort_timestamp
+            : m_frame->pts;
+
+        // Frames come out in presentation order, so earlier wanted ones will never come. The
+        // timestamps were queued in decode order: with B frames, later ones may precede this one.
+        const bool isWanted = std::find(
+            m_wantedTimestamps.begin(), m_wantedTimestamps.end(), timestampUs)
+                != m_wantedTimestamps.end();
+        m_wantedTimestamps.erase(
+            std::remove_if(m_wantedTimestamps.begin(), m_wantedTimestamps.end(),
+                [timestampUs](int64_t wanted) { return wanted <= timestampUs; }),
+            m_wantedTimestamps.end());
+        if (isWanted)
+        {
+
+            const auto conversionStart = PipelineStats::Clock::now();
+            outFrames->push_back(convert(timestampUs, targetWidth, aspectRatio));
+            const auto conversionTime = PipelineStats::Clock::now() - conversionStart;
+            *outConversionTime += conversionTime;
+            if (stats)
+                stats->record(PipelineStage::frameConversion, conversionTime);
+        }
+        av_frame_unref(m_frame);
+    }
+}
+
+SparseVideoDecoder::DecodedFrame SparseVideoDecoder::convert(
+    int64_t timestampUs, int targetWidth, double aspectRatio)
+{
+    const int width = m_frame->width;
+    const int height = m_frame->height;
+    const double frameAspectRatio = (double) width / height;
+    const bool isReshaped =
+        aspectRatio > 0 && std::abs(aspectRatio / frameAspectRatio - 1) > kAspectRatioTolerance;
+
+    const int newWidth = std::min(targetWidth, width);
+    const int newHeight = std::max(1,
+        (int) std::round(newWidth / (isReshaped ? aspectRatio : frameAspectRatio)));
+
+    m_swsContext = sws_getCachedContext(m_swsContext,
+        width, height, (AVPixelFormat) m_frame->format,
+        newWidth, newHeight, AV_PIX_FMT_BGR24,
+        SWS_AREA, nullptr, nullptr, nullptr);
+    if (!m_swsContext)
+    {
+        throw std::runtime_error(
+            "Unsupported decoded pixel format " + std::to_string(m_frame->format));
+    }
+
+    DecodedFrame result;
+    result.image.create(newHeight, newWidth, CV_8UC3);
+    uint8_t* const destination[] = {result.image.data};
+    const int destinationStride[] = {(int) result.image.step};
+    sws_scale(m_swsContext, m_frame->data, m_frame->linesize, 0, height,
+        destination, destinationStride);
+
+    result.timestampUs = timestampUs;
+    // Not width << m_lowres: lowres rounds odd sizes up.
+    result.width = m_lowres > 0 ? m_streamWidth : width;
+    result.height = m_lowres > 0 ? m_streamHeight : height;
+    return result;
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
+
+#endif // defined(PLUGIN_USE_COMPRESSED_FRAMES)
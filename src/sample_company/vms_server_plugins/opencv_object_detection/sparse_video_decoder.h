@@ -0,0 +1,126 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "pipeline_stats.h"
+
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Decodes the compressed video of one camera in the plugin, built with the "useCompressedFrames"
+ * CMake option (FFmpeg), so that decoding is paid for the analyzed frames only instead of the
+ * Server decoding every frame.
+ *
+ * - Unwanted frames that nothing references (e.g. B frames) are skipped by the decoder; reference
+ *   frames are still decoded, because the wanted frames after them depend on them.
+ * - In key frame mode (idle scene, service down) only wanted key frames reach the decoder.
+ *   Leaving the mode takes effect at the next key frame, the first one decodable without the
+ *   skipped ones. With intra-only codecs (MJPEG) only wanted frames are ever decoded.
+ * - Codecs that support it (MJPEG) decode at a reduced resolution (lowres) still at least as
+ *   wide as the image sent for inference; the color conversion downscales the rest in the same
+ *   pass, so there is no separate resize.
+ *
+ * Not thread-safe: used on the frame thread of the DeviceAgent.
+ */
+class SparseVideoDecoder
+{
+public:
+    struct Packet
+    {
+        std::string codec; //< As reported by the Server, e.g. "H264", "HEVC", "MJPEG".
+        const uint8_t* data = nullptr;
+        int size = 0;
+        const uint8_t* extradata = nullptr; //< Codec parameters given out of band, if any.
+        int extradataSize = 0;
+        int64_t timestampUs = 0;
+        bool isKeyFrame = false;
+        int width = 0; //< Of the stream; 0 if unknown.
+        int height = 0;
+    };
+
+    struct DecodedFrame
+    {
+        cv::Mat image; //< BGR, downscaled.
+        int64_t timestampUs = 0;
+        int width = 0; //< Of the stream, before lowres decoding and downscaling.
+        int height = 0;
+    };
+
+public:
+    SparseVideoDecoder() = default;
+    ~SparseVideoDecoder();
+
+    SparseVideoDecoder(const SparseVideoDecoder&) = delete;
+    SparseVideoDecoder& operator=(const SparseVideoDecoder&) = delete;
+
+    /**
+     * @param isWanted The frame of this packet is to be analyzed.
+     * @param isKeyFrameMode Decode key frames only.
+     * @param targetWidth Width of the returned images; narrower frames keep their width.
+     * @param aspectRatio If positive, the width / height of the returned images (see
+     *     downscaleFrame()).
+     * @param stats If not null, receives the videoDecode and frameConversion stage timings.
+     * @return The wanted frames that came out of the decoder: usually none or this packet's one;
+     *     with B frames, that of an earlier packet.
+     * @throws std::runtime_error If the codec is not supported or the decoder fails.
+     */
+    std::vector<DecodedFrame> decode(
+        const Packet& packet,
+        bool isWanted,
+        bool isKeyFrameMode,
+        int targetWidth,
+        double aspectRatio = 0,
+        PipelineStats* stats = nullptr);
+
+private:
+    void open(const Packet& packet, int lowres);
+    void close();
+
+    /** Largest reduction (as a power of 2) the codec supports that keeps targetWidth. */
+    int lowresFor(const Packet& packet, int targetWidth) const;
+
+    void receiveFrames(
+        int targetWidth,
+        double aspectRatio,
+        PipelineStats* stats,
+        std::vector<DecodedFrame>* outFrames,
+        PipelineStats::Clock::duration* outConversionTime);
+
+    DecodedFrame convert(int64_t timestampUs, int targetWidth, double aspectRatio);
+
+private:
+    /** Timestamps of wanted packets not yet out of the decoder are forgotten beyond this. */
+    static constexpr size_t kMaxWantedTimestampCount = 16;
+
+    AVCodecContext* m_context = nullptr;
+    AVPacket* m_packet = nullptr;
+    AVFrame* m_frame = nullptr;
+    SwsContext* m_swsContext = nullptr;
+
+    std::string m_codec;
+    int m_lowres = 0;
+    int m_streamWidth = 0; //< From the last key frame packet; lowres rounds odd sizes up.
+    int m_streamHeight = 0;
+    bool m_isIntraOnly = false; //< Every frame is a key frame, e.g. MJPEG.
+    bool m_isWaitingForKeyFrame = true;
+    bool m_isKeyFrameMode = false;
+    std::deque<int64_t> m_wantedTimestamps;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
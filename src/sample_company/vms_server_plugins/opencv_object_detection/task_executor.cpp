@@ -0,0 +1,136 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "task_executor.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "logger.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+namespace {
+
+// Which pool (and which of its threads) the current thread belongs to; lets post() from inside
+// a task stay on the same thread.
+thread_local const TaskExecutor* tlsExecutor = nullptr;
+thread_local size_t tlsWorkerIndex = 0;
+
+} // namespace
+
+TaskExecutor::TaskExecutor(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = std::max(2, (int) std::thread::hardware_concurrency());
+
+    m_workers.reserve((size_t) threadCount);
+    for (int i = 0; i < threadCount; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+
+    // Threads are started only after all queues exist: they steal from each other right away.
+    for (size_t i = 0; i < m_workers.size(); ++i)
+        m_workers[i]->thread = std::thread(&TaskExecutor::run, this, i);
+}
+
+TaskExecutor::~TaskExecutor()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+
+    for (const auto& worker: m_workers)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+}
+
+void TaskExecutor::post(Task task)
+{
+    const size_t workerIndex = tlsExecutor == this
+        ? tlsWorkerIndex
+        : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+
+    {
+        Worker& worker = *m_workers[workerIndex];
+        const std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_pendingTaskCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_wakeUp.notify_one();
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+void TaskExecutor::run(size_t workerIndex)
+{
+    tlsExecutor = this;
+    tlsWorkerIndex = workerIndex;
+
+    Task task;
+    while (true)
+    {
+        if (tryTakeTask(workerIndex, &task))
+        {
+            m_pendingTaskCount.fetch_sub(1, std::memory_order_relaxed);
+            try
+            {
+                task();
+            }
+            catch (const std::exception& e)
+            {
+                PLUGIN_LOG(error, 1, "Task failed: %s", e.what());
+            }
+            task = nullptr; //< Release the captures before sleeping.
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wakeUp.wait(lock,
+            [this]() { return m_pendingTaskCount.load(std::memory_order_relaxed) > 0 || m_stopping; });
+        if (m_stopping && m_pendingTaskCount.load(std::memory_order_relaxed) == 0)
+            return;
+    }
+}
+
+bool TaskExecutor::tryTakeTask(size_t workerIndex, Task* outTask)
+{
+    {
+        Worker& own = *m_workers[workerIndex];
+        const std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            *outTask = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    // Thieves take the oldest task too: a queue stuck behind a blocked thread must not keep
+    // skipping its oldest camera while newer ones are stolen.
+    for (size_t i = 1; i < m_workers.size(); ++i)
+    {
+        Worker& victim = *m_workers[(workerIndex + i) % m_workers.size()];
+        const std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            *outTask = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
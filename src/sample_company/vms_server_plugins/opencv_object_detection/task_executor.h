@@ -0,0 +1,71 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Fixed pool of threads shared by all DeviceAgents of an Engine. Every thread has its own FIFO
+ * queue; tasks posted from a pool thread go to that thread's queue, others are spread
+ * round-robin, and a thread whose queue is empty steals the oldest task of another queue, so a
+ * thread blocked in a long task does not hold back the cameras queued behind it.
+ *
+ * The executor does not serialize anything: a DeviceAgent keeps at most one task of its own
+ * posted at a time and re-posts it after each frame, which both keeps its state single-threaded
+ * and makes the cameras take turns.
+ */
+class TaskExecutor
+{
+public:
+    using Task = std::function<void()>;
+
+public:
+    /** @param threadCount 0 means one thread per hardware core (at least 2). */
+    explicit TaskExecutor(int threadCount = 0);
+
+    /** Runs the tasks already posted, then joins the threads. */
+    ~TaskExecutor();
+
+    TaskExecutor(const TaskExecutor&) = delete;
+    TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+    int threadCount() const { return (int) m_workers.size(); }
+
+    void post(Task task);
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void run(size_t workerIndex);
+    bool tryTakeTask(size_t workerIndex, Task* outTask);
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_nextWorker{0};
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+    std::atomic<int64_t> m_pendingTaskCount{0}; //< Incremented under m_sleepMutex.
+    bool m_stopping = false;
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,32 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <nx/sdk/uuid.h>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+
+/**
+ * Hash for using nx::sdk::Uuid as a key of unordered containers. Track ids are random UUIDs, so
+ * folding the two 64-bit halves is enough.
+ */
+struct UuidHash
+{
+    size_t operator()(const nx::sdk::Uuid& uuid) const
+    {
+        uint64_t halves[2];
+        static_assert(sizeof(halves) == nx::sdk::Uuid::kSize, "Unexpected Uuid size.");
+        std::memcpy(halves, uuid.data(), sizeof(halves));
+        return (size_t) (halves[0] ^ (halves[1] * 0x9E3779B97F4A7C15ULL));
+    }
+};
+
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,76 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+namespace {
+
+thread_local bool t_countingEnabled = false;
+std::atomic<uint64_t> g_allocationCount{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+void* allocate(size_t size)
+{
+    if (t_countingEnabled)
+    {
+        g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+        g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+} // namespace
+
+void AllocationCounter::setEnabledForThisThread(bool enabled)
+{
+    t_countingEnabled = enabled;
+}
+
+uint64_t AllocationCounter::allocationCount()
+{
+    return g_allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::allocatedBytes()
+{
+    return g_allocatedBytes.load(std::memory_order_relaxed);
+}
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
+
+using sample_company::vms_server_plugins::opencv_object_detection::perf::allocate;
+
+void* operator new(size_t size)
+{
+    if (void* result = allocate(size))
+        return result;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (void* result = allocate(size))
+        return result;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
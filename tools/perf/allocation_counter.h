@@ -0,0 +1,29 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstdint>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+/**
+ * Counts global operator new calls made by the threads that enabled counting. Linking
+ * allocation_counter.cpp replaces the global allocation functions of the executable.
+ */
+class AllocationCounter
+{
+public:
+    /** Enables or disables counting for the calling thread. */
+    static void setEnabledForThisThread(bool enabled);
+
+    static uint64_t allocationCount();
+    static uint64_t allocatedBytes();
+};
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,401 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+/**
+ * Headless load test: one Engine, N simulated cameras pushing frames at M fps into their
+ * DeviceAgents, each with a MetadataSink in place of the Server. Answers "how many cameras does
+ * this box sustain": with --ramp, runs 1..N cameras (in --step increments) and stops at the first
+ * count where the agents drop more than --max-drop-percent of the frames they should analyze,
+ * or the frame callback can no longer keep up with the frame rate.
+ *
+ * By default /infer is served by an in-process mock (see MockInferServer), so the numbers
+ * describe the plugin itself; --no-mock sends the frames to the real service instead. Drop
+ * accounting assumes every analyzed frame yields objects, which holds for the mock, and that the
+ * Engine's inference budget does not limit sampling, so the budget is unlimited unless --budget
+ * is given.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nx/sdk/analytics/i_consuming_device_agent.h>
+#include <nx/sdk/helpers/device_info.h>
+#include <nx/sdk/helpers/string_map.h>
+#include <nx/sdk/ptr.h>
+
+#include "device_agent_settings.h"
+#include "engine.h"
+#include "latency_histogram.h"
+#include "metadata_sink.h"
+#include "mock_infer_server.h"
+#include "mock_video_frame.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+namespace {
+
+using namespace nx::sdk;
+using namespace nx::sdk::analytics;
+using Clock = std::chrono::steady_clock;
+
+/** The agents run with default settings: they analyze every n-th frame. */
+const int kDetectionFramePeriod = DeviceAgentSettings().samplingPeriod;
+
+struct Options
+{
+    int cameraCount = 4;
+    bool ramp = false;
+    int rampStep = 1;
+    double fps = 15.0;
+    int durationS = 20;
+    std::string inputPath; //< Empty: synthetic frames.
+    MockVideoFrame::Format format = MockVideoFrame::Format::yv12;
+    int width = 1920;
+    int height = 1080;
+    bool useMock = true;
+    MockInferServerSettings server;
+    double maxDropPercent = 5.0;
+    double inferencesPerSecond = 0; //< Engine inference budget; 0 means unlimited.
+};
+
+void printUsage()
+{
+    std::cout <<
+        "Usage: load_test [options]\n"
+        "  --cameras <n>           Simulated cameras (default 4).\n"
+        "  --ramp                  Run 1..n cameras and report the highest sustained count.\n"
+        "  --step <n>              Camera increment of --ramp (default 1).\n"
+        "  --fps <m>               Frames per second per camera (default 15).\n"
+        "  --duration <s>          Seconds per run (default 20).\n"
+        "  --input <file>          Raw frames to replay (looped); synthetic if omitted.\n"
+        "  --format <name>         rgb, bgr, bgra, rgba or yv12 (default yv12).\n"
+        "  --width <px>            Frame width (default 1920).\n"
+        "  --height <px>           Frame height (default 1080).\n"
+        "  --detections <n>        Persons returned by the mock /infer (default 3).\n"
+        "  --infer-latency-us <us> Simulated inference time of the mock (default 20000).\n"
+        "  --no-mock               Use the service already listening on 127.0.0.1:18000.\n"
+        "  --max-drop-percent <p>  Drop rate still considered sustained (default 5).\n"
+        "  --budget <ips>          Engine inference budget per second (default 0, unlimited);\n"
+        "                          frames the budget skips then show up as drops.\n";
+}
+
+bool parseOptions(int argc, char** argv, Options* options)
+{
+    options->server.inferenceLatency = std::chrono::microseconds(20'000);
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+            return false;
+        if (arg == "--ramp")
+        {
+            options->ramp = true;
+            continue;
+        }
+        if (arg == "--no-mock")
+        {
+            options->useMock = false;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+
+        const std::string value = argv[++i];
+        if (arg == "--cameras")
+            options->cameraCount = std::atoi(value.c_str());
+        else if (arg == "--step")
+            options->rampStep = std::atoi(value.c_str());
+        else if (arg == "--fps")
+            options->fps = std::atof(value.c_str());
+        else if (arg == "--duration")
+            options->durationS = std::atoi(value.c_str());
+        else if (arg == "--input")
+            options->inputPath = value;
+        else if (arg == "--format")
+        {
+            if (!MockVideoFrame::formatFromString(value, &options->format))
+            {
+                std::cerr << "Unknown format: " << value << "\n";
+                return false;
+            }
+        }
+        else if (arg == "--width")
+            options->width = std::atoi(value.c_str());
+        else if (arg == "--height")
+            options->height = std::atoi(value.c_str());
+        else if (arg == "--detections")
+            options->server.detectionCount = std::atoi(value.c_str());
+        else if (arg == "--infer-latency-us")
+            options->server.inferenceLatency = std::chrono::microseconds(std::atoll(value.c_str()));
+        else if (arg == "--max-drop-percent")
+            options->maxDropPercent = std::atof(value.c_str());
+        else if (arg == "--budget")
+            options->inferencesPerSecond = std::atof(value.c_str());
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (options->cameraCount <= 0 || options->rampStep <= 0 || options->fps <= 0.0
+        || options->durationS <= 0 || options->width <= 1 || options->height <= 1
+        || options->width % 2 != 0 || options->height % 2 != 0)
+    {
+        std::cerr << "Invalid camera count, step, fps, duration or frame size.\n";
+        return false;
+    }
+    return true;
+}
+
+struct Camera
+{
+    Ptr<MetadataSink> sink; //< Declared first: must outlive the agent that calls it.
+    Ptr<IConsumingDeviceAgent> deviceAgent;
+    std::thread pump;
+    int64_t pushedFrameCount = 0;
+    int64_t lateFrameCount = 0; //< Frames pushed more than one interval after their due time.
+    LatencyHistogram pushLatency; //< Duration of pushDataPacket(), i.e. of the frame callback.
+};
+
+struct RunResult
+{
+    int cameraCount = 0;
+    double achievedFps = 0.0; //< Per camera.
+    double dropPercent = 0.0;
+    double latePercent = 0.0;
+    int64_t pushP99Us = 0;
+    int64_t metadataP50Us = 0;
+    int64_t metadataP99Us = 0;
+    int64_t warningCount = 0;
+    int64_t errorCount = 0;
+    bool sustained = false;
+};
+
+std::unique_ptr<Camera> makeCamera(Engine* engine, int index, Clock::time_point epoch)
+{
+    auto camera = std::make_unique<Camera>();
+    camera->sink = makePtr<MetadataSink>(epoch);
+
+    const auto deviceInfo = makePtr<DeviceInfo>();
+    deviceInfo->setId("load_test_camera_" + std::to_string(index));
+    deviceInfo->setName("Load test camera " + std::to_string(index));
+
+    const Result<IDeviceAgent*> result = engine->obtainDeviceAgent(deviceInfo.get());
+    if (!result.isOk() || !result.value())
+        throw std::runtime_error("Engine did not create a DeviceAgent");
+    const auto deviceAgent = Ptr<IDeviceAgent>(result.value());
+
+    camera->deviceAgent = deviceAgent->queryInterface<IConsumingDeviceAgent>();
+    if (!camera->deviceAgent)
+        throw std::runtime_error("DeviceAgent does not consume frames");
+    camera->deviceAgent->setHandler(camera->sink.get());
+    return camera;
+}
+
+void pumpFrames(
+    Camera* camera,
+    const Options& options,
+    const std::vector<MockVideoFrame::Buffer>& frames,
+    Clock::time_point epoch,
+    Clock::time_point start,
+    Clock::time_point deadline)
+{
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / options.fps));
+
+    for (int64_t i = 0; ; ++i)
+    {
+        const Clock::time_point due = start + interval * i;
+        if (due >= deadline)
+            break;
+        std::this_thread::sleep_until(due);
+
+        const Clock::time_point now = Clock::now();
+        if (now - due > interval)
+            ++camera->lateFrameCount;
+
+        const auto videoFrame = makePtr<MockVideoFrame>(
+            options.format,
+            options.width,
+            options.height,
+            std::chrono::duration_cast<std::chrono::microseconds>(now - epoch).count(),
+            frames[(size_t) i % frames.size()]);
+
+        camera->deviceAgent->pushDataPacket(videoFrame.get());
+        camera->pushLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - now).count());
+        ++camera->pushedFrameCount;
+    }
+}
+
+RunResult runCameras(
+    Engine* engine,
+    int cameraCount,
+    const Options& options,
+    const std::vector<MockVideoFrame::Buffer>& frames)
+{
+    const Clock::time_point epoch = Clock::now();
+
+    std::vector<std::unique_ptr<Camera>> cameras;
+    for (int i = 0; i < cameraCount; ++i)
+        cameras.push_back(makeCamera(engine, i, epoch));
+
+    // Cameras are spread over one frame interval instead of firing in lock-step.
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(100);
+    const Clock::time_point deadline = start + std::chrono::seconds(options.durationS);
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / options.fps));
+    for (int i = 0; i < cameraCount; ++i)
+    {
+        Camera* camera = cameras[(size_t) i].get();
+        const Clock::time_point cameraStart = start + interval * i / cameraCount;
+        camera->pump = std::thread(
+            pumpFrames, camera, std::cref(options), std::cref(frames), epoch, cameraStart,
+            deadline);
+    }
+    for (const auto& camera: cameras)
+        camera->pump.join();
+
+    // Let the workers finish the frames they have already dequeued.
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    RunResult result;
+    result.cameraCount = cameraCount;
+
+    int64_t pushed = 0;
+    int64_t late = 0;
+    int64_t analyzed = 0;
+    LatencyHistogram pushLatency;
+    LatencyHistogram metadataLatency;
+    for (const auto& camera: cameras)
+    {
+        pushed += camera->pushedFrameCount;
+        late += camera->lateFrameCount;
+        analyzed += camera->sink->objectPacketCount();
+        result.pushP99Us =
+            std::max(result.pushP99Us, camera->pushLatency.valueAtPercentileUs(99.0));
+        result.metadataP50Us = std::max(
+            result.metadataP50Us, camera->sink->frameToMetadataLatency().valueAtPercentileUs(50.0));
+        result.metadataP99Us = std::max(
+            result.metadataP99Us, camera->sink->frameToMetadataLatency().valueAtPercentileUs(99.0));
+        result.warningCount += camera->sink->warningCount();
+        result.errorCount += camera->sink->errorCount();
+    }
+
+    const double expectedAnalyzed = (double) pushed / kDetectionFramePeriod;
+    result.achievedFps = (double) pushed / cameraCount / options.durationS;
+    result.dropPercent = expectedAnalyzed > 0.0
+        ? std::max(0.0, 100.0 * (1.0 - (double) analyzed / expectedAnalyzed))
+        : 100.0;
+    result.latePercent = pushed > 0 ? 100.0 * (double) late / (double) pushed : 0.0;
+    result.sustained = result.dropPercent <= options.maxDropPercent && result.latePercent <= 1.0;
+
+    // Agents are released before the next run starts; each destructor waits for its task on the
+    // shared executor to finish.
+    for (auto& camera: cameras)
+        camera->deviceAgent.reset();
+    return result;
+}
+
+void printResultHeader()
+{
+    std::printf("%8s %9s %8s %8s %11s %13s %13s %6s %6s %s\n",
+        "cameras", "fps/cam", "drop,%", "late,%", "push p99,us", "metadata p50", "metadata p99",
+        "warn", "error", "");
+}
+
+void printResult(const RunResult& r)
+{
+    std::printf("%8d %9.1f %8.1f %8.1f %11lld %13lld %13lld %6lld %6lld %s\n",
+        r.cameraCount, r.achievedFps, r.dropPercent, r.latePercent,
+        (long long) r.pushP99Us, (long long) r.metadataP50Us, (long long) r.metadataP99Us,
+        (long long) r.warningCount, (long long) r.errorCount,
+        r.sustained ? "ok" : "OVERLOADED");
+    std::fflush(stdout);
+}
+
+int run(const Options& options)
+{
+    const std::vector<MockVideoFrame::Buffer> frames = options.inputPath.empty()
+        ? makeSyntheticFrameBuffers(options.format, options.width, options.height)
+        : loadRawFrameBuffers(options.inputPath, options.format, options.width, options.height);
+
+    std::unique_ptr<MockInferServer> server;
+    if (options.useMock)
+    {
+        server = std::make_unique<MockInferServer>(options.server);
+        server->start();
+    }
+
+    const auto engine = makePtr<Engine>(std::filesystem::temp_directory_path());
+    const auto engineSettings = makePtr<StringMap>();
+    engineSettings->setItem("inferencesPerSecond", std::to_string(options.inferencesPerSecond));
+    engine->setSettings(engineSettings.get());
+
+    std::printf("%dx%d frames at %.1f fps per camera, %d s per run\n\n",
+        options.width, options.height, options.fps, options.durationS);
+    printResultHeader();
+
+    if (!options.ramp)
+    {
+        const RunResult result = runCameras(engine.get(), options.cameraCount, options, frames);
+        printResult(result);
+        return result.sustained ? 0 : 3;
+    }
+
+    int sustainedCameraCount = 0;
+    for (int count = options.rampStep; count <= options.cameraCount; count += options.rampStep)
+    {
+        const RunResult result = runCameras(engine.get(), count, options, frames);
+        printResult(result);
+        if (!result.sustained)
+            break;
+        sustainedCameraCount = count;
+    }
+    std::printf("\nSustained: %d camera(s)\n", sustainedCameraCount);
+    return 0;
+}
+
+} // namespace
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
+
+int main(int argc, char** argv)
+{
+    using namespace sample_company::vms_server_plugins::opencv_object_detection::perf;
+
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    try
+    {
+        return run(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "load_test: " << e.what() << std::endl;
+        return 1;
+    }
+}
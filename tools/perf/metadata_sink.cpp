@@ -0,0 +1,70 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "metadata_sink.h"
+
+#include <nx/sdk/analytics/i_event_metadata_packet.h>
+#include <nx/sdk/analytics/i_object_metadata_packet.h>
+#include <nx/sdk/i_plugin_diagnostic_event.h>
+#include <nx/sdk/ptr.h>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+using namespace nx::sdk;
+using namespace nx::sdk::analytics;
+
+MetadataSink::MetadataSink(Clock::time_point epoch):
+    m_epoch(epoch)
+{
+}
+
+void MetadataSink::handleMetadata(IMetadataPacket* metadataPacket)
+{
+    if (!metadataPacket)
+        return;
+
+    // Like the Server, do not keep the packet: ObjectMetadataBuilder reuses objects only after
+    // their packet has been released.
+    if (const auto objectPacket = metadataPacket->queryInterface<IObjectMetadataPacket>())
+    {
+        m_objectPacketCount.fetch_add(1, std::memory_order_relaxed);
+        m_objectCount.fetch_add(objectPacket->count(), std::memory_order_relaxed);
+
+        const int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - m_epoch).count();
+        m_frameToMetadataLatency.record(nowUs - objectPacket->timestampUs());
+    }
+    else if (metadataPacket->queryInterface<IEventMetadataPacket>())
+    {
+        m_eventPacketCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MetadataSink::handlePluginDiagnosticEvent(IPluginDiagnosticEvent* event)
+{
+    if (!event)
+        return;
+
+    switch (event->level())
+    {
+        case IPluginDiagnosticEvent::Level::warning:
+            m_warningCount.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case IPluginDiagnosticEvent::Level::error:
+            m_errorCount.fetch_add(1, std::memory_order_relaxed);
+            break;
+        default:
+            break;
+    }
+}
+
+void MetadataSink::pushManifest(const IString* /*manifest*/)
+{
+}
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
@@ -0,0 +1,60 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <nx/sdk/analytics/i_device_agent.h>
+#include <nx/sdk/helpers/ref_countable.h>
+
+#include "latency_histogram.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+/**
+ * DeviceAgent handler standing in for the Server: counts the metadata packets and diagnostic
+ * events a DeviceAgent pushes. Called from the DeviceAgent worker thread while the load test
+ * reads the counters, so all of them are atomic.
+ *
+ * Frame timestamps are expected to be microseconds since `epoch`, which lets the sink measure
+ * the time from pushing a frame to receiving its object metadata.
+ */
+class MetadataSink: public nx::sdk::RefCountable<nx::sdk::analytics::IDeviceAgent::IHandler>
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+public:
+    explicit MetadataSink(Clock::time_point epoch);
+
+    virtual void handleMetadata(nx::sdk::analytics::IMetadataPacket* metadataPacket) override;
+    virtual void handlePluginDiagnosticEvent(nx::sdk::IPluginDiagnosticEvent* event) override;
+    virtual void pushManifest(const nx::sdk::IString* manifest) override;
+
+    int64_t objectPacketCount() const { return m_objectPacketCount.load(); }
+    int64_t objectCount() const { return m_objectCount.load(); }
+    int64_t eventPacketCount() const { return m_eventPacketCount.load(); }
+    int64_t warningCount() const { return m_warningCount.load(); }
+    int64_t errorCount() const { return m_errorCount.load(); }
+
+    const LatencyHistogram& frameToMetadataLatency() const { return m_frameToMetadataLatency; }
+
+private:
+    const Clock::time_point m_epoch;
+    std::atomic<int64_t> m_objectPacketCount{0};
+    std::atomic<int64_t> m_objectCount{0};
+    std::atomic<int64_t> m_eventPacketCount{0};
+    std::atomic<int64_t> m_warningCount{0};
+    std::atomic<int64_t> m_errorCount{0};
+    LatencyHistogram m_frameToMetadataLatency;
+};
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
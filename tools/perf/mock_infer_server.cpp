@@ -0,0 +1,89 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "mock_infer_server.h"
+
+#include <stdexcept>
+
+#include "httplib.h"
+#include "json.hpp"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+using json = nlohmann::json;
+
+MockInferServer::MockInferServer(MockInferServerSettings settings):
+    m_settings(std::move(settings)),
+    m_responseBody(makeResponseBody()),
+    m_server(std::make_unique<httplib::Server>())
+{
+    m_server->Post("/infer",
+        [this](const httplib::Request& /*request*/, httplib::Response& response)
+        {
+            m_requestCount.fetch_add(1, std::memory_order_relaxed);
+            if (m_settings.inferenceLatency.count() > 0)
+                std::this_thread::sleep_for(m_settings.inferenceLatency);
+            response.set_content(m_responseBody, "application/json");
+        });
+    m_server->Get("/health",
+        [](const httplib::Request& /*request*/, httplib::Response& response)
+        {
+            response.set_content(R"({"status":"ok"})", "application/json");
+        });
+}
+
+MockInferServer::~MockInferServer()
+{
+    stop();
+}
+
+void MockInferServer::start()
+{
+    if (!m_server->bind_to_port(m_settings.host, m_settings.port))
+    {
+        throw std::runtime_error("Unable to listen on " + m_settings.host + ":"
+            + std::to_string(m_settings.port) + "; is the Python service running?");
+    }
+    m_thread = std::thread([this]() { m_server->listen_after_bind(); });
+    m_server->wait_until_ready();
+}
+
+void MockInferServer::stop()
+{
+    if (!m_thread.joinable())
+        return;
+    m_server->stop();
+    m_thread.join();
+}
+
+//-------------------------------------------------------------------------------------------------
+// private
+
+std::string MockInferServer::makeResponseBody() const
+{
+    // Boxes in the pixel space of the 640-wide JPEG the plugin sends; ObjectDetector clamps them
+    // to the actual image size.
+    json detections = json::array();
+    for (int i = 0; i < m_settings.detectionCount; ++i)
+    {
+        detections.push_back({
+            {"cls", "person"},
+            {"cls_id", 0},
+            {"score", 0.9},
+            {"x", 20.0 + 60.0 * (i % 10)},
+            {"y", 40.0 + 20.0 * (i / 10)},
+            {"w", 50.0},
+            {"h", 150.0},
+            {"track_id", i + 1},
+            {"fall_detected", false},
+        });
+    }
+    return detections.dump();
+}
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
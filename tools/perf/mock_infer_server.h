@@ -0,0 +1,57 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace httplib { class Server; }
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+struct MockInferServerSettings
+{
+    std::string host = "127.0.0.1";
+    int port = 18000; //< The port ObjectDetector talks to.
+    int detectionCount = 3; //< Persons returned for every frame.
+    std::chrono::microseconds inferenceLatency{0}; //< Simulated model time per request.
+};
+
+/**
+ * Stand-in for the Python service: answers POST /infer with a fixed list of person detections
+ * in the format of python/service.py, and GET /health with 200.
+ */
+class MockInferServer
+{
+public:
+    explicit MockInferServer(MockInferServerSettings settings);
+    ~MockInferServer();
+
+    /** @throws std::runtime_error If the port cannot be bound. */
+    void start();
+    void stop();
+
+    int64_t requestCount() const { return m_requestCount.load(std::memory_order_relaxed); }
+
+private:
+    std::string makeResponseBody() const;
+
+private:
+    const MockInferServerSettings m_settings;
+    const std::string m_responseBody;
+    std::unique_ptr<httplib::Server> m_server;
+    std::thread m_thread;
+    std::atomic<int64_t> m_requestCount{0};
+};
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
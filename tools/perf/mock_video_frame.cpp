@@ -0,0 +1,161 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#include "mock_video_frame.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+MockVideoFrame::MockVideoFrame(
+    Format format,
+    int width,
+    int height,
+    int64_t timestampUs,
+    Buffer buffer)
+    :
+    m_format(format),
+    m_width(width),
+    m_height(height),
+    m_timestampUs(timestampUs),
+    m_buffer(std::move(buffer))
+{
+    if (!m_buffer || m_buffer->size() < frameSize(format, width, height))
+        throw std::invalid_argument("Frame buffer is smaller than the frame.");
+}
+
+size_t MockVideoFrame::frameSize(Format format, int width, int height)
+{
+    const size_t pixels = (size_t) width * (size_t) height;
+    switch (format)
+    {
+        case Format::rgb24:
+        case Format::bgr24:
+            return pixels * 3;
+        case Format::bgra32:
+        case Format::rgba32:
+            return pixels * 4;
+        case Format::yv12:
+            return pixels + pixels / 2;
+    }
+    return 0;
+}
+
+bool MockVideoFrame::formatFromString(const std::string& name, Format* outFormat)
+{
+    if (name == "rgb")
+        *outFormat = Format::rgb24;
+    else if (name == "bgr")
+        *outFormat = Format::bgr24;
+    else if (name == "bgra")
+        *outFormat = Format::bgra32;
+    else if (name == "rgba")
+        *outFormat = Format::rgba32;
+    else if (name == "yv12")
+        *outFormat = Format::yv12;
+    else
+        return false;
+    return true;
+}
+
+int MockVideoFrame::planeCount() const
+{
+    return m_format == Format::yv12 ? 3 : 1;
+}
+
+int MockVideoFrame::dataSize(int plane) const
+{
+    if (plane < 0 || plane >= planeCount())
+        return 0;
+    if (m_format != Format::yv12)
+        return (int) frameSize(m_format, m_width, m_height);
+    return lineSize(plane) * (plane == 0 ? m_height : m_height / 2);
+}
+
+const char* MockVideoFrame::data(int plane) const
+{
+    if (plane < 0 || plane >= planeCount())
+        return nullptr;
+
+    // Planes are contiguous, so data(0) also spans the whole YV12 frame as Frame expects.
+    const char* result = m_buffer->data();
+    for (int i = 0; i < plane; ++i)
+        result += dataSize(i);
+    return result;
+}
+
+int MockVideoFrame::lineSize(int plane) const
+{
+    switch (m_format)
+    {
+        case Format::rgb24:
+        case Format::bgr24:
+            return plane == 0 ? m_width * 3 : 0;
+        case Format::bgra32:
+        case Format::rgba32:
+            return plane == 0 ? m_width * 4 : 0;
+        case Format::yv12:
+            return plane == 0 ? m_width : m_width / 2;
+    }
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// protected
+
+void MockVideoFrame::getMetadataList(
+    nx::sdk::Result<nx::sdk::IList<nx::sdk::analytics::IMetadataPacket>*>* outResult) const
+{
+    *outResult = nullptr;
+}
+
+std::vector<MockVideoFrame::Buffer> makeSyntheticFrameBuffers(
+    MockVideoFrame::Format format, int width, int height, int count)
+{
+    const size_t frameSize = MockVideoFrame::frameSize(format, width, height);
+
+    std::vector<MockVideoFrame::Buffer> result;
+    for (int f = 0; f < count; ++f)
+    {
+        auto buffer = std::make_shared<std::vector<char>>(frameSize);
+        for (size_t i = 0; i < frameSize; ++i)
+        {
+            const size_t x = i % (size_t) width;
+            const size_t y = i / (size_t) width;
+            (*buffer)[i] = (char) ((x + y + (size_t) f * 16) & 0xFF);
+        }
+        result.push_back(std::move(buffer));
+    }
+    return result;
+}
+
+std::vector<MockVideoFrame::Buffer> loadRawFrameBuffers(
+    const std::string& path, MockVideoFrame::Format format, int width, int height)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Unable to open " + path);
+
+    const std::vector<char> data(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const size_t frameSize = MockVideoFrame::frameSize(format, width, height);
+    if (data.size() < frameSize)
+        throw std::runtime_error(path + " does not contain a whole frame");
+
+    std::vector<MockVideoFrame::Buffer> result;
+    for (size_t offset = 0; offset + frameSize <= data.size(); offset += frameSize)
+    {
+        result.push_back(std::make_shared<std::vector<char>>(
+            data.begin() + (ptrdiff_t) offset, data.begin() + (ptrdiff_t) (offset + frameSize)));
+    }
+    return result;
+}
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
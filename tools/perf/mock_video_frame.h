@@ -0,0 +1,90 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nx/sdk/analytics/i_uncompressed_video_frame.h>
+#include <nx/sdk/helpers/ref_countable.h>
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+/**
+ * IUncompressedVideoFrame over a caller-owned buffer, so that recorded or synthetic frames can be
+ * fed to the plugin without a Server. The buffer is shared, not copied: replaying the same frame
+ * many times (or on many simulated cameras) costs no memory.
+ */
+class MockVideoFrame: public nx::sdk::RefCountable<nx::sdk::analytics::IUncompressedVideoFrame>
+{
+public:
+    /** Pixel format codes as interpreted by Frame. */
+    enum class Format
+    {
+        rgb24 = 2,
+        bgr24 = 3,
+        bgra32 = 4,
+        rgba32 = 5,
+        yv12 = 6, //< Contiguous Y, V, U planes.
+    };
+
+    using Buffer = std::shared_ptr<const std::vector<char>>;
+
+public:
+    /** @throws std::invalid_argument If the buffer is smaller than frameSize(). */
+    MockVideoFrame(Format format, int width, int height, int64_t timestampUs, Buffer buffer);
+
+    static size_t frameSize(Format format, int width, int height);
+
+    /** @return False if the name is not one of "rgb", "bgr", "bgra", "rgba", "yv12". */
+    static bool formatFromString(const std::string& name, Format* outFormat);
+
+    virtual int64_t timestampUs() const override { return m_timestampUs; }
+    virtual int width() const override { return m_width; }
+    virtual int height() const override { return m_height; }
+    virtual PixelAspectRatio pixelAspectRatio() const override { return {1, 1}; }
+    virtual PixelFormat pixelFormat() const override { return (PixelFormat) m_format; }
+    virtual int planeCount() const override;
+    virtual int dataSize(int plane) const override;
+    virtual const char* data(int plane) const override;
+    virtual int lineSize(int plane) const override;
+
+protected:
+    virtual void getMetadataList(
+        nx::sdk::Result<nx::sdk::IList<nx::sdk::analytics::IMetadataPacket>*>* outResult)
+        const override;
+
+private:
+    const Format m_format;
+    const int m_width;
+    const int m_height;
+    const int64_t m_timestampUs;
+    const Buffer m_buffer;
+};
+
+/**
+ * Diagonal gradients shifted per frame, so that consecutive JPEGs differ. Valid for every format:
+ * for YV12 the gradient also fills the chroma planes.
+ */
+std::vector<MockVideoFrame::Buffer> makeSyntheticFrameBuffers(
+    MockVideoFrame::Format format, int width, int height, int count = 8);
+
+/**
+ * Splits a raw file of concatenated frames without headers, e.g. made by
+ * `ffmpeg -i clip.mp4 -pix_fmt bgr24 -s 1920x1080 -f rawvideo clip.bgr`. A trailing partial frame
+ * is ignored.
+ * @throws std::runtime_error If the file cannot be read or has no whole frame.
+ */
+std::vector<MockVideoFrame::Buffer> loadRawFrameBuffers(
+    const std::string& path, MockVideoFrame::Format format, int width, int height);
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
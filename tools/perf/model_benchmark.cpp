@@ -0,0 +1,420 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+/**
+ * Throughput and person recall of the native inference service's detector on recorded frames,
+ * to compare a statically quantized INT8 model (tools/quantize_model.py) with its FP32 original:
+ *
+ *     model_benchmark --fp32 yolov8n.onnx --int8 yolov8n_int8.onnx --images frame_samples
+ *
+ * Recall is measured against YOLO-format labels ("class cx cy w h", normalized; class 0 is a
+ * person) in <image stem>.txt next to each image, in --labels, or in the labels/ directory
+ * beside an images/ one. The INT8 model is also scored against the FP32 detections on every
+ * image, which needs no labels.
+ *
+ * Throughput runs the images through --threads workers sharing one YoloDetector with as many
+ * network instances, as the service does with INFERENCE_THREADS.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "latency_histogram.h"
+#include "yolo_detector.h"
+
+namespace sample_company {
+namespace inference_service {
+namespace perf {
+
+namespace {
+
+using LatencyHistogram = vms_server_plugins::opencv_object_detection::LatencyHistogram;
+
+struct Options
+{
+    std::string fp32ModelPath;
+    std::string int8ModelPath; //< Empty: the FP32 model alone is measured.
+    std::string imagesPath;
+    std::string labelsPath; //< Empty: next to the images, or in ../labels.
+    int inputSize = 640;
+    float confidenceThreshold = 0.35F;
+    float iouThreshold = 0.45F;
+    float matchIouThreshold = 0.5F; //< A detection this close to a reference person finds it.
+    int threadCount = 1;
+    int passCount = 3; //< Throughput passes over the images.
+};
+
+struct ValidationImage
+{
+    std::filesystem::path path;
+    cv::Mat image;
+    bool isLabeled = false;
+    std::vector<cv::Rect2f> persons; //< Labeled persons, in pixels.
+};
+
+struct ModelResult
+{
+    std::string name;
+    bool isQuantized = false;
+    double imagesPerSecond = 0;
+    std::unique_ptr<LatencyHistogram> latency = std::make_unique<LatencyHistogram>();
+    std::vector<std::vector<cv::Rect2f>> detections; //< Per image, by decreasing score.
+};
+
+struct MatchScore
+{
+    int referenceCount = 0;
+    int detectionCount = 0;
+    int matchedCount = 0;
+
+    double recall() const { return referenceCount ? (double) matchedCount / referenceCount : 0; }
+    double precision() const { return detectionCount ? (double) matchedCount / detectionCount : 0; }
+};
+
+void printUsage()
+{
+    std::cout <<
+        "Usage: model_benchmark --fp32 <model.onnx> --images <dir> [options]\n"
+        "  --fp32 <file>           FP32 ONNX model, the reference.\n"
+        "  --int8 <file>           INT8 (QDQ) ONNX model to compare with it.\n"
+        "  --images <dir>          Recorded validation frames (.jpg, .jpeg, .png, .bmp).\n"
+        "  --labels <dir>          YOLO-format labels, if not next to the images.\n"
+        "  --input-size <px>       Input size the models were exported with (default 640).\n"
+        "  --confidence <value>    Confidence threshold (default 0.35, as the service).\n"
+        "  --iou <value>           NMS IoU threshold (default 0.45, as the service).\n"
+        "  --match-iou <value>     IoU at which a detection finds a person (default 0.5).\n"
+        "  --threads <n>           Images processed at once (default 1).\n"
+        "  --passes <n>            Throughput passes over the images (default 3).\n";
+}
+
+/** @return False if the arguments are invalid or help was requested. */
+bool parseOptions(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+            return false;
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+
+        const std::string value = argv[++i];
+        if (arg == "--fp32")
+            options->fp32ModelPath = value;
+        else if (arg == "--int8")
+            options->int8ModelPath = value;
+        else if (arg == "--images")
+            options->imagesPath = value;
+        else if (arg == "--labels")
+            options->labelsPath = value;
+        else if (arg == "--input-size")
+            options->inputSize = std::atoi(value.c_str());
+        else if (arg == "--confidence")
+            options->confidenceThreshold = (float) std::atof(value.c_str());
+        else if (arg == "--iou")
+            options->iouThreshold = (float) std::atof(value.c_str());
+        else if (arg == "--match-iou")
+            options->matchIouThreshold = (float) std::atof(value.c_str());
+        else if (arg == "--threads")
+            options->threadCount = std::atoi(value.c_str());
+        else if (arg == "--passes")
+            options->passCount = std::atoi(value.c_str());
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (options->fp32ModelPath.empty() || options->imagesPath.empty())
+    {
+        std::cerr << "--fp32 and --images are required.\n";
+        return false;
+    }
+    if (options->inputSize <= 0 || options->inputSize % 32 != 0 || options->threadCount <= 0
+        || options->passCount <= 0)
+    {
+        std::cerr << "Input size must be a positive multiple of 32, threads and passes "
+            "positive.\n";
+        return false;
+    }
+    return true;
+}
+
+std::filesystem::path labelPathFor(const std::filesystem::path& imagePath, const Options& options)
+{
+    const std::filesystem::path fileName = imagePath.stem().string() + ".txt";
+    if (!options.labelsPath.empty())
+        return std::filesystem::path(options.labelsPath) / fileName;
+
+    const std::filesystem::path besideImage = imagePath.parent_path() / fileName;
+    if (std::filesystem::exists(besideImage) || imagePath.parent_path().filename() != "images")
+        return besideImage;
+    return imagePath.parent_path().parent_path() / "labels" / fileName;
+}
+
+/** @return False if the image has no label file; a file without persons is a labeled image. */
+bool loadLabels(const std::filesystem::path& labelPath, cv::Size imageSize,
+    std::vector<cv::Rect2f>* outPersons)
+{
+    std::ifstream file(labelPath);
+    if (!file)
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream values(line);
+        int classId = -1;
+        float centerX = 0, centerY = 0, width = 0, height = 0;
+        if (!(values >> classId >> centerX >> centerY >> width >> height) || classId != 0)
+            continue;
+        outPersons->emplace_back(
+            (centerX - width / 2) * imageSize.width, (centerY - height / 2) * imageSize.height,
+            width * imageSize.width, height * imageSize.height);
+    }
+    return true;
+}
+
+std::vector<ValidationImage> loadValidationSet(const Options& options)
+{
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry: std::filesystem::directory_iterator(options.imagesPath))
+    {
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return (char) std::tolower(c); });
+        if (extension == ".jpg" || extension == ".jpeg" || extension == ".png"
+            || extension == ".bmp")
+        {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<ValidationImage> result;
+    for (const std::filesystem::path& path: paths)
+    {
+        ValidationImage image;
+        image.path = path;
+        image.image = cv::imread(path.string(), cv::IMREAD_COLOR);
+        if (image.image.empty())
+        {
+            std::cerr << "Skipped unreadable " << path.string() << "\n";
+            continue;
+        }
+        image.isLabeled = loadLabels(
+            labelPathFor(path, options), image.image.size(), &image.persons);
+        result.push_back(std::move(image));
+    }
+    if (result.empty())
+        throw std::runtime_error("No images in " + options.imagesPath);
+    return result;
+}
+
+float iou(const cv::Rect2f& a, const cv::Rect2f& b)
+{
+    const float intersection = (a & b).area();
+    const float unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0 ? intersection / unionArea : 0;
+}
+
+/** Greedy matching in decreasing detection score, as in COCO evaluation. */
+void addMatches(const std::vector<cv::Rect2f>& references,
+    const std::vector<cv::Rect2f>& detections, float matchIouThreshold, MatchScore* score)
+{
+    std::vector<bool> isMatched(references.size(), false);
+    for (const cv::Rect2f& detection: detections)
+    {
+        int bestIndex = -1;
+        float bestIou = matchIouThreshold;
+        for (size_t i = 0; i < references.size(); ++i)
+        {
+            const float value = isMatched[i] ? 0 : iou(detection, references[i]);
+            if (value >= bestIou)
+            {
+                bestIou = value;
+                bestIndex = (int) i;
+            }
+        }
+        if (bestIndex >= 0)
+        {
+            isMatched[(size_t) bestIndex] = true;
+            ++score->matchedCount;
+        }
+    }
+    score->referenceCount += (int) references.size();
+    score->detectionCount += (int) detections.size();
+}
+
+ModelResult runModel(
+    const std::string& name, const std::string& modelPath,
+    const std::vector<ValidationImage>& images, const Options& options)
+{
+    YoloDetector detector(YoloDetectorSettings{modelPath, options.inputSize,
+        options.confidenceThreshold, options.iouThreshold, options.threadCount});
+
+    ModelResult result;
+    result.name = name;
+    result.isQuantized = detector.isQuantizedModel();
+
+    // Accuracy pass; also warms the networks up.
+    for (const ValidationImage& image: images)
+    {
+        std::vector<cv::Rect2f> boxes;
+        for (const PersonDetection& person: detector.detect(image.image))
+            boxes.push_back(person.box);
+        result.detections.push_back(std::move(boxes));
+    }
+
+    const int totalCount = (int) images.size() * options.passCount;
+    std::atomic<int> nextIndex{0};
+    const auto worker =
+        [&]()
+        {
+            for (int i = nextIndex++; i < totalCount; i = nextIndex++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                detector.detect(images[(size_t) i % images.size()].image);
+                result.latency->record(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+            }
+        };
+
+    const auto wallStart = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.threadCount; ++i)
+        threads.emplace_back(worker);
+    for (std::thread& thread: threads)
+        thread.join();
+    const double wallS = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wallStart).count();
+
+    result.imagesPerSecond = totalCount / wallS;
+    return result;
+}
+
+MatchScore scoreAgainstLabels(
+    const ModelResult& model, const std::vector<ValidationImage>& images, const Options& options)
+{
+    MatchScore score;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        if (images[i].isLabeled)
+            addMatches(images[i].persons, model.detections[i], options.matchIouThreshold, &score);
+    }
+    return score;
+}
+
+void printModelRow(const ModelResult& model, const MatchScore* labelScore)
+{
+    std::printf("  %-6s %-5s %9.1f %9.1f %9.1f %9.1f",
+        model.name.c_str(),
+        model.isQuantized ? "int8" : "fp32",
+        model.imagesPerSecond,
+        model.latency->meanUs() / 1000.0,
+        model.latency->valueAtPercentileUs(50.0) / 1000.0,
+        model.latency->valueAtPercentileUs(99.0) / 1000.0);
+    if (labelScore)
+        std::printf(" %8.1f%% %8.1f%%", labelScore->recall() * 100, labelScore->precision() * 100);
+    std::printf("\n");
+}
+
+int run(const Options& options)
+{
+    const std::vector<ValidationImage> images = loadValidationSet(options);
+    const int labeledCount = (int) std::count_if(images.begin(), images.end(),
+        [](const ValidationImage& image) { return image.isLabeled; });
+    int labeledPersonCount = 0;
+    for (const ValidationImage& image: images)
+        labeledPersonCount += (int) image.persons.size();
+
+    std::vector<ModelResult> models;
+    models.push_back(runModel("fp32", options.fp32ModelPath, images, options));
+    if (!options.int8ModelPath.empty())
+        models.push_back(runModel("int8", options.int8ModelPath, images, options));
+
+    std::printf("Images: %zu from %s, %d labeled with %d persons\n",
+        images.size(), options.imagesPath.c_str(), labeledCount, labeledPersonCount);
+    std::printf("Input %dx%d, confidence %.2f, %d threads, %d passes\n",
+        options.inputSize, options.inputSize, options.confidenceThreshold,
+        options.threadCount, options.passCount);
+
+    std::vector<MatchScore> labelScores;
+    for (const ModelResult& model: models)
+        labelScores.push_back(scoreAgainstLabels(model, images, options));
+
+    std::printf("\n  %-6s %-5s %9s %9s %9s %9s", "model", "type", "images/s", "mean,ms",
+        "p50,ms", "p99,ms");
+    if (labeledPersonCount > 0)
+        std::printf(" %9s %9s", "recall", "precision");
+    std::printf("\n");
+    for (size_t i = 0; i < models.size(); ++i)
+        printModelRow(models[i], labeledPersonCount > 0 ? &labelScores[i] : nullptr);
+
+    if (models.size() < 2)
+        return 0;
+
+    MatchScore agreement;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        addMatches(models[0].detections[i], models[1].detections[i],
+            options.matchIouThreshold, &agreement);
+    }
+
+    std::printf("\nINT8 vs FP32: %.2fx images/s", models[1].imagesPerSecond
+        / std::max(models[0].imagesPerSecond, 1e-9));
+    if (labeledPersonCount > 0)
+    {
+        std::printf(", person recall %+.1f pt",
+            (labelScores[1].recall() - labelScores[0].recall()) * 100);
+    }
+    std::printf(", %.1f%% of the %d FP32 persons found\n",
+        agreement.recall() * 100, agreement.referenceCount);
+    return 0;
+}
+
+} // namespace
+
+} // namespace perf
+} // namespace inference_service
+} // namespace sample_company
+
+int main(int argc, char** argv)
+{
+    using namespace sample_company::inference_service::perf;
+
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    try
+    {
+        return run(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "model_benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,262 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+/**
+ * Offline replay benchmark of the plugin frame pipeline, no Server needed:
+ *
+ *     Frame conversion -> encodeFrameToJpeg() -> ObjectDetector::run() against a local mock
+ *     /infer -> ObjectMetadataBuilder::build()
+ *
+ * Frames are synthetic, or replayed from a raw file of concatenated frames (see
+ * loadRawFrameBuffers()), e.g.
+ *
+ *     pipeline_benchmark --input clip.bgr --format bgr --width 1920 --height 1080
+ *
+ * Reports throughput, per-stage and end-to-end latency percentiles, and heap allocations per
+ * frame made by the pipeline thread. The mock service listens on 127.0.0.1:18000 by default
+ * (--port), so the Python service must not be running on that port.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <nx/sdk/ptr.h>
+
+#include "allocation_counter.h"
+#include "frame.h"
+#include "frame_encoder.h"
+#include "inference_router.h"
+#include "latency_histogram.h"
+#include "mock_infer_server.h"
+#include "mock_video_frame.h"
+#include "object_detector.h"
+#include "object_metadata_builder.h"
+#include "pipeline_stats.h"
+
+namespace sample_company {
+namespace vms_server_plugins {
+namespace opencv_object_detection {
+namespace perf {
+
+namespace {
+
+struct Options
+{
+    std::string inputPath; //< Empty: synthetic frames.
+    MockVideoFrame::Format format = MockVideoFrame::Format::yv12;
+    int width = 1920;
+    int height = 1080;
+    int frameCount = 500;
+    int warmupFrameCount = 20;
+    int frameIntervalUs = 66'666; //< Timestamp step; 15 fps.
+    MockInferServerSettings server;
+    std::string jsonPath; //< Empty: no JSON report.
+};
+
+void printUsage()
+{
+    std::cout <<
+        "Usage: pipeline_benchmark [options]\n"
+        "  --input <file>          Raw frames to replay (looped); synthetic frames if omitted.\n"
+        "  --format <name>         rgb, bgr, bgra, rgba or yv12 (default yv12).\n"
+        "  --width <px>            Frame width (default 1920).\n"
+        "  --height <px>           Frame height (default 1080).\n"
+        "  --frames <n>            Measured frames (default 500).\n"
+        "  --warmup <n>            Frames run before measuring (default 20).\n"
+        "  --detections <n>        Persons returned by the mock /infer (default 3).\n"
+        "  --infer-latency-us <us> Simulated inference time of the mock (default 0).\n"
+        "  --port <port>           Mock /infer port (default 18000, used by ObjectDetector).\n"
+        "  --json <file>           Also write the per-stage histograms as JSON.\n";
+}
+
+/** @return False if the arguments are invalid or help was requested. */
+bool parseOptions(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+            return false;
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+
+        const std::string value = argv[++i];
+        if (arg == "--input")
+            options->inputPath = value;
+        else if (arg == "--format")
+        {
+            if (!MockVideoFrame::formatFromString(value, &options->format))
+            {
+                std::cerr << "Unknown format: " << value << "\n";
+                return false;
+            }
+        }
+        else if (arg == "--width")
+            options->width = std::atoi(value.c_str());
+        else if (arg == "--height")
+            options->height = std::atoi(value.c_str());
+        else if (arg == "--frames")
+            options->frameCount = std::atoi(value.c_str());
+        else if (arg == "--warmup")
+            options->warmupFrameCount = std::atoi(value.c_str());
+        else if (arg == "--detections")
+            options->server.detectionCount = std::atoi(value.c_str());
+        else if (arg == "--infer-latency-us")
+            options->server.inferenceLatency = std::chrono::microseconds(std::atoll(value.c_str()));
+        else if (arg == "--port")
+            options->server.port = std::atoi(value.c_str());
+        else if (arg == "--json")
+            options->jsonPath = value;
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+    }
+
+    // YV12 chroma planes need even dimensions.
+    if (options->width <= 1 || options->height <= 1 || options->width % 2 != 0
+        || options->height % 2 != 0 || options->frameCount <= 0 || options->warmupFrameCount < 0)
+    {
+        std::cerr << "Width and height must be positive and even, frames positive.\n";
+        return false;
+    }
+    return true;
+}
+
+void printHistogramRow(const char* name, const LatencyHistogram& histogram)
+{
+    std::printf("  %-16s %9lld %10.1f %9lld %9lld %9lld %9lld\n",
+        name,
+        (long long) histogram.count(),
+        histogram.meanUs(),
+        (long long) histogram.valueAtPercentileUs(50.0),
+        (long long) histogram.valueAtPercentileUs(90.0),
+        (long long) histogram.valueAtPercentileUs(99.0),
+        (long long) histogram.maxUs());
+}
+
+int run(const Options& options)
+{
+    const std::vector<MockVideoFrame::Buffer> frames = options.inputPath.empty()
+        ? makeSyntheticFrameBuffers(options.format, options.width, options.height)
+        : loadRawFrameBuffers(options.inputPath, options.format, options.width, options.height);
+
+    MockInferServer server(options.server);
+    server.start();
+
+    // The detector goes wherever its router says; without one it would use 127.0.0.1:18000.
+    const auto inferenceRouter = std::make_shared<InferenceRouter>();
+    inferenceRouter->setEndpoints({ServiceEndpoint{options.server.host, options.server.port}});
+    ObjectDetector objectDetector(/*modelPath*/ "", inferenceRouter);
+    ObjectMetadataBuilder objectMetadataBuilder;
+    PipelineStats stats;
+    LatencyHistogram endToEnd;
+
+    const auto runFrame =
+        [&](int index, PipelineStats* frameStats, LatencyHistogram* frameLatency)
+        {
+            const auto videoFrame = nx::sdk::makePtr<MockVideoFrame>(
+                options.format,
+                options.width,
+                options.height,
+                /*timestampUs*/ (int64_t) index * options.frameIntervalUs,
+                frames[(size_t) index % frames.size()]);
+
+            const auto start = PipelineStats::Clock::now();
+            const Frame frame(videoFrame.get(), index);
+            if (frameStats)
+                frameStats->record(PipelineStage::frameConversion, start);
+
+            const std::vector<uint8_t> jpegBytes = encodeFrameToJpeg(frame, 640, frameStats);
+            const DetectionList detections =
+                objectDetector.run("benchmark", jpegBytes, frameStats);
+
+            const auto buildStart = PipelineStats::Clock::now();
+            objectMetadataBuilder.build(detections, frame.timestampUs);
+            if (frameStats)
+            {
+                const auto end = frameStats->record(PipelineStage::metadataBuild, buildStart);
+                frameLatency->record(
+                    std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+            }
+        };
+
+    for (int i = 0; i < options.warmupFrameCount; ++i)
+        runFrame(i, nullptr, nullptr);
+
+    const uint64_t allocationsBefore = AllocationCounter::allocationCount();
+    const uint64_t bytesBefore = AllocationCounter::allocatedBytes();
+    const auto wallStart = PipelineStats::Clock::now();
+
+    AllocationCounter::setEnabledForThisThread(true);
+    for (int i = 0; i < options.frameCount; ++i)
+        runFrame(options.warmupFrameCount + i, &stats, &endToEnd);
+    AllocationCounter::setEnabledForThisThread(false);
+
+    const double wallS = std::chrono::duration<double>(
+        PipelineStats::Clock::now() - wallStart).count();
+    const double allocationsPerFrame =
+        (double) (AllocationCounter::allocationCount() - allocationsBefore) / options.frameCount;
+    const double kilobytesPerFrame =
+        (double) (AllocationCounter::allocatedBytes() - bytesBefore) / options.frameCount / 1024.0;
+
+    server.stop();
+
+    std::printf("Frames: %d x %dx%d (%s), %zu distinct, %d detections/frame\n",
+        options.frameCount, options.width, options.height,
+        options.inputPath.empty() ? "synthetic" : options.inputPath.c_str(),
+        frames.size(), options.server.detectionCount);
+    std::printf("Throughput: %.1f frames/s\n", options.frameCount / wallS);
+    std::printf("Allocations: %.1f per frame, %.1f KiB per frame\n",
+        allocationsPerFrame, kilobytesPerFrame);
+    std::printf("\n  %-16s %9s %10s %9s %9s %9s %9s\n",
+        "stage", "count", "mean,us", "p50,us", "p90,us", "p99,us", "max,us");
+    for (int i = 0; i < kPipelineStageCount; ++i)
+    {
+        const auto stage = (PipelineStage) i;
+        if (stats.histogram(stage).count() > 0)
+            printHistogramRow(pipelineStageName(stage), stats.histogram(stage));
+    }
+    printHistogramRow("total", endToEnd);
+
+    if (!options.jsonPath.empty())
+        stats.writeJsonFile("benchmark", options.jsonPath);
+    return 0;
+}
+
+} // namespace
+
+} // namespace perf
+} // namespace opencv_object_detection
+} // namespace vms_server_plugins
+} // namespace sample_company
+
+int main(int argc, char** argv)
+{
+    using namespace sample_company::vms_server_plugins::opencv_object_detection::perf;
+
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    try
+    {
+        return run(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "pipeline_benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+}
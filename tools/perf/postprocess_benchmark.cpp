@@ -0,0 +1,376 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+/**
+ * Cost of turning the raw output of the native inference service's YOLOv8 model into persons:
+ * postprocessYoloOutput() against the scalar loop and cv::dnn::NMSBoxes() it replaces, on
+ * synthetic outputs with 0 to 100 persons:
+ *
+ *     postprocess_benchmark --input-size 640 --classes 80 --iterations 2000
+ *
+ * Each person lights up the anchors around its center on the stride 8 and 16 grids, with jittered
+ * boxes and scores falling off with the distance, as a real model does; the other anchors carry
+ * low background scores. Both paths must keep the same boxes; the target is under 0.2 ms a frame.
+ *
+ * Times are in microseconds with fractions, which LatencyHistogram does not keep.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+
+#include "yolo_postprocess.h"
+
+namespace sample_company {
+namespace inference_service {
+namespace perf {
+
+namespace {
+
+constexpr int kBoxValueCount = 4;
+constexpr int kPersonClassIndex = 0;
+constexpr int kMaxDetections = 300; //< As YoloDetector.
+constexpr double kBudgetUs = 200;
+
+struct Options
+{
+    int inputSize = 640;
+    int classCount = 80; //< 1 for the pose model.
+    int iterationCount = 2000; //< Per person count and path.
+    float confidenceThreshold = 0.35F;
+    float iouThreshold = 0.45F;
+};
+
+struct Timings
+{
+    std::vector<double> us;
+
+    double mean() const
+    {
+        double sum = 0;
+        for (const double value: us)
+            sum += value;
+        return us.empty() ? 0 : sum / us.size();
+    }
+
+    /** @param percentile In [0, 100]. */
+    double atPercentile(double percentile) const
+    {
+        if (us.empty())
+            return 0;
+        std::vector<double> sorted = us;
+        std::sort(sorted.begin(), sorted.end());
+        const size_t index = (size_t) std::ceil(percentile / 100 * sorted.size());
+        return sorted[std::min(sorted.size(), std::max<size_t>(index, 1)) - 1];
+    }
+};
+
+void printUsage()
+{
+    std::cout <<
+        "Usage: postprocess_benchmark [options]\n"
+        "  --input-size <px>       Model input size (default 640, i.e. 8400 anchors).\n"
+        "  --classes <n>           Classes of the model (default 80; 1 for a pose model).\n"
+        "  --iterations <n>        Frames per person count and path (default 2000).\n"
+        "  --confidence <value>    Confidence threshold (default 0.35, as the service).\n"
+        "  --iou <value>           NMS IoU threshold (default 0.45, as the service).\n";
+}
+
+/** @return False if the arguments are invalid or help was requested. */
+bool parseOptions(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+            return false;
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+
+        const std::string value = argv[++i];
+        if (arg == "--input-size")
+            options->inputSize = std::atoi(value.c_str());
+        else if (arg == "--classes")
+            options->classCount = std::atoi(value.c_str());
+        else if (arg == "--iterations")
+            options->iterationCount = std::atoi(value.c_str());
+        else if (arg == "--confidence")
+            options->confidenceThreshold = (float) std::atof(value.c_str());
+        else if (arg == "--iou")
+            options->iouThreshold = (float) std::atof(value.c_str());
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (options->inputSize <= 0 || options->inputSize % 32 != 0 || options->classCount <= 0
+        || options->iterationCount <= 0)
+    {
+        std::cerr << "Input size must be a positive multiple of 32, classes and iterations "
+            "positive.\n";
+        return false;
+    }
+    return true;
+}
+
+/** A [4 + classes, anchors] output as YOLOv8 makes it: grids of strides 8, 16 and 32. */
+class SyntheticOutput
+{
+public:
+    SyntheticOutput(const Options& options, int personCount, unsigned seed):
+        m_classCount(options.classCount),
+        m_random(seed)
+    {
+        for (const int stride: {8, 16, 32})
+        {
+            m_grids.push_back({stride, options.inputSize / stride, m_anchorCount});
+            m_anchorCount += m_grids.back().size * m_grids.back().size;
+        }
+        m_values.resize((size_t) (kBoxValueCount + m_classCount) * m_anchorCount);
+
+        std::uniform_real_distribution<float> position(0, (float) options.inputSize);
+        std::uniform_real_distribution<float> background(0, 0.05F);
+        for (int anchor = 0; anchor < m_anchorCount; ++anchor)
+        {
+            setBox(anchor, position(m_random), position(m_random), 8 + position(m_random) / 8,
+                8 + position(m_random) / 8);
+            for (int classId = 0; classId < m_classCount; ++classId)
+                value(kBoxValueCount + classId, anchor) = background(m_random);
+        }
+
+        std::uniform_real_distribution<float> width(20, 80);
+        for (int i = 0; i < personCount; ++i)
+        {
+            const float personWidth = width(m_random);
+            addPerson(position(m_random), position(m_random), personWidth, personWidth * 2.5F);
+        }
+    }
+
+    const float* data() const { return m_values.data(); }
+    int anchorCount() const { return m_anchorCount; }
+    int classCount() const { return m_classCount; }
+
+private:
+    struct Grid
+    {
+        int stride = 0;
+        int size = 0; //< Cells per side.
+        int firstAnchor = 0;
+    };
+
+    float& value(int row, int anchor) { return m_values[(size_t) row * m_anchorCount + anchor]; }
+
+    void setBox(int anchor, float centerX, float centerY, float width, float height)
+    {
+        value(0, anchor) = centerX;
+        value(1, anchor) = centerY;
+        value(2, anchor) = width;
+        value(3, anchor) = height;
+    }
+
+    void addPerson(float centerX, float centerY, float width, float height)
+    {
+        std::normal_distribution<float> jitter(0, 0.04F);
+        for (const Grid& grid: m_grids)
+        {
+            if (grid.stride > 16)
+                continue;
+
+            // Anchors within a third of the person's width respond, more so near its center.
+            const int radius = std::max(1, (int) (width / 3 / grid.stride));
+            const int cellX = (int) (centerX / grid.stride);
+            const int cellY = (int) (centerY / grid.stride);
+            for (int y = std::max(0, cellY - radius); y <= std::min(grid.size - 1, cellY + radius);
+                ++y)
+            {
+                for (int x = std::max(0, cellX - radius);
+                    x <= std::min(grid.size - 1, cellX + radius); ++x)
+                {
+                    const int anchor = grid.firstAnchor + y * grid.size + x;
+                    const float distance = std::hypot((float) (x - cellX), (float) (y - cellY));
+                    const float score = 0.9F * std::exp(-distance * distance / (radius + 1))
+                        + jitter(m_random);
+                    if (score <= value(kBoxValueCount + kPersonClassIndex, anchor))
+                        continue;
+                    value(kBoxValueCount + kPersonClassIndex, anchor) = score;
+                    setBox(anchor, centerX * (1 + jitter(m_random) / 4),
+                        centerY * (1 + jitter(m_random) / 4), width * (1 + jitter(m_random)),
+                        height * (1 + jitter(m_random)));
+                }
+            }
+        }
+    }
+
+private:
+    const int m_classCount;
+    std::mt19937 m_random;
+    std::vector<Grid> m_grids;
+    int m_anchorCount = 0;
+    std::vector<float> m_values;
+};
+
+/** What YoloDetector did before yolo_postprocess: a scalar loop, then cv::dnn::NMSBoxes(). */
+std::vector<int> postprocessWithOpenCv(const SyntheticOutput& output, const Options& options)
+{
+    const int anchorCount = output.anchorCount();
+    const float* const rows = output.data();
+    const float* const scores = rows + (size_t) (kBoxValueCount + kPersonClassIndex) * anchorCount;
+    const int classRowEnd = kBoxValueCount + output.classCount();
+
+    std::vector<int> anchors;
+    std::vector<cv::Rect2d> boxes;
+    std::vector<float> boxScores;
+    for (int anchor = 0; anchor < anchorCount; ++anchor)
+    {
+        if (scores[anchor] < options.confidenceThreshold)
+            continue;
+
+        bool isPersonBestClass = true;
+        for (int row = kBoxValueCount + 1; row < classRowEnd && isPersonBestClass; ++row)
+            isPersonBestClass = rows[(size_t) row * anchorCount + anchor] <= scores[anchor];
+        if (!isPersonBestClass)
+            continue;
+
+        const float centerX = rows[anchor];
+        const float centerY = rows[(size_t) anchorCount + anchor];
+        const float width = rows[(size_t) 2 * anchorCount + anchor];
+        const float height = rows[(size_t) 3 * anchorCount + anchor];
+        anchors.push_back(anchor);
+        boxes.emplace_back(centerX - width / 2, centerY - height / 2, width, height);
+        boxScores.push_back(scores[anchor]);
+    }
+
+    std::vector<int> kept;
+    cv::dnn::NMSBoxes(boxes, boxScores, options.confidenceThreshold, options.iouThreshold, kept,
+        /*eta*/ 1.0F, kMaxDetections);
+
+    std::vector<int> result;
+    for (const int index: kept)
+        result.push_back(anchors[(size_t) index]);
+    return result;
+}
+
+std::vector<int> postprocessWithSimd(
+    const SyntheticOutput& output, const Options& options, YoloBoxes* boxes)
+{
+    YoloPostprocessSettings settings;
+    settings.classCount = output.classCount();
+    settings.classId = kPersonClassIndex;
+    settings.confidenceThreshold = options.confidenceThreshold;
+    settings.iouThreshold = options.iouThreshold;
+    settings.maxDetections = kMaxDetections;
+
+    std::vector<int> result;
+    for (const int index: postprocessYoloOutput(
+        output.data(), output.anchorCount(), settings, boxes))
+        result.push_back(boxes->anchor[(size_t) index]);
+    return result;
+}
+
+template<typename Postprocess>
+Timings measure(int iterationCount, std::vector<int>* outKeptAnchors, Postprocess postprocess)
+{
+    *outKeptAnchors = postprocess(); //< Also warms the caches up.
+
+    Timings result;
+    result.us.reserve((size_t) iterationCount);
+    for (int i = 0; i < iterationCount; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        postprocess();
+        result.us.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    return result;
+}
+
+void printRow(const char* name, int candidateCount, const std::vector<int>& kept,
+    const Timings& timings, const Timings& reference)
+{
+    std::printf("  %-7s %10d %6zu %9.1f %9.1f %9.1f %8.2fx\n",
+        name, candidateCount, kept.size(),
+        timings.mean(), timings.atPercentile(50), timings.atPercentile(99),
+        reference.mean() / std::max(timings.mean(), 1e-9));
+}
+
+int run(const Options& options)
+{
+    std::printf("Kernels: %s, input %dx%d, %d classes, confidence %.2f, IoU %.2f, "
+        "%d iterations\n",
+        yoloPostprocessInstructionSet(), options.inputSize, options.inputSize,
+        options.classCount, options.confidenceThreshold, options.iouThreshold,
+        options.iterationCount);
+    std::printf("  %-7s %10s %6s %9s %9s %9s %9s\n",
+        "path", "candidates", "kept", "mean,us", "p50,us", "p99,us", "speedup");
+
+    bool isWithinBudget = true;
+    bool isSameResult = true;
+    for (const int personCount: {0, 1, 10, 25, 50, 100})
+    {
+        const SyntheticOutput output(options, personCount, /*seed*/ (unsigned) personCount + 1);
+        std::printf("\n%d persons, %d anchors\n", personCount, output.anchorCount());
+
+        YoloBoxes boxes;
+        std::vector<int> referenceKept;
+        std::vector<int> kept;
+        const Timings reference = measure(options.iterationCount, &referenceKept,
+            [&]() { return postprocessWithOpenCv(output, options); });
+        const Timings timings = measure(options.iterationCount, &kept,
+            [&]() { return postprocessWithSimd(output, options, &boxes); });
+
+        printRow("opencv", (int) boxes.size(), referenceKept, reference, reference);
+        printRow("simd", (int) boxes.size(), kept, timings, reference);
+        if (kept != referenceKept)
+        {
+            std::printf("  The paths kept different boxes.\n");
+            isSameResult = false;
+        }
+        isWithinBudget = isWithinBudget && timings.atPercentile(99) < kBudgetUs;
+    }
+
+    std::printf("\np99 %s %.1f us on every frame; %s results.\n",
+        isWithinBudget ? "within" : "OVER", kBudgetUs, isSameResult ? "same" : "DIFFERENT");
+    return isSameResult ? 0 : 1;
+}
+
+} // namespace
+
+} // namespace perf
+} // namespace inference_service
+} // namespace sample_company
+
+int main(int argc, char** argv)
+{
+    using namespace sample_company::inference_service::perf;
+
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    try
+    {
+        return run(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "postprocess_benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+}
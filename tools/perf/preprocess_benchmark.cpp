@@ -0,0 +1,233 @@
+// Copyright 2018-present Network Optix, Inc. Licensed under MPL 2.0: www.mozilla.org/MPL/2.0/
+
+/**
+ * Cost of building the model input of the native inference service from a decoded BGR frame:
+ * the single-pass packInputTensor() against the OpenCV passes it replaces (cv::resize(),
+ * cv::copyMakeBorder() and cv::dnn::blobFromImage()), at the usual camera resolutions:
+ *
+ *     preprocess_benchmark --input-size 640 --iterations 500
+ *
+ * Each path writes into a buffer allocated once, as the detector does. The largest difference
+ * from the OpenCV result is printed too: it stays within 1/255, the fixed-point rounding of
+ * cv::resize(). The INT8 tensor must equal ONNX QuantizeLinear of the float one exactly; the
+ * benchmark fails otherwise.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "input_tensor.h"
+#include "latency_histogram.h"
+
+namespace sample_company {
+namespace inference_service {
+namespace perf {
+
+namespace {
+
+using LatencyHistogram = vms_server_plugins::opencv_object_detection::LatencyHistogram;
+
+/** Maps the [0, 1] input onto the whole int8 range; a model's input QuantizeLinear has its own. */
+constexpr float kInt8Scale = 1.0F / 255;
+constexpr int kInt8ZeroPoint = -128;
+
+struct Options
+{
+    int inputSize = 640;
+    int iterationCount = 500; //< Per frame size and path.
+};
+
+struct PathResult
+{
+    explicit PathResult(const char* name): name(name) {}
+
+    const char* const name;
+    LatencyHistogram latency;
+};
+
+void printUsage()
+{
+    std::cout <<
+        "Usage: preprocess_benchmark [options]\n"
+        "  --input-size <px>       Model input size (default 640).\n"
+        "  --iterations <n>        Frames packed per frame size and path (default 500).\n";
+}
+
+/** @return False if the arguments are invalid or help was requested. */
+bool parseOptions(int argc, char** argv, Options* options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h")
+            return false;
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+
+        const std::string value = argv[++i];
+        if (arg == "--input-size")
+            options->inputSize = std::atoi(value.c_str());
+        else if (arg == "--iterations")
+            options->iterationCount = std::atoi(value.c_str());
+        else
+        {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (options->inputSize <= 0 || options->inputSize % 32 != 0 || options->iterationCount <= 0)
+    {
+        std::cerr << "Input size must be a positive multiple of 32, iterations positive.\n";
+        return false;
+    }
+    return true;
+}
+
+/** The passes YoloDetector used before packInputTensor(), into a preallocated blob. */
+void packWithOpenCv(const cv::Mat& bgrImage, int inputSize, cv::Mat* letterboxed, cv::Mat* blob)
+{
+    const LetterboxLayout layout = letterboxLayout(bgrImage.size(), inputSize);
+    cv::Mat resized;
+    cv::resize(bgrImage, resized, layout.scaledSize, 0, 0, cv::INTER_LINEAR);
+    cv::copyMakeBorder(resized, *letterboxed,
+        layout.top, inputSize - layout.scaledSize.height - layout.top,
+        layout.left, inputSize - layout.scaledSize.width - layout.left,
+        cv::BORDER_CONSTANT, cv::Scalar(114, 114, 114));
+    cv::dnn::blobFromImage(*letterboxed, *blob, 1.0 / 255.0, cv::Size(), cv::Scalar(),
+        /*swapRB*/ true, /*crop*/ false, CV_32F);
+}
+
+/** ONNX QuantizeLinear: saturate(round(value / scale) + zeroPoint), rounding half to even. */
+int8_t quantizeLinear(float value, float scale, int zeroPoint)
+{
+    const long q = std::lrint(value / scale) + zeroPoint;
+    return (int8_t) std::clamp(q, -128L, 127L);
+}
+
+template<typename Pack>
+void measure(int iterationCount, PathResult* result, Pack pack)
+{
+    pack(); //< Warms the caches and the interpolation tables up.
+    for (int i = 0; i < iterationCount; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        pack();
+        result->latency.record(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+/** @return Whether the INT8 tensor matches the scalar QuantizeLinear of the float one. */
+bool runFrameSize(cv::Size frameSize, const Options& options)
+{
+    // Content does not change the cost of either path; noise makes the difference meaningful.
+    cv::Mat frame(frameSize, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+
+    const int inputSize = options.inputSize;
+    const size_t tensorSize = (size_t) 3 * inputSize * inputSize;
+    cv::Mat letterboxed;
+    cv::Mat blob;
+    std::vector<float> tensor(tensorSize);
+    std::vector<int8_t> tensorInt8(tensorSize);
+
+    PathResult openCv("opencv");
+    PathResult fused("fused");
+    PathResult fusedInt8("int8");
+    measure(options.iterationCount, &openCv,
+        [&]() { packWithOpenCv(frame, inputSize, &letterboxed, &blob); });
+    measure(options.iterationCount, &fused,
+        [&]() { packInputTensor(frame, inputSize, tensor.data()); });
+    measure(options.iterationCount, &fusedInt8,
+        [&]() {
+            packInputTensorInt8(frame, inputSize, kInt8Scale, kInt8ZeroPoint, tensorInt8.data());
+        });
+
+    const float* reference = blob.ptr<float>();
+    float maxDifference = 0;
+    size_t int8MismatchCount = 0;
+    for (size_t i = 0; i < tensorSize; ++i)
+    {
+        maxDifference = std::max(maxDifference, std::abs(tensor[i] - reference[i]));
+        if (tensorInt8[i] != quantizeLinear(tensor[i], kInt8Scale, kInt8ZeroPoint))
+            ++int8MismatchCount;
+    }
+
+    std::printf("\n%dx%d -> %dx%d, largest difference %.4f (%.2f/255), "
+        "%zu INT8 values differ from QuantizeLinear\n",
+        frameSize.width, frameSize.height, inputSize, inputSize,
+        maxDifference, maxDifference * 255, int8MismatchCount);
+    std::printf("  %-7s %9s %9s %9s %9s\n", "path", "mean,ms", "p50,ms", "p99,ms", "speedup");
+    for (const PathResult* path: {&openCv, &fused, &fusedInt8})
+    {
+        std::printf("  %-7s %9.3f %9.3f %9.3f %8.2fx\n",
+            path->name,
+            path->latency.meanUs() / 1000.0,
+            path->latency.valueAtPercentileUs(50.0) / 1000.0,
+            path->latency.valueAtPercentileUs(99.0) / 1000.0,
+            openCv.latency.meanUs() / std::max(path->latency.meanUs(), 1e-9));
+    }
+    return int8MismatchCount == 0;
+}
+
+int run(const Options& options)
+{
+    std::printf("Kernels: %s, OpenCV %s, %d threads for OpenCV, %d iterations\n",
+        inputTensorInstructionSet(), CV_VERSION, cv::getNumThreads(), options.iterationCount);
+
+    bool isInt8Exact = true;
+    for (const cv::Size frameSize: {cv::Size(640, 360), cv::Size(1280, 720), cv::Size(1920, 1080)})
+        isInt8Exact = runFrameSize(frameSize, options) && isInt8Exact;
+
+    if (!isInt8Exact)
+    {
+        std::cerr << "preprocess_benchmark: packInputTensorInt8() does not match QuantizeLinear"
+            << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+} // namespace perf
+} // namespace inference_service
+} // namespace sample_company
+
+int main(int argc, char** argv)
+{
+    using namespace sample_company::inference_service::perf;
+
+    Options options;
+    if (!parseOptions(argc, argv, &options))
+    {
+        printUsage();
+        return 2;
+    }
+
+    try
+    {
+        return run(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "preprocess_benchmark: " << e.what() << std::endl;
+        return 1;
+    }
+}
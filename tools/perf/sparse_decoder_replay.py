@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""
+Replays the decoding sequence of SparseVideoDecoder (the useCompressedFrames build) on real
+libavcodec through PyAV, for machines without the FFmpeg headers to build the plugin with:
+the same send/drain/flush order, skip_frame, lowres, one thread, pts passed with dts unset.
+
+Each encoded frame shows its index as 16 black/white blocks, so every returned frame is checked
+to be the one whose timestamp it carries. Streams: H.264 and HEVC with B frames, and MJPEG at an
+odd size decoded at reduced resolution.
+
+Keep in step with sparse_video_decoder.cpp.
+
+Usage:
+    pip install av numpy
+    python sparse_decoder_replay.py
+"""
+
+import sys
+from fractions import Fraction
+
+import av
+import numpy as np
+
+FRAME_COUNT = 150
+FRAME_DURATION_US = 40_000
+TARGET_WIDTH = 320
+MAX_WANTED_TIMESTAMP_COUNT = 16  # kMaxWantedTimestampCount
+BITS = 16
+
+
+def make_image(index, width, height):
+    image = np.full((height, width, 3), 60, np.uint8)
+    block_width, block_height = width // 8, height // 4
+    for bit in range(BITS):
+        x, y = (bit % 8) * block_width, (bit // 8) * block_height
+        image[y + 4:y + block_height - 4, x + 4:x + block_width - 4] = \
+            235 if (index >> bit) & 1 else 20
+    return image
+
+
+def read_index(image):
+    height, width = image.shape[:2]
+    block_width, block_height = width / 8, height / 4
+    index = 0
+    for bit in range(BITS):
+        x, y = int(((bit % 8) + 0.5) * block_width), int(((bit // 8) + 0.5) * block_height)
+        if image[y, x].mean() > 128:
+            index |= 1 << bit
+    return index
+
+
+def encode(encoder, width, height, options, gop):
+    """Returns (data, timestampUs, isKeyFrame) in decode order, as the Server delivers them."""
+    context = av.CodecContext.create(encoder, "w")
+    context.width, context.height = width, height
+    context.pix_fmt = "yuvj420p" if encoder == "mjpeg" else "yuv420p"
+    context.time_base = Fraction(1, 1_000_000)
+    context.framerate = 1_000_000 // FRAME_DURATION_US
+    context.gop_size = gop
+    context.options = options
+    packets = []
+    for i in range(FRAME_COUNT):
+        frame = av.VideoFrame.from_ndarray(make_image(i, width, height), format="rgb24")
+        frame = frame.reformat(format=context.pix_fmt)
+        frame.pts = i * FRAME_DURATION_US
+        frame.time_base = context.time_base
+        packets += context.encode(frame)
+    packets += context.encode(None)
+    return [(bytes(p), p.pts, p.is_keyframe) for p in packets]
+
+
+class SparseVideoDecoder:
+    """SparseVideoDecoder::decode(), line by line."""
+
+    def __init__(self, codec, max_lowres):
+        self.codec, self.max_lowres = codec, max_lowres
+        self.intra_only = codec == "mjpeg"
+        self.context = None
+        self.lowres = 0
+        self.stream_size = (0, 0)
+        self.is_waiting_for_key_frame = True
+        self.is_key_frame_mode = False
+        self.wanted_timestamps = []
+
+    def decode(self, data, timestamp_us, is_key_frame, is_wanted, is_key_frame_mode, size):
+        result = []
+        if is_key_frame_mode != self.is_key_frame_mode:
+            self.is_key_frame_mode = is_key_frame_mode
+            if not is_key_frame_mode:
+                self.is_waiting_for_key_frame = True
+        if is_key_frame:
+            lowres = self.lowres_for(size[0])
+            if self.context is None or lowres != self.lowres:
+                self.open(lowres)
+            self.is_waiting_for_key_frame = False
+            self.stream_size = size
+        if self.context is None or self.is_waiting_for_key_frame \
+                or (self.is_key_frame_mode and not is_key_frame):
+            return result
+        if not is_wanted and (self.is_key_frame_mode or self.intra_only):
+            return result
+        if is_wanted:
+            self.wanted_timestamps.append(timestamp_us)
+            del self.wanted_timestamps[:-MAX_WANTED_TIMESTAMP_COUNT]
+        self.context.skip_frame = "DEFAULT" if is_wanted else "NONREF"
+        packet = av.Packet(data)
+        packet.pts = timestamp_us
+        packet.is_keyframe = is_key_frame
+        frames = list(self.context.decode(packet))
+        if self.is_key_frame_mode:
+            frames += self.context.decode(None)
+        for frame in frames:
+            self.receive_frame(frame, result)
+        if self.is_key_frame_mode:
+            self.context.flush_buffers()
+        return result
+
+    def open(self, lowres):
+        self.context = av.CodecContext.create(self.codec, "r")
+        self.context.thread_count = 1
+        self.context.options = {"lowres": str(lowres)}
+        self.lowres = lowres
+        self.wanted_timestamps = []
+
+    def lowres_for(self, width):
+        lowres = 0
+        while lowres < self.max_lowres and (width >> (lowres + 1)) >= TARGET_WIDTH:
+            lowres += 1
+        return lowres
+
+    def receive_frame(self, frame, result):
+        timestamp_us = frame.pts
+        is_wanted = timestamp_us in self.wanted_timestamps
+        self.wanted_timestamps = [t for t in self.wanted_timestamps if t > timestamp_us]
+        if is_wanted:
+            size = self.stream_size if self.lowres > 0 else (frame.width, frame.height)
+            result.append((timestamp_us, frame, size))
+
+
+def run(name, encoder, codec, width, height, options, gop, max_lowres, schedule):
+    decoder = SparseVideoDecoder(codec, max_lowres)
+    wanted, returned, wrong_content, wrong_size, waited = set(), [], 0, 0, 0
+    packets = encode(encoder, width, height, options, gop)
+    for n, (data, timestamp_us, is_key_frame) in enumerate(packets):
+        is_key_frame_mode, is_wanted = schedule(n, timestamp_us // FRAME_DURATION_US)
+        frames = decoder.decode(data, timestamp_us, is_key_frame, is_wanted, is_key_frame_mode,
+            (width, height))
+        if is_wanted and (not is_key_frame_mode or is_key_frame):
+            # Leaving key frame mode, the frames up to the next key frame are skipped on purpose.
+            if decoder.is_waiting_for_key_frame:
+                waited += 1
+            else:
+                wanted.add(timestamp_us)
+        for frame_timestamp_us, frame, size in frames:
+            if read_index(frame.to_ndarray(format="rgb24")) != \
+                    frame_timestamp_us // FRAME_DURATION_US:
+                wrong_content += 1
+            if size != (width, height):
+                wrong_size += 1
+            returned.append(frame_timestamp_us)
+    # The last frames are still held in the decoder for reordering at the end of the stream.
+    missing = sorted(t // FRAME_DURATION_US
+        for t in wanted - set(returned) - set(sorted(wanted)[-6:]))
+    duplicate_count = len(returned) - len(set(returned))
+    print(f"{name:32s} wanted {len(wanted):3d}, returned {len(returned):3d}, "
+        f"waited for a key frame {waited:2d}, wrong content {wrong_content}, "
+        f"wrong size {wrong_size}, duplicates {duplicate_count}, missing {missing[:10]}")
+    return not missing and not wrong_content and not wrong_size and not duplicate_count
+
+
+def every(k):
+    return lambda n, i: (False, i % k == 0)
+
+
+def b_and_p_frames(n, i):
+    # A B frame is decoded after the P frame following it: both wanted.
+    return False, i % 4 in (0, 1)
+
+
+def key_frame_mode_back_and_forth(n, i):
+    # The mode follows the arrival of packets (decode order), as it does in the DeviceAgent.
+    is_key_frame_mode = (n // 45) % 2 == 1
+    return is_key_frame_mode, (True if is_key_frame_mode else i % 3 == 1)
+
+
+def main():
+    x264 = {"bf": "3", "preset": "veryfast", "x264-params": "b-pyramid=normal:scenecut=0"}
+    x265 = {"preset": "ultrafast", "x265-params": "bframes=3:scenecut=0:log-level=error"}
+    streams = [
+        ("H.264 B frames", "libx264", "h264", 640, 360, x264, 30, 0),
+        ("HEVC B frames", "libx265", "hevc", 640, 360, x265, 30, 0),
+        ("MJPEG 1281x721 lowres", "mjpeg", "mjpeg", 1281, 721, {}, 1, 3),
+    ]
+    schedules = [
+        ("every 5", every(5)),
+        ("B and P", b_and_p_frames),
+        ("all", every(1)),
+        ("key frame mode", key_frame_mode_back_and_forth),
+    ]
+    ok = True
+    for stream_name, encoder, codec, width, height, options, gop, max_lowres in streams:
+        for schedule_name, schedule in schedules:
+            ok = run(f"{stream_name} / {schedule_name}", encoder, codec, width, height, options,
+                gop, max_lowres, schedule) and ok
+    print("OK" if ok else "FAILED")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Statically quantize a YOLOv8 model to INT8 for the CPU inference services.
+
+The FP32 ONNX model (exported here from a .pt if needed) is quantized with ONNX Runtime to the
+QDQ format, which both the native service (OpenCV DNN) and python/service.py (ONNX Runtime via
+ultralytics) load. Activation ranges are calibrated on recorded camera frames, preprocessed as
+the services do: letterboxed to the input size, RGB, scaled to [0, 1].
+
+The box decoding of the Detect head (DFL softmax, anchor math, concat) stays FP32: quantizing it
+costs box precision for no measurable speed. Its convolutions are quantized.
+
+Run:
+    pip install ultralytics onnx onnxruntime opencv-python
+    python tools/quantize_model.py --model yolov8n.pt --images frame_samples \\
+        --output yolov8n_int8.onnx
+
+Then compare it with the FP32 model on the same frames (tools/perf, buildBenchmarks=ON):
+    model_benchmark --fp32 yolov8n.onnx --int8 yolov8n_int8.onnx --images frame_samples
+"""
+import argparse
+import glob
+import os
+import random
+import re
+import sys
+import tempfile
+
+import cv2
+import numpy as np
+
+IMAGE_PATTERNS = ("*.jpg", "*.jpeg", "*.png", "*.bmp")
+
+
+def export_onnx(model_path: str, imgsz: int, dynamic: bool) -> str:
+    """Exports a .pt model to ONNX next to it, as the native service expects it."""
+    import torch
+
+    # Same PyTorch 2.6 workaround as python/service.py.
+    original_torch_load = torch.load
+
+    def patched_torch_load(f, *args, **kwargs):
+        kwargs.setdefault("weights_only", False)
+        return original_torch_load(f, *args, **kwargs)
+
+    torch.load = patched_torch_load
+    try:
+        from ultralytics import YOLO
+        # Opset 13 is the first with per-channel QuantizeLinear / DequantizeLinear.
+        return YOLO(model_path).export(format="onnx", imgsz=imgsz, opset=13, dynamic=dynamic, simplify=True)
+    finally:
+        torch.load = original_torch_load
+
+
+def letterbox(image: np.ndarray, size: int) -> np.ndarray:
+    """Ultralytics letterbox, as packInputTensor() of the native service, to an NCHW float32 blob."""
+    h, w = image.shape[:2]
+    scale = min(size / w, size / h)
+    new_w, new_h = int(round(w * scale)), int(round(h * scale))
+    if (new_w, new_h) != (w, h):
+        image = cv2.resize(image, (new_w, new_h), interpolation=cv2.INTER_LINEAR)
+    top = int(round((size - new_h) / 2 - 0.1))
+    left = int(round((size - new_w) / 2 - 0.1))
+    image = cv2.copyMakeBorder(image, top, size - new_h - top, left, size - new_w - left,
+                               cv2.BORDER_CONSTANT, value=(114, 114, 114))
+    blob = cv2.cvtColor(image, cv2.COLOR_BGR2RGB).astype(np.float32) / 255.0
+    return blob.transpose(2, 0, 1)[np.newaxis]
+
+
+class FrameCalibrationReader:
+    """Feeds the calibration frames to ONNX Runtime one at a time."""
+
+    def __init__(self, image_paths, input_name: str, imgsz: int):
+        self.image_paths = list(image_paths)
+        self.input_name = input_name
+        self.imgsz = imgsz
+        self.index = 0
+
+    def get_next(self):
+        while self.index < len(self.image_paths):
+            path = self.image_paths[self.index]
+            self.index += 1
+            image = cv2.imread(path)
+            if image is None:
+                print(f"  skipped unreadable {path}")
+                continue
+            return {self.input_name: letterbox(image, self.imgsz)}
+        return None
+
+    def rewind(self):
+        self.index = 0
+
+
+def head_decode_nodes(model) -> list:
+    """Non-convolution nodes of the last /model.N/ block, the Detect (or Pose) head."""
+    indexes = [int(m.group(1)) for node in model.graph.node
+               for m in [re.match(r"^/model\.(\d+)/", node.name)] if m]
+    if not indexes:
+        return []
+    prefix = f"/model.{max(indexes)}/"
+    return [node.name for node in model.graph.node
+            if node.name.startswith(prefix) and node.op_type != "Conv"]
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--model", required=True, help="FP32 .onnx, or .pt to export first")
+    parser.add_argument("--images", required=True, help="Directory of recorded frames for calibration")
+    parser.add_argument("--output", help="INT8 model (default: <model>_int8.onnx)")
+    parser.add_argument("--imgsz", type=int, default=640, help="Input size the model is exported with (YOLO_IMGSZ)")
+    parser.add_argument("--calibration-count", type=int, default=300, help="Frames used for calibration (random subset)")
+    parser.add_argument("--dynamic", action="store_true", help="Export with a dynamic batch (needed by ENABLE_TILING batches)")
+    parser.add_argument("--quantize-head", action="store_true", help="Also quantize the box decoding of the head")
+    parser.add_argument("--method", choices=["minmax", "entropy", "percentile"], default="minmax",
+                        help="Activation range calibration (default minmax)")
+    args = parser.parse_args()
+
+    import onnx
+    from onnxruntime.quantization import (CalibrationMethod, QuantFormat, QuantType, quantize_static)
+    from onnxruntime.quantization.shape_inference import quant_pre_process
+
+    image_paths = sorted(p for pattern in IMAGE_PATTERNS for p in glob.glob(os.path.join(args.images, pattern)))
+    if not image_paths:
+        print(f"No images in {args.images}")
+        return 1
+    random.Random(0).shuffle(image_paths)
+    image_paths = image_paths[:args.calibration_count]
+
+    fp32_path = args.model
+    if fp32_path.endswith(".pt"):
+        print(f"[1] Exporting {fp32_path} to ONNX ({args.imgsz}px, dynamic={args.dynamic})...")
+        fp32_path = export_onnx(fp32_path, args.imgsz, args.dynamic)
+    else:
+        print(f"[1] Using FP32 model {fp32_path}")
+    output_path = args.output or os.path.splitext(fp32_path)[0] + "_int8.onnx"
+
+    with tempfile.TemporaryDirectory() as work_dir:
+        print("[2] Preprocessing the graph (shape inference, constant folding)...")
+        prepared_path = os.path.join(work_dir, "prepared.onnx")
+        quant_pre_process(fp32_path, prepared_path, skip_symbolic_shape=True)
+
+        model = onnx.load(prepared_path)
+        input_name = model.graph.input[0].name
+        excluded = [] if args.quantize_head else head_decode_nodes(model)
+
+        print(f"[3] Calibrating on {len(image_paths)} frames ({args.method}), "
+              f"{len(excluded)} head decoding nodes kept FP32...")
+        quantize_static(
+            prepared_path,
+            output_path,
+            FrameCalibrationReader(image_paths, input_name, args.imgsz),
+            quant_format=QuantFormat.QDQ,
+            activation_type=QuantType.QInt8,
+            weight_type=QuantType.QInt8,
+            per_channel=True,
+            calibrate_method={
+                "minmax": CalibrationMethod.MinMax,
+                "entropy": CalibrationMethod.Entropy,
+                "percentile": CalibrationMethod.Percentile,
+            }[args.method],
+            nodes_to_exclude=excluded,
+        )
+
+    # Ultralytics reads the task, class names and input size from the metadata.
+    fp32_model = onnx.load(fp32_path)
+    int8_model = onnx.load(output_path)
+    del int8_model.metadata_props[:]
+    int8_model.metadata_props.extend(fp32_model.metadata_props)
+    onnx.save(int8_model, output_path)
+
+    print(f"[4] Saved {output_path}: {os.path.getsize(fp32_path) / 1e6:.1f} MB -> "
+          f"{os.path.getsize(output_path) / 1e6:.1f} MB")
+    print(f"    Set MODEL_PATH={output_path} for the service; measure it with model_benchmark.")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())